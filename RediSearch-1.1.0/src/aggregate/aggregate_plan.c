@@ -2,6 +2,7 @@
 #include "reducer.h"
 #include "expr/expression.h"
 #include <commands.h>
+#include <cursor.h>
 #include <util/arr.h>
 #include <ctype.h>
 #include <err.h>
@@ -64,6 +65,23 @@ AggregateStep *newApplyStepArgs(CmdArg *arg, char **err) {
   return AggregatePlan_NewApplyStep(alias ? strdup(alias) : NULL, exp, err);
 }
 
+AggregateStep *newFilterStep(CmdArg *arg, char **err) {
+  if (CMDARG_TYPE(arg) != CmdArg_String) {
+    SET_ERR(err, "Missing or invalid filter expression");
+    return NULL;
+  }
+  AggregateFilterPredicate *preds = AggregateFilter_Parse(CMDARG_STRPTR(arg), err);
+  if (!preds) {
+    return NULL;
+  }
+  AggregateStep *ret = AggregatePlan_NewStep(AggregateStep_Filter);
+  ret->filter = (AggregateFilterStep){
+      .rawExpr = strdup(CMDARG_STRPTR(arg)),
+      .preds = preds,
+  };
+  return ret;
+}
+
 AggregateStep *newSortStep(CmdArg *srt, char **err) {
   CmdArg *by = CmdArg_FirstOf(srt, "by");
   if (!by || CMDARG_ARRLEN(by) == 0) return NULL;
@@ -379,6 +397,13 @@ AggregateSchema AggregatePlan_GetSchema(AggregatePlan *plan, RSSortingTable *tbl
           }
         }
         break;
+      case AggregateStep_Filter:
+        for (size_t i = 0; i < array_len(current->filter.preds); i++) {
+          const char *k = current->filter.preds[i].property.key;
+          arr = AggregateSchema_Set(arr, k, SortingTable_GetFieldType(tbl, k, RSValue_String),
+                                    Property_Field, 0);
+        }
+        break;
       case AggregateStep_Limit:
       default:
         break;
@@ -448,11 +473,16 @@ void plan_setCursor(AggregatePlan *plan, CmdArg *arg) {
 
   CmdArg *tmoarg = CmdArg_FirstOf(arg, "MAXIDLE");
   CmdArg *countarg = CmdArg_FirstOf(arg, "COUNT");
+  CmdArg *prefetcharg = CmdArg_FirstOf(arg, "PREFETCH");
   uint32_t timeout = tmoarg ? CMDARG_INT(tmoarg) : RSGlobalConfig.cursorMaxIdle;
   if (timeout > RSGlobalConfig.cursorMaxIdle) {
     timeout = RSGlobalConfig.cursorMaxIdle;
   }
   plan->cursor.count = countarg ? CMDARG_INT(countarg) : 0;
+  plan->cursor.prefetch = prefetcharg ? CMDARG_INT(prefetcharg) : 0;
+  if (plan->cursor.prefetch > RSCURSORS_MAX_PREFETCH) {
+    plan->cursor.prefetch = RSCURSORS_MAX_PREFETCH;
+  }
 
   plan->hasCursor = 1;
   plan->cursor.maxIdle = timeout;
@@ -493,6 +523,8 @@ int AggregatePlan_Build(AggregatePlan *plan, CmdArg *cmd, char **err) {
       next = newLimit(child, err);
     } else if (!strcasecmp(key, "LOAD")) {
       next = newLoadStep(child, err);
+    } else if (!strcasecmp(key, "FILTER")) {
+      next = newFilterStep(child, err);
     } else if (!strcasecmp(key, "WITHCURSOR")) {
       plan_setCursor(plan, child);
       continue;
@@ -586,6 +618,11 @@ void serializeLoad(AggregateLoadStep *l, char ***v) {
   }
 }
 
+void serializeFilter(AggregateFilterStep *f, char ***v) {
+  arrPushStrdup(v, "FILTER");
+  arrPushStrdup(v, f->rawExpr);
+}
+
 void plan_serializeCursor(AggregatePlan *plan, char ***vec) {
   arrPushStrdup(vec, "WITHCURSOR");
   arrPushStrdup(vec, "COUNT");
@@ -594,6 +631,10 @@ void plan_serializeCursor(AggregatePlan *plan, char ***vec) {
     arrPushStrdup(vec, "MAXIDLE");
     arrPushStrfmt(vec, "%d", plan->cursor.maxIdle);
   }
+  if (plan->cursor.prefetch > 0) {
+    arrPushStrdup(vec, "PREFETCH");
+    arrPushStrfmt(vec, "%d", plan->cursor.prefetch);
+  }
 }
 char **AggregatePlan_Serialize(AggregatePlan *plan) {
   char **vec = array_new(char *, 10);
@@ -637,6 +678,10 @@ char **AggregatePlan_Serialize(AggregatePlan *plan) {
         serializeLoad(&current->load, &vec);
         break;
 
+      case AggregateStep_Filter:
+        serializeFilter(&current->filter, &vec);
+        break;
+
       case AggregateStep_Distribute: {
         arrPushStrdup(&vec, "{{");
         char **sub = AggregatePlan_Serialize(current->dist.plan);
@@ -723,6 +768,10 @@ void AggregateStep_Free(AggregateStep *s) {
       AggregatePlan_Free(s->dist.plan);
       free(s->dist.plan);
       break;
+    case AggregateStep_Filter:
+      free(s->filter.rawExpr);
+      AggregateFilter_Free(s->filter.preds);
+      break;
 
     case AggregateStep_Limit:
     case AggregateStep_Dummy:
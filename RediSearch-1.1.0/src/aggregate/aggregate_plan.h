@@ -3,6 +3,7 @@
 #include <value.h>
 #include <search_options.h>
 #include <aggregate/expr/expression.h>
+#include <aggregate/filter.h>
 
 /* A structure representing an aggregation execution plan and all its various steps.
  * This is used to safely manipulate and validate plans */
@@ -41,6 +42,12 @@ typedef struct {
   char *alias;
 } AggregateApplyStep;
 
+/* Filter step - drop records not matching a set of predicates */
+typedef struct {
+  char *rawExpr;
+  AggregateFilterPredicate *preds;
+} AggregateFilterStep;
+
 /* Schema property kind (not type!) is this a field from the result, a projection or an aggregation?
  */
 typedef enum {
@@ -80,6 +87,7 @@ typedef enum {
   AggregateStep_Limit,
   AggregateStep_Load,
   AggregateStep_Distribute,
+  AggregateStep_Filter,
   AggregateStep_Dummy,  // dummy step representing an empty plan's head
 } AggregateStepType;
 
@@ -98,6 +106,7 @@ typedef struct AggregateStep {
     AggregateSortStep sort;
     AggregateDistributeStep dist;
     AggregateQueryStep query;
+    AggregateFilterStep filter;
   };
   AggregateStepType type;
   struct AggregateStep *next;
@@ -117,6 +126,8 @@ typedef struct AggregatePlan {
   struct {
     size_t count;
     int maxIdle;
+    // number of chunks to read ahead in the background between reads
+    int prefetch;
   } cursor;
 } AggregatePlan;
 
@@ -140,6 +151,10 @@ int AggregateSchema_Contains(AggregateSchema schema, const char *property);
 /* Free the plan resources, not the plan itself */
 void AggregatePlan_Free(AggregatePlan *plan);
 
+void AggregateStep_AddAfter(AggregateStep *step, AggregateStep *add);
+AggregateStep *AggregateStep_Detach(AggregateStep *step);
+AggregateStep *AggregateStep_FirstOf(AggregateStep *start, AggregateStepType t);
+
 /* Print the plan */
 void AggregatePlan_Print(AggregatePlan *plan);
 
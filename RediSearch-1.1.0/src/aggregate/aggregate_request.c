@@ -46,6 +46,7 @@ void Aggregate_BuildSchema() {
       ]
       [SORTBY {nargs} {property} ... ]
       [APPLY {expression} [AS {alias}]]
+      [FILTER {predicate}]
       [LIMIT {count} {offset}]
       ...
       */
@@ -95,6 +96,11 @@ void Aggregate_BuildSchema() {
   CmdSchema_AddPostional(prj, "EXPR", CmdSchema_NewArg('s'), CmdSchema_Required);
   CmdSchema_AddNamed(prj, "AS", CmdSchema_NewArgAnnotated('s', "name"), CmdSchema_Required);
 
+  CmdSchema_AddNamedWithHelp(requestSchema, "FILTER", CmdSchema_NewArgAnnotated('s', "expression"),
+                             CmdSchema_Optional | CmdSchema_Repeating,
+                             "Filter the results with one or more predicates in the form of "
+                             "`@property <op> <value>` joined by &&");
+
   CmdSchema_AddNamed(requestSchema, "LIMIT",
                      CmdSchema_NewTuple("ll", (const char *[]){"offset", "num"}),
                      CmdSchema_Optional | CmdSchema_Repeating);
@@ -108,6 +114,10 @@ void Aggregate_BuildSchema() {
   CmdSchema_AddNamed(cursorSchema, "MAXIDLE", CmdSchema_NewArgAnnotated('l', "idle_timeout"),
                      CmdSchema_Optional);
 
+  CmdSchema_AddNamedWithHelp(cursorSchema, "PREFETCH", CmdSchema_NewArgAnnotated('l', "chunks"),
+                             CmdSchema_Optional,
+                             "Keep reading this many chunks ahead in the background between reads");
+
   CmdSchema_Print(requestSchema);
 }
 
@@ -212,6 +222,9 @@ ResultProcessor *AggregatePlan_BuildProcessorChain(AggregatePlan *plan, RedisSea
           next = buildLoader(next, sctx, &current->load);
         }
         break;
+      case AggregateStep_Filter:
+        next = NewFilterProcessor(sctx, next, current->filter.preds);
+        break;
       case AggregateStep_Distribute:
       case AggregateStep_Dummy:
       case AggregateStep_Query:
@@ -284,6 +297,9 @@ int AggregateRequest_Start(AggregateRequest *req, RedisSearchCtx *sctx, RedisMod
   if (!req->ap.verbatim) {
     Query_Expand(req->parseCtx, opts.expander);
   }
+  // predicates on indexed fields are turned into query filters before we build the iterators
+  AggregatePlan_PushDownFilters(&req->ap, req->parseCtx, sctx->spec);
+
   req->plan = Query_BuildPlan(sctx, req->parseCtx, &opts, Aggregate_BuildProcessorChain, &req->ap,
                               (char **)err);
   if (!req->plan) {
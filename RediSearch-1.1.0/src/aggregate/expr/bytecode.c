@@ -0,0 +1,305 @@
+#include "bytecode.h"
+#include <util/arr.h>
+#include <err.h>
+
+typedef struct {
+  RSExprInstr *code;
+  // next free register and the high watermark, for value and numeric registers
+  uint16_t topVal, maxVal;
+  uint16_t topNum, maxNum;
+} RSExprCompiler;
+
+static inline uint16_t allocVals(RSExprCompiler *c, uint16_t n) {
+  uint16_t r = c->topVal;
+  c->topVal += n;
+  c->maxVal = MAX(c->maxVal, c->topVal);
+  return r;
+}
+
+static inline uint16_t allocNum(RSExprCompiler *c) {
+  uint16_t r = c->topNum++;
+  c->maxNum = MAX(c->maxNum, c->topNum);
+  return r;
+}
+
+static inline void emit(RSExprCompiler *c, RSExprInstr in) {
+  c->code = array_append(c->code, in);
+}
+
+/* Turn an expression node into a number literal, releasing whatever it held before */
+static void foldToNumber(RSExpr *e, double n) {
+  switch (e->t) {
+    case RSExpr_Function:
+      free((char *)e->func.name);
+      RSArgList_Free(e->func.args);
+      break;
+    case RSExpr_Op:
+      RSExpr_Free(e->op.left);
+      RSExpr_Free(e->op.right);
+      break;
+    default:
+      break;
+  }
+  e->t = RSExpr_Literal;
+  e->literal = RS_StaticValue(RSValue_Number);
+  e->literal.numval = n;
+}
+
+/* Evaluate sub-expressions that do not depend on the result. Operators are always numeric and
+ * side effect free. For functions we only fold those returning numbers, since string and array
+ * functions may depend on the result or on the per-query allocator */
+static void foldConstants(RSExpr *e) {
+  switch (e->t) {
+    case RSExpr_Op: {
+      foldConstants(e->op.left);
+      foldConstants(e->op.right);
+      double n1, n2;
+      if (e->op.left->t == RSExpr_Literal && e->op.right->t == RSExpr_Literal &&
+          RSValue_ToNumber(&e->op.left->literal, &n1) &&
+          RSValue_ToNumber(&e->op.right->literal, &n2)) {
+        foldToNumber(e, RSExpr_ArithOp(e->op.op, n1, n2));
+      }
+      break;
+    }
+    case RSExpr_Function: {
+      int allConst = e->func.args->len > 0;
+      for (size_t i = 0; i < e->func.args->len; i++) {
+        foldConstants(e->func.args->args[i]);
+        allConst &= e->func.args->args[i]->t == RSExpr_Literal;
+      }
+      if (!allConst || GetExprType(e, NULL) != RSValue_Number) break;
+
+      RSExprEvalCtx ctx = {.fctx = RS_NewFunctionEvalCtx()};
+      ctx.fctx->res = NULL;
+      RSValue v = RSVALUE_STATIC;
+      char *err = NULL;
+      if (RSExpr_Eval(&ctx, e, &v, &err) == EXPR_EVAL_OK &&
+          RSValue_Dereference(&v)->t == RSValue_Number) {
+        foldToNumber(e, RSValue_Dereference(&v)->numval);
+      }
+      RSValue_Free(&v);
+      ERR_FREE(err);
+      RSFunctionEvalCtx_Free(ctx.fctx);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static int compileNum(RSExprCompiler *c, RSExpr *e, uint16_t dst, char **err);
+
+/* Compile an expression whose boxed result goes into vals[dst] */
+static int compileVal(RSExprCompiler *c, RSExpr *e, uint16_t dst, char **err) {
+  switch (e->t) {
+    case RSExpr_Literal:
+      emit(c, (RSExprInstr){.code = RSXOp_LoadConst, .dst = dst, .val = &e->literal});
+      return 1;
+
+    case RSExpr_Property:
+      emit(c, (RSExprInstr){.code = RSXOp_LoadProp, .dst = dst, .key = &e->property});
+      return 1;
+
+    case RSExpr_Op: {
+      uint16_t n = allocNum(c);
+      if (!compileNum(c, e, n, err)) return 0;
+      emit(c, (RSExprInstr){.code = RSXOp_Box, .dst = dst, .a = n});
+      c->topNum--;
+      return 1;
+    }
+
+    case RSExpr_Function: {
+      uint16_t argc = e->func.args->len;
+      uint16_t base = allocVals(c, argc);
+      for (uint16_t i = 0; i < argc; i++) {
+        if (!compileVal(c, e->func.args->args[i], base + i, err)) return 0;
+      }
+      emit(c, (RSExprInstr){
+                  .code = RSXOp_Call, .dst = dst, .a = base, .b = argc, .fn = e->func.Call});
+      c->topVal -= argc;
+      return 1;
+    }
+  }
+  SET_ERR(err, "Invalid expression type");
+  return 0;
+}
+
+/* Compile an expression whose unboxed numeric result goes into nums[dst] */
+static int compileNum(RSExprCompiler *c, RSExpr *e, uint16_t dst, char **err) {
+  switch (e->t) {
+    case RSExpr_Literal: {
+      double d;
+      if (RSValue_ToNumber(&e->literal, &d)) {
+        emit(c, (RSExprInstr){.code = RSXOp_NumConst, .dst = dst, .num = d});
+        return 1;
+      }
+      // non numeric literals fail at runtime, just like the tree evaluator
+      break;
+    }
+
+    case RSExpr_Property:
+      emit(c, (RSExprInstr){.code = RSXOp_NumProp, .dst = dst, .key = &e->property});
+      return 1;
+
+    case RSExpr_Op: {
+      uint16_t l = allocNum(c);
+      uint16_t r = allocNum(c);
+      if (!compileNum(c, e->op.left, l, err) || !compileNum(c, e->op.right, r, err)) return 0;
+      emit(c, (RSExprInstr){.code = RSXOp_Arith, .op = e->op.op, .dst = dst, .a = l, .b = r});
+      c->topNum -= 2;
+      return 1;
+    }
+
+    case RSExpr_Function:
+      break;
+  }
+
+  uint16_t v = allocVals(c, 1);
+  if (!compileVal(c, e, v, err)) return 0;
+  emit(c, (RSExprInstr){.code = RSXOp_ToNum, .dst = dst, .a = v});
+  c->topVal--;
+  return 1;
+}
+
+/* Resolve property keys to their sorting table index once, so that results that do not have the
+ * property loaded go straight to their sorting vector */
+static void resolveProperties(RSExpr *e, RSSortingTable *tbl) {
+  switch (e->t) {
+    case RSExpr_Property:
+      if (e->property.sortableIdx != RSKEY_NOCACHE) {
+        e->property.sortableIdx = RSSortingTable_GetFieldIdx(tbl, RSKEY(e->property.key));
+      }
+      break;
+    case RSExpr_Op:
+      resolveProperties(e->op.left, tbl);
+      resolveProperties(e->op.right, tbl);
+      break;
+    case RSExpr_Function:
+      for (size_t i = 0; i < e->func.args->len; i++) {
+        resolveProperties(e->func.args->args[i], tbl);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+RSExprProgram *RSExpr_Compile(RSExpr *root, RSSortingTable *tbl, char **err) {
+  foldConstants(root);
+  if (tbl) resolveProperties(root, tbl);
+
+  RSExprCompiler c = {.code = array_new(RSExprInstr, 8)};
+  uint16_t dst = allocVals(&c, 1);
+  if (!compileVal(&c, root, dst, err)) {
+    array_free(c.code);
+    return NULL;
+  }
+
+  RSExprProgram *p = malloc(sizeof(*p));
+  p->root = root;
+  p->code = c.code;
+  p->len = array_len(c.code);
+  p->numVals = c.maxVal;
+  p->numNums = MAX(c.maxNum, 1);
+  return p;
+}
+
+void RSExprProgram_Free(RSExprProgram *p) {
+  if (!p) return;
+  RSExpr_Free(p->root);
+  array_free(p->code);
+  free(p);
+}
+
+/* Get a property of the current result, either from its loaded fields or from its sorting vector.
+ * The sorting table index has been resolved at compile time, unless the key must not be cached */
+static inline RSValue *getProperty(RSExprEvalCtx *ctx, RSKey *k) {
+  SearchResult *r = ctx->r;
+  if (r->fields) {
+    RSValue *v = RSFieldMap_GetByKey(r->fields, k);
+    if (!RSValue_IsNull(v)) return v;
+  }
+  if (r->md && r->md->sortVector) {
+    int idx = k->sortableIdx;
+    if (idx == RSKEY_UNCACHED || idx == RSKEY_NOCACHE) {
+      idx = RSSortingTable_GetFieldIdx(ctx->sortables, RSKEY(k->key));
+      if (k->sortableIdx != RSKEY_NOCACHE) {
+        k->sortableIdx = idx;
+      }
+    }
+    if (RSKEY_ISVALIDIDX(idx) && r->md->sortVector->values[idx]) {
+      return r->md->sortVector->values[idx];
+    }
+  }
+  return RS_NullVal();
+}
+
+int RSExprProgram_Eval(RSExprEvalCtx *ctx, RSExprProgram *p, RSValue *result, char **err) {
+  RSValue vals[p->numVals];
+  double nums[p->numNums];
+  for (uint16_t i = 0; i < p->numVals; i++) {
+    vals[i] = RSVALUE_STATIC;
+  }
+
+  for (const RSExprInstr *in = p->code, *end = p->code + p->len; in < end; ++in) {
+    switch (in->code) {
+      case RSXOp_LoadConst:
+        RSValue_MakeReference(&vals[in->dst], in->val);
+        break;
+
+      case RSXOp_LoadProp:
+        RSValue_MakeReference(&vals[in->dst], getProperty(ctx, in->key));
+        break;
+
+      case RSXOp_Call: {
+        int rc = in->fn(ctx->fctx, &vals[in->dst], &vals[in->a], in->b, err);
+        for (uint16_t i = in->a; i < in->a + in->b; i++) {
+          RSValue_Free(&vals[i]);
+          vals[i] = RSVALUE_STATIC;
+        }
+        if (rc != EXPR_EVAL_OK) goto error;
+        break;
+      }
+
+      case RSXOp_NumConst:
+        nums[in->dst] = in->num;
+        break;
+
+      case RSXOp_NumProp: {
+        RSValue *v = getProperty(ctx, in->key);
+        if (v->t == RSValue_Number) {
+          nums[in->dst] = v->numval;
+        } else if (!RSValue_ToNumber(v, &nums[in->dst])) {
+          goto error;
+        }
+        break;
+      }
+
+      case RSXOp_ToNum: {
+        int ok = RSValue_ToNumber(&vals[in->a], &nums[in->dst]);
+        RSValue_Free(&vals[in->a]);
+        vals[in->a] = RSVALUE_STATIC;
+        if (!ok) goto error;
+        break;
+      }
+
+      case RSXOp_Arith:
+        nums[in->dst] = RSExpr_ArithOp(in->op, nums[in->a], nums[in->b]);
+        break;
+
+      case RSXOp_Box:
+        vals[in->dst] = RS_StaticValue(RSValue_Number);
+        vals[in->dst].numval = nums[in->a];
+        break;
+    }
+  }
+
+  *result = vals[0];
+  return EXPR_EVAL_OK;
+
+error:
+  for (uint16_t i = 0; i < p->numVals; i++) {
+    RSValue_Free(&vals[i]);
+  }
+  return EXPR_EVAL_ERR;
+}
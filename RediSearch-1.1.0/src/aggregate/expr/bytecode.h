@@ -0,0 +1,68 @@
+#ifndef RS_AGG_BYTECODE_H_
+#define RS_AGG_BYTECODE_H_
+#include "expression.h"
+
+/********************************************************************************
+ * Compiled expressions
+ *
+ * Instead of walking the expression tree for every result, APPLY expressions are compiled once
+ * when the plan is built into a flat, register based program. Compilation folds constant
+ * sub-expressions, resolves properties to sorting table indexes, and keeps arithmetic on unboxed
+ * doubles in a separate numeric register file, so only function calls and the final result go
+ * through RSValue boxing.
+ ********************************************************************************/
+
+typedef enum {
+  // vals[dst] = reference to a literal
+  RSXOp_LoadConst,
+  // vals[dst] = reference to a property of the current result
+  RSXOp_LoadProp,
+  // vals[dst] = fn(vals[a] ... vals[a + b - 1])
+  RSXOp_Call,
+  // nums[dst] = immediate number
+  RSXOp_NumConst,
+  // nums[dst] = numeric value of a property of the current result
+  RSXOp_NumProp,
+  // nums[dst] = numeric value of vals[a]
+  RSXOp_ToNum,
+  // nums[dst] = nums[a] <op> nums[b]
+  RSXOp_Arith,
+  // vals[dst] = number value of nums[a]
+  RSXOp_Box,
+} RSExprOpcode;
+
+typedef struct {
+  uint8_t code;
+  // arithmetic operator for RSXOp_Arith
+  unsigned char op;
+  uint16_t dst;
+  uint16_t a;
+  uint16_t b;
+  union {
+    double num;
+    RSValue *val;
+    RSKey *key;
+    RSFunction fn;
+  };
+} RSExprInstr;
+
+typedef struct {
+  // The expression tree. Literals and property keys are referenced by the instructions
+  RSExpr *root;
+  RSExprInstr *code;
+  uint16_t len;
+  uint16_t numVals;
+  uint16_t numNums;
+} RSExprProgram;
+
+/* Compile an expression tree into a program. The program takes ownership of the tree, which is
+ * folded in place. If tbl is not NULL, properties are resolved to their sorting table indexes.
+ * Returns NULL and sets err on failure */
+RSExprProgram *RSExpr_Compile(RSExpr *root, RSSortingTable *tbl, char **err);
+
+/* Run a compiled program on the result in ctx, putting the value in result */
+int RSExprProgram_Eval(RSExprEvalCtx *ctx, RSExprProgram *p, RSValue *result, char **err);
+
+void RSExprProgram_Free(RSExprProgram *p);
+
+#endif
@@ -169,29 +169,7 @@ static int evalOp(RSExprEvalCtx *ctx, RSExprOp *op, RSValue *result, char **err)
     goto cleanup;
   }
 
-  double res;
-  switch (op->op) {
-    case '+':
-      res = n1 + n2;
-      break;
-    case '/':
-      res = n1 / n2;
-      break;
-    case '-':
-      res = n1 - n2;
-      break;
-    case '*':
-      res = n1 * n2;
-      break;
-    case '%':
-      res = (long long)n1 % (long long)n2;
-      break;
-    case '^':
-      res = pow(n1, n2);
-      break;
-    default:
-      res = NAN;
-  }
+  double res = RSExpr_ArithOp(op->op, n1, n2);
 
   result->numval = res;
   result->t = RSValue_Number;
@@ -54,6 +54,26 @@ typedef struct {
   RSFunctionEvalCtx *fctx;
 } RSExprEvalCtx;
 
+/* Apply an arithmetic operator to two numbers */
+static inline double RSExpr_ArithOp(unsigned char op, double n1, double n2) {
+  switch (op) {
+    case '+':
+      return n1 + n2;
+    case '/':
+      return n1 / n2;
+    case '-':
+      return n1 - n2;
+    case '*':
+      return n1 * n2;
+    case '%':
+      return (long long)n1 % (long long)n2;
+    case '^':
+      return pow(n1, n2);
+    default:
+      return NAN;
+  }
+}
+
 #define EXPR_EVAL_ERR 1
 #define EXPR_EVAL_OK 0
 int RSExpr_Eval(RSExprEvalCtx *ctx, RSExpr *e, RSValue *result, char **err);
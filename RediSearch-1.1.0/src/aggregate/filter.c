@@ -0,0 +1,371 @@
+#include "filter.h"
+#include "aggregate_plan.h"
+#include <numeric_filter.h>
+#include <util/arr.h>
+#include <ctype.h>
+#include <err.h>
+
+static inline const char *skipSpaces(const char *p) {
+  while (*p && isspace(*p)) ++p;
+  return p;
+}
+
+static inline int isPropertyChar(char c) {
+  return c && !isspace(c) && !strchr("=!<>&", c);
+}
+
+/* Parse a quoted string literal, unescaping backslashes. Returns the position after the closing
+ * quote, or NULL if the string is not terminated */
+static const char *parseStringLiteral(const char *p, RSValue **v) {
+  char quote = *p++;
+  const char *start = p;
+  while (*p && *p != quote) {
+    if (*p == '\\' && p[1]) ++p;
+    ++p;
+  }
+  if (*p != quote) return NULL;
+
+  char *s = malloc(p - start + 1), *dst = s;
+  for (const char *c = start; c < p; c++) {
+    if (*c == '\\') ++c;
+    *dst++ = *c;
+  }
+  *dst = '\0';
+  *v = RS_StringVal(s, dst - s);
+  return p + 1;
+}
+
+static const char *parseOp(const char *p, AggregateFilterOp *op) {
+  if (!strncmp(p, "==", 2)) {
+    *op = FilterOp_Eq;
+    return p + 2;
+  } else if (!strncmp(p, "!=", 2)) {
+    *op = FilterOp_Ne;
+    return p + 2;
+  } else if (!strncmp(p, "<=", 2)) {
+    *op = FilterOp_Le;
+    return p + 2;
+  } else if (!strncmp(p, ">=", 2)) {
+    *op = FilterOp_Ge;
+    return p + 2;
+  } else if (*p == '<') {
+    *op = FilterOp_Lt;
+    return p + 1;
+  } else if (*p == '>') {
+    *op = FilterOp_Gt;
+    return p + 1;
+  }
+  return NULL;
+}
+
+AggregateFilterPredicate *AggregateFilter_Parse(const char *expr, char **err) {
+  AggregateFilterPredicate *preds = array_new(AggregateFilterPredicate, 2);
+  const char *p = skipSpaces(expr);
+
+  while (1) {
+    if (*p != '@') {
+      FMT_ERR(err, "Expected a property in FILTER near '%s'", p);
+      goto fail;
+    }
+    const char *name = ++p;
+    while (isPropertyChar(*p)) ++p;
+    if (p == name) {
+      FMT_ERR(err, "Missing property name in FILTER near '%s'", name - 1);
+      goto fail;
+    }
+    AggregateFilterPredicate pr = {.property = RS_KEY(strndup(name, p - name))};
+
+    p = skipSpaces(p);
+    const char *opEnd = parseOp(p, &pr.op);
+    if (!opEnd) {
+      FMT_ERR(err, "Invalid operator in FILTER near '%s'", p);
+      free((char *)pr.property.key);
+      goto fail;
+    }
+    p = skipSpaces(opEnd);
+
+    if (*p == '"' || *p == '\'') {
+      const char *end = parseStringLiteral(p, &pr.value);
+      if (!end) {
+        FMT_ERR(err, "Unterminated string in FILTER near '%s'", p);
+        free((char *)pr.property.key);
+        goto fail;
+      }
+      p = end;
+    } else {
+      char *end;
+      double d = strtod(p, &end);
+      if (end == p) {
+        FMT_ERR(err, "Expected a number or a quoted string in FILTER near '%s'", p);
+        free((char *)pr.property.key);
+        goto fail;
+      }
+      pr.value = RS_NumVal(d);
+      p = end;
+    }
+    RSValue_IncrRef(pr.value);
+    preds = array_append(preds, pr);
+
+    p = skipSpaces(p);
+    if (!*p) break;
+    if (strncmp(p, "&&", 2)) {
+      FMT_ERR(err, "Expected '&&' in FILTER near '%s'", p);
+      goto fail;
+    }
+    p = skipSpaces(p + 2);
+  }
+  return preds;
+
+fail:
+  AggregateFilter_Free(preds);
+  return NULL;
+}
+
+void AggregateFilter_Free(AggregateFilterPredicate *preds) {
+  if (!preds) return;
+  for (size_t i = 0; i < array_len(preds); i++) {
+    free((char *)preds[i].property.key);
+    RSValue_Free(preds[i].value);
+  }
+  array_free(preds);
+}
+
+/* Check if a tag field value contains a tag, the same way the tag index splits and normalizes it */
+static int hasTag(RSValue *v, RSValue *tag, char sep) {
+  size_t len, tlen;
+  const char *s = RSValue_StringPtrLen(v, &len);
+  const char *t = RSValue_StringPtrLen(tag, &tlen);
+  if (!s || !t) return 0;
+
+  const char *end = s + len;
+  while (s < end) {
+    const char *e = memchr(s, sep, end - s);
+    if (!e) e = end;
+    const char *b = s;
+    const char *te = e;
+    while (b < te && isspace(*b)) ++b;
+    while (te > b && isspace(te[-1])) --te;
+    if (te - b == tlen && !strncasecmp(b, t, tlen)) return 1;
+    s = e + 1;
+  }
+  return 0;
+}
+
+static int matchPredicate(AggregateFilterPredicate *pr, SearchResult *res, RSSortingTable *tbl) {
+  RSValue *v = SearchResult_GetValue(res, tbl, &pr->property);
+  // missing properties never match
+  if (RSValue_IsNull(v)) return 0;
+
+  if (pr->tagSep && (pr->op == FilterOp_Eq || pr->op == FilterOp_Ne)) {
+    return hasTag(v, pr->value, pr->tagSep) == (pr->op == FilterOp_Eq);
+  }
+
+  int cmp;
+  if (pr->value->t == RSValue_Number) {
+    double d;
+    if (!RSValue_ToNumber(v, &d)) return 0;
+    cmp = d < pr->value->numval ? -1 : (d > pr->value->numval ? 1 : 0);
+  } else {
+    cmp = RSValue_Cmp(v, pr->value);
+  }
+
+  switch (pr->op) {
+    case FilterOp_Eq:
+      return cmp == 0;
+    case FilterOp_Ne:
+      return cmp != 0;
+    case FilterOp_Lt:
+      return cmp < 0;
+    case FilterOp_Le:
+      return cmp <= 0;
+    case FilterOp_Gt:
+      return cmp > 0;
+    case FilterOp_Ge:
+      return cmp >= 0;
+  }
+  return 0;
+}
+
+int AggregateFilter_Match(AggregateFilterPredicate *preds, SearchResult *res,
+                          RSSortingTable *tbl) {
+  for (size_t i = 0; i < array_len(preds); i++) {
+    if (!preds[i].pushedDown && !matchPredicate(&preds[i], res, tbl)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+typedef struct {
+  AggregateFilterPredicate *preds;
+  RSSortingTable *sortables;
+} FilterCtx;
+
+static int filter_Next(ResultProcessorCtx *ctx, SearchResult *res) {
+  RESULTPROCESSOR_MAYBE_RET_EOF(ctx->upstream, res, 1);
+  FilterCtx *fc = ctx->privdata;
+  if (AggregateFilter_Match(fc->preds, res, fc->sortables)) {
+    return RS_RESULT_OK;
+  }
+
+  // the result was counted by the upstream processors, so we take it out of the total
+  if (ctx->qxc) ctx->qxc->totalResults--;
+  RSFieldMap_Free(res->fields, 0);
+  res->fields = NULL;
+  return RS_RESULT_QUEUED;
+}
+
+ResultProcessor *NewFilterProcessor(RedisSearchCtx *sctx, ResultProcessor *upstream,
+                                    AggregateFilterPredicate *preds) {
+  size_t residual = 0;
+  for (size_t i = 0; i < array_len(preds); i++) {
+    if (preds[i].pushedDown) continue;
+    residual++;
+    FieldSpec *fs = sctx && sctx->spec
+                        ? IndexSpec_GetField(sctx->spec, RSKEY(preds[i].property.key),
+                                             strlen(RSKEY(preds[i].property.key)))
+                        : NULL;
+    if (fs && fs->type == FIELD_TAG) {
+      preds[i].tagSep = fs->tagOpts.separator;
+    }
+  }
+  if (!residual) return upstream;
+
+  FilterCtx *fc = malloc(sizeof(*fc));
+  fc->preds = preds;
+  fc->sortables = sctx && sctx->spec ? sctx->spec->sortables : NULL;
+
+  ResultProcessor *rp = NewResultProcessor(upstream, fc);
+  rp->Next = filter_Next;
+  rp->Free = ResultProcessor_GenericFree;
+  return rp;
+}
+
+static int containsProperty(const char **props, const char *k) {
+  for (size_t i = 0; i < array_len(props); i++) {
+    if (!strcasecmp(RSKEY(props[i]), RSKEY(k))) return 1;
+  }
+  return 0;
+}
+
+/* Narrow a numeric range by a single comparison */
+static void narrowRange(NumericFilter *nf, AggregateFilterOp op, double d) {
+  if (op == FilterOp_Gt || op == FilterOp_Ge || op == FilterOp_Eq) {
+    if (d > nf->min || (d == nf->min && op == FilterOp_Gt)) {
+      nf->min = d;
+      nf->inclusiveMin = op != FilterOp_Gt;
+    }
+  }
+  if (op == FilterOp_Lt || op == FilterOp_Le || op == FilterOp_Eq) {
+    if (d < nf->max || (d == nf->max && op == FilterOp_Lt)) {
+      nf->max = d;
+      nf->inclusiveMax = op != FilterOp_Lt;
+    }
+  }
+}
+
+/* Push down the predicates of a single step. Returns 1 if all the remaining predicates can be
+ * evaluated on sortable values only */
+static int pushDownStep(AggregateFilterPredicate *preds, QueryParseCtx *q, IndexSpec *spec,
+                        const char **aliases, const char **loaded) {
+  NumericFilter **ranges = array_new(NumericFilter *, 2);
+  int sortableOnly = 1;
+
+  for (size_t i = 0; i < array_len(preds); i++) {
+    AggregateFilterPredicate *pr = &preds[i];
+    const char *k = RSKEY(pr->property.key);
+    if (containsProperty(aliases, k)) {
+      sortableOnly = 0;
+      continue;
+    }
+    FieldSpec *fs = IndexSpec_GetField(spec, k, strlen(k));
+    if (!fs) {
+      sortableOnly = 0;
+      continue;
+    }
+
+    // a NOINDEX field has no index to filter by, but may still be evaluated on its sortable value
+    if (!FieldSpec_IsIndexable(fs)) {
+      if (!FieldSpec_IsSortable(fs) || containsProperty(loaded, k)) sortableOnly = 0;
+    } else if (fs->type == FIELD_NUMERIC && pr->value->t == RSValue_Number &&
+               pr->op != FilterOp_Ne) {
+      NumericFilter *nf = NULL;
+      for (size_t j = 0; j < array_len(ranges); j++) {
+        if (!strcasecmp(ranges[j]->fieldName, fs->name)) nf = ranges[j];
+      }
+      if (!nf) {
+        nf = NewNumericFilter(NF_NEGATIVE_INFINITY, NF_INFINITY, 1, 1);
+        nf->fieldName = strdup(fs->name);
+        ranges = array_append(ranges, nf);
+      }
+      narrowRange(nf, pr->op, pr->value->numval);
+      pr->pushedDown = 1;
+    } else if (fs->type == FIELD_TAG && pr->op == FilterOp_Eq && RSValue_IsString(pr->value)) {
+      size_t len;
+      const char *tag = RSValue_StringPtrLen(pr->value, &len);
+      Query_SetTagFilter(q, fs, tag, len);
+      pr->pushedDown = 1;
+    } else if (!FieldSpec_IsSortable(fs) || containsProperty(loaded, k)) {
+      sortableOnly = 0;
+    }
+  }
+
+  for (size_t j = 0; j < array_len(ranges); j++) {
+    Query_SetNumericFilter(q, ranges[j]);
+  }
+  array_free(ranges);
+  return sortableOnly;
+}
+
+void AggregatePlan_PushDownFilters(AggregatePlan *plan, QueryParseCtx *q, IndexSpec *spec) {
+  // filter nodes can only be attached to an existing query tree
+  if (!spec || !q || !q->root) return;
+
+  // properties that are re-defined or loaded by earlier steps
+  const char **aliases = array_new(const char *, 4);
+  const char **loaded = array_new(const char *, 4);
+
+  // hoisted filters are moved right after the query step, keeping their relative order
+  AggregateStep *hoistAfter = AggregateStep_FirstOf(plan->head, AggregateStep_Query);
+  if (!hoistAfter) hoistAfter = plan->head;
+
+  AggregateStep *current = plan->head;
+  while (current) {
+    AggregateStep *next = current->next;
+    switch (current->type) {
+      // these change the set or the order of rows, so nothing after them can be pushed down
+      case AggregateStep_Group:
+      case AggregateStep_Sort:
+      case AggregateStep_Limit:
+      case AggregateStep_Distribute:
+        goto done;
+
+      case AggregateStep_Apply:
+        if (current->apply.alias) aliases = array_append(aliases, current->apply.alias);
+        break;
+
+      case AggregateStep_Load:
+        for (int i = 0; i < current->load.keys->len; i++) {
+          loaded = array_append(loaded, current->load.keys->keys[i].key);
+        }
+        break;
+
+      case AggregateStep_Filter:
+        if (pushDownStep(current->filter.preds, q, spec, aliases, loaded) &&
+            current != hoistAfter->next) {
+          AggregateStep_Detach(current);
+          AggregateStep_AddAfter(hoistAfter, current);
+        }
+        if (current->prev == hoistAfter) hoistAfter = current;
+        break;
+
+      default:
+        break;
+    }
+    current = next;
+  }
+
+done:
+  array_free(aliases);
+  array_free(loaded);
+}
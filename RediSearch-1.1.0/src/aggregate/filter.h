@@ -0,0 +1,52 @@
+#ifndef RS_AGG_FILTER_H_
+#define RS_AGG_FILTER_H_
+
+#include <result_processor.h>
+#include <value.h>
+#include <query.h>
+
+struct AggregatePlan;
+
+/* Comparison operators supported by FILTER predicates */
+typedef enum {
+  FilterOp_Eq,
+  FilterOp_Ne,
+  FilterOp_Lt,
+  FilterOp_Le,
+  FilterOp_Gt,
+  FilterOp_Ge,
+} AggregateFilterOp;
+
+/* A single FILTER predicate, in the form of `@property <op> <literal>` */
+typedef struct {
+  RSKey property;
+  AggregateFilterOp op;
+  RSValue *value;
+  // set by the planner if the predicate was pushed down into the index iterators
+  int pushedDown;
+  // if the property is a TAG field, equality means the document has this tag
+  char tagSep;
+} AggregateFilterPredicate;
+
+/* Parse a FILTER expression - one or more predicates joined by `&&`. Returns an array of
+ * predicates that should be freed with AggregateFilter_Free, or NULL and sets err on failure */
+AggregateFilterPredicate *AggregateFilter_Parse(const char *expr, char **err);
+
+void AggregateFilter_Free(AggregateFilterPredicate *preds);
+
+/* Return 1 if the result matches all the predicates that were not pushed down */
+int AggregateFilter_Match(AggregateFilterPredicate *preds, SearchResult *res,
+                          RSSortingTable *tbl);
+
+/* Create a processor that drops results not matching the predicates. If all the predicates were
+ * pushed down to the index there is nothing left to evaluate, and upstream is returned as is */
+ResultProcessor *NewFilterProcessor(RedisSearchCtx *sctx, ResultProcessor *upstream,
+                                    AggregateFilterPredicate *preds);
+
+/* Analyze the FILTER steps of the plan that can be evaluated before anything changes the
+ * documents' properties. Numeric ranges and tag equality on indexed fields are added to the query
+ * as filter nodes. FILTER steps whose remaining predicates only touch sortable fields are moved to
+ * the head of the pipeline, so they are evaluated before any document is loaded */
+void AggregatePlan_PushDownFilters(struct AggregatePlan *plan, QueryParseCtx *q, IndexSpec *spec);
+
+#endif
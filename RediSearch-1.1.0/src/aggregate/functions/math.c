@@ -2,6 +2,8 @@
 #include <aggregate/expr/expression.h>
 #include <math.h>
 #include <err.h>
+#include <util/cmsketch.h>
+#include <aggregate/reducer.h>
 
 /* Template for single argument double to double math function */
 #define NUMERIC_SIMPLE_FUNCTION(f)                                                          \
@@ -28,6 +30,24 @@ NUMERIC_SIMPLE_FUNCTION(sqrt);
 NUMERIC_SIMPLE_FUNCTION(log2);
 NUMERIC_SIMPLE_FUNCTION(exp);
 
+/* cms_count(sketch, value) - the estimated count of a value in a sketch built by the CMS reducer.
+ * The sketch is queried in place, as it is evaluated once per row */
+static int mathfunc_cmsCount(RSFunctionEvalCtx *ctx, RSValue *result, RSValue *argv, int argc,
+                             char **err) {
+  VALIDATE_ARGS("cms_count", 2, 2, err);
+  VALIDATE_ARG_ISSTRING("cms_count", argv, 0);
+
+  size_t len;
+  const char *buf = RSValue_StringPtrLen(RSValue_Dereference(&argv[0]), &len);
+  uint32_t count;
+  if (!CMS_QuerySerialized(buf, len, CMS_ValueHash(&argv[1]), &count)) {
+    RSValue_SetNumber(result, NAN);
+    return EXPR_EVAL_OK;
+  }
+  RSValue_SetNumber(result, count);
+  return EXPR_EVAL_OK;
+}
+
 #define REGISTER_MATHFUNC(name, f) \
   RSFunctionRegistry_RegisterFunction(name, mathfunc_##f, RSValue_Number);
 
@@ -39,4 +59,5 @@ void RegisterMathFunctions() {
   REGISTER_MATHFUNC("sqrt", sqrt);
   REGISTER_MATHFUNC("log2", log2);
   REGISTER_MATHFUNC("exp", exp);
+  RSFunctionRegistry_RegisterFunction("cms_count", mathfunc_cmsCount, RSValue_Number);
 }
\ No newline at end of file
@@ -9,9 +9,10 @@
 #include <ctype.h>
 #include "project.h"
 #include <aggregate/expr/expression.h>
+#include <aggregate/expr/bytecode.h>
 #include <aggregate/functions/function.h>
 typedef struct {
-  RSExpr *exp;
+  RSExprProgram *prog;
   const char *alias;
   RSSortingTable *sortables;
   RSExprEvalCtx ctx;
@@ -28,7 +29,7 @@ void Projector_Free(ResultProcessor *p) {
   ProjectorCtx *pc = p->ctx.privdata;
 
   RSFunctionEvalCtx_Free(pc->ctx.fctx);
-  RSExpr_Free(pc->exp);
+  RSExprProgram_Free(pc->prog);
   free(pc);
   free(p);
 }
@@ -39,7 +40,7 @@ int Projector_Next(ResultProcessorCtx *ctx, SearchResult *res) {
   pc->ctx.r = res;
   pc->ctx.fctx->res = res;
   char *err;
-  int rc = RSExpr_Eval(&pc->ctx, pc->exp, &pc->val, &err);
+  int rc = RSExprProgram_Eval(&pc->ctx, pc->prog, &pc->val, &err);
   if (rc == EXPR_EVAL_OK) {
     RSValue *a = RS_NewValue(RSValue_Null);
     *a = pc->val;
@@ -60,8 +61,12 @@ ResultProcessor *NewProjector(RedisSearchCtx *sctx, ResultProcessor *upstream, c
   ctx->ctx.sctx = sctx;
   ctx->ctx.sortables = sctx && sctx->spec ? sctx->spec->sortables : NULL;
   ctx->ctx.fctx = RS_NewFunctionEvalCtx();
-  ctx->exp = RSExpr_Parse(expr, len, err);
-  if (!ctx->exp) {
+  RSExpr *exp = RSExpr_Parse(expr, len, err);
+  // compile the expression once, so that evaluating it per result does not walk the tree
+  ctx->prog = exp ? RSExpr_Compile(exp, ctx->ctx.sortables, err) : NULL;
+  if (!ctx->prog) {
+    if (exp) RSExpr_Free(exp);
+    RSFunctionEvalCtx_Free(ctx->ctx.fctx);
     free(ctx);
     return NULL;
   }
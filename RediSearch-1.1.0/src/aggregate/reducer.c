@@ -3,6 +3,21 @@
 #include <rmutil/cmdparse.h>
 #include <string.h>
 #include <err.h>
+#include <math.h>
+#include <util/tdigest.h>
+#include <util/cmsketch.h>
+
+/* Parse the optional relative error of COUNT_DISTINCTISH and HLL into HLL precision bits. The
+ * standard error of HLL is 1.04/sqrt(2^bits). Returns 0 for the default precision, -1 on error */
+static int parseHllError(RSValue **args, size_t argc) {
+  if (argc < 2) return 0;
+  double e;
+  if (!RSValue_ToNumber(args[1], &e) || e <= 0 || e >= 1) {
+    return -1;
+  }
+  int bits = (int)ceil(log2((1.04 / e) * (1.04 / e)));
+  return bits < 4 ? 4 : bits > 16 ? 16 : bits;
+}
 
 static Reducer *NewCountArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
                              char **err) {
@@ -67,11 +82,13 @@ static Reducer *NewCountDistinctArgs(RedisSearchCtx *ctx, RSValue **args, size_t
 
 static Reducer *NewCountDistinctishArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc,
                                         const char *alias, char **err) {
-  if (argc != 1 || !RSValue_IsString(args[0])) {
+  int bits;
+  if (argc < 1 || argc > 2 || !RSValue_IsString(args[0]) ||
+      (bits = parseHllError(args, argc)) < 0) {
     SET_ERR(err, "Invalid arguments for COUNT_DISTINCTISH");
     return NULL;
   }
-  return NewCountDistinctish(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)));
+  return NewCountDistinctish(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)), bits);
 }
 
 /* REDUCE FRIST_VALUE {nargs} @property [BY @property DESC|ASC] */
@@ -105,7 +122,7 @@ static Reducer *NewStddevArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc,
 
 static Reducer *NewQuantileArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
                                 char **err) {
-  if (argc != 2 || !RSValue_IsString(args[0])) {
+  if (argc < 2 || argc > 3 || !RSValue_IsString(args[0])) {
     SET_ERR(err, "Invalid arguments for QUANTILE");
     return NULL;
   }
@@ -120,7 +137,65 @@ static Reducer *NewQuantileArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc
   if (pct <= 0 || pct >= 1) {
     SET_ERR(err, "Quantile must be between 0.0 and 1.0 (exclusive) )");
   }
-  return NewQuantile(ctx, property, alias, pct);
+
+  // an explicit compression means we use a t-digest
+  double compression = 0;
+  if (argc == 3 && (!RSValue_ToNumber(args[2], &compression) || compression < 10)) {
+    SET_ERR(err, "Invalid compression for QUANTILE, must be at least 10");
+    return NULL;
+  }
+  return NewQuantile(ctx, property, alias, pct, compression);
+}
+
+/* REDUCE TDIGEST {nargs} @property [compression] */
+static Reducer *NewTDigestArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
+                               char **err) {
+  double compression = TDIGEST_DEFAULT_COMPRESSION;
+  if (argc < 1 || argc > 2 || !RSValue_IsString(args[0]) ||
+      (argc == 2 && (!RSValue_ToNumber(args[1], &compression) || compression < 10))) {
+    SET_ERR(err, "Invalid arguments for TDIGEST");
+    return NULL;
+  }
+  return NewRawTDigest(ctx, RSKEY(RSValue_StringPtrLen(args[0], NULL)), alias, compression);
+}
+
+/* REDUCE TDIGEST_QUANTILE 2 @digest {quantile} */
+static Reducer *NewTDigestQuantileArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc,
+                                       const char *alias, char **err) {
+  double pct;
+  if (argc != 2 || !RSValue_IsString(args[0]) || !RSValue_ToNumber(args[1], &pct) || pct < 0 ||
+      pct > 1) {
+    SET_ERR(err, "Invalid arguments for TDIGEST_QUANTILE");
+    return NULL;
+  }
+  return NewTDigestQuantile(ctx, RSKEY(RSValue_StringPtrLen(args[0], NULL)), alias, pct);
+}
+
+/* REDUCE CMS {nargs} @property [error delta] */
+static Reducer *NewCMSArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
+                           char **err) {
+  double error = CMS_DEFAULT_ERROR, delta = CMS_DEFAULT_DELTA;
+  if ((argc != 1 && argc != 3) || !RSValue_IsString(args[0]) ||
+      (argc == 3 && (!RSValue_ToNumber(args[1], &error) || !RSValue_ToNumber(args[2], &delta)))) {
+    SET_ERR(err, "Invalid arguments for CMS");
+    return NULL;
+  }
+  // make sure the sketch can be created before we start
+  uint32_t width, depth;
+  if (!CMS_DimensionsByError(error, delta, &width, &depth)) {
+    SET_ERR(err, "Invalid error or probability for CMS");
+    return NULL;
+  }
+  return NewCMS(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)), error, delta);
+}
+
+static Reducer *NewCMSSumArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
+                              char **err) {
+  if (argc != 1 || !RSValue_IsString(args[0])) {
+    SET_ERR(err, "Invalid arguments for CMS_SUM");
+    return NULL;
+  }
+  return NewCMSSum(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)));
 }
 
 static Reducer *NewRandomSampleArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc,
@@ -145,11 +220,13 @@ static Reducer *NewRandomSampleArgs(RedisSearchCtx *ctx, RSValue **args, size_t
 
 static Reducer *NewHllArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
                            char **err) {
-  if (argc != 1 || !RSValue_IsString(args[0])) {
+  int bits;
+  if (argc < 1 || argc > 2 || !RSValue_IsString(args[0]) ||
+      (bits = parseHllError(args, argc)) < 0) {
     SET_ERR(err, "Invalid arguments for HLL");
     return NULL;
   }
-  return NewHLL(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)));
+  return NewHLL(ctx, alias, RSKEY(RSValue_StringPtrLen(args[0], NULL)), bits);
 }
 
 static Reducer *NewHllSumArgs(RedisSearchCtx *ctx, RSValue **args, size_t argc, const char *alias,
@@ -183,6 +260,10 @@ static struct {
     {"random_sample", NewRandomSampleArgs, RSValue_Array},
     {"hll", NewHllArgs, RSValue_String},
     {"hll_sum", NewHllSumArgs, RSValue_Number},
+    {"tdigest", NewTDigestArgs, RSValue_String},
+    {"tdigest_quantile", NewTDigestQuantileArgs, RSValue_Number},
+    {"cms", NewCMSArgs, RSValue_String},
+    {"cms_sum", NewCMSSumArgs, RSValue_String},
 
     {NULL, NULL},
 };
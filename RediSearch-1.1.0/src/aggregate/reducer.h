@@ -87,8 +87,8 @@ Reducer *NewMin(RedisSearchCtx *, const char *, const char *);
 Reducer *NewMax(RedisSearchCtx *, const char *, const char *);
 Reducer *NewAvg(RedisSearchCtx *, const char *, const char *);
 Reducer *NewCountDistinct(RedisSearchCtx *, const char *, const char *);
-Reducer *NewCountDistinctish(RedisSearchCtx *, const char *, const char *);
-Reducer *NewQuantile(RedisSearchCtx *, const char *, const char *, double);
+Reducer *NewCountDistinctish(RedisSearchCtx *, const char *, const char *, int bits);
+Reducer *NewQuantile(RedisSearchCtx *, const char *, const char *, double, double compression);
 Reducer *NewStddev(RedisSearchCtx *, const char *, const char *);
 Reducer *GetReducer(RedisSearchCtx *ctx, const char *name, const char *alias, RSValue **args,
                     size_t argc, char **err);
@@ -96,7 +96,17 @@ RSValueType GetReducerType(const char *name);
 Reducer *NewFirstValue(RedisSearchCtx *ctx, const char *key, const char *sortKey, int asc,
                        const char *alias);
 Reducer *NewRandomSample(RedisSearchCtx *sctx, int size, const char *property, const char *alias);
-Reducer *NewHLL(RedisSearchCtx *ctx, const char *alias, const char *key);
+Reducer *NewHLL(RedisSearchCtx *ctx, const char *alias, const char *key, int bits);
 Reducer *NewHLLSum(RedisSearchCtx *ctx, const char *alias, const char *key);
+Reducer *NewRawTDigest(RedisSearchCtx *ctx, const char *property, const char *alias,
+                       double compression);
+Reducer *NewTDigestQuantile(RedisSearchCtx *ctx, const char *property, const char *alias,
+                            double pct);
+Reducer *NewCMS(RedisSearchCtx *ctx, const char *alias, const char *key, double error,
+                double delta);
+Reducer *NewCMSSum(RedisSearchCtx *ctx, const char *alias, const char *key);
+
+/* Hash a value for count-min sketches, by its string representation */
+uint64_t CMS_ValueHash(RSValue *v);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <aggregate/reducer.h>
+#include <util/cmsketch.h>
+#include <util/fnv.h>
+
+uint64_t CMS_ValueHash(RSValue *v) {
+  char buf[128];
+  size_t len;
+  const char *s;
+  v = RSValue_Dereference(v);
+  // numbers are formatted the way we return them, so 5 and "5" are the same value
+  if (v->t == RSValue_Number) {
+    len = snprintf(buf, sizeof(buf), "%.12g", v->numval);
+    s = buf;
+  } else {
+    s = RSValue_ConvertStringPtrLen(v, &len, buf, sizeof(buf));
+  }
+  return fnv_64a_buf((void *)s, len, 0);
+}
+
+typedef struct {
+  const char *key;
+  double error;
+  double delta;
+} cmsParams;
+
+typedef struct {
+  CMSketch *cms;
+  RSKey key;
+  RSSortingTable *sortables;
+} cmsCtx;
+
+static void *cms_NewInstance(ReducerCtx *ctx) {
+  cmsParams *params = ctx->privdata;
+  cmsCtx *cc = ReducerCtx_Alloc(ctx, sizeof(*cc), 1024 * sizeof(*cc));
+  cc->cms = NewCMSketchByError(params->error, params->delta);
+  cc->key = RS_KEY(RSKEY(params->key));
+  cc->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
+  return cc;
+}
+
+static int cms_Add(void *ctx, SearchResult *res) {
+  cmsCtx *cc = ctx;
+  RSValue *v = SearchResult_GetValue(res, cc->sortables, &cc->key);
+  if (!v || v->t == RSValue_Null) {
+    return 1;
+  }
+  if (v->t == RSValue_Array) {
+    for (uint32_t i = 0; i < RSValue_ArrayLen(v); i++) {
+      CMS_Add(cc->cms, CMS_ValueHash(RSValue_ArrayItem(v, i)), 1);
+    }
+  } else {
+    CMS_Add(cc->cms, CMS_ValueHash(v), 1);
+  }
+  return 1;
+}
+
+static int cms_Finalize(void *ctx, const char *key, SearchResult *res) {
+  cmsCtx *cc = ctx;
+  size_t len = 0;
+  char *buf = cc->cms ? CMS_Serialize(cc->cms, &len) : NULL;
+  RSFieldMap_Add(&res->fields, key, buf ? RS_StringVal(buf, len) : RS_NullVal());
+  return 1;
+}
+
+static void cms_FreeInstance(void *p) {
+  cmsCtx *cc = p;
+  CMS_Free(cc->cms);
+}
+
+Reducer *NewCMS(RedisSearchCtx *ctx, const char *alias, const char *key, double error,
+                double delta) {
+  cmsParams *params = malloc(sizeof(*params));
+  params->key = key;
+  params->error = error;
+  params->delta = delta;
+
+  Reducer *r = NewReducer(ctx, params);
+  r->Add = cms_Add;
+  r->Finalize = cms_Finalize;
+  r->NewInstance = cms_NewInstance;
+  r->FreeInstance = cms_FreeInstance;
+  r->Free = Reducer_GenericFree;
+  r->alias = FormatAggAlias(alias, "cms", key);
+  return r;
+}
+
+/* CMS_SUM merges serialized sketches into one, e.g. when collecting them from several shards */
+static void *cmsSum_NewInstance(ReducerCtx *ctx) {
+  cmsCtx *cc = ReducerCtx_Alloc(ctx, sizeof(*cc), 1024 * sizeof(*cc));
+  cc->cms = NULL;
+  cc->key = RS_KEY(RSKEY((char *)ctx->privdata));
+  cc->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
+  return cc;
+}
+
+static int cmsSum_Add(void *ctx, SearchResult *res) {
+  cmsCtx *cc = ctx;
+  RSValue *v = SearchResult_GetValue(res, cc->sortables, &cc->key);
+  if (!v || !RSValue_IsString(v)) {
+    return 0;
+  }
+
+  size_t len;
+  const char *buf = RSValue_StringPtrLen(v, &len);
+  CMSketch *cms = CMS_Deserialize(buf, len);
+  if (!cms) {
+    return 0;
+  }
+  if (!cc->cms) {
+    cc->cms = cms;
+    return 1;
+  }
+  int rc = CMS_Merge(cc->cms, cms);
+  CMS_Free(cms);
+  return rc;
+}
+
+Reducer *NewCMSSum(RedisSearchCtx *ctx, const char *alias, const char *key) {
+  Reducer *r = NewReducer(ctx, (void *)key);
+  r->Add = cmsSum_Add;
+  r->Finalize = cms_Finalize;
+  r->NewInstance = cmsSum_NewInstance;
+  r->FreeInstance = cms_FreeInstance;
+  r->Free = Reducer_GenericFreeWithStaticPrivdata;
+  r->alias = FormatAggAlias(alias, "cms_sum", key);
+  return r;
+}
@@ -4,8 +4,10 @@
 #include <util/fnv.h>
 #include <dep/hll/hll.h>
 #include <rmutil/sds.h>
+#include <util/arr.h>
 
 #define HLL_PRECISION_BITS 8
+#define HLL_MAX_PRECISION_BITS 16
 
 static const int khid = 35;
 KHASH_SET_INIT_INT64(khid);
@@ -72,18 +74,108 @@ Reducer *NewCountDistinct(RedisSearchCtx *ctx, const char *alias, const char *ke
   return r;
 }
 
+/* A HyperLogLog counter that starts out sparse, as in HLL++: until it would take as much memory as
+ * the dense registers, we keep a sorted array of the non-zero registers encoded as
+ * (index << 8 | rank), and only then switch to a regular dense HLL. This keeps many small groups
+ * cheap even with high precision */
+typedef struct {
+  uint8_t bits;
+  // NULL once the counter is dense
+  uint32_t *sparse;
+  struct HLL dense;
+} sparseHLL;
+
+static void sparseHLL_Init(sparseHLL *h, uint8_t bits) {
+  h->bits = bits;
+  h->sparse = array_new(uint32_t, 4);
+  h->dense = (struct HLL){0};
+}
+
+static void sparseHLL_Destroy(sparseHLL *h) {
+  if (h->sparse) array_free(h->sparse);
+  h->sparse = NULL;
+  hll_destroy(&h->dense);
+}
+
+static void sparseHLL_ToDense(sparseHLL *h) {
+  hll_init(&h->dense, h->bits);
+  for (uint32_t i = 0; i < array_len(h->sparse); i++) {
+    h->dense.registers[h->sparse[i] >> 8] = h->sparse[i] & 0xff;
+  }
+  array_free(h->sparse);
+  h->sparse = NULL;
+}
+
+static void sparseHLL_SetRegister(sparseHLL *h, uint32_t idx, uint8_t rank) {
+  if (!h->sparse) {
+    if (rank > h->dense.registers[idx]) h->dense.registers[idx] = rank;
+    return;
+  }
+
+  uint32_t len = array_len(h->sparse);
+  uint32_t lo = 0, hi = len;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if ((h->sparse[mid] >> 8) < idx) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < len && (h->sparse[lo] >> 8) == idx) {
+    if (rank > (h->sparse[lo] & 0xff)) h->sparse[lo] = idx << 8 | rank;
+    return;
+  }
+
+  // insert the new register at its place
+  h->sparse = array_append(h->sparse, 0);
+  memmove(h->sparse + lo + 1, h->sparse + lo, (len - lo) * sizeof(uint32_t));
+  h->sparse[lo] = idx << 8 | rank;
+
+  if ((len + 1) * sizeof(uint32_t) >= ((size_t)1 << h->bits)) {
+    sparseHLL_ToDense(h);
+  }
+}
+
+static void sparseHLL_Add(sparseHLL *h, uint32_t hash) {
+  // the same register and rank the dense HLL would use
+  uint32_t idx = hash >> (32 - h->bits);
+  uint8_t rank = hash ? __builtin_ctz(hash) + 1 : 33 - h->bits;
+  if (rank > 33 - h->bits) rank = 33 - h->bits;
+  sparseHLL_SetRegister(h, idx, rank);
+}
+
+static uint64_t sparseHLL_Count(sparseHLL *h) {
+  if (!h->sparse) return (uint64_t)hll_count(&h->dense);
+
+  // expand temporarily, so the estimate is exactly the one of the dense counter
+  struct HLL tmp;
+  hll_init(&tmp, h->bits);
+  for (uint32_t i = 0; i < array_len(h->sparse); i++) {
+    tmp.registers[h->sparse[i] >> 8] = h->sparse[i] & 0xff;
+  }
+  uint64_t ret = (uint64_t)hll_count(&tmp);
+  hll_destroy(&tmp);
+  return ret;
+}
+
+typedef struct {
+  const char *key;
+  uint8_t bits;
+} hllParams;
+
 struct distinctishCounter {
-  struct HLL hll;
+  sparseHLL hll;
   RSKey key;
   RSSortingTable *sortables;
 };
 
 static void *countDistinctish_NewInstance(ReducerCtx *ctx) {
-  BlkAlloc *ba = &ctx->alloc;
+  hllParams *params = ctx->privdata;
   struct distinctishCounter *ctr =
       ReducerCtx_Alloc(ctx, sizeof(*ctr), 1024 * sizeof(*ctr));  // malloc(sizeof(*ctr));
-  hll_init(&ctr->hll, HLL_PRECISION_BITS);
-  ctr->key = RS_KEY(RSKEY((char *)ctx->privdata));
+  sparseHLL_Init(&ctr->hll, params->bits);
+  ctr->key = RS_KEY(RSKEY(params->key));
   ctr->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
   return ctr;
 }
@@ -97,45 +189,59 @@ static int countDistinctish_Add(void *ctx, SearchResult *res) {
 
   uint64_t hval = RSValue_Hash(val, 0x5f61767a);
   uint32_t val32 = (uint32_t)hval ^ (uint32_t)(hval >> 32);
-  hll_add_hash(&ctr->hll, val32);
+  sparseHLL_Add(&ctr->hll, val32);
   return 1;
 }
 
 static int countDistinctish_Finalize(void *ctx, const char *key, SearchResult *res) {
   struct distinctishCounter *ctr = ctx;
-  // rintf("Counter finalize! count %f\n", hll_count(&ctr->hll));
-  RSFieldMap_SetNumber(&res->fields, key, (uint64_t)hll_count(&ctr->hll));
+  RSFieldMap_SetNumber(&res->fields, key, sparseHLL_Count(&ctr->hll));
   return 1;
 }
 
 static void countDistinctish_FreeInstance(void *p) {
   struct distinctishCounter *ctr = p;
-  hll_destroy(&ctr->hll);
+  sparseHLL_Destroy(&ctr->hll);
 }
 
+#define HLL_FLAG_SPARSE 0x01
+
 /** Serialized HLL format */
 typedef struct __attribute__((packed)) {
-  uint32_t flags;  // Currently unused
+  uint32_t flags;  // HLL_FLAG_SPARSE or 0
   uint8_t bits;
-  // uint32_t size -- NOTE - always 1<<bits
+  // Dense: uint8_t registers[1 << bits]
+  // Sparse: uint32_t registers[], each (index << 8 | rank)
 } HLLSerializedHeader;
 
 static int hllFinalize(void *ctx, const char *key, SearchResult *res) {
   struct distinctishCounter *ctr = ctx;
   // Serialize field map.
   HLLSerializedHeader hdr = {.flags = 0, .bits = ctr->hll.bits};
-  char *str = malloc(sizeof(hdr) + ctr->hll.size);
+  const void *regs = ctr->hll.dense.registers;
+  size_t regsz = ctr->hll.dense.size;
+  if (ctr->hll.sparse) {
+    hdr.flags |= HLL_FLAG_SPARSE;
+    regs = ctr->hll.sparse;
+    regsz = array_len(ctr->hll.sparse) * sizeof(uint32_t);
+  }
+  char *str = malloc(sizeof(hdr) + regsz);
   size_t hdrsize = sizeof(hdr);
   memcpy(str, &hdr, hdrsize);
-  memcpy(str + hdrsize, ctr->hll.registers, ctr->hll.size);
-  RSFieldMap_Add(&res->fields, key, RS_StringVal(str, sizeof(hdr) + ctr->hll.size));
+  memcpy(str + hdrsize, regs, regsz);
+  RSFieldMap_Add(&res->fields, key, RS_StringVal(str, sizeof(hdr) + regsz));
   return 1;
 }
 
-static Reducer *newHllCommon(RedisSearchCtx *ctx, const char *alias, const char *key, int isRaw) {
-  Reducer *r = NewReducer(ctx, (void *)key);
+static Reducer *newHllCommon(RedisSearchCtx *ctx, const char *alias, const char *key, int bits,
+                             int isRaw) {
+  hllParams *params = malloc(sizeof(*params));
+  params->key = key;
+  params->bits = bits;
+
+  Reducer *r = NewReducer(ctx, params);
   r->Add = countDistinctish_Add;
-  r->Free = Reducer_GenericFreeWithStaticPrivdata;
+  r->Free = Reducer_GenericFree;
   r->FreeInstance = countDistinctish_FreeInstance;
   r->NewInstance = countDistinctish_NewInstance;
 
@@ -149,18 +255,18 @@ static Reducer *newHllCommon(RedisSearchCtx *ctx, const char *alias, const char
   return r;
 }
 
-Reducer *NewCountDistinctish(RedisSearchCtx *ctx, const char *alias, const char *key) {
-  return newHllCommon(ctx, alias, key, 0);
+Reducer *NewCountDistinctish(RedisSearchCtx *ctx, const char *alias, const char *key, int bits) {
+  return newHllCommon(ctx, alias, key, bits ? bits : HLL_PRECISION_BITS, 0);
 }
 
-Reducer *NewHLL(RedisSearchCtx *ctx, const char *alias, const char *key) {
-  return newHllCommon(ctx, alias, key, 1);
+Reducer *NewHLL(RedisSearchCtx *ctx, const char *alias, const char *key, int bits) {
+  return newHllCommon(ctx, alias, key, bits ? bits : HLL_PRECISION_BITS, 1);
 }
 
 typedef struct {
   RSKey key;
   RSSortingTable *sortables;
-  struct HLL hll;
+  sparseHLL hll;
 } hllSumCtx;
 
 static int hllSum_Add(void *ctx, SearchResult *res) {
@@ -186,44 +292,53 @@ static int hllSum_Add(void *ctx, SearchResult *res) {
 
   // Can't be an insane bit value - we don't want to overflow either!
   size_t regsz = len - sizeof(*hdr);
-  if (hdr->bits > 64) {
+  if (hdr->bits < 4 || hdr->bits > HLL_MAX_PRECISION_BITS) {
     return 0;
   }
 
   // Expected length should be determined from bits (whose value we've also
   // verified)
-  if (regsz != 1 << hdr->bits) {
+  int sparse = hdr->flags & HLL_FLAG_SPARSE;
+  if (sparse ? regsz % sizeof(uint32_t) : regsz != 1 << hdr->bits) {
     return 0;
   }
 
-  if (ctr->hll.bits) {
-    if (hdr->bits != ctr->hll.bits) {
-      return 0;
+  if (!ctr->hll.bits) {
+    sparseHLL_Init(&ctr->hll, hdr->bits);
+  } else if (hdr->bits != ctr->hll.bits) {
+    return 0;
+  }
+
+  if (sparse) {
+    for (size_t i = 0; i < regsz / sizeof(uint32_t); i++) {
+      uint32_t reg;
+      memcpy(&reg, registers + i * sizeof(reg), sizeof(reg));
+      if ((reg >> 8) >= 1 << hdr->bits) return 0;
+      sparseHLL_SetRegister(&ctr->hll, reg >> 8, reg & 0xff);
+    }
+  } else {
+    if (ctr->hll.sparse) {
+      sparseHLL_ToDense(&ctr->hll);
     }
     // Merge!
     struct HLL tmphll = {
         .bits = hdr->bits, .size = 1 << hdr->bits, .registers = (uint8_t *)registers};
-    if (hll_merge(&ctr->hll, &tmphll) != 0) {
+    if (hll_merge(&ctr->hll.dense, &tmphll) != 0) {
       return 0;
     }
-  } else {
-    // Not yet initialized - make this our first register and continue.
-    hll_init(&ctr->hll, hdr->bits);
-    memcpy(ctr->hll.registers, registers, regsz);
   }
   return 1;
 }
 
 static int hllSum_Finalize(void *ctx, const char *key, SearchResult *res) {
   hllSumCtx *ctr = ctx;
-  RSFieldMap_SetNumber(&res->fields, key, ctr->hll.bits ? (uint64_t)hll_count(&ctr->hll) : 0);
+  RSFieldMap_SetNumber(&res->fields, key, ctr->hll.bits ? sparseHLL_Count(&ctr->hll) : 0);
   return 1;
 }
 
 static void *hllSum_NewInstance(ReducerCtx *ctx) {
   hllSumCtx *ctr = ReducerCtx_Alloc(ctx, sizeof(*ctr), 1024 * sizeof(*ctr));
-  ctr->hll.bits = 0;
-  ctr->hll.registers = NULL;
+  ctr->hll = (sparseHLL){0};
   ctr->key = RS_KEY(RSKEY((char *)ctx->privdata));
   ctr->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
   return ctr;
@@ -231,7 +346,7 @@ static void *hllSum_NewInstance(ReducerCtx *ctx) {
 
 static void hllSum_FreeInstance(void *p) {
   hllSumCtx *ctr = p;
-  hll_destroy(&ctr->hll);
+  sparseHLL_Destroy(&ctr->hll);
 }
 
 Reducer *NewHLLSum(RedisSearchCtx *ctx, const char *alias, const char *key) {
@@ -243,4 +358,4 @@ Reducer *NewHLLSum(RedisSearchCtx *ctx, const char *alias, const char *key) {
   r->Free = Reducer_GenericFreeWithStaticPrivdata;
   r->alias = FormatAggAlias(alias, "hll_sum", key);
   return r;
-}
\ No newline at end of file
+}
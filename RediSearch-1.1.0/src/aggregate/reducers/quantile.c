@@ -1,41 +1,56 @@
 #include <aggregate/reducer.h>
 #include "util/quantile.h"
+#include "util/tdigest.h"
+#include <math.h>
 
 typedef struct {
   RSKey property;
   double pct;
+  // If set, we use a t-digest with this compression instead of the quantile stream
+  double compression;
 } quantileParams;
 
 typedef struct {
   QuantStream *strm;
+  TDigest *td;
   quantileParams *params;
   RSSortingTable *sortables;
 } quantileCtx;
 
-
 static void *quantile_NewInstance(ReducerCtx *ctx) {
-  quantileCtx *qctx = ReducerCtx_Alloc(ctx, sizeof(*qctx), 100*sizeof(*qctx));
+  quantileCtx *qctx = ReducerCtx_Alloc(ctx, sizeof(*qctx), 100 * sizeof(*qctx));
   qctx->params = ctx->privdata;
-  qctx->strm = NewQuantileStream(&qctx->params->pct, 1, 500);
+  qctx->strm = NULL;
+  qctx->td = NULL;
+  if (qctx->params->compression) {
+    qctx->td = NewTDigest(qctx->params->compression);
+  } else {
+    qctx->strm = NewQuantileStream(&qctx->params->pct, 1, 500);
+  }
   qctx->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
   return qctx;
 }
 
+static inline void quantile_Insert(quantileCtx *qctx, RSValue *v) {
+  double d;
+  if (!RSValue_ToNumber(v, &d)) return;
+  if (qctx->td) {
+    TD_Add(qctx->td, d, 1);
+  } else {
+    QS_Insert(qctx->strm, d);
+  }
+}
+
 static int quantile_Add(void *ctx, SearchResult *res) {
   quantileCtx *qctx = ctx;
-  double d;
   RSValue *v = SearchResult_GetValue(res, qctx->sortables, &qctx->params->property);
   if (v) {
     if (v->t != RSValue_Array) {
-      if (RSValue_ToNumber(v, &d)) {
-        QS_Insert(qctx->strm, d);
-      }
+      quantile_Insert(qctx, v);
     } else {
       uint32_t sz = RSValue_ArrayLen(v);
       for (uint32_t i = 0; i < sz; i++) {
-        if (RSValue_ToNumber(RSValue_ArrayItem(v, i), &d)) {
-          QS_Insert(qctx->strm, d);
-        }
+        quantile_Insert(qctx, RSValue_ArrayItem(v, i));
       }
     }
   }
@@ -44,29 +59,106 @@ static int quantile_Add(void *ctx, SearchResult *res) {
 
 static int quantile_Finalize(void *ctx, const char *key, SearchResult *res) {
   quantileCtx *qctx = ctx;
-  double value = QS_Query(qctx->strm, qctx->params->pct);
+  double value = qctx->td ? TD_Quantile(qctx->td, qctx->params->pct)
+                          : QS_Query(qctx->strm, qctx->params->pct);
   RSFieldMap_SetNumber(&res->fields, key, value);
   return 1;
 }
 
 static void quantile_FreeInstance(void *p) {
   quantileCtx *qctx = p;
-  QS_Free(qctx->strm);
+  if (qctx->strm) QS_Free(qctx->strm);
+  TD_Free(qctx->td);
 }
 
-Reducer *NewQuantile(RedisSearchCtx *ctx, const char *property, const char *alias, double pct) {
+static Reducer *newQuantileCommon(RedisSearchCtx *ctx, const char *property, double pct,
+                                  double compression) {
   Reducer *r = malloc(sizeof(*r));
   r->Add = quantile_Add;
   r->Finalize = quantile_Finalize;
   r->Free = Reducer_GenericFree;
   r->FreeInstance = quantile_FreeInstance;
   r->NewInstance = quantile_NewInstance;
-  r->alias = FormatAggAlias(alias, "quantile", property);
 
   quantileParams *params = calloc(1, sizeof(*params));
-
   params->property = RS_KEY(property);
   params->pct = pct;
+  params->compression = compression;
   r->ctx = (ReducerCtx){.ctx = ctx, .privdata = params};
+  BlkAlloc_Init(&r->ctx.alloc);
+  return r;
+}
+
+Reducer *NewQuantile(RedisSearchCtx *ctx, const char *property, const char *alias, double pct,
+                     double compression) {
+  Reducer *r = newQuantileCommon(ctx, property, pct, compression);
+  r->alias = FormatAggAlias(alias, "quantile", property);
   return r;
-}
\ No newline at end of file
+}
+
+/* The TDIGEST reducer returns the serialized digest of the group, to be merged by TDIGEST_QUANTILE
+ * later on, e.g. in a distributed aggregation */
+static int tdigest_Finalize(void *ctx, const char *key, SearchResult *res) {
+  quantileCtx *qctx = ctx;
+  size_t len;
+  char *buf = TD_Serialize(qctx->td, &len);
+  RSFieldMap_Add(&res->fields, key, RS_StringVal(buf, len));
+  return 1;
+}
+
+Reducer *NewRawTDigest(RedisSearchCtx *ctx, const char *property, const char *alias,
+                       double compression) {
+  Reducer *r = newQuantileCommon(ctx, property, 0, compression);
+  r->Finalize = tdigest_Finalize;
+  r->alias = FormatAggAlias(alias, "tdigest", property);
+  return r;
+}
+
+static int tdigestQuantile_Add(void *ctx, SearchResult *res) {
+  quantileCtx *qctx = ctx;
+  RSValue *v = SearchResult_GetValue(res, qctx->sortables, &qctx->params->property);
+  if (!v || !RSValue_IsString(v)) {
+    return 0;
+  }
+
+  size_t len;
+  const char *buf = RSValue_StringPtrLen(v, &len);
+  TDigest *td = TD_Deserialize(buf, len);
+  if (!td) {
+    return 0;
+  }
+  if (!qctx->td) {
+    // take the first digest as is, keeping its compression
+    qctx->td = td;
+  } else {
+    TD_Merge(qctx->td, td);
+    TD_Free(td);
+  }
+  return 1;
+}
+
+static int tdigestQuantile_Finalize(void *ctx, const char *key, SearchResult *res) {
+  quantileCtx *qctx = ctx;
+  RSFieldMap_SetNumber(&res->fields, key,
+                       qctx->td ? TD_Quantile(qctx->td, qctx->params->pct) : NAN);
+  return 1;
+}
+
+static void *tdigestQuantile_NewInstance(ReducerCtx *ctx) {
+  quantileCtx *qctx = ReducerCtx_Alloc(ctx, sizeof(*qctx), 100 * sizeof(*qctx));
+  qctx->params = ctx->privdata;
+  qctx->strm = NULL;
+  qctx->td = NULL;
+  qctx->sortables = SEARCH_CTX_SORTABLES(ctx->ctx);
+  return qctx;
+}
+
+Reducer *NewTDigestQuantile(RedisSearchCtx *ctx, const char *property, const char *alias,
+                            double pct) {
+  Reducer *r = newQuantileCommon(ctx, property, pct, 0);
+  r->Add = tdigestQuantile_Add;
+  r->Finalize = tdigestQuantile_Finalize;
+  r->NewInstance = tdigestQuantile_NewInstance;
+  r->alias = FormatAggAlias(alias, "tdigest_quantile", property);
+  return r;
+}
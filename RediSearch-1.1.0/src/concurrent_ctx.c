@@ -1,4 +1,5 @@
 #include "concurrent_ctx.h"
+#include "config.h"
 #include "dep/thpool/thpool.h"
 #include <unistd.h>
 #include <util/arr.h>
@@ -9,6 +10,16 @@ static threadpool *threadpools_g = NULL;
 int CONCURRENT_POOL_INDEX = -1;
 int CONCURRENT_POOL_SEARCH = -1;
 
+static uint64_t writeEpoch_g = 0;
+
+void ConcurrentSearch_AdvanceEpoch() {
+  __atomic_fetch_add(&writeEpoch_g, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t ConcurrentSearch_Epoch() {
+  return __atomic_load_n(&writeEpoch_g, __ATOMIC_ACQUIRE);
+}
+
 int ConcurrentSearch_CreatePool(int numThreads) {
   if (!threadpools_g) {
     threadpools_g = array_new(threadpool, 4);
@@ -22,12 +33,20 @@ int ConcurrentSearch_CreatePool(int numThreads) {
 void ConcurrentSearch_ThreadPoolStart() {
 
   if (CONCURRENT_POOL_SEARCH == -1) {
-    CONCURRENT_POOL_SEARCH = ConcurrentSearch_CreatePool(CONCURRENT_SEARCH_POOL_SIZE);
-    long numProcs = sysconf(_SC_NPROCESSORS_ONLN);
-    if (numProcs < 1) {
-      numProcs = CONCURRENT_INDEX_POOL_SIZE;
+    long searchThreads = RSGlobalConfig.searchPoolSize;
+    if (searchThreads < 1) {
+      searchThreads = CONCURRENT_SEARCH_POOL_SIZE;
     }
-    CONCURRENT_POOL_INDEX = ConcurrentSearch_CreatePool(numProcs);
+    CONCURRENT_POOL_SEARCH = ConcurrentSearch_CreatePool(searchThreads);
+
+    long indexThreads = RSGlobalConfig.indexPoolSize;
+    if (indexThreads < 1) {
+      indexThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (indexThreads < 1) {
+      indexThreads = CONCURRENT_INDEX_POOL_SIZE;
+    }
+    CONCURRENT_POOL_INDEX = ConcurrentSearch_CreatePool(indexThreads);
   }
 }
 
@@ -41,9 +60,10 @@ typedef struct ConcurrentCmdCtx {
 } ConcurrentCmdCtx;
 
 /* Run a function on the concurrent thread pool */
-void ConcurrentSearch_ThreadPoolRun(void (*func)(void *), void *arg, int type) {
+void ConcurrentSearch_ThreadPoolRun(void (*func)(void *), void *arg, int type,
+                                    ConcurrentPriority priority) {
   threadpool p = threadpools_g[type];
-  thpool_add_work(p, func, arg);
+  thpool_add_work_priority(p, func, arg, priority);
 }
 
 static void threadHandleCommand(void *p) {
@@ -73,8 +93,9 @@ void ConcurrentCmdCtx_KeepRedisCtx(ConcurrentCmdCtx *cctx) {
   cctx->options |= CMDCTX_KEEP_RCTX;
 }
 
-int ConcurrentSearch_HandleRedisCommandEx(int poolType, int options, ConcurrentCmdHandler handler,
-                                          RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+int ConcurrentSearch_HandleRedisCommandEx(int poolType, ConcurrentPriority priority, int options,
+                                          ConcurrentCmdHandler handler, RedisModuleCtx *ctx,
+                                          RedisModuleString **argv, int argc) {
   ConcurrentCmdCtx *cmdCtx = malloc(sizeof(*cmdCtx));
   cmdCtx->bc = RedisModule_BlockClient(ctx, NULL, NULL, NULL, 0);
   cmdCtx->argc = argc;
@@ -88,13 +109,14 @@ int ConcurrentSearch_HandleRedisCommandEx(int poolType, int options, ConcurrentC
     cmdCtx->argv[i] = RedisModule_CreateStringFromString(cmdCtx->ctx, argv[i]);
   }
 
-  ConcurrentSearch_ThreadPoolRun(threadHandleCommand, cmdCtx, poolType);
+  ConcurrentSearch_ThreadPoolRun(threadHandleCommand, cmdCtx, poolType, priority);
   return REDISMODULE_OK;
 }
 
-int ConcurrentSearch_HandleRedisCommand(int poolType, ConcurrentCmdHandler handler,
-                                        RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
-  return ConcurrentSearch_HandleRedisCommandEx(poolType, 0, handler, ctx, argv, argc);
+int ConcurrentSearch_HandleRedisCommand(int poolType, ConcurrentPriority priority,
+                                        ConcurrentCmdHandler handler, RedisModuleCtx *ctx,
+                                        RedisModuleString **argv, int argc) {
+  return ConcurrentSearch_HandleRedisCommandEx(poolType, priority, 0, handler, ctx, argv, argc);
 }
 
 static void ConcurrentSearch_CloseKeys(ConcurrentSearchCtx *ctx) {
@@ -107,10 +129,36 @@ static void ConcurrentSearch_CloseKeys(ConcurrentSearchCtx *ctx) {
   }
 }
 
+/* Versioned keys can be skipped if no writer advanced the epoch since we opened them. Writes that
+ * the module does not see, such as an async flush or swapping databases, are caught by the
+ * unversioned keys (i.e. the index spec) we always reopen, so without one we reopen everything */
+static int ConcurrentSearchCtx_CanSkipVersioned(ConcurrentSearchCtx *ctx, uint64_t epoch) {
+  if (epoch != ctx->epoch) {
+    return 0;
+  }
+  for (size_t i = 0; i < ctx->numOpenKeys; i++) {
+    if (!(ctx->openKeys[i].opts & ConcurrentKey_Versioned)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 void ConcurrentSearchCtx_ReopenKeys(ConcurrentSearchCtx *ctx) {
+  uint64_t epoch = ConcurrentSearch_Epoch();
+  int skipVersioned = ConcurrentSearchCtx_CanSkipVersioned(ctx, epoch);
+  ctx->epoch = epoch;
+
   size_t sz = ctx->numOpenKeys;
   for (size_t i = 0; i < sz; i++) {
     ConcurrentKeyCtx *kx = &ctx->openKeys[i];
+    if (skipVersioned && (kx->opts & ConcurrentKey_Versioned)) {
+      // we closed the key when unlocking, unless it was shared
+      if (!(kx->opts & ConcurrentKey_SharedKey)) {
+        kx->key = NULL;
+      }
+      continue;
+    }
     kx->key = RedisModule_OpenKey(ctx->ctx, kx->keyName, kx->keyFlags);
     // if the key is marked as shared, make sure it isn't now
     kx->opts &= ~ConcurrentKey_SharedKey;
@@ -153,6 +201,7 @@ void ConcurrentSearchCtx_Init(RedisModuleCtx *rctx, ConcurrentSearchCtx *ctx) {
   ctx->isLocked = 0;
   ctx->numOpenKeys = 0;
   ctx->openKeys = NULL;
+  ctx->epoch = ConcurrentSearch_Epoch();
   ConcurrentSearchCtx_ResetClock(ctx);
 }
 
@@ -161,6 +210,7 @@ void ConcurrentSearchCtx_InitSingle(ConcurrentSearchCtx *ctx, RedisModuleCtx *rc
   ctx->ctx = rctx;
   ctx->isLocked = 0;
   ctx->numOpenKeys = 1;
+  ctx->epoch = ConcurrentSearch_Epoch();
   ctx->openKeys = calloc(1, sizeof(*ctx->openKeys));
   ctx->openKeys->cb = cb;
   ctx->openKeys->keyFlags = mode;
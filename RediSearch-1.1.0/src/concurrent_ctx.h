@@ -39,6 +39,11 @@ typedef enum {
   // the key itself is shared and should not be deleted.
   // this may be rewritten on reopening
   ConcurrentKey_SharedKey = 0x02,
+
+  // the data behind the key is only changed in ways that advance the write epoch (see
+  // ConcurrentSearch_AdvanceEpoch), so if the epoch is the same when we get the lock back, the
+  // key does not need to be reopened and its callback is not called
+  ConcurrentKey_Versioned = 0x04,
 } ConcurrentKeyOptions;
 /* ConcurrentKeyCtx is a reference to a key that's being held open during concurrent execution and
  * needs to be reopened after yielding and gaining back execution. See ConcurrentSearch_AddKey for
@@ -65,6 +70,8 @@ typedef struct {
   ConcurrentKeyCtx *openKeys;
   uint32_t numOpenKeys;
   uint32_t isLocked;
+  // the write epoch when the keys were last opened
+  uint64_t epoch;
 } ConcurrentSearchCtx;
 
 /** The maximal size of the concurrent query thread pool. Since only one thread is operational at a
@@ -125,14 +132,42 @@ static inline void ConcurrentSearch_SetKey(ConcurrentSearchCtx *ctx, RedisModule
 /** Start the concurrent search thread pool. Should be called when initializing the module */
 void ConcurrentSearch_ThreadPoolStart();
 
+/* The write epoch is a global counter that writers advance whenever they change index data in a
+ * way that invalidates what a sleeping query holds - deleting or replacing an index key, garbage
+ * collecting an inverted index or restructuring a numeric tree. Appending to indexes does not
+ * advance it, as readers already cope with that.
+ *
+ * A query pins the epoch when it opens its keys. If no writer advanced it while the query released
+ * the lock, its readers are still valid and re-opening and re-seeking its versioned keys is
+ * skipped. */
+void ConcurrentSearch_AdvanceEpoch();
+
+/* Get the current write epoch */
+uint64_t ConcurrentSearch_Epoch();
+
 /* Create a new thread pool, and return its identifying id */
 int ConcurrentSearch_CreatePool(int numThreads);
 
 extern int CONCURRENT_POOL_INDEX;
 extern int CONCURRENT_POOL_SEARCH;
 
-/* Run a function on the concurrent thread pool */
-void ConcurrentSearch_ThreadPoolRun(void (*func)(void *), void *arg, int type);
+/* The priority of work sent to the thread pools. Each pool serves its most urgent work first, but
+ * a priority is never passed over more than THPOOL_MAX_SKIPS times in a row, so long running work
+ * is delayed rather than starved */
+typedef enum {
+  // Interactive searches (FT.SEARCH)
+  ConcurrentPriority_Search = THPOOL_PRIORITY_HIGH,
+  // Aggregations and reading their cursors
+  ConcurrentPriority_Aggregate,
+  // Indexing documents
+  ConcurrentPriority_Indexing,
+  // Maintenance work no client is waiting for, such as compacting suggestion dictionaries
+  ConcurrentPriority_Background,
+} ConcurrentPriority;
+
+/* Run a function on the concurrent thread pool with the given priority */
+void ConcurrentSearch_ThreadPoolRun(void (*func)(void *), void *arg, int type,
+                                    ConcurrentPriority priority);
 
 /** Check the elapsed timer, and release the lock if enough time has passed.
  * Return 1 if switching took place
@@ -181,12 +216,14 @@ typedef void (*ConcurrentCmdHandler)(RedisModuleCtx *, RedisModuleString **, int
  */
 void ConcurrentCmdCtx_KeepRedisCtx(struct ConcurrentCmdCtx *ctx);
 
-int ConcurrentSearch_HandleRedisCommand(int poolType, ConcurrentCmdHandler handler,
-                                        RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int ConcurrentSearch_HandleRedisCommand(int poolType, ConcurrentPriority priority,
+                                        ConcurrentCmdHandler handler, RedisModuleCtx *ctx,
+                                        RedisModuleString **argv, int argc);
 
 /* Same as handleRedis command, but set flags for the concurrent context */
-int ConcurrentSearch_HandleRedisCommandEx(int poolType, int options, ConcurrentCmdHandler handler,
-                                          RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int ConcurrentSearch_HandleRedisCommandEx(int poolType, ConcurrentPriority priority, int options,
+                                          ConcurrentCmdHandler handler, RedisModuleCtx *ctx,
+                                          RedisModuleString **argv, int argc);
 
 /** This macro is called by concurrent executors (currently the query only).
  * It checks if enough time has passed and releases the global lock if that is the case.
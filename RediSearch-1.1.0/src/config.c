@@ -55,6 +55,60 @@ int ReadConfig(RedisModuleString **argv, int argc, const char **err) {
     RMUtil_ParseArgsAfter("FRISOINI", argv, argc, "c", &RSGlobalConfig.frisoIni);
   }
 
+  /* Read the thread pool sizes */
+  if (argc >= 2 && RMUtil_ArgIndex("SEARCH_THREADS", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("SEARCH_THREADS", argv, argc, "l", &RSGlobalConfig.searchPoolSize);
+    if (RSGlobalConfig.searchPoolSize <= 0) {
+      *err = "Invalid SEARCH_THREADS value";
+      return REDISMODULE_ERR;
+    }
+  }
+
+  if (argc >= 2 && RMUtil_ArgIndex("INDEX_THREADS", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("INDEX_THREADS", argv, argc, "l", &RSGlobalConfig.indexPoolSize);
+    if (RSGlobalConfig.indexPoolSize <= 0) {
+      *err = "Invalid INDEX_THREADS value";
+      return REDISMODULE_ERR;
+    }
+  }
+
+  /* Read the query cost budget */
+  if (argc >= 2 && RMUtil_ArgIndex("MAXQUERYCOST", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("MAXQUERYCOST", argv, argc, "l", &RSGlobalConfig.maxQueryCost);
+    if (RSGlobalConfig.maxQueryCost < 0) {
+      *err = "Invalid MAXQUERYCOST value";
+      return REDISMODULE_ERR;
+    }
+  }
+
+  /* Read the query cache memory limit */
+  if (argc >= 2 && RMUtil_ArgIndex("QUERYCACHE_MAXMEM", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("QUERYCACHE_MAXMEM", argv, argc, "l",
+                          &RSGlobalConfig.queryCacheMaxMemory);
+    if (RSGlobalConfig.queryCacheMaxMemory < 0) {
+      *err = "Invalid QUERYCACHE_MAXMEM value";
+      return REDISMODULE_ERR;
+    }
+  }
+
+  /* Read the champion tier options */
+  if (argc >= 2 && RMUtil_ArgIndex("CHAMPION_THRESHOLD", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("CHAMPION_THRESHOLD", argv, argc, "l",
+                          &RSGlobalConfig.championThreshold);
+    if (RSGlobalConfig.championThreshold < 0) {
+      *err = "Invalid CHAMPION_THRESHOLD value";
+      return REDISMODULE_ERR;
+    }
+  }
+
+  if (argc >= 2 && RMUtil_ArgIndex("CHAMPION_SIZE", argv, argc) >= 0) {
+    RMUtil_ParseArgsAfter("CHAMPION_SIZE", argv, argc, "l", &RSGlobalConfig.championSize);
+    if (RSGlobalConfig.championSize <= 0 || RSGlobalConfig.championSize > UINT32_MAX) {
+      *err = "Invalid CHAMPION_SIZE value";
+      return REDISMODULE_ERR;
+    }
+  }
+
   const char *policy = NULL;
   RMUtil_ParseArgsAfter("ON_TIMEOUT", argv, argc, "c", &policy);
   if (policy != NULL) {
@@ -67,5 +121,18 @@ int ReadConfig(RedisModuleString **argv, int argc, const char **err) {
       return REDISMODULE_ERR;
     }
   }
+
+  policy = NULL;
+  RMUtil_ParseArgsAfter("ON_MAXQUERYCOST", argv, argc, "c", &policy);
+  if (policy != NULL) {
+    if (!strcasecmp(policy, "RETURN")) {
+      RSGlobalConfig.queryCostPolicy = TimeoutPolicy_Return;
+    } else if (!strcasecmp(policy, "FAIL")) {
+      RSGlobalConfig.queryCostPolicy = TimeoutPolicy_Fail;
+    } else {
+      *err = "Invalid ON_MAXQUERYCOST value";
+      return REDISMODULE_ERR;
+    }
+  }
   return REDISMODULE_OK;
 }
\ No newline at end of file
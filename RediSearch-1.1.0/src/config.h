@@ -50,6 +50,29 @@ typedef struct {
   long long cursorMaxIdle;
 
   RSTimeoutPolicy timeoutPolicy;
+
+  // The number of threads running concurrent searches and aggregations. 0 means the default,
+  // CONCURRENT_SEARCH_POOL_SIZE
+  long long searchPoolSize;
+
+  // The number of threads indexing documents. 0 means the default, the number of CPUs
+  long long indexPoolSize;
+
+  // The maximal estimated cost of a query, in index entries it may read. 0 means unlimited
+  long long maxQueryCost;
+
+  // What to do with queries costing more than maxQueryCost: fail them, or run them with a scan
+  // budget and return what was found within it
+  RSTimeoutPolicy queryCostPolicy;
+
+  // The memory limit of the search results cache of each index, in bytes. 0 disables the cache
+  long long queryCacheMaxMemory;
+
+  // The number of documents a term needs to appear in to get a champion tier. 0 disables the tiers
+  long long championThreshold;
+
+  // The maximal number of documents in the champion tier of a term
+  long long championSize;
 } RSConfig;
 
 // global config extern reference
@@ -64,7 +87,9 @@ int ReadConfig(RedisModuleString **argv, int argc, const char **err);
   (RSConfig) {                                                                                \
     .concurrentMode = 1, .extLoad = NULL, .enableGC = 1, .minTermPrefix = 2,                  \
     .maxPrefixExpansions = 200, .queryTimeoutMS = 500, .timeoutPolicy = TimeoutPolicy_Return, \
-    .cursorReadSize = 1000, .cursorMaxIdle = 300000                                           \
+    .cursorReadSize = 1000, .cursorMaxIdle = 300000, .searchPoolSize = 0,                    \
+    .indexPoolSize = 0, .maxQueryCost = 0, .queryCostPolicy = TimeoutPolicy_Fail,             \
+    .queryCacheMaxMemory = 0, .championThreshold = 0, .championSize = 100                     \
   }
 ;
 
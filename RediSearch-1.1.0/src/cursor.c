@@ -23,6 +23,7 @@ static void CursorList_Unlock(CursorList *cl) {
 void CursorList_Init(CursorList *cl) {
   memset(cl, 0, sizeof(*cl));
   pthread_mutex_init(&cl->lock, NULL);
+  pthread_cond_init(&cl->prefetchDone, NULL);
   cl->lookup = kh_init(cursors);
   Array_Init(&cl->idle);
 }
@@ -183,13 +184,9 @@ done:
   return cur;
 }
 
-int Cursor_Pause(Cursor *cur) {
+/* Place the cursor in the idle list. Must be called with the list locked */
+static void Cursor_AddToIdle(Cursor *cur) {
   CursorList *cl = cur->parent;
-  cur->nextTimeoutNs = curTimeNs() + (cur->timeoutIntervalMs * 1000000);
-
-  CursorList_Lock(cl);
-  CursorList_IncrCounter(cl);
-
   if (cur->nextTimeoutNs < cl->nextIdleTimeoutNs || cl->nextIdleTimeoutNs == 0) {
     cl->nextIdleTimeoutNs = cur->nextTimeoutNs;
   }
@@ -197,11 +194,69 @@ int Cursor_Pause(Cursor *cur) {
   /* Add to idle list */
   *(Cursor **)(ARRAY_ADD_AS(&cl->idle, Cursor *)) = cur;
   cur->pos = ARRAY_GETSIZE_AS(&cl->idle, Cursor **) - 1;
+}
+
+int Cursor_Pause(Cursor *cur) {
+  CursorList *cl = cur->parent;
+  cur->nextTimeoutNs = curTimeNs() + (cur->timeoutIntervalMs * 1000000);
+
+  CursorList_Lock(cl);
+  CursorList_IncrCounter(cl);
+  Cursor_AddToIdle(cur);
   CursorList_Unlock(cl);
 
   return REDISMODULE_OK;
 }
 
+void Cursor_StartPrefetch(Cursor *cur) {
+  CursorList *cl = cur->parent;
+  cur->nextTimeoutNs = curTimeNs() + (cur->timeoutIntervalMs * 1000000);
+
+  CursorList_Lock(cl);
+  cur->prefetching = 1;
+  CursorList_Unlock(cl);
+}
+
+int Cursor_EndPrefetch(Cursor *cur) {
+  CursorList *cl = cur->parent;
+  int rc = REDISMODULE_OK;
+
+  CursorList_Lock(cl);
+  cur->prefetching = 0;
+  if (cur->purged) {
+    rc = REDISMODULE_ERR;
+  } else {
+    Cursor_AddToIdle(cur);
+  }
+  pthread_cond_broadcast(&cl->prefetchDone);
+  CursorList_Unlock(cl);
+  return rc;
+}
+
+/* Get a cursor by ID, or NULL if it does not exist. Must be called with the list locked */
+static Cursor *CursorList_Find(CursorList *cl, uint64_t cid) {
+  khiter_t iter = kh_get(cursors, cl->lookup, cid);
+  return iter != kh_end(cl->lookup) ? kh_value(cl->lookup, iter) : NULL;
+}
+
+int Cursors_IsPrefetching(CursorList *cl, uint64_t cid) {
+  CursorList_Lock(cl);
+  Cursor *cur = CursorList_Find(cl, cid);
+  int rc = cur && cur->prefetching;
+  CursorList_Unlock(cl);
+  return rc;
+}
+
+void Cursors_WaitPrefetch(CursorList *cl, uint64_t cid) {
+  CursorList_Lock(cl);
+  Cursor *cur;
+  // the cursor may be freed while we wait, so look it up again each time
+  while ((cur = CursorList_Find(cl, cid)) && cur->prefetching) {
+    pthread_cond_wait(&cl->prefetchDone, &cl->lock);
+  }
+  CursorList_Unlock(cl);
+}
+
 Cursor *Cursors_TakeForExecution(CursorList *cl, uint64_t cid) {
   CursorList_Lock(cl);
   CursorList_IncrCounter(cl);
@@ -231,10 +286,15 @@ int Cursors_Purge(CursorList *cl, uint64_t cid) {
   khiter_t iter = kh_get(cursors, cl->lookup, cid);
   if (iter != kh_end(cl->lookup)) {
     Cursor *cur = kh_value(cl->lookup, iter);
-    if (Cursor_IsIdle(cur)) {
-      Cursor_RemoveFromIdle(cur);
+    if (cur->prefetching) {
+      // The prefetching thread owns the cursor - it will free it when it's done
+      cur->purged = 1;
+    } else {
+      if (Cursor_IsIdle(cur)) {
+        Cursor_RemoveFromIdle(cur);
+      }
+      Cursor_FreeInternal(cur, iter);
     }
-    Cursor_FreeInternal(cur, iter);
     rc = REDISMODULE_OK;
 
   } else {
@@ -43,6 +43,13 @@ typedef struct Cursor {
 
   /** Position within idle list */
   int pos;
+
+  /** Set while the cursor is reading ahead in the background. It is not idle, but a read may wait
+   * for it */
+  int prefetching;
+
+  /** Set if the cursor was deleted while prefetching, and should be freed once done */
+  int purged;
 } Cursor;
 
 KHASH_MAP_INIT_INT64(cursors, Cursor *);
@@ -63,6 +70,9 @@ typedef struct CursorList {
 
   pthread_mutex_t lock;
 
+  /** Signalled whenever a cursor finishes prefetching */
+  pthread_cond_t prefetchDone;
+
   /**
    * Counter - this serves two purposes:
    * 1) When counter % n == 0, a GC sweep is performed
@@ -105,6 +115,10 @@ extern CursorList RSCursors;
  * (4) When the cursor is finally exhausted (or removed), it is removed from
  *     the idle list and freed.
  *
+ * (5) A prefetching cursor is executed in the background between (2) and
+ *     (3). It is only placed in the idle list once done. Removing it
+ *     meanwhile only marks it, and the prefetching thread frees it.
+ *
  * In essence, whenever the cursor is accessed by any internal API (i.e. not
  * a network API) it becomes invisible to the cursor subsystem, so there is
  * never any worry that the cursor is accessed from different threads, or
@@ -119,6 +133,7 @@ void CursorList_Init(CursorList *cl);
 #define RSCURSORS_DEFAULT_CAPACITY 128
 #define RSCURSORS_SWEEP_INTERVAL 500                /* GC Every 500 requests */
 #define RSCURSORS_SWEEP_THROTTLE (1 * (1000000000)) /* Throttle, in NS */
+#define RSCURSORS_MAX_PREFETCH 8                    /* Max chunks read ahead by a cursor */
 
 /**
  * Add an index spec to the cursor list. This has the effect of adding the
@@ -148,6 +163,31 @@ Cursor *Cursors_TakeForExecution(CursorList *cl, uint64_t cid);
  */
 int Cursor_Pause(Cursor *cur);
 
+/**
+ * Prefetching: instead of pausing a cursor after a read, the consumer may mark it as prefetching
+ * and keep executing it in the background. The idle timeout starts counting right away.
+ *
+ * While prefetching the cursor is not idle and cannot be taken for execution, so readers should
+ * first call Cursors_WaitPrefetch (without holding the GIL, which the prefetching cursor needs).
+ */
+void Cursor_StartPrefetch(Cursor *cur);
+
+/**
+ * Finish prefetching and place the cursor in the idle list. Returns REDISMODULE_ERR if the
+ * cursor was deleted in the meantime, in which case it should be freed by the caller
+ */
+int Cursor_EndPrefetch(Cursor *cur);
+
+/**
+ * Returns true if the cursor with the given ID is currently prefetching
+ */
+int Cursors_IsPrefetching(CursorList *cl, uint64_t cid);
+
+/**
+ * Block until the cursor with the given ID is no longer prefetching
+ */
+void Cursors_WaitPrefetch(CursorList *cl, uint64_t cid);
+
 /**
  * Free a given cursor. This should be called on an already-obtained cursor
  */
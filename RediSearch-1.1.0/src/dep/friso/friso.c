@@ -1182,6 +1182,26 @@ FRISO_API lex_entry_t next_complex_cjk(
 /* {{{ A macro function to check and free
  *     the lex_entry_t with type of __LEX_OTHER_WORDS__.
  */
+/* {{{ get a task copy of a lexicon entry from the dictionary.
+ *     entries of type __LEX_OTHER_WORDS__ and __LEX_NCSYN_WORDS__ were
+ * created by the task, so they are returned as they are.
+ * the copies share the word and synonyms of the dictionary entry, 
+ *     and are never freed.
+ */
+__STATIC_API__ lex_entry_t task_lex_entry( 
+        friso_task_t task, int copy, lex_entry_t lex )
+{
+    if ( lex->type == __LEX_OTHER_WORDS__ 
+            || lex->type == __LEX_NCSYN_WORDS__ ) {
+        return lex;
+    }
+
+    task->lex[copy] = *lex;
+    task->lex[copy].ctrlMask = 0;
+    return &task->lex[copy];
+}
+/* }}} */
+
 #define check_free_otlex_entry( lex ) \
     do { \
         if ( lex->type == __LEX_OTHER_WORDS__ )    {    \
@@ -1224,12 +1244,15 @@ __STATIC_API__ void token_sphinx_output(
  *
  * @param    task
  * @param    lex
+ * @param    offset   the offset of the token the synonyms are for. it is
+ *                     passed apart as lex may be a shared dictionary entry.
  * @param    front    1 for add the synoyum words from the head and 
  *                     0 for append from the tail.
  * */
 __STATIC_API__ void token_normal_output( 
         friso_task_t task,
         lex_entry_t lex, 
+        uint_t offset,
         int front )
 {
     uint_t i;
@@ -1240,7 +1263,7 @@ __STATIC_API__ void token_normal_output(
         _word = ( fstring ) lex->syn->items[i];
         e = new_lex_entry( _word, NULL, 0,     
                 strlen(_word), __LEX_NCSYN_WORDS__ );
-        e->offset = lex->offset;
+        e->offset = offset;
         //add to the buffer.
         if ( front ) {
             link_list_add_first( task->pool, e );
@@ -1348,10 +1371,7 @@ __STATIC_API__ lex_entry_t en_second_seg(
             if ( config->spx_out == 1 )            \
             token_sphinx_output(task, tmp);        \
             else \
-            {\
-                tmp->offset = lex->offset;        \
-                token_normal_output(task, tmp, front);    \
-            }\
+            token_normal_output(task, tmp, lex->offset, front);    \
         }\
     } while (0)
 /* }}} */
@@ -1461,6 +1481,7 @@ FRISO_API friso_token_t next_mmseg_token(
             lex = config->next_cjk(friso, config, task);
 
             if ( lex == NULL ) continue;    //find a stopwrod.
+            lex = task_lex_entry( task, 0, lex );
             lex->offset = task->idx - lex->rlen;
 
             /*
@@ -1491,7 +1512,8 @@ FRISO_API friso_token_t next_mmseg_token(
                 //find the next basic latin.
                 task->buffer[0] = task->text[task->idx++];
                 task->buffer[1] = '\0';
-                tmp = next_basic_latin(friso, config, task);
+                tmp = task_lex_entry( task, 1, 
+                        next_basic_latin(friso, config, task) );
                 tmp->offset = task->idx - tmp->length;
                 string_buffer_append( sb, tmp->word );
 
@@ -1499,8 +1521,8 @@ FRISO_API friso_token_t next_mmseg_token(
                 if ( friso_dic_match( friso->dic, 
                             __LEX_CEM_WORDS__, sb->buffer ) ) {
                     j = lex->offset; //bakup the offset.
-                    lex = friso_dic_get( friso->dic, 
-                            __LEX_CEM_WORDS__, sb->buffer );
+                    lex = task_lex_entry( task, 0, friso_dic_get( friso->dic, 
+                            __LEX_CEM_WORDS__, sb->buffer ) );
                     lex->offset = j;
                     check_free_otlex_entry(tmp);
                     free_string_buffer(sb);
@@ -1528,7 +1550,7 @@ FRISO_API friso_token_t next_mmseg_token(
                 if ( config->spx_out == 1 ) {
                     token_sphinx_output(task, lex);
                 } else {
-                    token_normal_output(task, lex, 0);
+                    token_normal_output(task, lex, lex->offset, 0);
                 }
             }
 
@@ -1600,7 +1622,8 @@ FRISO_API friso_token_t next_mmseg_token(
             }    
 
             //get the next basic latin word.
-            lex = next_basic_latin( friso, config, task );
+            lex = task_lex_entry( task, 0, 
+                    next_basic_latin( friso, config, task ) );
             lex->offset = task->idx - lex->rlen;
 
             /* @added: 2013-12-22
@@ -1811,7 +1834,7 @@ FRISO_API friso_token_t next_detect_token(
             if ( config->spx_out == 1 ) {
                 token_sphinx_output(task, lex);
             } else {
-                token_normal_output(task, lex, 0);
+                token_normal_output(task, lex, task->token->offset, 0);
             }
         }
 
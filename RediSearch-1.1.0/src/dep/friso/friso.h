@@ -141,6 +141,12 @@ typedef struct {
     string_buffer_t sbuf;   //string buffer.
     friso_token_t token;    //token result token;
     char buffer[7];         //word buffer. (1-6 bytes for an utf-8 word in C).
+    /*
+     * task copies of the dictionary entries being segmented.
+     *  dictionary entries are shared by all the tasks, so their offset and
+     *  control mask are set on these copies instead.
+     */
+    lex_entry_cdt lex[2];
 } friso_task_entry;
 typedef friso_task_entry * friso_task_t;
 
@@ -300,6 +306,16 @@ FRISO_API fstring file_get_line( fstring, FILE * );
  */
 FRISO_API void friso_dic_free( friso_dic_t );
 
+/*
+ * Function: friso_dic_freeze
+ * Usage: friso_dic_freeze( dic );
+ * -------------------------------
+ * This function is used to compact a fully loaded dictionary for faster
+ *     lookups (see hash_freeze). No words can be added after it, and the 
+ *     dictionary can be shared by tasks segmenting in many threads at once.
+ */
+FRISO_API void friso_dic_freeze( friso_dic_t );
+
 //create a new lexicon entry.
 FRISO_API lex_entry_t new_lex_entry( fstring, friso_array_t, uint_t, uint_t, uint_t );
 
@@ -308,12 +308,22 @@ typedef struct hash_entry friso_hash_entry;
 typedef friso_hash_entry * hash_entry_t;
 typedef void (*fhash_callback_fn_t)( hash_entry_t ); 
 
+/* a slot of a frozen hash table.*/
+typedef struct {
+    uint_t code;                    //the full hash code of the key
+    fstring _key;                   //NULL for an empty slot
+    void * _val;
+} friso_hash_slot;
+
 typedef struct {
     uint_t length;
     uint_t size;
     float factor;
     uint_t threshold;
     hash_entry_t *table;
+    //set once the table is frozen, see hash_freeze.
+    friso_hash_slot *slots;
+    uint_t mask;
 } friso_hash_cdt;
 
 typedef friso_hash_cdt * friso_hash_t;
@@ -371,6 +381,18 @@ FRISO_API void * hash_get_value( friso_hash_t, fstring );
  */
 FRISO_API hash_entry_t hash_remove_mapping( friso_hash_t, fstring );
 
+/*
+ * Function: hash_freeze
+ * Usage: hash_freeze( table );
+ * ----------------------------
+ * This function compacts a table that will not change anymore into a single
+ *     open addressing array, so lookups don't chase the bucket chains and
+ *     compare the hash codes before the keys. Once frozen, the table is read
+ *     only (mappings cannot be put or removed) and safe to read from many
+ *     threads at once.
+ */
+FRISO_API void hash_freeze( friso_hash_t );
+
 /*
  * Function: get_table_size
  * Usage: size = get_table_size( table );
@@ -16,7 +16,7 @@
 /* ************************
  *  mapping function area *
  **************************/
-__STATIC_API__ uint_t hash( fstring str, uint_t length ) 
+__STATIC_API__ uint_t hash_code( fstring str ) 
 {
     //hash code
     uint_t h = 0;
@@ -25,7 +25,39 @@ __STATIC_API__ uint_t hash( fstring str, uint_t length )
         h = h * HASH_FACTOR + ( *str++ );
     }
 
-    return (h % length);
+    return h;
+}
+
+__STATIC_API__ uint_t hash( fstring str, uint_t length ) 
+{
+    return (hash_code( str ) % length);
+}
+
+//mix the bits of a hash code, for the power of 2 sized frozen tables.
+__STATIC_API__ uint_t slot_index( uint_t code, uint_t mask ) 
+{
+    code ^= code >> 16;
+    code *= 0x85ebca6b;
+    code ^= code >> 13;
+    return code & mask;
+}
+
+//look a key up in a frozen table. returns NULL if not found.
+__STATIC_API__ friso_hash_slot *frozen_get_slot( friso_hash_t _hash, fstring key ) 
+{
+    uint_t code = ( key == NULL ) ? 0 : hash_code( key );
+    uint_t i = slot_index( code, _hash->mask );
+    friso_hash_slot *slot;
+
+    for ( slot = _hash->slots + i; slot->_key != NULL; 
+            i = ( i + 1 ) & _hash->mask, slot = _hash->slots + i ) {
+        if ( slot->code == code && key != NULL 
+                && strcmp( key, slot->_key ) == 0 ) {
+            return slot;
+        }
+    }
+
+    return NULL;
 }
 
 /*test if a integer is a prime.*/
@@ -162,6 +194,8 @@ FRISO_API friso_hash_t new_hash_table( void )
     _hash->factor    = DEFAULT_FACTOR;
     _hash->threshold = ( uint_t ) ( _hash->length * _hash->factor );
     _hash->table     = create_hash_entries( _hash->length );
+    _hash->slots     = NULL;
+    _hash->mask      = 0;
 
     return _hash;
 }
@@ -172,6 +206,21 @@ FRISO_API void free_hash_table(
 {
     register uint_t j;
     hash_entry_t e, n;
+    friso_hash_entry fe;
+
+    if ( _hash->slots != NULL ) {
+        for ( j = 0; j <= _hash->mask; j++ ) {
+            if ( _hash->slots[j]._key != NULL && fentry_func != NULL ) {
+                fe._key  = _hash->slots[j]._key;
+                fe._val  = _hash->slots[j]._val;
+                fe._next = NULL;
+                fentry_func(&fe);
+            }
+        }
+        FRISO_FREE( _hash->slots );
+        FRISO_FREE( _hash );
+        return;
+    }
 
     for ( j = 0; j < _hash->length; j++ ) {
         e = *( _hash->table + j );
@@ -196,6 +245,11 @@ FRISO_API void *hash_put_mapping(
     fstring key, 
     void * value ) 
 {
+    //frozen tables are read only.
+    if ( _hash->slots != NULL ) {
+        return NULL;
+    }
+
     uint_t bucket = ( key == NULL ) ? 0 : hash( key, _hash->length );
     hash_entry_t e = *( _hash->table + bucket );
     void *oval = NULL;
@@ -228,6 +282,10 @@ FRISO_API void *hash_put_mapping(
 FRISO_API int hash_exist_mapping( 
     friso_hash_t _hash, fstring key ) 
 {
+    if ( _hash->slots != NULL ) {
+        return frozen_get_slot( _hash, key ) != NULL;
+    }
+
     uint_t bucket = ( key == NULL ) ? 0 : hash( key, _hash->length );
     hash_entry_t e;
 
@@ -246,6 +304,11 @@ FRISO_API int hash_exist_mapping(
 //get the value associated with the given key.
 FRISO_API void *hash_get_value( friso_hash_t _hash, fstring key ) 
 {
+    if ( _hash->slots != NULL ) {
+        friso_hash_slot *slot = frozen_get_slot( _hash, key );
+        return slot == NULL ? NULL : slot->_val;
+    }
+
     uint_t bucket = ( key == NULL ) ? 0 : hash( key, _hash->length );
     hash_entry_t e;
 
@@ -265,6 +328,11 @@ FRISO_API void *hash_get_value( friso_hash_t _hash, fstring key )
 FRISO_API hash_entry_t hash_remove_mapping( 
     friso_hash_t _hash, fstring key ) 
 {
+    //frozen tables are read only.
+    if ( _hash->slots != NULL ) {
+        return NULL;
+    }
+
     uint_t bucket = ( key == NULL ) ? 0 : hash( key, _hash->length );
     hash_entry_t e, prev = NULL;
     hash_entry_t b;
@@ -295,3 +363,47 @@ FRISO_API hash_entry_t hash_remove_mapping(
 //FRISO_API uint_t hash_get_size( friso_hash_t _hash ) {
 //    return _hash->size;
 //}
+
+//compact the table into a read only open addressing array.
+FRISO_API void hash_freeze( friso_hash_t _hash ) 
+{
+    register uint_t t;
+    uint_t cap = 16, i;
+    hash_entry_t e, next;
+
+    if ( _hash->slots != NULL ) {
+        return;
+    }
+
+    //keep the load factor at 0.75 at most.
+    while ( cap * 3 < _hash->size * 4 ) {
+        cap *= 2;
+    }
+    _hash->slots = ( friso_hash_slot * ) FRISO_CALLOC( sizeof( friso_hash_slot ), cap );
+    if ( _hash->slots == NULL ) {
+        ___ALLOCATION_ERROR___
+    }
+    _hash->mask = cap - 1;
+
+    for ( t = 0; t < _hash->length; t++ ) {
+        for ( e = _hash->table[t]; e != NULL; e = next ) {
+            next = e->_next;
+            //the NULL key can't be told from an empty slot, and nobody puts it.
+            if ( e->_key != NULL ) {
+                uint_t code = hash_code( e->_key );
+                i = slot_index( code, _hash->mask );
+                while ( _hash->slots[i]._key != NULL ) {
+                    i = ( i + 1 ) & _hash->mask;
+                }
+                _hash->slots[i].code = code;
+                _hash->slots[i]._key = e->_key;
+                _hash->slots[i]._val = e->_val;
+            }
+            FRISO_FREE( e );
+        }
+    }
+
+    FRISO_FREE( _hash->table );
+    _hash->table  = NULL;
+    _hash->length = 0;
+}
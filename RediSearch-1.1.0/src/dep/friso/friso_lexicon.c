@@ -69,6 +69,14 @@ FRISO_API void friso_dic_free( friso_dic_t dic )
 }
 
 
+FRISO_API void friso_dic_freeze( friso_dic_t dic ) 
+{
+    register uint_t t;
+    for ( t = 0; t < __FRISO_LEXICON_LENGTH__; t++ ) {
+        hash_freeze( dic[t] );
+    }
+}
+
 //create a new lexicon entry
 FRISO_API lex_entry_t new_lex_entry( 
         fstring word, 
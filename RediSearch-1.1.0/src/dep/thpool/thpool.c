@@ -53,13 +53,15 @@ typedef struct job {
   void* arg;                   /* function's argument       */
 } job;
 
-/* Job queue */
+/* Job queue - one FIFO list per priority */
 typedef struct jobqueue {
-  pthread_mutex_t rwmutex; /* used for queue r/w access */
-  job* front;              /* pointer to front of queue */
-  job* rear;               /* pointer to rear  of queue */
-  bsem* has_jobs;          /* flag as binary semaphore  */
-  int len;                 /* number of jobs in queue   */
+  pthread_mutex_t rwmutex;             /* used for queue r/w access          */
+  job* front[THPOOL_NUM_PRIORITIES];   /* pointer to front of each priority  */
+  job* rear[THPOOL_NUM_PRIORITIES];    /* pointer to rear of each priority   */
+  int lens[THPOOL_NUM_PRIORITIES];     /* number of jobs of each priority    */
+  int skips[THPOOL_NUM_PRIORITIES];    /* times passed over for a higher one */
+  bsem* has_jobs;                      /* flag as binary semaphore           */
+  int len;                             /* number of jobs in queue            */
 } jobqueue;
 
 /* Thread */
@@ -88,7 +90,7 @@ static void thread_destroy(struct thread* thread_p);
 
 static int jobqueue_init(jobqueue* jobqueue_p);
 static void jobqueue_clear(jobqueue* jobqueue_p);
-static void jobqueue_push(jobqueue* jobqueue_p, struct job* newjob_p);
+static void jobqueue_push(jobqueue* jobqueue_p, struct job* newjob_p, int priority);
 static struct job* jobqueue_pull(jobqueue* jobqueue_p);
 static void jobqueue_destroy(jobqueue* jobqueue_p);
 
@@ -157,8 +159,19 @@ struct thpool_* thpool_init(int num_threads) {
 
 /* Add work to the thread pool */
 int thpool_add_work(thpool_* thpool_p, void (*function_p)(void*), void* arg_p) {
+  return thpool_add_work_priority(thpool_p, function_p, arg_p, THPOOL_PRIORITY_HIGH);
+}
+
+/* Add work with a given priority to the thread pool */
+int thpool_add_work_priority(thpool_* thpool_p, void (*function_p)(void*), void* arg_p,
+                             int priority) {
   job* newjob;
 
+  if (priority < THPOOL_PRIORITY_HIGH || priority >= THPOOL_NUM_PRIORITIES) {
+    err("thpool_add_work_priority(): Invalid priority\n");
+    return -1;
+  }
+
   newjob = (struct job*)malloc(sizeof(struct job));
   if (newjob == NULL) {
     err("thpool_add_work(): Could not allocate memory for new job\n");
@@ -170,7 +183,7 @@ int thpool_add_work(thpool_* thpool_p, void (*function_p)(void*), void* arg_p) {
   newjob->arg = arg_p;
 
   /* add job to queue */
-  jobqueue_push(&thpool_p->jobqueue, newjob);
+  jobqueue_push(&thpool_p->jobqueue, newjob, priority);
 
   return 0;
 }
@@ -363,8 +376,12 @@ static void thread_destroy(thread* thread_p) {
 /* Initialize queue */
 static int jobqueue_init(jobqueue* jobqueue_p) {
   jobqueue_p->len = 0;
-  jobqueue_p->front = NULL;
-  jobqueue_p->rear = NULL;
+  for (int i = 0; i < THPOOL_NUM_PRIORITIES; i++) {
+    jobqueue_p->front[i] = NULL;
+    jobqueue_p->rear[i] = NULL;
+    jobqueue_p->lens[i] = 0;
+    jobqueue_p->skips[i] = 0;
+  }
 
   jobqueue_p->has_jobs = (struct bsem*)malloc(sizeof(struct bsem));
   if (jobqueue_p->has_jobs == NULL) {
@@ -384,64 +401,91 @@ static void jobqueue_clear(jobqueue* jobqueue_p) {
     free(jobqueue_pull(jobqueue_p));
   }
 
-  jobqueue_p->front = NULL;
-  jobqueue_p->rear = NULL;
   bsem_reset(jobqueue_p->has_jobs);
   jobqueue_p->len = 0;
 }
 
 /* Add (allocated) job to queue
  */
-static void jobqueue_push(jobqueue* jobqueue_p, struct job* newjob) {
+static void jobqueue_push(jobqueue* jobqueue_p, struct job* newjob, int priority) {
 
   pthread_mutex_lock(&jobqueue_p->rwmutex);
   newjob->prev = NULL;
 
-  switch (jobqueue_p->len) {
+  switch (jobqueue_p->lens[priority]) {
 
-    case 0: /* if no jobs in queue */
-      jobqueue_p->front = newjob;
-      jobqueue_p->rear = newjob;
+    case 0: /* if no jobs of this priority in queue */
+      jobqueue_p->front[priority] = newjob;
+      jobqueue_p->rear[priority] = newjob;
       break;
 
-    default: /* if jobs in queue */
-      jobqueue_p->rear->prev = newjob;
-      jobqueue_p->rear = newjob;
+    default: /* if jobs of this priority in queue */
+      jobqueue_p->rear[priority]->prev = newjob;
+      jobqueue_p->rear[priority] = newjob;
   }
+  jobqueue_p->lens[priority]++;
   jobqueue_p->len++;
 
   bsem_post(jobqueue_p->has_jobs);
   pthread_mutex_unlock(&jobqueue_p->rwmutex);
 }
 
-/* Get first job from queue(removes it from queue)
-<<<<<<< HEAD
+/* Pick the priority to serve next: the highest one that has jobs, unless a lower one was passed
+ * over THPOOL_MAX_SKIPS times, in which case it gets its turn so it is never starved.
  *
- * Notice: Caller MUST hold a mutex
-=======
->>>>>>> da2c0fe45e43ce0937f272c8cd2704bdc0afb490
+ * Notice: Caller MUST hold the queue mutex and the queue must not be empty
+ */
+static int jobqueue_pick(jobqueue* jobqueue_p) {
+  int picked = -1;
+  for (int i = 0; i < THPOOL_NUM_PRIORITIES; i++) {
+    if (!jobqueue_p->lens[i]) continue;
+    if (picked == -1) {
+      picked = i;
+    } else if (jobqueue_p->skips[i] >= THPOOL_MAX_SKIPS) {
+      picked = i;
+      break;
+    }
+  }
+
+  /* every waiting lower priority was passed over once more */
+  for (int i = picked + 1; i < THPOOL_NUM_PRIORITIES; i++) {
+    if (jobqueue_p->lens[i] && jobqueue_p->skips[i] < THPOOL_MAX_SKIPS) {
+      jobqueue_p->skips[i]++;
+    }
+  }
+  jobqueue_p->skips[picked] = 0;
+  return picked;
+}
+
+/* Get the next job from queue(removes it from queue)
  */
 static struct job* jobqueue_pull(jobqueue* jobqueue_p) {
 
   pthread_mutex_lock(&jobqueue_p->rwmutex);
-  job* job_p = jobqueue_p->front;
+  if (!jobqueue_p->len) {
+    pthread_mutex_unlock(&jobqueue_p->rwmutex);
+    return NULL;
+  }
 
-  switch (jobqueue_p->len) {
+  int priority = jobqueue_pick(jobqueue_p);
+  job* job_p = jobqueue_p->front[priority];
 
-    case 0: /* if no jobs in queue */
-      break;
+  switch (jobqueue_p->lens[priority]) {
 
-    case 1: /* if one job in queue */
-      jobqueue_p->front = NULL;
-      jobqueue_p->rear = NULL;
-      jobqueue_p->len = 0;
+    case 1: /* if one job of this priority in queue */
+      jobqueue_p->front[priority] = NULL;
+      jobqueue_p->rear[priority] = NULL;
       break;
 
-    default: /* if >1 jobs in queue */
-      jobqueue_p->front = job_p->prev;
-      jobqueue_p->len--;
-      /* more than one job in queue -> post it */
-      bsem_post(jobqueue_p->has_jobs);
+    default: /* if >1 jobs of this priority in queue */
+      jobqueue_p->front[priority] = job_p->prev;
+  }
+  jobqueue_p->lens[priority]--;
+  jobqueue_p->len--;
+
+  /* more jobs in queue -> post it */
+  if (jobqueue_p->len) {
+    bsem_post(jobqueue_p->has_jobs);
   }
 
   pthread_mutex_unlock(&jobqueue_p->rwmutex);
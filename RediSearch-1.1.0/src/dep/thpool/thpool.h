@@ -16,6 +16,13 @@ extern "C" {
 
 typedef struct thpool_* threadpool;
 
+/* The number of job priorities, and the highest one */
+#define THPOOL_NUM_PRIORITIES 4
+#define THPOOL_PRIORITY_HIGH 0
+
+/* How many times in a row a waiting priority may be passed over for a higher one */
+#define THPOOL_MAX_SKIPS 8
+
 
 /**
  * @brief  Initialize threadpool
@@ -66,6 +73,24 @@ threadpool thpool_init(int num_threads);
  */
 int thpool_add_work(threadpool, void (*function_p)(void*), void* arg_p);
 
+/**
+ * @brief Add work with a priority to the job queue
+ *
+ * Same as thpool_add_work, but the job is queued with the given priority, from
+ * THPOOL_PRIORITY_HIGH (0) to THPOOL_NUM_PRIORITIES - 1. Threads always take the
+ * oldest job of the highest priority available, except that a priority that has
+ * been passed over THPOOL_MAX_SKIPS times in a row is served next, so lower
+ * priorities are delayed but never starved. thpool_add_work uses
+ * THPOOL_PRIORITY_HIGH.
+ *
+ * @param  threadpool    threadpool to which the work will be added
+ * @param  function_p    pointer to function to add as work
+ * @param  arg_p         pointer to an argument
+ * @param  priority      the job's priority, lower is more urgent
+ * @return 0 on successs, -1 otherwise.
+ */
+int thpool_add_work_priority(threadpool, void (*function_p)(void*), void* arg_p, int priority);
+
 
 /**
  * @brief Wait for all queued jobs to finish
@@ -225,7 +225,8 @@ void AddDocumentCtx_Submit(RSAddDocumentCtx *aCtx, RedisSearchCtx *sctx, uint32_
   }
 
   if (totalSize >= SELF_EXEC_THRESHOLD && AddDocumentCtx_IsBlockable(aCtx)) {
-    ConcurrentSearch_ThreadPoolRun(threadCallback, aCtx, CONCURRENT_POOL_INDEX);
+    ConcurrentSearch_ThreadPoolRun(threadCallback, aCtx, CONCURRENT_POOL_INDEX,
+                                   ConcurrentPriority_Indexing);
   } else {
     Document_AddToIndexes(aCtx);
   }
@@ -285,15 +286,20 @@ FIELD_PREPROCESSOR(fulltextPreprocessor) {
     }
 
     ForwardIndexTokenizerCtx_Init(&tokCtx, aCtx->fwIdx, c, curOffsetWriter, fs->textOpts.id,
-                                  fs->textOpts.weight);
-    aCtx->tokenizer->Start(aCtx->tokenizer, (char *)c, fl,
-                           FieldSpec_IsNoStem(fs) ? TOKENIZE_NOSTEM : TOKENIZE_DEFAULT_OPTIONS);
+                                  fs->textOpts.weight, FieldSpec_IsShingled(fs));
+    uint32_t tokOpts = FieldSpec_IsNoStem(fs) ? TOKENIZE_NOSTEM : TOKENIZE_DEFAULT_OPTIONS;
+    if (FieldSpec_IsShingled(fs)) {
+      tokOpts |= TOKENIZE_STOPWORDS;
+    }
+    aCtx->tokenizer->Start(aCtx->tokenizer, (char *)c, fl, tokOpts);
     Token tok;
     uint32_t lastTokPos = 0;
     uint32_t newTokPos;
     while (0 != (newTokPos = aCtx->tokenizer->Next(aCtx->tokenizer, &tok))) {
       forwardIndexTokenFunc(&tokCtx, &tok);
-      lastTokPos = newTokPos;
+      if (!(tok.flags & Token_Stopword)) {
+        lastTokPos = newTokPos;
+      }
     }
 
     if (curOffsetField) {
@@ -471,7 +477,10 @@ static void AddDocumentCtx_UpdateNoIndex(RSAddDocumentCtx *aCtx, RedisSearchCtx
     BAIL("Couldn't load document metadata");
   }
 
-  // Update the score
+  // Update the score. A raised score may make the document a champion of its terms
+  if (doc->score > md->score) {
+    sctx->spec->scoreRevision++;
+  }
   md->score = doc->score;
   // Set the payload if needed
   if (doc->payload) {
@@ -522,6 +531,8 @@ static void AddDocumentCtx_UpdateNoIndex(RSAddDocumentCtx *aCtx, RedisSearchCtx
   }
 
 done:
+  // the score, payload or sort keys of the document may have changed
+  sctx->spec->revision++;
   if (aCtx->errorString) {
     RedisModule_ReplyWithError(sctx->redisCtx, aCtx->errorString);
   } else {
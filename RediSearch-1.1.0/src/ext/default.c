@@ -2,7 +2,6 @@
 #include <stdio.h>
 #include <sys/param.h>
 #include "../redisearch.h"
-#include "../dep/snowball/include/libstemmer.h"
 #include "default.h"
 #include "../tokenize.h"
 #include "../rmutil/vector.h"
@@ -69,6 +68,56 @@ double TFIDFNormDocLenScorer(RSScoringFunctionCtx *ctx, RSIndexResult *h, RSDocu
   return tfIdfInternal(ctx, h, dmd, minScore, NORM_DOCLEN);
 }
 
+/* Sum up the scores of the leaves of each result in a batch */
+static void sumLeafScores(const RSScoringBatch *b, const double *leafScores, double *sums) {
+  for (size_t i = 0; i < b->numResults; i++) {
+    double sum = 0;
+    for (size_t j = b->leafOffsets[i]; j < b->leafOffsets[i + 1]; j++) {
+      sum += leafScores[j];
+    }
+    sums[i] = sum;
+  }
+}
+
+/* Apply the minimal score and the slop of each result to the raw scores of a batch, the same way
+ * the single result scorers do */
+static void applySlop(const RSScoringBatch *b, double minScore, double *scores) {
+  for (size_t i = 0; i < b->numResults; i++) {
+    scores[i] = scores[i] < minScore ? 0 : scores[i] / (double)b->slops[i];
+  }
+}
+
+/* Batch version of tfIdfInternal. The leaves of all the results are scored in one flat loop, and
+ * the per result loops run over plain arrays, so the compiler can vectorize them */
+static void tfIdfBatchInternal(const RSScoringBatch *b, double minScore, double *scores,
+                               int normMode) {
+  const double *freqs = b->leafFreqs, *idfs = b->leafIdfs;
+  double *leafScores = b->scratch;
+  for (size_t j = 0; j < b->numLeaves; j++) {
+    leafScores[j] = freqs[j] * idfs[j];
+  }
+  sumLeafScores(b, leafScores, scores);
+
+  const double *norms = normMode == NORM_MAXFREQ ? b->maxFreqs : b->docLens;
+  for (size_t i = 0; i < b->numResults; i++) {
+    scores[i] = b->docScores[i] * scores[i] / norms[i];
+  }
+  applySlop(b, minScore, scores);
+  for (size_t i = 0; i < b->numResults; i++) {
+    if (b->docScores[i] == 0) scores[i] = 0;
+  }
+}
+
+void TFIDFBatchScorer(RSScoringFunctionCtx *ctx, const RSScoringBatch *b, double minScore,
+                      double *scores) {
+  tfIdfBatchInternal(b, minScore, scores, NORM_MAXFREQ);
+}
+
+void TFIDFNormDocLenBatchScorer(RSScoringFunctionCtx *ctx, const RSScoringBatch *b,
+                                double minScore, double *scores) {
+  tfIdfBatchInternal(b, minScore, scores, NORM_DOCLEN);
+}
+
 /******************************************************************************************
  *
  * BM25 Scoring Functions
@@ -77,16 +126,17 @@ double TFIDFNormDocLenScorer(RSScoringFunctionCtx *ctx, RSIndexResult *h, RSDocu
  *
  ******************************************************************************************/
 
+static const float bm25_b = 0.5;
+static const float bm25_k1 = 1.2;
+
 /* recursively calculate score for each token, summing up sub tokens */
 static double bm25Recursive(RSScoringFunctionCtx *ctx, RSIndexResult *r, RSDocumentMetadata *dmd) {
-  static const float b = 0.5;
-  static const float k1 = 1.2;
   double f = (double)r->freq;
 
   if (r->type == RSResultType_Term) {
     double idf = (r->term.term ? r->term.term->idf : 0);
 
-    double ret = idf * f / (f + k1 * (1.0f - b + b * ctx->indexStats.avgDocLen));
+    double ret = idf * f / (f + bm25_k1 * (1.0f - bm25_b + bm25_b * ctx->indexStats.avgDocLen));
     return ret;
   }
 
@@ -98,7 +148,7 @@ static double bm25Recursive(RSScoringFunctionCtx *ctx, RSIndexResult *r, RSDocum
     return ret;
   }
   // default for virtual type -just disregard the idf
-  return r->freq ? f / (f + k1 * (1.0f - b + b * ctx->indexStats.avgDocLen)) : 0;
+  return r->freq ? f / (f + bm25_k1 * (1.0f - bm25_b + bm25_b * ctx->indexStats.avgDocLen)) : 0;
 }
 
 /* BM25 scoring function */
@@ -115,6 +165,24 @@ double BM25Scorer(RSScoringFunctionCtx *ctx, RSIndexResult *r, RSDocumentMetadat
   return score;
 }
 
+/* Batch version of the BM25 scorer. Leaves that are not terms have an idf of 1, which gives the
+ * same score bm25Recursive gives them */
+void BM25BatchScorer(RSScoringFunctionCtx *ctx, const RSScoringBatch *batch, double minScore,
+                     double *scores) {
+  const double k = bm25_k1 * (1.0f - bm25_b + bm25_b * ctx->indexStats.avgDocLen);
+  const double *freqs = batch->leafFreqs, *idfs = batch->leafIdfs;
+  double *leafScores = batch->scratch;
+  for (size_t j = 0; j < batch->numLeaves; j++) {
+    leafScores[j] = idfs[j] * freqs[j] / (freqs[j] + k);
+  }
+  sumLeafScores(batch, leafScores, scores);
+
+  for (size_t i = 0; i < batch->numResults; i++) {
+    scores[i] = batch->docScores[i] * scores[i];
+  }
+  applySlop(batch, minScore, scores);
+}
+
 /******************************************************************************************
  *
  * Raw document-score scorer. Just returns the document score
@@ -125,6 +193,11 @@ double DocScoreScorer(RSScoringFunctionCtx *ctx, RSIndexResult *r, RSDocumentMet
   return dmd->score;
 }
 
+void DocScoreBatchScorer(RSScoringFunctionCtx *ctx, const RSScoringBatch *b, double minScore,
+                         double *scores) {
+  memcpy(scores, b->docScores, b->numResults * sizeof(double));
+}
+
 /******************************************************************************************
  *
  * DISMAX-style scorer
@@ -200,7 +273,8 @@ typedef struct {
       RSTokenizer *tokenizer;
       Vector *tokList;
     } cn;
-    struct sb_stemmer *latin;
+    // owned by the thread, see GetThreadStemmer
+    Stemmer *latin;
   } data;
 } defaultExpanderCtx;
 
@@ -256,7 +330,7 @@ void DefaultStemmerExpand(RSQueryExpanderCtx *ctx, RSToken *token) {
 
   // we store the stemmer as private data on the first call to expand
   defaultExpanderCtx *dd = ctx->privdata;
-  struct sb_stemmer *sb;
+  Stemmer *sb;
 
   if (!ctx->privdata) {
     if (!strcasecmp(ctx->language, "chinese")) {
@@ -265,7 +339,7 @@ void DefaultStemmerExpand(RSQueryExpanderCtx *ctx, RSToken *token) {
     } else {
       dd = ctx->privdata = calloc(1, sizeof(*dd));
       dd->isCn = 0;
-      sb = dd->data.latin = sb_stemmer_new(ctx->language, NULL);
+      sb = dd->data.latin = GetThreadStemmer(ctx->language);
     }
   }
 
@@ -282,20 +356,20 @@ void DefaultStemmerExpand(RSQueryExpanderCtx *ctx, RSToken *token) {
     return;
   }
 
-  const sb_symbol *b = (const sb_symbol *)token->str;
-  const sb_symbol *stemmed = sb_stemmer_stem(sb, b, token->len);
+  // the stemmer returns the stem with its + prefix, or NULL if the token stems to itself
+  size_t sl;
+  const char *stemmed = sb->Stem(sb->ctx, token->str, token->len, &sl);
 
   if (stemmed) {
-    int sl = sb_stemmer_length(sb);
-
-    // Make a copy of the stemmed buffer with the + prefix given to stems
-    char *dup = malloc(sl + 2);
+    ctx->ExpandToken(ctx, strndup(stemmed, sl), sl, 0x0);  // TODO: Set proper flags here
+    ctx->ExpandToken(ctx, strndup(stemmed + 1, sl - 1), sl - 1, 0x0);
+  } else {
+    // Make a copy of the token with the + prefix given to stems
+    char *dup = malloc(token->len + 2);
     dup[0] = STEM_PREFIX;
-    memcpy(dup + 1, stemmed, sl + 1);
-    ctx->ExpandToken(ctx, dup, sl + 1, 0x0);  // TODO: Set proper flags here
-    if (sl != token->len || strncmp((const char *)stemmed, token->str, token->len)) {
-      ctx->ExpandToken(ctx, strndup((const char *)stemmed, sl), sl, 0x0);
-    }
+    memcpy(dup + 1, token->str, token->len);
+    dup[token->len + 1] = '\0';
+    ctx->ExpandToken(ctx, dup, token->len + 1, 0x0);
   }
 }
 
@@ -307,8 +381,6 @@ void defaultExpanderFree(void *p) {
   if (dd->isCn) {
     dd->data.cn.tokenizer->Free(dd->data.cn.tokenizer);
     Vector_Free(dd->data.cn.tokList);
-  } else if (dd->data.latin) {
-    sb_stemmer_delete(dd->data.latin);
   }
   free(dd);
 }
@@ -349,6 +421,16 @@ int DefaultExtensionInit(RSExtensionCtx *ctx) {
     return REDISEARCH_ERR;
   }
 
+  /* Batch versions of the scorers that only look at term frequencies and document stats. DisMax
+   * depends on the shape of the result tree, and Hamming distance on payloads, so they have none */
+  if (ctx->RegisterBatchScoringFunction(DEFAULT_SCORER_NAME, TFIDFBatchScorer) == REDISEARCH_ERR ||
+      ctx->RegisterBatchScoringFunction(TFIDF_DOCNORM_SCORER_NAME, TFIDFNormDocLenBatchScorer) ==
+          REDISEARCH_ERR ||
+      ctx->RegisterBatchScoringFunction(BM25_SCORER_NAME, BM25BatchScorer) == REDISEARCH_ERR ||
+      ctx->RegisterBatchScoringFunction(DOCSCORE_SCORER, DocScoreBatchScorer) == REDISEARCH_ERR) {
+    return REDISEARCH_ERR;
+  }
+
   /* Snowball Stemmer is the default expander */
   if (ctx->RegisterQueryExpander(DEFAULT_EXPANDER_NAME, DefaultStemmerExpand, defaultExpanderFree,
                                  NULL) == REDISEARCH_ERR) {
@@ -68,6 +68,11 @@ static void ForwardIndex_InitCommon(ForwardIndex *idx, Document *doc, uint32_t i
   idx->idxFlags = idxFlags;
   idx->maxFreq = 0;
   idx->totalFreq = 0;
+  idx->shinglePos = 0;
+  // keep the stemmer (and its stem cache) of the previous document if it's in the same language
+  if (idx->stemmer && doc->language && !strcasecmp(idx->stemmer->language, doc->language)) {
+    return;
+  }
   if (idx->stemmer) {
     idx->stemmer->Free(idx->stemmer);
   }
@@ -148,7 +153,7 @@ static khIdxEntry *makeEntry(ForwardIndex *idx, const char *s, size_t n, uint32_
 
 static void ForwardIndex_HandleToken(ForwardIndex *idx, const char *tok, size_t tokLen,
                                      uint32_t pos, float fieldScore, t_fieldId fieldId, int isStem,
-                                     int shouldCopy) {
+                                     int shouldCopy, int isShingle) {
   // LG_DEBUG("token %.*s, hval %d\n", t.len, t.s, hval);
   ForwardIndexEntry *h = NULL;
   int isNew = 0;
@@ -190,8 +195,11 @@ static void ForwardIndex_HandleToken(ForwardIndex *idx, const char *tok, size_t
     score *= STEM_TOKEN_FACTOR;
   }
   h->freq += MAX(1, (uint32_t)score);
-  idx->maxFreq = MAX(h->freq, idx->maxFreq);
-  idx->totalFreq += h->freq;
+  // shingles are not words of the document, and don't change its length or most frequent word
+  if (!isShingle) {
+    idx->maxFreq = MAX(h->freq, idx->maxFreq);
+    idx->totalFreq += h->freq;
+  }
   if (h->vw) {
     VVW_Write(h->vw, pos);
   }
@@ -202,10 +210,39 @@ static void ForwardIndex_HandleToken(ForwardIndex *idx, const char *tok, size_t
 // void ForwardIndex_NormalizeFreq(ForwardIndex *idx, ForwardIndexEntry *e) {
 //   e->freq = e->freq / idx->maxFreq;
 // }
+/* Add the shingle of the previous word and this one. Shingles have their own positions, counting
+ * stopwords too, so that a phrase matches only the words right next to each other */
+static void forwardIndex_HandleShingle(ForwardIndexTokenizerCtx *tokCtx, const Token *tokInfo) {
+  uint32_t pos = ++tokCtx->idx->shinglePos;
+  if (tokCtx->prevLen && tokInfo->tokLen <= SHINGLE_MAX_WORDLEN) {
+    char buf[SHINGLE_MAX_LEN];
+    size_t len =
+        Shingle_Format(buf, tokCtx->prevWord, tokCtx->prevLen, tokInfo->tok, tokInfo->tokLen);
+    ForwardIndex_HandleToken(tokCtx->idx, buf, len, pos - 1, tokCtx->fieldScore, tokCtx->fieldId,
+                             0, 1, 1);
+  }
+
+  if (tokInfo->tokLen <= SHINGLE_MAX_WORDLEN) {
+    memcpy(tokCtx->prevWord, tokInfo->tok, tokInfo->tokLen);
+    tokCtx->prevLen = tokInfo->tokLen;
+  } else {
+    tokCtx->prevLen = 0;
+  }
+}
+
 int forwardIndexTokenFunc(void *ctx, const Token *tokInfo) {
-  const ForwardIndexTokenizerCtx *tokCtx = ctx;
+  ForwardIndexTokenizerCtx *tokCtx = ctx;
+  if (tokCtx->shingles) {
+    forwardIndex_HandleShingle(tokCtx, tokInfo);
+  }
+  // stopwords are only seen by shingled fields, they are not terms of their own
+  if (tokInfo->flags & Token_Stopword) {
+    return 0;
+  }
+
   ForwardIndex_HandleToken(tokCtx->idx, tokInfo->tok, tokInfo->tokLen, tokInfo->pos,
-                           tokCtx->fieldScore, tokCtx->fieldId, 0, tokInfo->flags & Token_CopyRaw);
+                           tokCtx->fieldScore, tokCtx->fieldId, 0, tokInfo->flags & Token_CopyRaw,
+                           0);
 
   if (tokCtx->allOffsets) {
     VVW_Write(tokCtx->allOffsets, tokInfo->raw - tokCtx->doc);
@@ -214,7 +251,7 @@ int forwardIndexTokenFunc(void *ctx, const Token *tokInfo) {
   if (tokInfo->stem) {
     ForwardIndex_HandleToken(tokCtx->idx, tokInfo->stem, tokInfo->stemLen, tokInfo->pos,
                              tokCtx->fieldScore, tokCtx->fieldId, 1,
-                             tokInfo->flags & Token_CopyStem);
+                             tokInfo->flags & Token_CopyStem, 0);
   }
   return 0;
 }
@@ -8,6 +8,7 @@
 #include "varint.h"
 #include "tokenize.h"
 #include "document.h"
+#include <string.h>
 
 typedef struct ForwardIndexEntry {
   struct ForwardIndexEntry *next;
@@ -29,6 +30,8 @@ typedef struct ForwardIndex {
   KHTable *hits;
   uint32_t maxFreq;
   uint32_t totalFreq;
+  // the position of the last word of the document in its shingled fields, stopwords included
+  uint32_t shinglePos;
   uint32_t idxFlags;
   Stemmer *stemmer;
   BlkAlloc terms;
@@ -37,22 +40,54 @@ typedef struct ForwardIndex {
 
 } ForwardIndex;
 
+/* Shingles are the pairs of adjacent words of a field, indexed as terms to match exact phrases
+ * without reading the lists of their single words. A shingle term is SHINGLE_PREFIX, the first
+ * word, a space and the second word. Normalized words never have control characters or spaces, so
+ * shingles can't be confused with the words of a document. Words longer than SHINGLE_MAX_WORDLEN
+ * are not paired */
+#define SHINGLE_PREFIX '\x01'
+#define SHINGLE_MAX_WORDLEN 64
+#define SHINGLE_MAX_LEN (2 * SHINGLE_MAX_WORDLEN + 2)
+
+/* Format the shingle of two words into buf, which must have room for SHINGLE_MAX_LEN bytes.
+ * Returns its length */
+static inline size_t Shingle_Format(char *buf, const char *w1, size_t len1, const char *w2,
+                                    size_t len2) {
+  buf[0] = SHINGLE_PREFIX;
+  memcpy(buf + 1, w1, len1);
+  buf[len1 + 1] = ' ';
+  memcpy(buf + len1 + 2, w2, len2);
+  return len1 + len2 + 2;
+}
+
+/* Is an index term a shingle, rather than a word of the documents? */
+static inline int Shingle_IsShingle(const char *term, size_t len) {
+  return len && term[0] == SHINGLE_PREFIX;
+}
+
 typedef struct {
   const char *doc;
   VarintVectorWriter *allOffsets;
   ForwardIndex *idx;
   t_fieldId fieldId;
   float fieldScore;
+  // index the shingles of the field. The tokenizer must return its stopwords too
+  int shingles;
+  // the previous word of the field, the first one of the next shingle
+  char prevWord[SHINGLE_MAX_WORDLEN];
+  size_t prevLen;
 } ForwardIndexTokenizerCtx;
 
 static inline void ForwardIndexTokenizerCtx_Init(ForwardIndexTokenizerCtx *ctx, ForwardIndex *idx,
                                                  const char *doc, VarintVectorWriter *vvw,
-                                                 t_fieldId fieldId, float score) {
+                                                 t_fieldId fieldId, float score, int shingles) {
   ctx->idx = idx;
   ctx->fieldId = fieldId;
   ctx->fieldScore = score;
   ctx->doc = doc;
   ctx->allOffsets = vvw;
+  ctx->shingles = shingles;
+  ctx->prevLen = 0;
 }
 
 typedef struct {
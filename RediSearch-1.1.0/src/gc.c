@@ -9,6 +9,7 @@
 #include "redismodule.h"
 #include "rmutil/util.h"
 #include "gc.h"
+#include "config.h"
 #include "tests/time_sample.h"
 
 // convert a frequency to timespec
@@ -127,6 +128,10 @@ static void gc_periodicCallback(RedisModuleCtx *ctx, void *privdata) {
       totalRemoved += recordsRemoved;
       sctx->spec->stats.numRecords -= recordsRemoved;
       sctx->spec->stats.invertedSize -= bytesCollected;
+      if (recordsRemoved) {
+        // the term frequencies used for scoring have changed
+        sctx->spec->revision++;
+      }
       gc->stats.totalCollected += bytesCollected;
       totalCollected += bytesCollected;
 
@@ -154,6 +159,13 @@ static void gc_periodicCallback(RedisModuleCtx *ctx, void *privdata) {
     } while (idx != NULL);
   }
 
+  // drop the deleted champions of the term, rebuilding its tier if needed
+  if (sctx && idx && RSGlobalConfig.championThreshold &&
+      idx->numDocs >= RSGlobalConfig.championThreshold) {
+    InvertedIndex_CollectChampions(idx, &sctx->spec->docs, RSGlobalConfig.championSize,
+                                   sctx->spec->scoreRevision);
+  }
+
   if (totalRemoved) {
     RedisModule_Log(ctx, "notice", "Garbage collected %zd bytes in %zd records for term '%s'",
                     totalCollected, totalRemoved, term);
@@ -7,11 +7,67 @@
 #include "toksep.h"
 #include <ctype.h>
 
+/* A position of one of the query terms in the current document */
+typedef struct {
+  uint32_t pos;
+  RSQueryTerm *term;
+} hlpMatch;
+
 typedef struct {
   int fragmentizeOptions;
   const FieldList *fields;
+
+  // The positions of the query terms in the current document. Decoding them means merging the
+  // offset vectors of every term in the index result, so we do it once per document and replay the
+  // positions for each field we summarize
+  Array matches;  // hlpMatch
+  int hasMatches;
+
+  // Per fragment iovecs, reused across fields and documents
+  Array *iovsArr;
+  size_t numIovsArr;
 } hlpContext;
 
+/* Decode the offsets of all the terms in the index result into the match cache */
+static void hlpContext_LoadMatches(hlpContext *hlpCtx, RSIndexResult *indexResult) {
+  Array_Resize(&hlpCtx->matches, 0);
+  RSOffsetIterator offsIter = RSIndexResult_IterateOffsets(indexResult);
+  RSQueryTerm *term = NULL;
+  uint32_t pos;
+  while ((pos = offsIter.Next(offsIter.ctx, &term)) != RS_OFFSETVECTOR_EOF) {
+    hlpMatch *m = Array_Add(&hlpCtx->matches, sizeof(*m));
+    m->pos = pos;
+    m->term = term;
+  }
+  offsIter.Free(offsIter.ctx);
+  hlpCtx->hasMatches = 1;
+}
+
+/* An offset iterator over the cached matches, so the fragmenter can consume them like the offsets
+ * of the index result itself */
+typedef struct {
+  const hlpMatch *matches;
+  size_t num;
+  size_t cur;
+} matchIterCtx;
+
+static uint32_t matchIter_Next(void *ctx, RSQueryTerm **term) {
+  matchIterCtx *it = ctx;
+  if (it->cur == it->num) {
+    return RS_OFFSETVECTOR_EOF;
+  }
+  const hlpMatch *m = it->matches + it->cur++;
+  if (term) *term = m->term;
+  return m->pos;
+}
+
+static void matchIter_Rewind(void *ctx) {
+  ((matchIterCtx *)ctx)->cur = 0;
+}
+
+static void matchIter_Free(void *ctx) {
+}
+
 /**
  * Attempts to fragmentize a single field from its offset entries. This takes
  * the field name, gets the matching field ID, retrieves the offset iterator
@@ -21,50 +77,49 @@ typedef struct {
  * Returns true if the fragmentation succeeded, false otherwise.
  */
 static int fragmentizeOffsets(IndexSpec *spec, const char *fieldName, const char *fieldText,
-                              size_t fieldLen, RSIndexResult *indexResult,
+                              size_t fieldLen, hlpContext *hlpCtx, RSIndexResult *indexResult,
                               RSByteOffsets *byteOffsets, FragmentList *fragList, int options) {
   const FieldSpec *fs = IndexSpec_GetField(spec, fieldName, strlen(fieldName));
   if (!fs || fs->type != FIELD_FULLTEXT) {
     return 0;
   }
 
-  int rc = 0;
-  RSOffsetIterator offsIter = RSIndexResult_IterateOffsets(indexResult);
-  FragmentTermIterator fragIter = {NULL};
   RSByteOffsetIterator bytesIter;
   if (RSByteOffset_Iterate(byteOffsets, fs->textOpts.id, &bytesIter) != REDISMODULE_OK) {
-    goto done;
+    return 0;
   }
 
-  FragmentTermIterator_InitOffsets(&fragIter, &bytesIter, &offsIter);
-  FragmentList_FragmentizeIter(fragList, fieldText, fieldLen, &fragIter, options);
-  if (fragList->numFrags == 0) {
-    goto done;
+  if (!hlpCtx->hasMatches) {
+    hlpContext_LoadMatches(hlpCtx, indexResult);
   }
-  rc = 1;
+  matchIterCtx matchIter = {.matches = ARRAY_GETARRAY_AS(&hlpCtx->matches, const hlpMatch *),
+                            .num = ARRAY_GETSIZE_AS(&hlpCtx->matches, hlpMatch),
+                            .cur = 0};
+  RSOffsetIterator offsIter = {
+      .ctx = &matchIter, .Next = matchIter_Next, .Rewind = matchIter_Rewind, .Free = matchIter_Free};
 
-done:
-  offsIter.Free(offsIter.ctx);
-  return rc;
+  FragmentTermIterator fragIter = {NULL};
+  FragmentTermIterator_InitOffsets(&fragIter, &bytesIter, &offsIter);
+  FragmentList_FragmentizeIter(fragList, fieldText, fieldLen, &fragIter, options);
+  return fragList->numFrags != 0;
 }
 
-// Strip spaces from a buffer in place. Returns the new length of the text,
-// with all duplicate spaces stripped and converted to a single ' '.
-static size_t stripDuplicateSpaces(char *s, size_t n) {
-  int isLastSpace = 0;
+// Copy n bytes from src to dst, converting every run of spaces to a single ' '. Returns the number
+// of bytes written. isLastSpace carries the state between calls, so a text split into several
+// buffers is stripped as a whole. dst may be the same as src.
+static size_t copyStripDuplicateSpaces(char *dst, const char *src, size_t n, int *isLastSpace) {
   size_t oix = 0;
-  char *out = s;
   for (size_t ii = 0; ii < n; ++ii) {
-    if (isspace(s[ii])) {
-      if (isLastSpace) {
+    if (isspace(src[ii])) {
+      if (*isLastSpace) {
         continue;
       } else {
-        isLastSpace = 1;
-        out[oix++] = ' ';
+        *isLastSpace = 1;
+        dst[oix++] = ' ';
       }
     } else {
-      isLastSpace = 0;
-      out[oix++] = s[ii];
+      *isLastSpace = 0;
+      dst[oix++] = src[ii];
     }
   }
   return oix;
@@ -111,26 +166,60 @@ static char *trimField(const ReturnedField *fieldInfo, const char *docStr, size_
   headLen += estWordSize;  // Because we trim off a word when finding the toksep
   headLen = Min(headLen, *docLen);
 
-  Array bufTmp;
-  Array_InitEx(&bufTmp, ArrayAlloc_LibC);
-
-  Array_Write(&bufTmp, docStr, headLen);
-  headLen = stripDuplicateSpaces(bufTmp.data, headLen);
-  Array_Resize(&bufTmp, headLen);
+  char *buf = malloc(headLen + 1);
+  int isLastSpace = 0;
+  size_t len = copyStripDuplicateSpaces(buf, docStr, headLen, &isLastSpace);
 
-  while (bufTmp.len > 1) {
-    if (istoksep(bufTmp.data[--bufTmp.len])) {
-      --bufTmp.len;
+  while (len > 1) {
+    if (istoksep(buf[--len])) {
+      --len;
       break;
     }
   }
 
-  return Array_Steal(&bufTmp, docLen);
+  *docLen = len;
+  return buf;
+}
+
+// Write the highlighted fragments, each followed by the separator, into a single buffer. The size
+// of the output is known from the iovecs, so the text is copied exactly once, straight from the
+// field and the tags. Returns a string which should be freed using free()
+static char *writeFragments(const Array *iovsArr, size_t numIovArr, const char *sep,
+                            size_t *outLen) {
+  size_t sepLen = strlen(sep);
+  size_t total = numIovArr * sepLen;
+  for (size_t ii = 0; ii < numIovArr; ++ii) {
+    const struct iovec *iovs = ARRAY_GETARRAY_AS(iovsArr + ii, const struct iovec *);
+    size_t numIovs = ARRAY_GETSIZE_AS(iovsArr + ii, struct iovec);
+    for (size_t jj = 0; jj < numIovs; ++jj) {
+      total += iovs[jj].iov_len;
+    }
+  }
+
+  char *buf = malloc(total + 1);
+  size_t len = 0;
+  for (size_t ii = 0; ii < numIovArr; ++ii) {
+    const struct iovec *iovs = ARRAY_GETARRAY_AS(iovsArr + ii, const struct iovec *);
+    size_t numIovs = ARRAY_GETSIZE_AS(iovsArr + ii, struct iovec);
+
+    // Duplicate spaces are eliminated per snippet and not for the whole output, because the
+    // delimiter itself may contain a special kind of whitespace.
+    int isLastSpace = 0;
+    for (size_t jj = 0; jj < numIovs; ++jj) {
+      len += copyStripDuplicateSpaces(buf + len, iovs[jj].iov_base, iovs[jj].iov_len, &isLastSpace);
+    }
+    memcpy(buf + len, sep, sepLen);
+    len += sepLen;
+  }
+  buf[len] = '\0';
+
+  *outLen = len;
+  return buf;
 }
 
 static void summarizeField(IndexSpec *spec, const ReturnedField *fieldInfo, const char *fieldName,
-                           RSValue *returnedField, SearchResult *r, RSIndexResult *indexResult,
-                           int options, Array *iovsArr) {
+                           RSValue *returnedField, SearchResult *r, hlpContext *hlpCtx,
+                           RSIndexResult *indexResult) {
 
   FragmentList frags;
   FragmentList_Init(&frags, 8, 6);
@@ -143,8 +232,9 @@ static void summarizeField(IndexSpec *spec, const ReturnedField *fieldInfo, cons
   size_t docLen;
   RSByteOffsets *byteOffsets = r->md->byteOffsets;
   const char *docStr = RSValue_StringPtrLen(returnedField, &docLen);
-  if (byteOffsets == NULL || !fragmentizeOffsets(spec, fieldName, docStr, docLen, indexResult,
-                                                 byteOffsets, &frags, options)) {
+  if (byteOffsets == NULL ||
+      !fragmentizeOffsets(spec, fieldName, docStr, docLen, hlpCtx, indexResult, byteOffsets,
+                          &frags, hlpCtx->fragmentizeOptions)) {
     if (fieldInfo->mode == SummarizeMode_Synopsis) {
       // If summarizing is requested then trim the field so that the user isn't
       // spammed with a large blob of text
@@ -167,62 +257,36 @@ static void summarizeField(IndexSpec *spec, const ReturnedField *fieldInfo, cons
     return;
   }
 
+  Array *iovsArr = hlpCtx->iovsArr;
   size_t numIovArr = Min(fieldInfo->summarizeSettings.numFrags, FragmentList_GetNumFrags(&frags));
-  for (size_t ii = 0; ii < numIovArr; ++ii) {
-    Array_Resize(&iovsArr[ii], 0);
-  }
 
   FragmentList_HighlightFragments(&frags, &tags, fieldInfo->summarizeSettings.contextLen, iovsArr,
                                   numIovArr, HIGHLIGHT_ORDER_SCOREPOS);
 
-  // Buffer to store concatenated fragments
-  Array bufTmp;
-  Array_InitEx(&bufTmp, ArrayAlloc_LibC);
-
-  for (size_t ii = 0; ii < numIovArr; ++ii) {
-    Array *curIovs = iovsArr + ii;
-    struct iovec *iovs = ARRAY_GETARRAY_AS(curIovs, struct iovec *);
-    size_t numIovs = ARRAY_GETSIZE_AS(curIovs, struct iovec);
-    size_t lastSize = bufTmp.len;
-
-    for (size_t jj = 0; jj < numIovs; ++jj) {
-      Array_Write(&bufTmp, iovs[jj].iov_base, iovs[jj].iov_len);
-    }
-
-    // Duplicate spaces for the current snippet are eliminated here. We shouldn't
-    // move it to the end because the delimiter itself may contain a special kind
-    // of whitespace.
-    size_t newSize = stripDuplicateSpaces(bufTmp.data + lastSize, bufTmp.len - lastSize);
-    Array_Resize(&bufTmp, lastSize + newSize);
-    Array_Write(&bufTmp, fieldInfo->summarizeSettings.separator,
-                strlen(fieldInfo->summarizeSettings.separator));
-  }
-
-  // Set the string value to the contents of the array. It might be nice if we didn't
-  // need to strndup it.
   size_t hlLen;
-  char *hlText = Array_Steal(&bufTmp, &hlLen);
+  char *hlText = writeFragments(iovsArr, numIovArr, fieldInfo->summarizeSettings.separator, &hlLen);
   RSFieldMap_Set(&r->fields, fieldName, RS_StringVal(hlText, hlLen));
 
-  Array_Free(&bufTmp);
   FragmentList_Free(&frags);
 }
 
-static void resetIovsArr(Array **iovsArrp, size_t *curSize, size_t newSize) {
-  if (*curSize < newSize) {
-    *iovsArrp = realloc(*iovsArrp, sizeof(**iovsArrp) * newSize);
-  }
-  for (size_t ii = 0; ii < *curSize; ++ii) {
-    Array_Resize((*iovsArrp) + ii, 0);
+// Make room for newSize iovec arrays and empty them. The arrays are only grown, so their memory is
+// reused by the following fields and documents
+static void resetIovsArr(hlpContext *hlpCtx, size_t newSize) {
+  if (hlpCtx->numIovsArr < newSize) {
+    hlpCtx->iovsArr = realloc(hlpCtx->iovsArr, sizeof(*hlpCtx->iovsArr) * newSize);
+    for (size_t ii = hlpCtx->numIovsArr; ii < newSize; ++ii) {
+      Array_Init(hlpCtx->iovsArr + ii);
+    }
+    hlpCtx->numIovsArr = newSize;
   }
-  for (size_t ii = *curSize; ii < newSize; ++ii) {
-    Array_Init((*iovsArrp) + ii);
+  for (size_t ii = 0; ii < newSize; ++ii) {
+    Array_Resize(hlpCtx->iovsArr + ii, 0);
   }
-  *curSize = newSize;
 }
 
 static void processField(ResultProcessorCtx *ctx, SearchResult *r, ReturnedField *spec,
-                         RSIndexResult *indexResult, Array *iovsArr) {
+                         RSIndexResult *indexResult) {
   const char *fName = spec->name;
   RSValue *fieldValue = RSFieldMap_Get(r->fields, fName);
 
@@ -233,8 +297,8 @@ static void processField(ResultProcessorCtx *ctx, SearchResult *r, ReturnedField
     return;
   }
   hlpContext *hlpCtx = ctx->privdata;
-  summarizeField(RP_SPEC(ctx), spec, fName, fieldValue, r, indexResult, hlpCtx->fragmentizeOptions,
-                 iovsArr);
+  resetIovsArr(hlpCtx, spec->summarizeSettings.numFrags);
+  summarizeField(RP_SPEC(ctx), spec, fName, fieldValue, r, hlpCtx, indexResult);
 }
 
 static RSIndexResult *getIndexResult(QueryProcessingCtx *ctx, t_docId docId) {
@@ -263,12 +327,10 @@ static int hlp_Next(ResultProcessorCtx *ctx, SearchResult *r) {
     return RS_RESULT_QUEUED;
   }
 
-  Array *iovsArr = NULL;
-  size_t numIovsArr = 0;
-
-  const hlpContext *hlpCtx = ctx->privdata;
+  hlpContext *hlpCtx = ctx->privdata;
   const FieldList *fields = hlpCtx->fields;
-  RSByteOffsets *byteOffsets = r->md->byteOffsets;
+  // The match positions are decoded lazily, by the first field that has byte offsets
+  hlpCtx->hasMatches = 0;
 
   if (fields->numFields) {
     for (size_t ii = 0; ii < fields->numFields; ++ii) {
@@ -280,33 +342,38 @@ static int hlp_Next(ResultProcessorCtx *ctx, SearchResult *r) {
         ReturnedField combinedSpec = {0};
         normalizeSettings(fields->fields[ii].name, fields->fields + ii, &fields->defaultField,
                           &combinedSpec);
-        resetIovsArr(&iovsArr, &numIovsArr, combinedSpec.summarizeSettings.numFrags);
-        processField(ctx, r, &combinedSpec, ir, iovsArr);
+        processField(ctx, r, &combinedSpec, ir);
       }
     }
   } else if (fields->defaultField.mode != SummarizeMode_None) {
     for (size_t ii = 0; ii < r->fields->len; ++ii) {
       ReturnedField spec = {0};
       normalizeSettings(r->fields->fields[ii].key, NULL, &fields->defaultField, &spec);
-      resetIovsArr(&iovsArr, &numIovsArr, spec.summarizeSettings.numFrags);
-      processField(ctx, r, &spec, ir, iovsArr);
+      processField(ctx, r, &spec, ir);
     }
   }
-  for (size_t ii = 0; ii < numIovsArr; ++ii) {
-    Array_Free(&iovsArr[ii]);
-  }
-  free(iovsArr);
   return RS_RESULT_OK;
 }
 
+static void hlp_Free(ResultProcessor *rp) {
+  hlpContext *hlpCtx = rp->ctx.privdata;
+  for (size_t ii = 0; ii < hlpCtx->numIovsArr; ++ii) {
+    Array_Free(&hlpCtx->iovsArr[ii]);
+  }
+  free(hlpCtx->iovsArr);
+  Array_Free(&hlpCtx->matches);
+  ResultProcessor_GenericFree(rp);
+}
+
 ResultProcessor *NewHighlightProcessor(ResultProcessor *parent, RSSearchRequest *req) {
   hlpContext *hlpCtx = calloc(1, sizeof(*hlpCtx));
   hlpCtx->fields = &req->opts.fields;
+  Array_InitEx(&hlpCtx->matches, ArrayAlloc_LibC);
   if (req->opts.language && strcasecmp(req->opts.language, "chinese") == 0) {
     hlpCtx->fragmentizeOptions = FRAGMENTIZE_TOKLEN_EXACT;
   }
   ResultProcessor *rp = NewResultProcessor(parent, hlpCtx);
   rp->Next = hlp_Next;
-  rp->Free = ResultProcessor_GenericFree;
+  rp->Free = hlp_Free;
   return rp;
 }
\ No newline at end of file
@@ -282,6 +282,8 @@ void IntersectIterator_Free(IndexIterator *it) {
     // IndexResult_Free(&ui->currentHits[i]);
   }
   free(ui->docIds);
+  free(ui->order);
+  free(ui->hits);
   IndexResult_Free(ui->current);
   free(ui->its);
   free(it->ctx);
@@ -326,6 +328,11 @@ IndexIterator *NewIntersecIterator(IndexIterator **its, int num, DocTable *dt,
   ctx->fieldMask = fieldMask;
   ctx->atEnd = 0;
   ctx->docIds = calloc(num, sizeof(t_docId));
+  ctx->order = malloc(num * sizeof(int));
+  for (int i = 0; i < num; i++) {
+    ctx->order[i] = i;
+  }
+  ctx->hits = calloc(num, sizeof(RSIndexResult *));
   ctx->current = NewIntersectResult(num);
   ctx->docTable = dt;
 
@@ -344,6 +351,29 @@ IndexIterator *NewIntersecIterator(IndexIterator **its, int num, DocTable *dt,
   return it;
 }
 
+void IntersectIterator_SetDriveOrder(IndexIterator *it, const size_t *estimates) {
+  IntersectContext *ic = it->ctx;
+  // insertion sort - intersections have few children, and ties keep their original order
+  for (int i = 1; i < ic->num; i++) {
+    int cur = ic->order[i];
+    int j = i - 1;
+    while (j >= 0 && estimates[ic->order[j]] > estimates[cur]) {
+      ic->order[j + 1] = ic->order[j];
+      j--;
+    }
+    ic->order[j + 1] = cur;
+  }
+}
+
+/* Put the hits of all the children into the current result, in the original order of the
+ * children, which scoring and slop checks rely on */
+static void II_CollectHits(IntersectContext *ic) {
+  AggregateResult_Reset(ic->current);
+  for (int i = 0; i < ic->num; i++) {
+    AggregateResult_AddChild(ic->current, ic->hits[i]);
+  }
+}
+
 RSIndexResult *II_Current(void *ctx) {
   return ((IntersectContext *)ctx)->current;
 }
@@ -361,7 +391,8 @@ int II_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit) {
   int rc = INDEXREAD_EOF;
   // skip all iterators to docId
   for (int i = 0; i < ic->num; i++) {
-    IndexIterator *it = ic->its[i];
+    int c = ic->order[i];
+    IndexIterator *it = ic->its[c];
 
     if (!it || !it->HasNext(it->ctx)) return INDEXREAD_EOF;
 
@@ -369,10 +400,10 @@ int II_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit) {
     rc = INDEXREAD_OK;
 
     // only read if we are not already at the seek to position
-    if (ic->docIds[i] != docId) {
+    if (ic->docIds[c] != docId) {
       rc = it->SkipTo(it->ctx, docId, &res);
       if (rc != INDEXREAD_EOF) {
-        if (res) ic->docIds[i] = res->docId;
+        if (res) ic->docIds[c] = res->docId;
       }
     }
 
@@ -383,12 +414,12 @@ int II_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit) {
     } else if (rc == INDEXREAD_OK) {
 
       // YAY! found!
-      AggregateResult_AddChild(ic->current, res);
+      ic->hits[c] = res;
       ic->lastDocId = docId;
 
       ++nfound;
-    } else if (ic->docIds[i] > ic->lastDocId) {
-      ic->lastDocId = ic->docIds[i];
+    } else if (ic->docIds[c] > ic->lastDocId) {
+      ic->lastDocId = ic->docIds[c];
       break;
     }
   }
@@ -398,6 +429,7 @@ int II_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit) {
   // if the requested id was found on all children - we return OK
   if (nfound == ic->num) {
     // printf("Skipto %d hit @%d\n", docId, ic->current->docId);
+    II_CollectHits(ic);
 
     // Update the last found id
     ic->lastFoundId = ic->current->docId;
@@ -433,16 +465,18 @@ int II_Read(void *ctx, RSIndexResult **hit) {
     AggregateResult_Reset(ic->current);
 
     for (i = 0; i < ic->num; i++) {
-      IndexIterator *it = ic->its[i];
+      int c = ic->order[i];
+      IndexIterator *it = ic->its[c];
 
       if (!it) goto eof;
 
       RSIndexResult *h = it->Current(it->ctx);
       // skip to the next
       int rc = INDEXREAD_OK;
-      if (ic->docIds[i] != ic->lastDocId || ic->lastDocId == 0) {
+      if (ic->docIds[c] != ic->lastDocId || ic->lastDocId == 0) {
 
-        if (i == 0 && ic->docIds[i] >= ic->lastDocId) {
+        // the first child in the drive order reads, the others skip to its position
+        if (i == 0 && ic->docIds[c] >= ic->lastDocId) {
           rc = it->Read(it->ctx, &h);
         } else {
           rc = it->SkipTo(it->ctx, ic->lastDocId, &h);
@@ -451,16 +485,16 @@ int II_Read(void *ctx, RSIndexResult **hit) {
         //        h->docId, it->LastDocId(it->ctx), rc);
 
         if (rc == INDEXREAD_EOF) goto eof;
-        ic->docIds[i] = h->docId;
+        ic->docIds[c] = h->docId;
       }
 
-      if (ic->docIds[i] > ic->lastDocId) {
-        ic->lastDocId = ic->docIds[i];
+      if (ic->docIds[c] > ic->lastDocId) {
+        ic->lastDocId = ic->docIds[c];
         break;
       }
       if (rc == INDEXREAD_OK) {
         ++nh;
-        AggregateResult_AddChild(ic->current, h);
+        ic->hits[c] = h;
       } else {
         ic->lastDocId++;
       }
@@ -468,6 +502,7 @@ int II_Read(void *ctx, RSIndexResult **hit) {
 
     if (nh == ic->num) {
       // printf("II %p HIT @ %d\n", ic, ic->current->docId);
+      II_CollectHits(ic);
       // sum up all hits
       if (hit != NULL) {
         *hit = ic->current;
@@ -483,9 +518,11 @@ int II_Read(void *ctx, RSIndexResult **hit) {
         continue;
       }
 
-      // If we need to match slop and order, we do it now, and possibly skip the result
+      // If we need to match slop and order, we do it now, and possibly skip the result. Terms that
+      // don't share a field are rejected first, without decoding their offsets
       if (ic->maxSlop >= 0) {
-        if (!IndexResult_IsWithinRange(ic->current, ic->maxSlop, ic->inOrder)) {
+        if ((IndexResult_CommonFields(ic->current) & ic->fieldMask) == 0 ||
+            !IndexResult_IsWithinRange(ic->current, ic->maxSlop, ic->inOrder)) {
           continue;
         }
       }
@@ -820,6 +857,143 @@ IndexIterator *NewOptionalIterator(IndexIterator *it, t_docId maxDocId) {
   return ret;
 }
 
+/**********************************************************
+ * Champion tier iterator
+ **********************************************************/
+
+void CI_Free(IndexIterator *it) {
+  ChampionContext *cc = it->ctx;
+  cc->child->Free(cc->child);
+  free(cc->candidates);
+  free(cc);
+  free(it);
+}
+
+int CI_Read(void *ctx, RSIndexResult **hit) {
+  ChampionContext *cc = ctx;
+  IndexIterator *child = cc->child;
+  if (cc->atEnd) return INDEXREAD_EOF;
+
+  if (!cc->secondPass) {
+    while (cc->pos < cc->numCandidates) {
+      int rc = child->SkipTo(child->ctx, cc->candidates[cc->pos++], hit);
+      if (rc == INDEXREAD_EOF) break;
+      if (rc == INDEXREAD_OK) {
+        cc->numHits++;
+        cc->lastDocId = (*hit)->docId;
+        return INDEXREAD_OK;
+      }
+    }
+
+    // none of the other documents can make it into the results, so we don't read them
+    if (*cc->minScore > cc->bound) {
+      if (cc->totalResults && cc->estimate > cc->numHits) {
+        *cc->totalResults += cc->estimate - cc->numHits;
+      }
+      goto eof;
+    }
+    child->Rewind(child->ctx);
+    cc->secondPass = 1;
+    cc->pos = 0;
+  }
+
+  int rc;
+  while (INDEXREAD_EOF != (rc = child->Read(child->ctx, hit))) {
+    if (rc != INDEXREAD_OK) continue;
+    // skip the candidates, we've read them in the first pass
+    t_docId docId = (*hit)->docId;
+    while (cc->pos < cc->numCandidates && cc->candidates[cc->pos] < docId) {
+      cc->pos++;
+    }
+    if (cc->pos < cc->numCandidates && cc->candidates[cc->pos] == docId) continue;
+
+    cc->lastDocId = docId;
+    return INDEXREAD_OK;
+  }
+
+eof:
+  cc->atEnd = 1;
+  return INDEXREAD_EOF;
+}
+
+/* Skipping is only done after the results are read, e.g. for highlighting them, so we just skip the
+ * child */
+int CI_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit) {
+  ChampionContext *cc = ctx;
+  int rc = cc->child->SkipTo(cc->child->ctx, docId, hit);
+  if (rc == INDEXREAD_EOF) {
+    cc->atEnd = 1;
+  } else {
+    cc->lastDocId = cc->child->LastDocId(cc->child->ctx);
+  }
+  return rc;
+}
+
+int CI_HasNext(void *ctx) {
+  ChampionContext *cc = ctx;
+  return !cc->atEnd;
+}
+
+void CI_Abort(void *ctx) {
+  ChampionContext *cc = ctx;
+  cc->atEnd = 1;
+  cc->child->Abort(cc->child->ctx);
+}
+
+RSIndexResult *CI_Current(void *ctx) {
+  ChampionContext *cc = ctx;
+  return cc->child->Current(cc->child->ctx);
+}
+
+size_t CI_Len(void *ctx) {
+  ChampionContext *cc = ctx;
+  return cc->child->Len(cc->child->ctx);
+}
+
+t_docId CI_LastDocId(void *ctx) {
+  ChampionContext *cc = ctx;
+  return cc->lastDocId;
+}
+
+/* Rewinding starts over from the first pass. The estimate of the second pass was already added to
+ * the total results, so it is not added again */
+void CI_Rewind(void *ctx) {
+  ChampionContext *cc = ctx;
+  cc->child->Rewind(cc->child->ctx);
+  cc->pos = 0;
+  cc->numHits = 0;
+  cc->secondPass = 0;
+  cc->atEnd = 0;
+  cc->lastDocId = 0;
+  cc->totalResults = NULL;
+}
+
+IndexIterator *NewChampionIterator(IndexIterator *child, t_docId *candidates, size_t numCandidates,
+                                   double bound, size_t estimate, const double *minScore,
+                                   uint32_t *totalResults) {
+  ChampionContext *cc = calloc(1, sizeof(*cc));
+  cc->child = child;
+  cc->candidates = candidates;
+  cc->numCandidates = numCandidates;
+  cc->bound = bound;
+  cc->estimate = estimate;
+  cc->minScore = minScore;
+  cc->totalResults = totalResults;
+
+  IndexIterator *ret = malloc(sizeof(*ret));
+  ret->ctx = cc;
+  ret->Current = CI_Current;
+  ret->Free = CI_Free;
+  ret->HasNext = CI_HasNext;
+  ret->LastDocId = CI_LastDocId;
+  ret->Len = CI_Len;
+  ret->Read = CI_Read;
+  ret->SkipTo = CI_SkipTo;
+  ret->Abort = CI_Abort;
+  ret->Rewind = CI_Rewind;
+  return ret;
+}
+
 /* Wildcard iterator, matchin ALL documents in the index. This is used for one thing only -
  * purely negative queries. If the root of the query is a negative expression, we cannot process
  * it
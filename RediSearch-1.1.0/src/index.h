@@ -64,6 +64,10 @@ typedef struct {
   t_docId *docIds;
   int *rcs;
   RSIndexResult *current;
+  // the order the children are advanced in - the first one drives the iteration
+  int *order;
+  // the results of the children on the current doc, by child
+  RSIndexResult **hits;
   int num;
   size_t len;
   int maxSlop;
@@ -86,6 +90,11 @@ typedef struct {
 IndexIterator *NewIntersecIterator(IndexIterator **its, int num, DocTable *t, t_fieldMask fieldMask,
                                    int maxSlop, int inOrder);
 
+/* Set the order an intersect iterator advances its children in, by ascending estimates of their
+ * number of results, so the most selective child drives the iteration and the others are only
+ * skipped to its hits. The results still list the children in their original order */
+void IntersectIterator_SetDriveOrder(IndexIterator *it, const size_t *estimates);
+
 int II_SkipTo(void *ctx, uint32_t docId, RSIndexResult **hit);
 int II_Next(void *ctx);
 int II_Read(void *ctx, RSIndexResult **hit);
@@ -121,6 +130,36 @@ typedef struct {
 /* Create a NOT iterator by wrapping another index iterator */
 IndexIterator *NewOptionalIterator(IndexIterator *it, t_docId maxDocId);
 
+typedef struct {
+  IndexIterator *child;
+  // the champion candidates of the query, sorted by docId
+  t_docId *candidates;
+  size_t numCandidates;
+  // the next candidate to read in the first pass, or to skip in the second
+  size_t pos;
+  // the highest score a document which is not a candidate can have
+  double bound;
+  // the estimated number of results of the child
+  size_t estimate;
+  // the lowest score the query still accepts, and its count of results
+  const double *minScore;
+  uint32_t *totalResults;
+  size_t numHits;
+  int secondPass;
+  int atEnd;
+  t_docId lastDocId;
+} ChampionContext;
+
+/* Create an iterator reading the results of a scored query in two passes: first the champion
+ * candidates - the documents most likely to score the highest, then all the rest. The second pass is
+ * skipped if the lowest score the query accepts, pointed at by minScore, is above bound - the
+ * highest score any other document can have. In that case the results of the second pass are
+ * estimated from the child's estimate, and added to totalResults. The iterator takes ownership of
+ * the candidates, which must be sorted by docId */
+IndexIterator *NewChampionIterator(IndexIterator *child, t_docId *candidates, size_t numCandidates,
+                                   double bound, size_t estimate, const double *minScore,
+                                   uint32_t *totalResults);
+
 /* Create a wildcard iterator, matching ALL documents in the index. This is used for one thing only
  * - purely negative queries. If the root of the query is a negative expression, we cannot process
  * it without a positive expression. So we create a wildcard iterator that basically just iterates
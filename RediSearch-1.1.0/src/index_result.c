@@ -309,35 +309,130 @@ size_t IndexResult_GetMatchedTerms(RSIndexResult *r, RSQueryTerm **arr, size_t c
   return arrlen;
 }
 
-int __indexResult_withinRangeInOrder(RSOffsetIterator *iters, uint32_t *positions, int num,
-                                     int maxSlop) {
-  while (1) {
+/* The positions of each of the children of a result, decoded in bulk for checking their distances.
+ * Each list is sorted in ascending order */
+typedef struct {
+  const uint32_t *pos;
+  int num;
+} positionList;
+
+/* An upper bound on the number of offsets of a result - each encoded offset takes at least one
+ * byte, and the offsets of an aggregate are those of its children */
+static size_t result_MaxOffsets(const RSIndexResult *r) {
+  switch (r->type) {
+    case RSResultType_Term:
+      return r->term.offsets.len;
+    case RSResultType_Intersection:
+    case RSResultType_Union: {
+      size_t n = 0;
+      for (int i = 0; i < r->agg.numChildren; i++) {
+        n += result_MaxOffsets(r->agg.children[i]);
+      }
+      return n;
+    }
+    default:
+      return 0;
+  }
+}
+
+/* Decode the offsets of a result into out, which must have room for result_MaxOffsets of them.
+ * Term offsets are decoded straight from their varint vector, and aggregate ones are merged by
+ * their offset iterator. Returns the number of offsets */
+static int result_DecodeOffsets(RSIndexResult *r, uint32_t *out) {
+  int n = 0;
+  if (r->type == RSResultType_Term) {
+    const unsigned char *p = (const unsigned char *)r->term.offsets.data;
+    const unsigned char *end = p + r->term.offsets.len;
+    uint32_t last = 0;
+    while (p < end) {
+      // the varint encoding of varint.h, see ReadVarint
+      unsigned char c = *p++;
+      uint32_t val = c & 127;
+      while (c >> 7) {
+        ++val;
+        c = *p++;
+        val = (val << 7) | (c & 127);
+      }
+      last += val;
+      out[n++] = last;
+    }
+    return n;
+  }
+
+  RSOffsetIterator it = RSIndexResult_IterateOffsets(r);
+  uint32_t pos;
+  while ((pos = it.Next(it.ctx, NULL)) != RS_OFFSETVECTOR_EOF) {
+    out[n++] = pos;
+  }
+  it.Free(it.ctx);
+  return n;
+}
+
+/* In order check of two position lists: for each position of the first term, the closest position
+ * of the second one at or after it */
+static int withinRangeInOrder2(const positionList *l, int maxSlop) {
+  const uint32_t *a = l[0].pos, *b = l[1].pos;
+  int j = 0;
+  for (int i = 0; i < l[0].num; i++) {
+    while (j < l[1].num && b[j] < a[i]) j++;
+    if (j == l[1].num) return 0;
+    if ((int)b[j] - (int)a[i] - 1 <= maxSlop) return 1;
+  }
+  return 0;
+}
+
+/* In order check of three position lists, like that of two with another chained list */
+static int withinRangeInOrder3(const positionList *l, int maxSlop) {
+  const uint32_t *a = l[0].pos, *b = l[1].pos, *c = l[2].pos;
+  int j = 0, k = 0;
+  for (int i = 0; i < l[0].num; i++) {
+    while (j < l[1].num && b[j] < a[i]) j++;
+    if (j == l[1].num) return 0;
+    int span = (int)b[j] - (int)a[i] - 1;
+    if (span > maxSlop) continue;
+
+    while (k < l[2].num && c[k] < b[j]) k++;
+    if (k == l[2].num) return 0;
+    if (span + (int)c[k] - (int)b[j] - 1 <= maxSlop) return 1;
+  }
+  return 0;
+}
+
+/* In order check of any number of position lists. For every position of the first term we take
+ * the closest positions of the next terms after each other, until they are too far apart */
+static int withinRangeInOrder(const positionList *l, int num, int maxSlop) {
+  switch (num) {
+    case 2:
+      return withinRangeInOrder2(l, maxSlop);
+    case 3:
+      return withinRangeInOrder3(l, maxSlop);
+  }
+
+  // the current index in each list, the lists after the first one are not read yet
+  int cur[num];
+  cur[0] = -1;
+  for (int i = 1; i < num; i++) {
+    cur[i] = -1;
+  }
 
+  while (1) {
     // we start from the beginning, and a span of 0
     int span = 0;
     for (int i = 0; i < num; i++) {
-      // take the current position and the position of the previous iterator.
-      // For the first iterator we always advance once
-      uint32_t pos = i ? positions[i] : iters[i].Next(iters[i].ctx, NULL);
-      uint32_t lastPos = i ? positions[i - 1] : 0;
-      // printf("Before: i=%d, pos=%d, lastPos %d\n", i, pos, lastPos);
-
-      // read while we are not in order
-      while (pos != RS_OFFSETVECTOR_EOF && pos < lastPos) {
-        pos = iters[i].Next(iters[i].ctx, NULL);
-        // printf("Reading: i=%d, pos=%d, lastPos %d\n", i, pos, lastPos);
+      // the first list always advances once, the others while they are before the previous term
+      uint32_t lastPos = i ? l[i - 1].pos[cur[i - 1]] : 0;
+      if (i == 0) cur[0]++;
+      while (cur[i] < l[i].num && (cur[i] < 0 || l[i].pos[cur[i]] < lastPos)) {
+        cur[i]++;
       }
-      // printf("i=%d, pos=%d, lastPos %d\n", i, pos, lastPos);
-
       // we've read through the entire list and it's not in order relative to the last pos
-      if (pos == RS_OFFSETVECTOR_EOF) {
+      if (cur[i] == l[i].num) {
         return 0;
       }
-      positions[i] = pos;
 
       // add the diff from the last pos to the total span
       if (i > 0) {
-        span += ((int)pos - (int)lastPos - 1);
+        span += ((int)l[i].pos[cur[i]] - (int)lastPos - 1);
         // if we are already out of slop - just quit
         if (span > maxSlop) {
           break;
@@ -349,77 +444,75 @@ int __indexResult_withinRangeInOrder(RSOffsetIterator *iters, uint32_t *position
       return 1;
     }
   }
-
-  return 0;
 }
 
-static inline uint32_t _arrayMin(uint32_t *arr, int len, uint32_t *pos) {
-  int m = arr[0];
-  *pos = 0;
-  for (int i = 1; i < len; i++) {
-    if (arr[i] < m) {
-      m = arr[i];
-      *pos = i;
+/* Unordered check of two position lists - advance the lower one until they are close enough */
+static int withinRangeUnordered2(const positionList *l, int maxSlop) {
+  const uint32_t *a = l[0].pos, *b = l[1].pos;
+  int i = 0, j = 0;
+  while (i < l[0].num && j < l[1].num) {
+    if (a[i] != b[j]) {
+      int span = (a[i] < b[j] ? (int)b[j] - (int)a[i] : (int)a[i] - (int)b[j]) - 1;
+      if (span <= maxSlop) return 1;
     }
-  }
-  return m;
-}
-
-static inline uint32_t _arrayMax(uint32_t *arr, int len, uint32_t *pos) {
-  int m = arr[0];
-  *pos = 0;
-  for (int i = 1; i < len; i++) {
-    if (arr[i] >= m) {
-      m = arr[i];
-      *pos = i;
+    if (a[i] <= b[j]) {
+      i++;
+    } else {
+      j++;
     }
   }
-  return m;
+  return 0;
 }
 
 /* Check the index result for maximal slop, in an unordered fashion.
  * The algorithm is simple - we find the first offsets min and max such that max-min<=maxSlop */
-int __indexResult_withinRangeUnordered(RSOffsetIterator *iters, uint32_t *positions, int num,
-                                       int maxSlop) {
+static int withinRangeUnordered(const positionList *l, int num, int maxSlop) {
+  if (num == 2) {
+    return withinRangeUnordered2(l, maxSlop);
+  }
+
+  int cur[num];
+  uint32_t max = 0;
   for (int i = 0; i < num; i++) {
-    positions[i] = iters[i].Next(iters[i].ctx, NULL);
+    cur[i] = 0;
+    max = MAX(max, l[i].pos[0]);
   }
-  uint32_t minPos, maxPos, min, max;
-  // find the max member
-  max = _arrayMax(positions, num, &maxPos);
 
   while (1) {
-
-    // we start from the beginning, and a span of 0
-    min = _arrayMin(positions, num, &minPos);
-    if (min != max) {
-      // calculate max - min
-      int span = (int)max - (int)min - (num - 1);
-      // printf("maxslop %d min %d, max %d, minPos %d, maxPos %d, span %d\n", maxSlop, min, max,
-      //        minPos, maxPos, span);
-      // if it matches the condition - just return success
-      if (span <= maxSlop) {
-        return 1;
-      }
+    // find the first list with the minimal position
+    int minIdx = 0;
+    for (int i = 1; i < num; i++) {
+      if (l[i].pos[cur[i]] < l[minIdx].pos[cur[minIdx]]) minIdx = i;
+    }
+    uint32_t min = l[minIdx].pos[cur[minIdx]];
+    if (min != max && (int)max - (int)min - (num - 1) <= maxSlop) {
+      return 1;
     }
 
-    // if we are not meeting the conditions - advance the minimal iterator
-    positions[minPos] = iters[minPos].Next(iters[minPos].ctx, NULL);
-    // If the minimal iterator is larger than the max iterator, the minimal iterator is the new
-    // maximal iterator.
-    if (positions[minPos] != RS_OFFSETVECTOR_EOF && positions[minPos] > max) {
-      maxPos = minPos;
-      max = positions[maxPos];
-
-    } else if (positions[minPos] == RS_OFFSETVECTOR_EOF) {
-      // this means we've reached the end
-      break;
+    // if we are not meeting the conditions - advance the minimal list
+    if (++cur[minIdx] == l[minIdx].num) {
+      return 0;
     }
+    max = MAX(max, l[minIdx].pos[cur[minIdx]]);
   }
+}
 
-  return 0;
+t_fieldMask IndexResult_CommonFields(RSIndexResult *r) {
+  if (!RSIndexResult_IsAggregate(r)) {
+    return r->fieldMask;
+  }
+  t_fieldMask mask = RS_FIELDMASK_ALL;
+  for (int i = 0; i < r->agg.numChildren; i++) {
+    if (RSIndexResult_HasOffsets(r->agg.children[i])) {
+      mask &= r->agg.children[i]->fieldMask;
+    }
+  }
+  return mask;
 }
 
+// The number of positions decoded on the stack when checking the range of a result
+#define RANGE_STACK_POSITIONS 256
+
 /** Test the result offset vectors to see if they fall within a max "slop" or distance between the
  * terms. That is the total number of non matched offsets between the terms is no bigger than
  * maxSlop.
@@ -435,16 +528,14 @@ int IndexResult_IsWithinRange(RSIndexResult *ir, int maxSlop, int inOrder) {
   RSAggregateResult *r = &ir->agg;
   int num = r->numChildren;
 
-  // Fill a list of iterators and the last read positions
-  RSOffsetIterator iters[num];
-  uint32_t positions[num];
+  // collect only the children that can have offsets, and the room their offsets take
+  RSIndexResult *children[num];
   int n = 0;
+  size_t total = 0;
   for (int i = 0; i < num; i++) {
-    // collect only iterators for nodes that can have offsets
     if (RSIndexResult_HasOffsets(r->children[i])) {
-      iters[n] = RSIndexResult_IterateOffsets(r->children[i]);
-      positions[n] = 0;
-      n++;
+      children[n++] = r->children[i];
+      total += result_MaxOffsets(r->children[i]);
     }
   }
 
@@ -453,15 +544,26 @@ int IndexResult_IsWithinRange(RSIndexResult *ir, int maxSlop, int inOrder) {
     return 1;
   }
 
-  int rc;
-  // cal the relevant algorithm based on ordered/unordered condition
-  if (inOrder)
-    rc = __indexResult_withinRangeInOrder(iters, positions, n, maxSlop);
-  else
-    rc = __indexResult_withinRangeUnordered(iters, positions, n, maxSlop);
-  // printf("slop result for %d: %d\n", ir->docId, rc);
+  // decode all the offsets at once, on the stack unless there are many of them
+  uint32_t stackBuf[RANGE_STACK_POSITIONS];
+  uint32_t *buf = total <= RANGE_STACK_POSITIONS ? stackBuf : rm_malloc(total * sizeof(uint32_t));
+  positionList lists[n];
+  uint32_t *p = buf;
+  int rc = 1;
   for (int i = 0; i < n; i++) {
-    iters[i].Free(iters[i].ctx);
+    lists[i] = (positionList){.pos = p, .num = result_DecodeOffsets(children[i], p)};
+    p += lists[i].num;
+    // a child with no offsets at all can't be in range
+    if (lists[i].num == 0) rc = 0;
+  }
+
+  if (rc && n > 1) {
+    // cal the relevant algorithm based on ordered/unordered condition
+    rc = inOrder ? withinRangeInOrder(lists, n, maxSlop) : withinRangeUnordered(lists, n, maxSlop);
+  }
+  // printf("slop result for %d: %d\n", ir->docId, rc);
+  if (buf != stackBuf) {
+    rm_free(buf);
   }
   return rc;
 }
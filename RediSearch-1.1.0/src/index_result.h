@@ -71,4 +71,9 @@ size_t IndexResult_GetMatchedTerms(RSIndexResult *r, RSQueryTerm **arr, size_t c
  * need to be ordered as in the query or not */
 int IndexResult_IsWithinRange(RSIndexResult *r, int maxSlop, int inOrder);
 
+/* Return the fields all the children of an aggregate result that have offsets appear in. Offsets
+ * run on from one field of a document to the next, so terms with no field in common can't be
+ * within a slop range of each other */
+t_fieldMask IndexResult_CommonFields(RSIndexResult *r);
+
 #endif
\ No newline at end of file
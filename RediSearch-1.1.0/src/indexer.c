@@ -5,6 +5,7 @@
 #include "geo_index.h"
 #include "index.h"
 #include "redis_index.h"
+#include "config.h"
 
 #include <assert.h>
 
@@ -12,6 +13,12 @@ static void writeIndexEntry(IndexSpec *spec, InvertedIndex *idx, IndexEncoder en
                             ForwardIndexEntry *entry) {
   size_t sz = InvertedIndex_WriteForwardIndexEntry(idx, encoder, entry);
 
+  // Keep the champion tier of frequent terms up to date
+  if (sz && RSGlobalConfig.championThreshold && idx->numDocs >= RSGlobalConfig.championThreshold) {
+    InvertedIndex_AddChampion(idx, &spec->docs, entry->docId, entry->freq,
+                              RSGlobalConfig.championSize, spec->scoreRevision);
+  }
+
   // Update index statistics:
 
   // Number of additional bytes
@@ -422,6 +429,9 @@ static void Indexer_Process(DocumentIndexer *indexer, RSAddDocumentCtx *aCtx) {
   }
 
 cleanup:
+  if (ctx.spec) {
+    ctx.spec->revision++;
+  }
   if (isBlocked) {
     ConcurrentSearchCtx_Unlock(&indexer->concCtx);
   }
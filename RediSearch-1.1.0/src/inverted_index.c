@@ -4,6 +4,7 @@
 #include "varint.h"
 #include <stdio.h>
 #include <float.h>
+#include <sys/param.h>
 #include "rmalloc.h"
 #include "qint.h"
 #include "qint.c"
@@ -22,6 +23,12 @@
 // pointer to the current block while reading the index
 #define IR_CURRENT_BLOCK(ir) (ir->idx->blocks[ir->currentBlock])
 
+/* Point the reader at the beginning of its current block */
+static inline void IndexReader_ResetBlock(IndexReader *ir) {
+  ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+  ir->obr = NewBufferReader(IR_CURRENT_BLOCK(ir).offsets);
+}
+
 static IndexReader *NewIndexReaderGeneric(InvertedIndex *idx, IndexDecoder decoder,
                                           IndexDecoderCtx decoderCtx, RSIndexResult *record);
 
@@ -32,6 +39,8 @@ static void InvertedIndex_AddBlock(InvertedIndex *idx, t_docId firstId) {
   idx->blocks = rm_realloc(idx->blocks, idx->size * sizeof(IndexBlock));
   idx->blocks[idx->size - 1] = (IndexBlock){.firstId = firstId, .lastId = 0, .numDocs = 0};
   INDEX_LAST_BLOCK(idx).data = NewBuffer(INDEX_BLOCK_INITIAL_CAP);
+  INDEX_LAST_BLOCK(idx).offsets =
+      idx->flags & Index_StoreTermOffsets ? NewBuffer(INDEX_BLOCK_INITIAL_CAP) : NULL;
 }
 
 InvertedIndex *NewInvertedIndex(IndexFlags flags, int initBlock) {
@@ -42,6 +51,7 @@ InvertedIndex *NewInvertedIndex(IndexFlags flags, int initBlock) {
   idx->gcMarker = 0;
   idx->flags = flags;
   idx->numDocs = 0;
+  idx->champions = NULL;
   if (initBlock) {
     InvertedIndex_AddBlock(idx, 0);
   }
@@ -51,14 +61,27 @@ InvertedIndex *NewInvertedIndex(IndexFlags flags, int initBlock) {
 void indexBlock_Free(IndexBlock *blk) {
   Buffer_Free(blk->data);
   free(blk->data);
+  if (blk->offsets) {
+    Buffer_Free(blk->offsets);
+    free(blk->offsets);
+  }
+}
+
+static void championTier_Free(ChampionTier *t) {
+  if (!t) return;
+  rm_free(t->entries);
+  rm_free(t);
 }
 
 void InvertedIndex_Free(void *ctx) {
   InvertedIndex *idx = ctx;
+  // queries holding a reader on this index need to reopen it
+  ConcurrentSearch_AdvanceEpoch();
   for (uint32_t i = 0; i < idx->size; i++) {
     indexBlock_Free(&idx->blocks[i]);
   }
   rm_free(idx->blocks);
+  championTier_Free(idx->champions);
   rm_free(idx);
 }
 
@@ -80,17 +103,18 @@ void IndexReader_OnReopen(RedisModuleKey *k, void *privdata) {
 
   // the gc marker tells us if there is a chance the keys has undergone GC while we were asleep
   if (ir->gcMarker == ir->idx->gcMarker) {
-    // no GC - we just go to the same offset we were at
-    size_t offset = ir->br.pos;
-    ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+    // no GC - we just go to the same offsets we were at
+    size_t offset = ir->br.pos, offsetsPos = ir->obr.pos;
+    IndexReader_ResetBlock(ir);
     ir->br.pos = offset;
+    ir->obr.pos = offsetsPos;
   } else {
     // if there has been a GC cycle on this key while we were asleep, the offset might not be valid
     // anymore. This means that we need to seek to last docId we were at
 
     // reset the state of the reader
     t_docId lastId = ir->lastId;
-    ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+    IndexReader_ResetBlock(ir);
     ir->lastId = 0;
 
     // seek to the previous last id
@@ -103,23 +127,25 @@ void IndexReader_OnReopen(RedisModuleKey *k, void *privdata) {
    * Index Encoders Implementations.
    *
    * We have 9 distinct ways to encode the index records. Based on the index flags we select the
-   * correct encoder when writing to the index
+   * correct encoder when writing to the index. The term offsets of the records are not written
+   * inline, but to the offsets stream of the block (ow), so the records themselves stay small
    *
    ******************************************************************************/
 
-#define ENCODER(f) static size_t f(BufferWriter *bw, t_docId delta, RSIndexResult *res)
+#define ENCODER(f) \
+  static size_t f(BufferWriter *bw, BufferWriter *ow, t_docId delta, RSIndexResult *res)
 
 // 1. Encode the full data of the record, delta, frequency, field mask and offset vector
 ENCODER(encodeFull) {
   size_t sz = qint_encode4(bw, delta, res->freq, (uint32_t)res->fieldMask, res->offsetsSz);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
 ENCODER(encodeFullWide) {
   size_t sz = qint_encode3(bw, delta, res->freq, res->offsetsSz);
   sz += WriteVarintFieldMask(res->fieldMask, bw);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
@@ -153,14 +179,14 @@ ENCODER(encodeFieldsOnlyWide) {
 // 5. (field, offset)
 ENCODER(encodeFieldsOffsets) {
   size_t sz = qint_encode3(bw, delta, (uint32_t)res->fieldMask, res->term.offsets.len);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
 ENCODER(encodeFieldsOffsetsWide) {
   size_t sz = qint_encode2(bw, delta, res->term.offsets.len);
   sz += WriteVarintFieldMask(res->fieldMask, bw);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
@@ -168,14 +194,14 @@ ENCODER(encodeFieldsOffsetsWide) {
 ENCODER(encodeOffsetsOnly) {
 
   size_t sz = qint_encode2(bw, delta, res->term.offsets.len);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
 // 7. Offsets and freqs
 ENCODER(encodeFreqsOffsets) {
   size_t sz = qint_encode3(bw, delta, (uint32_t)res->freq, (uint32_t)res->term.offsets.len);
-  sz += Buffer_Write(bw, res->term.offsets.data, res->term.offsets.len);
+  sz += Buffer_Write(ow, res->term.offsets.data, res->term.offsets.len);
   return sz;
 }
 
@@ -384,6 +410,14 @@ IndexEncoder InvertedIndex_GetEncoder(IndexFlags flags) {
   return NULL;
 }
 
+/* Open a writer at the end of the offsets stream of a block, if it has one */
+static BufferWriter indexBlock_OffsetsWriter(IndexBlock *blk) {
+  if (!blk->offsets) {
+    return (BufferWriter){.buf = NULL, .pos = NULL};
+  }
+  return NewBufferWriter(blk->offsets);
+}
+
 /* Write a forward-index entry to an index writer */
 size_t InvertedIndex_WriteEntryGeneric(InvertedIndex *idx, IndexEncoder encoder, t_docId docId,
                                        RSIndexResult *entry) {
@@ -406,10 +440,11 @@ size_t InvertedIndex_WriteEntryGeneric(InvertedIndex *idx, IndexEncoder encoder,
   }
 
   BufferWriter bw = NewBufferWriter(blk->data);
+  BufferWriter ow = indexBlock_OffsetsWriter(blk);
 
   //  printf("Writing docId %d, delta %d, flags %x\n", docId, docId - idx->lastId,
   //  (int)idx->flags);
-  size_t ret = encoder(&bw, docId - blk->lastId, entry);
+  size_t ret = encoder(&bw, &ow, docId - blk->lastId, entry);
 
   idx->lastId = docId;
   blk->lastId = docId;
@@ -454,7 +489,7 @@ int IR_HasNext(void *ctx) {
 
 static void IndexReader_AdvanceBlock(IndexReader *ir) {
   ir->currentBlock++;
-  ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+  IndexReader_ResetBlock(ir);
   ir->lastId = 0;  // IR_CURRENT_BLOCK(ir).firstId;
 }
 
@@ -469,7 +504,8 @@ static void IndexReader_AdvanceBlock(IndexReader *ir) {
    *
    ******************************************************************************/
 
-#define DECODER(name) static int name(BufferReader *br, IndexDecoderCtx ctx, RSIndexResult *res)
+#define DECODER(name) \
+  static int name(BufferReader *br, BufferReader *obr, IndexDecoderCtx ctx, RSIndexResult *res)
 
 #define CHECK_FLAGS(ctx, res) return ((res->fieldMask & ctx.num) != 0)
 
@@ -490,8 +526,8 @@ DECODER(readFreqOffsetsFlags) {
   // qint_decode(br, (uint32_t *)res, 4);
   qint_decode4(br, &res->docId, &res->freq, (uint32_t *)&res->fieldMask, &res->offsetsSz);
 
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
-  Buffer_Skip(br, res->offsetsSz);
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
+  Buffer_Skip(obr, res->offsetsSz);
   CHECK_FLAGS(ctx, res);
 }
 
@@ -501,8 +537,8 @@ DECODER(readFreqOffsetsFlagsWide) {
 
   qint_decode3(br, &res->docId, &res->freq, &res->offsetsSz);
   res->fieldMask = ReadVarintFieldMask(br);
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
-  Buffer_Skip(br, res->offsetsSz);
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
+  Buffer_Skip(obr, res->offsetsSz);
   CHECK_FLAGS(ctx, res);
 }
 
@@ -567,8 +603,8 @@ DECODER(readFlagsWide) {
 
 DECODER(readFlagsOffsets) {
   qint_decode3(br, &res->docId, (uint32_t *)&res->fieldMask, &res->offsetsSz);
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
-  Buffer_Skip(br, res->offsetsSz);
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
+  Buffer_Skip(obr, res->offsetsSz);
   CHECK_FLAGS(ctx, res);
 }
 
@@ -576,23 +612,23 @@ DECODER(readFlagsOffsetsWide) {
 
   qint_decode2(br, &res->docId, &res->offsetsSz);
   res->fieldMask = ReadVarintFieldMask(br);
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
 
-  Buffer_Skip(br, res->offsetsSz);
+  Buffer_Skip(obr, res->offsetsSz);
   CHECK_FLAGS(ctx, res);
 }
 
 DECODER(readOffsets) {
   qint_decode2(br, &res->docId, &res->offsetsSz);
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
-  Buffer_Skip(br, res->offsetsSz);
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
+  Buffer_Skip(obr, res->offsetsSz);
   return 1;
 }
 
 DECODER(readFreqsOffsets) {
   qint_decode3(br, &res->docId, &res->freq, &res->offsetsSz);
-  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(br), .len = res->offsetsSz};
-  Buffer_Skip(br, res->offsetsSz);
+  res->term.offsets = (RSOffsetVector){.data = BufferReader_Current(obr), .len = res->offsetsSz};
+  Buffer_Skip(obr, res->offsetsSz);
   return 1;
 }
 
@@ -686,7 +722,7 @@ int IR_Read(void *ctx, RSIndexResult **e) {
       IndexReader_AdvanceBlock(ir);
     }
 
-    int rv = ir->decoder(&ir->br, ir->decoderCtx, ir->record);
+    int rv = ir->decoder(&ir->br, &ir->obr, ir->decoderCtx, ir->record);
     ir->lastId = ir->record->docId += ir->lastId;
     // The decoder also acts as a filter. A zero return value means that the
     // current record should not be processed.
@@ -748,7 +784,7 @@ static int IndexReader_SkipToBlock(IndexReader *ir, t_docId docId) {
 
 found:
   ir->lastId = 0;
-  ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+  IndexReader_ResetBlock(ir);
   return 1;
 }
 
@@ -796,6 +832,10 @@ eof:
 
 size_t IR_NumDocs(void *ctx) {
   IndexReader *ir = ctx;
+  // the number of documents in the index, unless it was deleted while we were reading it
+  if (ir->idx) {
+    return ir->idx->numDocs;
+  }
   // otherwise we use our counter
   return ir->len;
 }
@@ -811,7 +851,7 @@ static IndexReader *NewIndexReaderGeneric(InvertedIndex *idx, IndexDecoder decod
   ret->record = record;
   ret->len = 0;
   ret->atEnd = 0;
-  ret->br = NewBufferReader(IR_CURRENT_BLOCK(ret).data);
+  IndexReader_ResetBlock(ret);
   ret->decoder = decoder;
   ret->decoderCtx = decoderCtx;
   return ret;
@@ -870,7 +910,7 @@ void IR_Rewind(void *ctx) {
   ir->currentBlock = 0;
   ir->lastId = 0;
   ir->gcMarker = ir->idx->gcMarker;
-  ir->br = NewBufferReader(IR_CURRENT_BLOCK(ir).data);
+  IndexReader_ResetBlock(ir);
 }
 
 IndexIterator *NewReadIterator(IndexReader *ir) {
@@ -909,6 +949,15 @@ int IndexBlock_Repair(IndexBlock *blk, DocTable *dt, IndexFlags flags, size_t *b
   BufferReader br = NewBufferReader(blk->data);
   BufferWriter bw = NewBufferWriter(&repair);
 
+  // the offsets stream is compacted alongside the records
+  Buffer offsetsRepair = {0};
+  if (blk->offsets) {
+    offsetsRepair = *blk->offsets;
+    offsetsRepair.offset = 0;
+  }
+  BufferReader obr = NewBufferReader(blk->offsets);
+  BufferWriter ow = NewBufferWriter(&offsetsRepair);
+
   RSIndexResult *res = NewTokenRecord(NULL);
   int frags = 0;
 
@@ -921,9 +970,10 @@ int IndexBlock_Repair(IndexBlock *blk, DocTable *dt, IndexFlags flags, size_t *b
     return -1;
   }
   while (!BufferReader_AtEnd(&br)) {
-    const char *bufBegin = BufferReader_Current(&br);
-    decoder(&br, (IndexDecoderCtx){}, res);
-    size_t sz = BufferReader_Current(&br) - bufBegin;
+    size_t begin = BufferReader_Offset(&br), offsetsBegin = BufferReader_Offset(&obr);
+    decoder(&br, &obr, (IndexDecoderCtx){}, res);
+    size_t sz = BufferReader_Offset(&br) - begin;
+    size_t offsetsSz = BufferReader_Offset(&obr) - offsetsBegin;
     lastReadId = res->docId += lastReadId;
     RSDocumentMetadata *md = DocTable_Get(dt, res->docId);
 
@@ -932,7 +982,7 @@ int IndexBlock_Repair(IndexBlock *blk, DocTable *dt, IndexFlags flags, size_t *b
     // this will close the "hole" in the index
     if (!md || md->flags & Document_Deleted) {
       ++frags;
-      if (bytesCollected) *bytesCollected += sz;
+      if (bytesCollected) *bytesCollected += sz + offsetsSz;
     } else {  // valid document
 
       // If we're already operating in a repaired block, we do nothing if we found no holes yet, or
@@ -941,12 +991,14 @@ int IndexBlock_Repair(IndexBlock *blk, DocTable *dt, IndexFlags flags, size_t *b
 
         // In this case we are already closing holes, so we need to write back the record at the
         // writer's position. We also calculate the delta again
-        encoder(&bw, res->docId - blk->lastId, res);
+        encoder(&bw, &ow, res->docId - blk->lastId, res);
 
       } else {
-        // Nothing to do - this block is not fragmented as of now, so we just advance the writer
+        // Nothing to do - this block is not fragmented as of now, so we just advance the writers
         bw.buf->offset += sz;
         bw.pos += sz;
+        ow.buf->offset += offsetsSz;
+        ow.pos += offsetsSz;
       }
       blk->lastId = res->docId;
     }
@@ -957,6 +1009,10 @@ int IndexBlock_Repair(IndexBlock *blk, DocTable *dt, IndexFlags flags, size_t *b
     blk->numDocs -= frags;
     *blk->data = repair;
     Buffer_Truncate(blk->data, 0);
+    if (blk->offsets) {
+      *blk->offsets = offsetsRepair;
+      Buffer_Truncate(blk->offsets, 0);
+    }
   }
   IndexResult_Free(res);
   return frags;
@@ -979,6 +1035,7 @@ int InvertedIndex_Repair(InvertedIndex *idx, DocTable *dt, uint32_t startBlock,
 
       // Increase the GC marker so other queries can tell that we did something
       ++idx->gcMarker;
+      ConcurrentSearch_AdvanceEpoch();
     }
     n++;
     startBlock++;
@@ -986,3 +1043,157 @@ int InvertedIndex_Repair(InvertedIndex *idx, DocTable *dt, uint32_t startBlock,
 
   return startBlock < idx->size ? startBlock : 0;
 }
+
+void InvertedIndex_SplitOffsets(InvertedIndex *idx) {
+  if (!(idx->flags & Index_StoreTermOffsets)) return;
+
+  IndexDecoder decoder = InvertedIndex_GetDecoder(idx->flags & INDEX_STORAGE_MASK);
+  IndexEncoder encoder = InvertedIndex_GetEncoder(idx->flags & INDEX_STORAGE_MASK);
+  if (!encoder || !decoder) return;
+
+  RSIndexResult *res = NewTokenRecord(NULL);
+  for (uint32_t i = 0; i < idx->size; i++) {
+    IndexBlock *blk = &idx->blocks[i];
+    Buffer *old = blk->data;
+    blk->data = NewBuffer(MAX(Buffer_Offset(old), INDEX_BLOCK_INITIAL_CAP));
+    blk->offsets = NewBuffer(INDEX_BLOCK_INITIAL_CAP);
+    BufferWriter bw = NewBufferWriter(blk->data);
+    BufferWriter ow = NewBufferWriter(blk->offsets);
+
+    // The offsets of a record were written right after it, so reading its offsets stream from the
+    // same reader as the record itself reads the old layout
+    BufferReader br = NewBufferReader(old);
+    while (!BufferReader_AtEnd(&br)) {
+      decoder(&br, &br, (IndexDecoderCtx){}, res);
+      encoder(&bw, &ow, res->docId, res);
+    }
+    Buffer_Truncate(blk->data, 0);
+    Buffer_Free(old);
+    free(old);
+  }
+  IndexResult_Free(res);
+}
+
+/* The impact of a term on the score of a document - its TF-IDF score without the IDF */
+static inline double championImpact(RSDocumentMetadata *dmd, uint32_t freq) {
+  return (double)freq * dmd->score / (double)dmd->maxFreq;
+}
+
+static inline void championTier_Swap(ChampionTier *t, uint32_t i, uint32_t j) {
+  IndexChampion tmp = t->entries[i];
+  t->entries[i] = t->entries[j];
+  t->entries[j] = tmp;
+}
+
+static void championTier_SiftUp(ChampionTier *t, uint32_t i) {
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (t->entries[parent].impact <= t->entries[i].impact) break;
+    championTier_Swap(t, i, parent);
+    i = parent;
+  }
+}
+
+static void championTier_SiftDown(ChampionTier *t, uint32_t i) {
+  while (1) {
+    uint32_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < t->size && t->entries[l].impact < t->entries[min].impact) min = l;
+    if (r < t->size && t->entries[r].impact < t->entries[min].impact) min = r;
+    if (min == i) break;
+    championTier_Swap(t, i, min);
+    i = min;
+  }
+}
+
+/* Offer a document to the tier. If the tier is full, the weaker of the document and the weakest
+ * champion is left out of the tier, and its impact is accounted for in the bound */
+static void championTier_Offer(ChampionTier *t, t_docId docId, double impact) {
+  if (t->size < t->cap) {
+    t->entries[t->size] = (IndexChampion){.docId = docId, .impact = impact};
+    championTier_SiftUp(t, t->size++);
+    return;
+  }
+  if (impact <= t->entries[0].impact) {
+    t->bound = MAX(t->bound, impact);
+    return;
+  }
+  t->bound = MAX(t->bound, t->entries[0].impact);
+  t->entries[0] = (IndexChampion){.docId = docId, .impact = impact};
+  championTier_SiftDown(t, 0);
+}
+
+void InvertedIndex_BuildChampions(InvertedIndex *idx, DocTable *dt, size_t size,
+                                  uint32_t scoreRevision) {
+  IndexReader *ir = NewTermIndexReader(idx, NULL, RS_FIELDMASK_ALL, NULL);
+  if (!ir) return;
+
+  ChampionTier *t = idx->champions;
+  if (t && t->cap != size) {
+    championTier_Free(t);
+    t = NULL;
+  }
+  if (!t) {
+    t = rm_malloc(sizeof(*t));
+    t->entries = rm_malloc(size * sizeof(IndexChampion));
+    t->cap = size;
+    idx->champions = t;
+  }
+  t->size = 0;
+  t->bound = 0;
+  t->scoreRevision = scoreRevision;
+
+  RSIndexResult *r;
+  while (IR_Read(ir, &r) != INDEXREAD_EOF) {
+    RSDocumentMetadata *dmd = DocTable_Get(dt, r->docId);
+    if (!dmd || dmd->flags & Document_Deleted) continue;
+    championTier_Offer(t, r->docId, championImpact(dmd, r->freq));
+  }
+  IR_Free(ir);
+}
+
+void InvertedIndex_AddChampion(InvertedIndex *idx, DocTable *dt, t_docId docId, uint32_t freq,
+                               size_t size, uint32_t scoreRevision) {
+  // without frequencies the impacts can't be told apart
+  if (!(idx->flags & Index_StoreFreqs)) return;
+
+  if (!idx->champions) {
+    InvertedIndex_BuildChampions(idx, dt, size, scoreRevision);
+    return;
+  }
+  if (idx->champions->scoreRevision != scoreRevision) return;
+
+  RSDocumentMetadata *dmd = DocTable_Get(dt, docId);
+  if (dmd) {
+    championTier_Offer(idx->champions, docId, championImpact(dmd, freq));
+  }
+}
+
+void InvertedIndex_CollectChampions(InvertedIndex *idx, DocTable *dt, size_t size,
+                                    uint32_t scoreRevision) {
+  if (!(idx->flags & Index_StoreFreqs)) return;
+
+  ChampionTier *t = InvertedIndex_GetChampions(idx, scoreRevision);
+  if (t) {
+    // dropping champions keeps the bound valid for the documents not in the tier
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < t->size; i++) {
+      RSDocumentMetadata *dmd = DocTable_Get(dt, t->entries[i].docId);
+      if (dmd && !(dmd->flags & Document_Deleted)) {
+        t->entries[n++] = t->entries[i];
+      }
+    }
+    if (n < t->size) {
+      t->size = n;
+      for (uint32_t i = n / 2; i-- > 0;) {
+        championTier_SiftDown(t, i);
+      }
+    }
+    if (t->size >= t->cap / 2) return;
+  }
+  InvertedIndex_BuildChampions(idx, dt, size, scoreRevision);
+}
+
+ChampionTier *InvertedIndex_GetChampions(InvertedIndex *idx, uint32_t scoreRevision) {
+  ChampionTier *t = idx->champions;
+  return t && t->scoreRevision == scoreRevision ? t : NULL;
+}
@@ -18,8 +18,34 @@ typedef struct {
   t_docId lastId;
   uint16_t numDocs;
   Buffer *data;
+  // the term offsets of the records, kept apart from their doc ids, frequencies and field masks so
+  // that reading the records without their offsets never has to step over them. NULL if the index
+  // does not store term offsets
+  Buffer *offsets;
 } IndexBlock;
 
+/* A document in the champion tier of a term, and the impact of the term on its score */
+typedef struct {
+  t_docId docId;
+  double impact;
+} IndexChampion;
+
+/* The champion tier of a frequent term: the documents where the term has the highest impact on the
+ * score. The impact is the frequency of the term in the document times the document score,
+ * normalized by the maximal term frequency of the document, the same way the default scorer does.
+ * Scored queries read the tier first, and can skip the rest of the term's documents if none of
+ * them can beat the results found in the tier */
+typedef struct {
+  // a min-heap on impact, so the weakest champion is the one replaced
+  IndexChampion *entries;
+  uint32_t size;
+  uint32_t cap;
+  // the highest impact of the term in any document not in the tier
+  double bound;
+  // the score revision of the index spec the impacts were computed at
+  uint32_t scoreRevision;
+} ChampionTier;
+
 typedef struct {
   IndexBlock *blocks;
   uint32_t size;
@@ -27,6 +53,8 @@ typedef struct {
   t_docId lastId;
   uint32_t numDocs;
   uint32_t gcMarker;
+  // the champion tier of the term. NULL unless the term is frequent enough to have one
+  ChampionTier *champions;
 } InvertedIndex;
 
 struct indexReadCtx;
@@ -48,17 +76,23 @@ void InvertedIndex_Free(void *idx);
 int InvertedIndex_Repair(InvertedIndex *idx, DocTable *dt, uint32_t startBlock, int num,
                          size_t *bytesCollected, size_t *recordsRemoved);
 
+/* Move the term offsets of an index loaded from an older RDB, where they were written inline after
+ * each record, to the offsets streams of its blocks */
+void InvertedIndex_SplitOffsets(InvertedIndex *idx);
+
 /**
  * Decode a single record from the buffer reader. This function is responsible for:
- * (1) Decoding the record at the given position of br
- * (2) Advancing the reader's position to the next record
+ * (1) Decoding the record at the given position of br, and pointing its term offsets at the given
+ *     position of obr, the block's offsets stream, without decoding them
+ * (2) Advancing the readers' positions to the next record
  * (3) Filtering the record based on any relevant information (can be passed through `ctx`)
  * (4) Populating `res` with the information from the record.
  *
  * If the record should not be processed, it should not be populated and 0 should
  * be returned. Otherwise, the function should return 1.
  */
-typedef int (*IndexDecoder)(BufferReader *br, IndexDecoderCtx ctx, RSIndexResult *res);
+typedef int (*IndexDecoder)(BufferReader *br, BufferReader *obr, IndexDecoderCtx ctx,
+                            RSIndexResult *res);
 
 /* Get the decoder for the index based on the index flags. This is used to externally inject the
  * endoder/decoder when reading and writing */
@@ -68,6 +102,8 @@ IndexDecoder InvertedIndex_GetDecoder(uint32_t flags);
 typedef struct indexReadCtx {
   // the underlying data buffer
   BufferReader br;
+  // the offsets stream of the current block
+  BufferReader obr;
 
   InvertedIndex *idx;
   // last docId, used for delta encoding/decoding
@@ -97,14 +133,34 @@ typedef struct indexReadCtx {
 void IndexReader_OnReopen(RedisModuleKey *k, void *privdata);
 
 /* An index encoder is a callback that writes records to the index. It accepts a pre-calculated
- * delta for encoding */
-typedef size_t (*IndexEncoder)(BufferWriter *bw, t_docId delta, RSIndexResult *record);
+ * delta for encoding, and writes the record's term offsets, if it stores them, to ow */
+typedef size_t (*IndexEncoder)(BufferWriter *bw, BufferWriter *ow, t_docId delta,
+                               RSIndexResult *record);
 
 /* Write a ForwardIndexEntry into an indexWriter. Returns the number of bytes written to the index
  */
 size_t InvertedIndex_WriteForwardIndexEntry(InvertedIndex *idx, IndexEncoder encoder,
                                             ForwardIndexEntry *ent);
 
+/* Add a document just written to the index to its champion tier, if the term's impact on the
+ * document is high enough. If the index has no tier yet, it is built from all the documents of the
+ * index, keeping up to size champions. A tier computed at an older score revision is left as is,
+ * for the GC to rebuild */
+void InvertedIndex_AddChampion(InvertedIndex *idx, DocTable *dt, t_docId docId, uint32_t freq,
+                               size_t size, uint32_t scoreRevision);
+
+/* Build the champion tier of the index from all its documents, keeping up to size champions */
+void InvertedIndex_BuildChampions(InvertedIndex *idx, DocTable *dt, size_t size,
+                                  uint32_t scoreRevision);
+
+/* Called by the GC: remove deleted documents from the champion tier of the index, and rebuild it if
+ * it is missing, stale, or has lost more than half of its champions */
+void InvertedIndex_CollectChampions(InvertedIndex *idx, DocTable *dt, size_t size,
+                                    uint32_t scoreRevision);
+
+/* Get the champion tier of an index, or NULL if it has none or it is stale */
+ChampionTier *InvertedIndex_GetChampions(InvertedIndex *idx, uint32_t scoreRevision);
+
 /* Write a numeric index entry to the index. it includes only a float value and docId. Returns the
  * number of bytes written */
 size_t InvertedIndex_WriteNumericEntry(InvertedIndex *idx, t_docId docId, double value);
@@ -156,7 +212,8 @@ size_t IR_NumDocs(void *ctx);
 /* LastDocId of an inverted index stateful reader */
 t_docId IR_LastDocId(void *ctx);
 
-/* Seek the inverted index reader to a specific offset and set the last docId */
+/* Seek the inverted index reader to a specific offset and set the last docId. The offsets stream
+ * is not moved, so this is only valid for indexes without term offsets */
 void IR_Seek(IndexReader *ir, t_offset offset, t_docId docId);
 
 /* Create a reader iterator that iterates an inverted index record */
@@ -245,6 +245,7 @@ int SetPayloadCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_ReplyWithError(ctx, "Could not set payload ¯\\_(ツ)_/¯");
     goto cleanup;
   }
+  sp->revision++;
 
   RedisModule_ReplyWithSimpleString(ctx, "OK");
 cleanup:
@@ -279,6 +280,52 @@ static int renderIndexOptions(RedisModuleCtx *ctx, IndexSpec *sp) {
   return 2;
 }
 
+/* The stem cache is shared by all the indexes, so these are global stats */
+static void renderStemCacheStats(RedisModuleCtx *ctx) {
+  StemCacheStats st;
+  Stemmer_GetCacheStats(&st);
+  size_t lookups = st.hits + st.misses;
+
+  RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+  int n = 0;
+  REPLY_KVNUM(n, "hits", st.hits);
+  REPLY_KVNUM(n, "misses", st.misses);
+  REPLY_KVNUM(n, "hit_rate", (double)st.hits / (double)(lookups ? lookups : 1));
+  REPLY_KVNUM(n, "entries", st.entries);
+  REPLY_KVNUM(n, "memory_mb", st.memory / (float)0x100000);
+  RedisModule_ReplySetArrayLength(ctx, n);
+}
+
+static void renderQueryCacheStats(RedisModuleCtx *ctx, IndexSpec *sp) {
+  QueryCacheStats st;
+  QueryCache_GetStats(sp->queryCache, &st);
+  size_t lookups = st.hits + st.misses;
+
+  RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+  int n = 0;
+  REPLY_KVNUM(n, "hits", st.hits);
+  REPLY_KVNUM(n, "misses", st.misses);
+  REPLY_KVNUM(n, "hit_rate", (double)st.hits / (double)(lookups ? lookups : 1));
+  REPLY_KVNUM(n, "entries", st.entries);
+  REPLY_KVNUM(n, "memory_mb", st.memory / (float)0x100000);
+  RedisModule_ReplySetArrayLength(ctx, n);
+}
+
+static void renderQueryStats(RedisModuleCtx *ctx, IndexSpec *sp) {
+  QueryStats *st = &sp->queryStats;
+
+  RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+  int n = 0;
+  REPLY_KVNUM(n, "queries", st->numQueries);
+  REPLY_KVNUM(n, "rejected", st->numRejected);
+  REPLY_KVNUM(n, "degraded", st->numDegraded);
+  REPLY_KVNUM(n, "docs_scanned", st->docsScanned);
+  REPLY_KVNUM(n, "cpu_time_ms", st->cpuTimeNS / 1000000.0);
+  REPLY_KVNUM(n, "avg_cpu_time_ms",
+              st->cpuTimeNS / 1000000.0 / (double)(st->numQueries ? st->numQueries : 1));
+  RedisModule_ReplySetArrayLength(ctx, n);
+}
+
 /* FT.INFO {index}
  *  Provide info and stats about an index
  */
@@ -322,6 +369,10 @@ int IndexInfoCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
       RedisModule_ReplyWithSimpleString(ctx, SPEC_NOSTEM_STR);
       ++nn;
     }
+    if (FieldSpec_IsShingled(&sp->fields[i])) {
+      RedisModule_ReplyWithSimpleString(ctx, SPEC_SHINGLES_STR);
+      ++nn;
+    }
     if (!FieldSpec_IsIndexable(&sp->fields[i])) {
       RedisModule_ReplyWithSimpleString(ctx, SPEC_NOINDEX_STR);
       ++nn;
@@ -366,6 +417,18 @@ int IndexInfoCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
   Cursors_RenderStats(&RSCursors, RedisModule_StringPtrLen(specKey, NULL), ctx);
   n += 2;
 
+  RedisModule_ReplyWithSimpleString(ctx, "stem_cache_stats");
+  renderStemCacheStats(ctx);
+  n += 2;
+
+  RedisModule_ReplyWithSimpleString(ctx, "query_stats");
+  renderQueryStats(ctx, sp);
+  n += 2;
+
+  RedisModule_ReplyWithSimpleString(ctx, "query_cache_stats");
+  renderQueryCacheStats(ctx, sp);
+  n += 2;
+
   RedisModule_ReplySetArrayLength(ctx, n);
   return REDISMODULE_OK;
 }
@@ -436,7 +499,7 @@ int GetSingleDocumentCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int
   return REDISMODULE_OK;
 }
 
-/* FT.EXPLAIN {index_name} {query} */
+/* FT.EXPLAIN {index_name} {query} [WITHCOSTS] */
 int QueryExplainCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
 
   // at least one field, and number of field/text args must be even
@@ -505,7 +568,10 @@ int QueryExplainCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
     req->numericFilters = NULL;
   }
 
-  char *explain = (char *)Query_DumpExplain(q);
+  // WITHCOSTS plans the query, and adds the estimated number of results of every node
+  char *explain = RMUtil_ArgExists("WITHCOSTS", argv, argc, 3)
+                      ? (char *)Query_DumpExplainCosts(q, &req->opts)
+                      : (char *)Query_DumpExplain(q);
   RedisModule_ReplyWithStringBuffer(ctx, explain, strlen(explain));
   free(explain);
 
@@ -516,6 +582,27 @@ end:
   return REDISMODULE_OK;
 }
 
+/* Read the next chunks of a cursor into its plan's buffer, in the background. This runs on the
+ * search thread pool, queued before the client can even send its next read, so a read waiting for
+ * it never starves it of a thread */
+static void cursorPrefetch(void *p) {
+  Cursor *cursor = p;
+  AggregateRequest *req = cursor->execState;
+  RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(NULL);
+  RedisModule_ThreadSafeContextLock(ctx);
+
+  ConcurrentSearchCtx_ReopenKeys(req->plan->conc);
+  QueryPlan_Prefetch(req->plan, req->plan->opts.chunksize * req->ap.cursor.prefetch);
+  if (Cursor_EndPrefetch(cursor) != REDISMODULE_OK) {
+    // The cursor was deleted while we were reading
+    AggregateRequest_Free(req);
+    Cursor_Free(cursor);
+  }
+
+  RedisModule_ThreadSafeContextUnlock(ctx);
+  RedisModule_FreeThreadSafeContext(ctx);
+}
+
 static void runCursor(RedisModuleCtx *outputCtx, Cursor *cursor, size_t num) {
   AggregateRequest *req = cursor->execState;
   if (!num) {
@@ -543,6 +630,12 @@ static void runCursor(RedisModuleCtx *outputCtx, Cursor *cursor, size_t num) {
 
   if (req->plan->outputFlags & QP_OUTPUT_FLAG_DONE) {
     goto delcursor;
+  } else if (req->ap.cursor.prefetch > 0 && req->plan->conc) {
+    // Keep reading the next chunks in the background, so the next read does not wait for them
+    Cursor_StartPrefetch(cursor);
+    ConcurrentSearch_ThreadPoolRun(cursorPrefetch, cursor, CONCURRENT_POOL_SEARCH,
+                                   ConcurrentPriority_Aggregate);
+    return;
   } else {
     // Update the idle timeout
     Cursor_Pause(cursor);
@@ -554,17 +647,17 @@ delcursor:
   Cursor_Free(cursor);
 }
 
-#define GEN_CONCURRENT_WRAPPER(name, argcond, target, pooltype)                      \
-  static int name(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {         \
-    if (!(argcond)) {                                                                \
-      return RedisModule_WrongArity(ctx);                                            \
-    }                                                                                \
-    if (CheckConcurrentSupport(ctx)) {                                               \
-      return ConcurrentSearch_HandleRedisCommand(pooltype, target, ctx, argv, argc); \
-    } else {                                                                         \
-      target(ctx, argv, argc, NULL);                                                 \
-      return REDISMODULE_OK;                                                         \
-    }                                                                                \
+#define GEN_CONCURRENT_WRAPPER(name, argcond, target, pooltype, priority)                     \
+  static int name(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {                   \
+    if (!(argcond)) {                                                                          \
+      return RedisModule_WrongArity(ctx);                                                      \
+    }                                                                                          \
+    if (CheckConcurrentSupport(ctx)) {                                                         \
+      return ConcurrentSearch_HandleRedisCommand(pooltype, priority, target, ctx, argv, argc); \
+    } else {                                                                                   \
+      target(ctx, argv, argc, NULL);                                                           \
+      return REDISMODULE_OK;                                                                   \
+    }                                                                                          \
   }
 
 /**
@@ -572,7 +665,18 @@ delcursor:
  * FT.CURSOR DEL {index} {CID}
  * FT.CURSOR GC {index}
  */
-static void cursorRead(RedisModuleCtx *ctx, uint64_t cid, size_t count) {
+static void cursorRead(RedisModuleCtx *ctx, uint64_t cid, size_t count, int isConcurrent) {
+  if (Cursors_IsPrefetching(&RSCursors, cid)) {
+    if (!isConcurrent) {
+      // We can't release the GIL for the prefetching cursor from the main thread
+      RedisModule_ReplyWithError(ctx, "Cursor is busy");
+      return;
+    }
+    RedisModule_ThreadSafeContextUnlock(ctx);
+    Cursors_WaitPrefetch(&RSCursors, cid);
+    RedisModule_ThreadSafeContextLock(ctx);
+  }
+
   Cursor *cursor = Cursors_TakeForExecution(&RSCursors, cid);
   if (cursor == NULL) {
     RedisModule_ReplyWithError(ctx, "Cursor not found");
@@ -584,7 +688,7 @@ static void cursorRead(RedisModuleCtx *ctx, uint64_t cid, size_t count) {
 }
 
 static void _CursorCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
-                           struct ConcurrentCmdCtx *unused) {
+                           struct ConcurrentCmdCtx *cmdCtx) {
   if (argc < 3) {
     RedisModule_WrongArity(ctx);
     return;
@@ -613,7 +717,7 @@ static void _CursorCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int ar
         return;
       }
     }
-    cursorRead(ctx, cid, count);
+    cursorRead(ctx, cid, count, cmdCtx != NULL);
 
   } else if (cmdc == 'D') {
     int rc = Cursors_Purge(&RSCursors, cid);
@@ -632,7 +736,8 @@ static void _CursorCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int ar
   }
 }
 
-GEN_CONCURRENT_WRAPPER(CursorCommand, argc >= 4, _CursorCommand, CONCURRENT_POOL_SEARCH)
+GEN_CONCURRENT_WRAPPER(CursorCommand, argc >= 4, _CursorCommand, CONCURRENT_POOL_SEARCH,
+                       ConcurrentPriority_Aggregate)
 
 /*
   FT.AGGREGATE
@@ -701,7 +806,8 @@ done:
   SearchCtx_Free(sctx);
 }
 
-GEN_CONCURRENT_WRAPPER(AggregateCommand, argc >= 3, _AggregateCommand, CONCURRENT_POOL_SEARCH);
+GEN_CONCURRENT_WRAPPER(AggregateCommand, argc >= 3, _AggregateCommand, CONCURRENT_POOL_SEARCH,
+                       ConcurrentPriority_Aggregate);
 
 /* FT.DEL {index} {doc_id}
  *  Delete a document from the index. Returns 1 if the document was in the index, or 0 if not.
@@ -727,6 +833,7 @@ int DeleteCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
   int rc = DocTable_Delete(&sp->docs, MakeDocKeyR(argv[2]));
   if (rc == 1) {
     sp->stats.numDocuments--;
+    sp->revision++;
 
     // If needed - delete the actual doc
     if (delDoc) {
@@ -993,7 +1100,8 @@ end:
   if (q) Query_Free(q);
 }
 
-GEN_CONCURRENT_WRAPPER(SearchCommand, argc >= 3, _SearchCommand, CONCURRENT_POOL_SEARCH)
+GEN_CONCURRENT_WRAPPER(SearchCommand, argc >= 3, _SearchCommand, CONCURRENT_POOL_SEARCH,
+                       ConcurrentPriority_Search)
 
 /* FT.TAGVALS {idx} {field}
  * Return all the values of a tag field.
@@ -1035,7 +1143,7 @@ cleanup:
 }
 /*
 ## FT.CREATE {index} [NOOFFSETS] [NOFIELDS]
-    SCHEMA {field} [TEXT [NOSTEM] [WEIGHT {weight}]] | [NUMERIC] ...
+    SCHEMA {field} [TEXT [NOSTEM] [SHINGLES] [WEIGHT {weight}]] | [NUMERIC] ...
 
 Creates an index with the given spec. The index name will be used in all the
 key
@@ -1156,6 +1264,36 @@ int DropIndexCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
   return RedisModule_ReplyWithSimpleString(ctx, "OK");
 }
 
+typedef struct {
+  char *keyName;
+  size_t keyLen;
+  int db;
+} suggestCompactCtx;
+
+/* Compact a suggestion dictionary into its frozen representation after a burst of additions. This
+ * runs on the indexing thread pool, so the SUGADD that triggered it does not wait for it */
+static void suggestCompact(void *p) {
+  suggestCompactCtx *sc = p;
+  RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(NULL);
+  RedisModule_ThreadSafeContextLock(ctx);
+  RedisModule_SelectDb(ctx, sc->db);
+
+  RedisModuleString *keyName = RedisModule_CreateString(ctx, sc->keyName, sc->keyLen);
+  RedisModuleKey *key = RedisModule_OpenKey(ctx, keyName, REDISMODULE_READ);
+  // the key may have been deleted or replaced in the meantime
+  if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY &&
+      RedisModule_ModuleTypeGetType(key) == TrieType) {
+    Trie_Compact(RedisModule_ModuleTypeGetValue(key));
+  }
+  RedisModule_CloseKey(key);
+  RedisModule_FreeString(ctx, keyName);
+
+  RedisModule_ThreadSafeContextUnlock(ctx);
+  RedisModule_FreeThreadSafeContext(ctx);
+  free(sc->keyName);
+  free(sc);
+}
+
 /*
 ## FT.SUGGADD key string score [INCR] [PAYLOAD {payload}]
 
@@ -1225,6 +1363,15 @@ int SuggestAddCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
   /* Insert the new element. */
   Trie_Insert(tree, val, score, incr, &payload);
 
+  if (Trie_NeedsCompaction(tree)) {
+    suggestCompactCtx *sc = malloc(sizeof(*sc));
+    const char *keyName = RedisModule_StringPtrLen(argv[1], &sc->keyLen);
+    sc->keyName = strndup(keyName, sc->keyLen);
+    sc->db = RedisModule_GetSelectedDb(ctx);
+    ConcurrentSearch_ThreadPoolRun(suggestCompact, sc, CONCURRENT_POOL_INDEX,
+                                   ConcurrentPriority_Background);
+  }
+
   RedisModule_ReplyWithLongLong(ctx, tree->size);
   RedisModule_ReplicateVerbatim(ctx);
   return REDISMODULE_OK;
@@ -1466,11 +1613,17 @@ int RediSearch_InitModuleInternal(RedisModuleCtx *ctx, RedisModuleString **argv,
   }
   RedisModule_Log(ctx, "notice",
                   "Configuration: concurrent mode: %d, ext load: %s, min prefix: %d, max "
-                  "expansions: %d, query timeout: %dms, timeout policy: %s",
+                  "expansions: %d, query timeout: %dms, timeout policy: %s, search threads: %lld, "
+                  "index threads: %lld, max query cost: %lld, query cost policy: %s, query cache "
+                  "max memory: %lld",
                   RSGlobalConfig.concurrentMode, RSGlobalConfig.extLoad,
                   RSGlobalConfig.minTermPrefix, RSGlobalConfig.maxPrefixExpansions,
                   RSGlobalConfig.queryTimeoutMS,
-                  TimeoutPolicy_ToString(RSGlobalConfig.timeoutPolicy));
+                  TimeoutPolicy_ToString(RSGlobalConfig.timeoutPolicy),
+                  RSGlobalConfig.searchPoolSize, RSGlobalConfig.indexPoolSize,
+                  RSGlobalConfig.maxQueryCost,
+                  TimeoutPolicy_ToString(RSGlobalConfig.queryCostPolicy),
+                  RSGlobalConfig.queryCacheMaxMemory);
 
   if (RedisModule_GetContextFlags == NULL && RSGlobalConfig.concurrentMode) {
     RedisModule_Log(ctx, "warning",
@@ -7,6 +7,8 @@
 #include <math.h>
 #include "redismodule.h"
 #include "util/misc.h"
+#include "doc_table.h"
+#include "value.h"
 //#include "tests/time_sample.h"
 #define NR_EXPONENT 4
 #define NR_MAXRANGE_CARD 2500
@@ -273,6 +275,7 @@ int NumericRangeTree_Add(NumericRangeTree *t, t_docId docId, double value) {
   // will abort the next time they get execution context
   if (rc) {
     t->revisionId++;
+    ConcurrentSearch_AdvanceEpoch();
   }
   t->numRanges += rc;
   t->numEntries++;
@@ -298,6 +301,7 @@ void NumericRangeNode_Traverse(NumericRangeNode *n,
 }
 
 void NumericRangeTree_Free(NumericRangeTree *t) {
+  ConcurrentSearch_AdvanceEpoch();
   NumericRangeNode_Free(t->root);
   RedisModule_Free(t);
 }
@@ -316,7 +320,10 @@ IndexIterator *NewNumericRangeIterator(NumericRange *nr, NumericFilter *f) {
 
 /* Create a union iterator from the numeric filter, over all the sub-ranges in the tree that fit
  * the filter */
-IndexIterator *createNumericIterator(NumericRangeTree *t, NumericFilter *f) {
+/* Create an iterator over the ranges matching the filter. If numEntries is not NULL, it is
+ * incremented by the number of entries in the selected ranges - an upper bound of the results */
+static IndexIterator *createNumericIteratorEx(NumericRangeTree *t, NumericFilter *f,
+                                              size_t *numEntries) {
 
   Vector *v = NumericRangeTree_Find(t, f->min, f->max);
   if (!v || Vector_Size(v) == 0) {
@@ -330,6 +337,7 @@ IndexIterator *createNumericIterator(NumericRangeTree *t, NumericFilter *f) {
     NumericRange *rng;
     Vector_Get(v, 0, &rng);
     IndexIterator *it = NewNumericRangeIterator(rng, f);
+    if (numEntries) *numEntries += rng->entries->numDocs;
     Vector_Free(v);
     return it;
   }
@@ -346,6 +354,7 @@ IndexIterator *createNumericIterator(NumericRangeTree *t, NumericFilter *f) {
     }
 
     its[i] = NewNumericRangeIterator(rng, f);
+    if (numEntries) *numEntries += rng->entries->numDocs;
   }
   Vector_Free(v);
 
@@ -354,6 +363,10 @@ IndexIterator *createNumericIterator(NumericRangeTree *t, NumericFilter *f) {
   return it;
 }
 
+IndexIterator *createNumericIterator(NumericRangeTree *t, NumericFilter *f) {
+  return createNumericIteratorEx(t, f, NULL);
+}
+
 RedisModuleType *NumericIndexType = NULL;
 #define NUMERICINDEX_KEY_FMT "nm:%s/%s"
 
@@ -363,7 +376,7 @@ RedisModuleString *fmtRedisNumericIndexKey(RedisSearchCtx *ctx, const char *fiel
 }
 
 struct indexIterator *NewNumericFilterIterator(RedisSearchCtx *ctx, NumericFilter *flt,
-                                               ConcurrentSearchCtx *csx) {
+                                               ConcurrentSearchCtx *csx, size_t *numEntries) {
   RedisModuleString *s = fmtRedisNumericIndexKey(ctx, flt->fieldName);
   RedisModuleKey *key = RedisModule_OpenKey(ctx->redisCtx, s, REDISMODULE_READ);
   if (!key || RedisModule_ModuleTypeGetType(key) != NumericIndexType) {
@@ -371,18 +384,150 @@ struct indexIterator *NewNumericFilterIterator(RedisSearchCtx *ctx, NumericFilte
   }
   NumericRangeTree *t = RedisModule_ModuleTypeGetValue(key);
 
-  IndexIterator *it = createNumericIterator(t, flt);
+  IndexIterator *it = createNumericIteratorEx(t, flt, numEntries);
   if (!it) {
     return NULL;
   }
 
-  NumericUnionCtx *uc = malloc(sizeof(*uc));
-  uc->lastRevId = t->revisionId;
-  uc->it = it;
   if (csx) {
+    NumericUnionCtx *uc = malloc(sizeof(*uc));
+    uc->lastRevId = t->revisionId;
+    uc->it = it;
     ConcurrentSearch_AddKey(csx, key, REDISMODULE_READ, s, NumericRangeIterator_OnReopen, uc, free,
-                            ConcurrentKey_SharedNothing);
+                            ConcurrentKey_Versioned);
+  }
+  return it;
+}
+
+size_t NumericFilter_EstimateEntries(RedisSearchCtx *ctx, NumericFilter *flt) {
+  RedisModuleString *s = fmtRedisNumericIndexKey(ctx, flt->fieldName);
+  RedisModuleKey *key = RedisModule_OpenKey(ctx->redisCtx, s, REDISMODULE_READ);
+  RedisModule_FreeString(ctx->redisCtx, s);
+  if (!key) return 0;
+
+  size_t n = 0;
+  if (RedisModule_ModuleTypeGetType(key) == NumericIndexType) {
+    NumericRangeTree *t = RedisModule_ModuleTypeGetValue(key);
+    Vector *v = NumericRangeTree_Find(t, flt->min, flt->max);
+    if (v) {
+      for (size_t i = 0; i < Vector_Size(v); i++) {
+        NumericRange *rng;
+        Vector_Get(v, i, &rng);
+        if (rng) n += rng->entries->numDocs;
+      }
+      Vector_Free(v);
+    }
+  }
+  RedisModule_CloseKey(key);
+  return n;
+}
+
+/* A numeric post filter passes on the results of its child whose documents have a sortable value
+ * matching the filter */
+typedef struct {
+  IndexIterator *child;
+  NumericFilter *filter;
+  DocTable *docTable;
+  RSSortingKey key;
+  t_docId lastDocId;
+  size_t len;
+} NumericPostFilterCtx;
+
+static int NPF_Match(NumericPostFilterCtx *pf, t_docId docId) {
+  RSDocumentMetadata *dmd = DocTable_Get(pf->docTable, docId);
+  if (!dmd) return 0;
+  RSValue *v = RSSortingVector_Get(dmd->sortVector, &pf->key);
+  v = v ? RSValue_Dereference(v) : NULL;
+  return v && v->t == RSValue_Number && NumericFilter_Match(pf->filter, v->numval);
+}
+
+static int NPF_Read(void *ctx, RSIndexResult **hit) {
+  NumericPostFilterCtx *pf = ctx;
+  RSIndexResult *res = NULL;
+  while (pf->child->Read(pf->child->ctx, &res) != INDEXREAD_EOF) {
+    if (res && NPF_Match(pf, res->docId)) {
+      pf->lastDocId = res->docId;
+      pf->len++;
+      if (hit) *hit = res;
+      return INDEXREAD_OK;
+    }
   }
+  return INDEXREAD_EOF;
+}
+
+static int NPF_SkipTo(void *ctx, t_docId docId, RSIndexResult **hit) {
+  NumericPostFilterCtx *pf = ctx;
+  RSIndexResult *res = NULL;
+  int rc = pf->child->SkipTo(pf->child->ctx, docId, &res);
+  if (rc == INDEXREAD_EOF) return INDEXREAD_EOF;
+
+  if (res && NPF_Match(pf, res->docId)) {
+    pf->lastDocId = res->docId;
+    if (rc == INDEXREAD_OK) pf->len++;
+    if (hit) *hit = res;
+    return rc;
+  }
+
+  // the child landed on a filtered out document, move on to the next one that passes
+  rc = NPF_Read(ctx, hit);
+  return rc == INDEXREAD_EOF ? INDEXREAD_EOF : INDEXREAD_NOTFOUND;
+}
+
+static RSIndexResult *NPF_Current(void *ctx) {
+  NumericPostFilterCtx *pf = ctx;
+  return pf->child->Current(pf->child->ctx);
+}
+
+static t_docId NPF_LastDocId(void *ctx) {
+  return ((NumericPostFilterCtx *)ctx)->lastDocId;
+}
+
+static int NPF_HasNext(void *ctx) {
+  NumericPostFilterCtx *pf = ctx;
+  return pf->child->HasNext(pf->child->ctx);
+}
+
+static size_t NPF_Len(void *ctx) {
+  return ((NumericPostFilterCtx *)ctx)->len;
+}
+
+static void NPF_Abort(void *ctx) {
+  NumericPostFilterCtx *pf = ctx;
+  pf->child->Abort(pf->child->ctx);
+}
+
+static void NPF_Rewind(void *ctx) {
+  NumericPostFilterCtx *pf = ctx;
+  pf->lastDocId = 0;
+  pf->child->Rewind(pf->child->ctx);
+}
+
+static void NPF_Free(IndexIterator *it) {
+  NumericPostFilterCtx *pf = it->ctx;
+  pf->child->Free(pf->child);
+  free(pf);
+  free(it);
+}
+
+IndexIterator *NewNumericPostFilterIterator(IndexIterator *child, NumericFilter *flt, DocTable *dt,
+                                            int sortIdx) {
+  NumericPostFilterCtx *pf = calloc(1, sizeof(*pf));
+  pf->child = child;
+  pf->filter = flt;
+  pf->docTable = dt;
+  pf->key = (RSSortingKey){.index = sortIdx, .ascending = 1};
+
+  IndexIterator *it = malloc(sizeof(*it));
+  it->ctx = pf;
+  it->Current = NPF_Current;
+  it->Read = NPF_Read;
+  it->SkipTo = NPF_SkipTo;
+  it->LastDocId = NPF_LastDocId;
+  it->HasNext = NPF_HasNext;
+  it->Free = NPF_Free;
+  it->Len = NPF_Len;
+  it->Abort = NPF_Abort;
+  it->Rewind = NPF_Rewind;
   return it;
 }
 
@@ -54,8 +54,19 @@ typedef struct {
 
 struct indexIterator *NewNumericRangeIterator(NumericRange *nr, NumericFilter *f);
 
+/* Create an iterator over the documents matching a numeric filter. If numEntries is not NULL, it is
+ * incremented by the number of entries in the ranges the filter selects */
 struct indexIterator *NewNumericFilterIterator(RedisSearchCtx *ctx, NumericFilter *flt,
-                                               ConcurrentSearchCtx *csx);
+                                               ConcurrentSearchCtx *csx, size_t *numEntries);
+
+/* Return the number of entries in the ranges a numeric filter selects, without opening them */
+size_t NumericFilter_EstimateEntries(RedisSearchCtx *ctx, NumericFilter *flt);
+
+/* Create an iterator passing on the results of child whose documents match a numeric filter. The
+ * values are read from the sortable field at sortIdx of the documents, rather than from the numeric
+ * index, which is cheaper when the child has much fewer results than the filter */
+struct indexIterator *NewNumericPostFilterIterator(struct indexIterator *child, NumericFilter *flt,
+                                                   DocTable *dt, int sortIdx);
 
 /* Add an entry to a numeric range node. Returns the cardinality of the range after the
  * inserstion.
@@ -0,0 +1,144 @@
+#include "prefix_cache.h"
+#include "util/khash.h"
+#include "util/fnv.h"
+#include <string.h>
+
+typedef struct {
+  const char *str;
+  size_t len;
+} prefixKey;
+
+static inline khint_t prefixKey_hash(prefixKey k) {
+  return rs_fnv_32a_buf((void *)k.str, k.len, 0);
+}
+
+static inline int prefixKey_equal(prefixKey a, prefixKey b) {
+  return a.len == b.len && !memcmp(a.str, b.str, a.len);
+}
+
+KHASH_INIT(prefixCache, prefixKey, PrefixCacheEntry *, 1, prefixKey_hash, prefixKey_equal);
+
+struct PrefixCache {
+  khash_t(prefixCache) * h;
+  PrefixCacheEntry *head, *tail;
+  size_t capacity;
+};
+
+PrefixCache *NewPrefixCache(size_t capacity) {
+  PrefixCache *pc = malloc(sizeof(*pc));
+  pc->h = kh_init(prefixCache);
+  pc->head = pc->tail = NULL;
+  pc->capacity = capacity;
+  return pc;
+}
+
+static void entry_Free(PrefixCacheEntry *e) {
+  for (size_t i = 0; i < e->numTerms; i++) {
+    free(e->terms[i].str);
+  }
+  free(e->terms);
+  free(e->prefix);
+  free(e);
+}
+
+static void prefixCache_Unlink(PrefixCache *pc, PrefixCacheEntry *e) {
+  if (e->prev) {
+    e->prev->next = e->next;
+  } else {
+    pc->head = e->next;
+  }
+  if (e->next) {
+    e->next->prev = e->prev;
+  } else {
+    pc->tail = e->prev;
+  }
+  e->prev = e->next = NULL;
+}
+
+static void prefixCache_PushFront(PrefixCache *pc, PrefixCacheEntry *e) {
+  e->prev = NULL;
+  e->next = pc->head;
+  if (pc->head) {
+    pc->head->prev = e;
+  } else {
+    pc->tail = e;
+  }
+  pc->head = e;
+}
+
+/* Remove an entry from the cache and free it */
+static void prefixCache_Del(PrefixCache *pc, khiter_t it) {
+  PrefixCacheEntry *e = kh_val(pc->h, it);
+  kh_del(prefixCache, pc->h, it);
+  prefixCache_Unlink(pc, e);
+  entry_Free(e);
+}
+
+void PrefixCache_Free(PrefixCache *pc) {
+  if (!pc) return;
+  PrefixCacheEntry *e = pc->head;
+  while (e) {
+    PrefixCacheEntry *next = e->next;
+    entry_Free(e);
+    e = next;
+  }
+  kh_destroy(prefixCache, pc->h);
+  free(pc);
+}
+
+PrefixCacheEntry *PrefixCache_Get(PrefixCache *pc, const char *prefix, size_t len,
+                                  uint64_t revision) {
+  khiter_t it = kh_get(prefixCache, pc->h, ((prefixKey){.str = prefix, .len = len}));
+  if (it == kh_end(pc->h)) {
+    return NULL;
+  }
+  PrefixCacheEntry *e = kh_val(pc->h, it);
+  if (e->revision != revision) {
+    prefixCache_Del(pc, it);
+    return NULL;
+  }
+  prefixCache_Unlink(pc, e);
+  prefixCache_PushFront(pc, e);
+  return e;
+}
+
+PrefixCacheEntry *PrefixCache_Put(PrefixCache *pc, const char *prefix, size_t len,
+                                  uint64_t revision) {
+  khiter_t it = kh_get(prefixCache, pc->h, ((prefixKey){.str = prefix, .len = len}));
+  if (it != kh_end(pc->h)) {
+    prefixCache_Del(pc, it);
+  } else if (kh_size(pc->h) >= pc->capacity && pc->tail) {
+    PrefixCacheEntry *last = pc->tail;
+    prefixCache_Del(pc, kh_get(prefixCache, pc->h,
+                               ((prefixKey){.str = last->prefix, .len = last->prefixLen})));
+  }
+
+  PrefixCacheEntry *e = calloc(1, sizeof(*e));
+  e->prefix = malloc(len + 1);
+  memcpy(e->prefix, prefix, len);
+  e->prefix[len] = '\0';
+  e->prefixLen = len;
+  e->revision = revision;
+
+  int rc;
+  it = kh_put(prefixCache, pc->h, ((prefixKey){.str = e->prefix, .len = len}), &rc);
+  kh_val(pc->h, it) = e;
+  prefixCache_PushFront(pc, e);
+  return e;
+}
+
+void PrefixCacheEntry_AddTerm(PrefixCacheEntry *e, const char *str, size_t len) {
+  if (e->numTerms == e->cap) {
+    e->cap = e->cap ? e->cap * 2 : 8;
+    e->terms = realloc(e->terms, e->cap * sizeof(*e->terms));
+  }
+  PrefixCacheTerm *t = &e->terms[e->numTerms++];
+  t->str = malloc(len + 1);
+  memcpy(t->str, str, len);
+  t->str[len] = '\0';
+  t->len = len;
+}
+
+size_t PrefixCache_Size(PrefixCache *pc) {
+  return kh_size(pc->h);
+}
@@ -0,0 +1,59 @@
+#ifndef __PREFIX_CACHE_H__
+#define __PREFIX_CACHE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* A cache of prefix expansions, i.e. the terms (or tags) a prefix query expands to, used to save
+ * walking the dictionary on every search of a popular prefix.
+ *
+ * Each entry is tagged with the revision of the dictionary it was expanded from. A dictionary only
+ * gets a new revision when strings are added or removed, so an entry with an old revision may be
+ * missing terms, and is dropped and rebuilt on the next lookup. When the cache is full, the least
+ * recently used prefix is evicted. */
+
+/* The number of prefixes we keep per dictionary */
+#define PREFIX_CACHE_SIZE 1024
+
+typedef struct {
+  char *str;
+  size_t len;
+} PrefixCacheTerm;
+
+typedef struct PrefixCacheEntry {
+  char *prefix;
+  size_t prefixLen;
+  uint64_t revision;
+
+  // the expanded terms, in the dictionary's iteration order
+  PrefixCacheTerm *terms;
+  size_t numTerms;
+  size_t cap;
+
+  // LRU list links, most recently used first
+  struct PrefixCacheEntry *prev, *next;
+} PrefixCacheEntry;
+
+typedef struct PrefixCache PrefixCache;
+
+PrefixCache *NewPrefixCache(size_t capacity);
+
+void PrefixCache_Free(PrefixCache *pc);
+
+/* Get the cached expansion of a prefix, if it was expanded from the given revision of the
+ * dictionary. Returns NULL if it is not cached or the entry is stale */
+PrefixCacheEntry *PrefixCache_Get(PrefixCache *pc, const char *prefix, size_t len,
+                                  uint64_t revision);
+
+/* Start caching the expansion of a prefix, replacing any existing entry. Returns the new, empty
+ * entry, to be filled by the caller with PrefixCacheEntry_AddTerm */
+PrefixCacheEntry *PrefixCache_Put(PrefixCache *pc, const char *prefix, size_t len,
+                                  uint64_t revision);
+
+/* Add a term to an entry. The term is copied */
+void PrefixCacheEntry_AddTerm(PrefixCacheEntry *e, const char *str, size_t len);
+
+/* The number of cached prefixes */
+size_t PrefixCache_Size(PrefixCache *pc);
+
+#endif
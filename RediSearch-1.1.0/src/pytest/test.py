@@ -577,6 +577,86 @@ class SearchTestCase(ModuleTestCase('../redisearch.so')):
                     'ft.search', 'idx', 'constant term9*', 'nocontent')
                 self.assertEqual([0], res)
 
+    def testPrefixCacheInvalidation(self):
+        with self.redis() as r:
+            r.flushdb()
+            self.assertOk(r.execute_command(
+                'ft.create', 'idx', 'schema', 'foo', 'text', 'tags', 'tag'))
+            self.assertOk(r.execute_command('ft.add', 'idx', 'doc1', 1.0, 'fields',
+                                            'foo', 'hello', 'tags', 'helium'))
+            for _ in range(2):
+                self.assertEqual(1, r.execute_command(
+                    'ft.search', 'idx', 'hel*', 'nocontent')[0])
+                self.assertEqual(1, r.execute_command(
+                    'ft.search', 'idx', '@tags:{hel*}', 'nocontent')[0])
+
+            # new terms and tags under the cached prefixes must show up
+            self.assertOk(r.execute_command('ft.add', 'idx', 'doc2', 1.0, 'fields',
+                                            'foo', 'help', 'tags', 'hello world'))
+            self.assertEqual(2, r.execute_command(
+                'ft.search', 'idx', 'hel*', 'nocontent')[0])
+            self.assertEqual(2, r.execute_command(
+                'ft.search', 'idx', '@tags:{hel*}', 'nocontent')[0])
+
+            # a new document with an existing term needs no invalidation
+            self.assertOk(r.execute_command('ft.add', 'idx', 'doc3', 1.0, 'fields',
+                                            'foo', 'hello'))
+            self.assertEqual(3, r.execute_command(
+                'ft.search', 'idx', 'hel*', 'nocontent')[0])
+
+    def testStemCacheStats(self):
+        with self.redis() as r:
+            r.flushdb()
+            self.assertOk(r.execute_command(
+                'ft.create', 'idx', 'schema', 'foo', 'text'))
+
+            def get_stats():
+                res = r.execute_command('ft.info', 'idx')
+                d = {res[i]: res[i + 1] for i in range(0, len(res), 2)}
+                st = d['stem_cache_stats']
+                return {st[x]: float(st[x + 1]) for x in range(0, len(st), 2)}
+
+            before = get_stats()
+            for i in range(10):
+                self.assertOk(r.execute_command('ft.add', 'idx', 'doc%d' % i, 1.0,
+                                                'fields', 'foo', 'going running jumping'))
+            after = get_stats()
+            self.assertGreater(after['hits'], before['hits'])
+            self.assertGreater(after['hit_rate'], 0)
+            self.assertLessEqual(after['hit_rate'], 1)
+            self.assertGreater(after['entries'], 0)
+
+            # stems of cached words are still found at query time
+            res = r.execute_command('ft.search', 'idx', 'runs', 'nocontent')
+            self.assertEqual(10, res[0])
+
+    def testFuzzyQuery(self):
+        with self.redis() as r:
+            r.flushdb()
+            self.assertOk(r.execute_command(
+                'ft.create', 'idx', 'schema', 'foo', 'text'))
+            for i, term in enumerate(['jello', 'helo', 'hello', 'help', 'world']):
+                self.assertOk(r.execute_command('ft.add', 'idx', 'doc%d' % i, 1.0, 'fields',
+                                                'foo', term))
+            for _ in r.retry_with_rdb_reload():
+                res = r.execute_command(
+                    'ft.search', 'idx', '%hello%', 'nocontent')
+                self.assertEqual(3, res[0])
+                # the exact match scores higher than the typos
+                self.assertEqual('doc2', res[1])
+                res = r.execute_command(
+                    'ft.search', 'idx', '%%hello%%', 'nocontent')
+                self.assertEqual(4, res[0])
+                res = r.execute_command(
+                    'ft.search', 'idx', '%hello% -jello', 'nocontent')
+                self.assertEqual(2, res[0])
+                res = r.execute_command(
+                    'ft.search', 'idx', '%wrold%', 'nocontent')
+                self.assertEqual([0], res)
+                res = r.execute_command(
+                    'ft.explain', 'idx', '%%hello%%')
+                self.assertEqual('FUZZY{%%hello%%}\n', res)
+
     def testSortBy(self):
         with self.redis() as r:
             r.flushdb()
@@ -1226,6 +1306,31 @@ class SearchTestCase(ModuleTestCase('../redisearch.so')):
             # we don't compare the scores beause they may change
             self.assertEqual(12, len(res))
 
+    def testSuggestCompaction(self):
+        with self.redis() as r:
+            r.flushdb()
+            # enough suggestions for the dictionary to be compacted in the background
+            for i in range(1500):
+                r.execute_command('ft.SUGADD', 'ac', 'word%d' % i, i + 1,
+                                  'PAYLOAD', 'pl%d' % i)
+            self.assertEqual(['word1499', 'pl1499', 'word1498', 'pl1498'],
+                             r.execute_command('ft.SUGGET', 'ac', 'word', 'MAX', 2, 'WITHPAYLOADS'))
+
+            # updates, deletes and additions after compaction
+            self.assertEqual(1500, r.execute_command('ft.SUGADD', 'ac', 'word3', 10000))
+            self.assertEqual(1, r.execute_command('ft.SUGDEL', 'ac', 'word1499'))
+            self.assertEqual(0, r.execute_command('ft.SUGDEL', 'ac', 'word1499'))
+            # a prefix of suggestions is not a suggestion
+            self.assertEqual(0, r.execute_command('ft.SUGDEL', 'ac', 'word'))
+            self.assertEqual(1499, r.execute_command('ft.SUGADD', 'ac', 'word14', 5000))
+
+            for _ in r.retry_with_rdb_reload():
+                self.assertEqual(['word3', 'word14', 'word1498'],
+                                 r.execute_command('ft.SUGGET', 'ac', 'word', 'MAX', 3))
+                self.assertEqual(['word14', None],
+                                 r.execute_command('ft.SUGGET', 'ac', 'word14', 'MAX', 1, 'WITHPAYLOADS'))
+                self.assertEqual(1499, r.execute_command('ft.SUGLEN', 'ac'))
+
     def testPayload(self):
 
         with self.redis() as r:
@@ -1340,6 +1445,20 @@ class SearchTestCase(ModuleTestCase('../redisearch.so')):
         with self.assertResponseError():
             res = self.cmd('ft.search', 'idx', 'val*', 'return', 2, 'nonexist')
 
+    def testReturnSortableNumeric(self):
+        self.assertCmdOk('ft.create', 'idx', 'schema', 't', 'text', 'n', 'numeric', 'sortable')
+        self.assertCmdOk('ft.add', 'idx', 'doc1', 1.0, 'fields', 't', 'hello', 'n', '10.50')
+        self.assertCmdOk('ft.add', 'idx', 'doc2', 1.0, 'fields', 't', 'hello', 'n', '1234567890123')
+        self.assertCmdOk('ft.add', 'idx', 'doc3', 1.0, 'fields', 't', 'hello')
+
+        # sortable numbers are returned as they were stored, and missing ones are not set
+        res = self.cmd('ft.search', 'idx', 'hello', 'return', 1, 'n', 'sortby', 'n')
+        self.assertEqual(3, res[0])
+        fields = dict(zip(res[1::2], res[2::2]))
+        self.assertEqual(['n', '10.50'], fields['doc1'])
+        self.assertEqual(['n', '1234567890123'], fields['doc2'])
+        self.assertEqual(['n', None], fields['doc3'])
+
     def _test_create_options_real(self, *options):
         options = [x for x in options if x]
         has_offsets = 'NOOFFSETS' not in options
@@ -0,0 +1,40 @@
+from rmtest import ModuleTestCase
+import redis
+import unittest
+
+
+class ChampionsTestCase(ModuleTestCase('../redisearch.so',
+                                       module_args=['CHAMPION_THRESHOLD', '50',
+                                                    'CHAMPION_SIZE', '20'])):
+
+    def testChampions(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'f1', 'TEXT')
+        for x in range(200):
+            score = 1.0 if x % 20 else 0.5
+            text = 'hello world' if x % 2 else 'hello'
+            self.cmd('FT.ADD', 'idx', 'doc{}'.format(x), score, 'FIELDS', 'f1', text)
+
+        # the top results are found in the champion tier
+        res = self.cmd('FT.SEARCH', 'idx', 'hello', 'NOCONTENT', 'WITHSCORES', 'LIMIT', 0, 5)
+        self.assertEqual(200, res[0])
+        self.assertEqual(11, len(res))
+        scores = [float(s) for s in res[2::2]]
+        self.assertEqual(max(scores), min(scores))
+
+        res = self.cmd('FT.SEARCH', 'idx', 'hello|world', 'NOCONTENT', 'LIMIT', 0, 5)
+        self.assertEqual(6, len(res))
+
+        # the weakest documents are still found when asking for all the results
+        res = self.cmd('FT.SEARCH', 'idx', 'hello', 'NOCONTENT', 'LIMIT', 0, 200)
+        self.assertEqual(200, res[0])
+        self.assertEqual(201, len(res))
+        self.assertIn('doc0', res[1:])
+
+        # a document added with a higher score becomes a champion
+        self.cmd('FT.ADD', 'idx', 'doc0', 10.0, 'REPLACE', 'PARTIAL', 'FIELDS', 'f1', 'hello')
+        res = self.cmd('FT.SEARCH', 'idx', 'hello', 'NOCONTENT', 'LIMIT', 0, 1)
+        self.assertEqual('doc0', res[1])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -48,6 +48,19 @@ class CursorTestCase(ModuleTestCase('../redisearch.so')):
         # pprint.pprint(resp)
         self.assertEqual(11, len(resp))
     
+    def testPrefetch(self):
+        self.loadDocs()
+        query = ['FT.AGGREGATE', 'idx', '*', 'LOAD', 1, '@f1', 'WITHCURSOR', 'COUNT', 10, 'PREFETCH', 2]
+        resp = self.exhaustCursor('idx', self.cmd(*query))
+        self.assertEqual(11, len(resp))
+        self.assertEqual(100, sum(len(r[0]) - 1 for r in resp))
+
+        # Deleting a cursor while it may be prefetching
+        resp, cid = self.cmd(*query)
+        self.assertEqual('OK', self.cmd('FT.CURSOR', 'DEL', 'idx', cid))
+        sleep(0.1)
+        self.assertEqual(0, self.getCursorStats()['global_total'])
+
     def testMultipleIndexes(self):
         self.loadDocs(idx='idx2', text='goodbye')
         self.loadDocs(idx='idx1', text='hello')
@@ -0,0 +1,57 @@
+from rmtest import ModuleTestCase
+import redis
+import unittest
+
+
+class QueryPlannerTestCase(ModuleTestCase('../redisearch.so')):
+
+    def loadDocs(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'f1', 'TEXT', 'n', 'NUMERIC', 'SORTABLE')
+        for x in range(100):
+            text = 'hello world' if x % 10 else 'hello rare'
+            self.cmd('FT.ADD', 'idx', 'doc{}'.format(x), 1.0, 'FIELDS', 'f1', text, 'n', x)
+
+    def testExplainCosts(self):
+        self.loadDocs()
+        res = self.cmd('FT.EXPLAIN', 'idx', 'hello rare', 'VERBATIM', 'WITHCOSTS').split('\n')
+        self.assertEqual('COST 110', res[0])
+        self.assertEqual('[est:10] INTERSECT {', res[1])
+        self.assertEqual('  [est:100] hello', res[2])
+        self.assertEqual('  [est:10] rare', res[3])
+
+        # without WITHCOSTS the plain parse tree is returned
+        res = self.cmd('FT.EXPLAIN', 'idx', 'hello rare', 'VERBATIM')
+        self.assertNotIn('est:', res)
+
+    def testNumericPostFilter(self):
+        self.loadDocs()
+        q = 'rare @n:[0 50]'
+        # sorted queries check the numeric filter against the sortable values
+        res = self.cmd('FT.EXPLAIN', 'idx', q, 'VERBATIM', 'SORTBY', 'n', 'WITHCOSTS')
+        self.assertIn('post-filter', res)
+        self.assertTrue(res.startswith('COST 10\n'))
+        res = self.cmd('FT.SEARCH', 'idx', q, 'VERBATIM', 'SORTBY', 'n', 'NOCONTENT')
+        self.assertEqual([6L, 'doc0', 'doc10', 'doc20', 'doc30', 'doc40', 'doc50'], res)
+
+        # scored queries intersect with the numeric index
+        res = self.cmd('FT.EXPLAIN', 'idx', q, 'VERBATIM', 'WITHCOSTS')
+        self.assertNotIn('post-filter', res)
+        res = self.cmd('FT.SEARCH', 'idx', q, 'VERBATIM', 'NOCONTENT')
+        self.assertEqual(6, res[0])
+
+    def testFlatten(self):
+        self.loadDocs()
+        q = '(hello (world (@n:[10 20])))|(rare|(@n:[90 91]))'
+        res = self.cmd('FT.EXPLAIN', 'idx', q, 'VERBATIM', 'SORTBY', 'n', 'WITHCOSTS')
+        self.assertEqual(1, res.count('UNION'))
+        self.assertEqual(1, res.count('INTERSECT'))
+
+        res = self.cmd('FT.SEARCH', 'idx', q, 'VERBATIM', 'SORTBY', 'n', 'NOCONTENT',
+                       'LIMIT', 0, 100)
+        unsorted = self.cmd('FT.SEARCH', 'idx', q, 'VERBATIM', 'NOCONTENT', 'LIMIT', 0, 100)
+        self.assertEqual(res[0], unsorted[0])
+        self.assertEqual(sorted(res[1:]), sorted(unsorted[1:]))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,63 @@
+from rmtest import ModuleTestCase
+import redis
+import unittest
+
+
+def to_dict(res):
+    d = {res[i]: res[i + 1] for i in range(0, len(res), 2)}
+    return d
+
+
+class QueryCacheTestCase(ModuleTestCase('../redisearch.so',
+                                        module_args=['QUERYCACHE_MAXMEM', '1000000'])):
+
+    def getCacheStats(self):
+        st = to_dict(self.cmd('FT.INFO', 'idx'))['query_cache_stats']
+        return {st[x]: float(st[x + 1]) for x in range(0, len(st), 2)}
+
+    def testQueryCache(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'f1', 'TEXT', 'n', 'NUMERIC', 'SORTABLE')
+        for x in range(100):
+            self.cmd('FT.ADD', 'idx', 'doc{}'.format(x), 1.0, 'FIELDS',
+                     'f1', 'hello world' if x % 2 else 'hello', 'n', x)
+
+        query = ['FT.SEARCH', 'idx', 'hello world', 'WITHSCORES', 'LIMIT', 0, 5]
+        res = self.cmd(*query)
+        self.assertEqual(50, res[0])
+        self.assertEqual(res, self.cmd(*query))
+        st = self.getCacheStats()
+        self.assertEqual(1, st['hits'])
+        self.assertEqual(1, st['misses'])
+        self.assertEqual(1, st['entries'])
+
+        # a smaller page of the same query is served from the cache
+        res2 = self.cmd('FT.SEARCH', 'idx', 'hello world', 'WITHSCORES', 'LIMIT', 2, 3)
+        self.assertEqual(res[0], res2[0])
+        self.assertEqual(res[7:], res2[1:])
+        self.assertEqual(2, self.getCacheStats()['hits'])
+
+        # a larger page, other options and other filters are not
+        self.cmd('FT.SEARCH', 'idx', 'hello world', 'LIMIT', 0, 10)
+        self.cmd('FT.SEARCH', 'idx', 'hello world', 'SORTBY', 'n')
+        self.cmd('FT.SEARCH', 'idx', 'hello world', 'FILTER', 'n', 0, 10)
+        self.assertEqual(2, self.getCacheStats()['hits'])
+
+        # writing to the index invalidates the cached results
+        self.cmd('FT.ADD', 'idx', 'doc100', 1.0, 'FIELDS', 'f1', 'hello world', 'n', 100)
+        self.assertEqual(51, self.cmd(*query)[0])
+        self.cmd('FT.DEL', 'idx', 'doc100')
+        self.assertEqual(50, self.cmd(*query)[0])
+        st = self.getCacheStats()
+        self.assertEqual(2, st['hits'])
+        self.assertEqual(7, st['misses'])
+
+        # highlighting needs the index results, so it is never cached
+        self.cmd('FT.SEARCH', 'idx', 'hello', 'HIGHLIGHT')
+        self.cmd('FT.SEARCH', 'idx', 'hello', 'HIGHLIGHT')
+        st = self.getCacheStats()
+        self.assertEqual(2, st['hits'])
+        self.assertEqual(7, st['misses'])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,67 @@
+from rmtest import ModuleTestCase
+import redis
+import unittest
+from redis import ResponseError
+
+
+def to_dict(res):
+    d = {res[i]: res[i + 1] for i in range(0, len(res), 2)}
+    return d
+
+
+class QueryCostTestCase(ModuleTestCase('../redisearch.so', module_args=['MAXQUERYCOST', '50'])):
+
+    def loadDocs(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'f1', 'TEXT', 'n', 'NUMERIC')
+        for x in range(100):
+            text = 'hello world' if x % 10 else 'hello rare'
+            self.cmd('FT.ADD', 'idx', 'doc{}'.format(x), 1.0, 'FIELDS', 'f1', text, 'n', x)
+
+    def getQueryStats(self):
+        st = to_dict(self.cmd('FT.INFO', 'idx'))['query_stats']
+        return {st[x]: float(st[x + 1]) for x in range(0, len(st), 2)}
+
+    def testMaxQueryCost(self):
+        self.loadDocs()
+        # 10 postings - within the budget
+        res = self.cmd('FT.SEARCH', 'idx', 'rare', 'NOCONTENT')
+        self.assertEqual(10, res[0])
+
+        # 100 + 90 postings - over the budget
+        with self.assertResponseError():
+            self.cmd('FT.SEARCH', 'idx', 'hello world')
+        with self.assertResponseError():
+            self.cmd('FT.SEARCH', 'idx', '@n:[0 100]')
+        with self.assertResponseError():
+            self.cmd('FT.AGGREGATE', 'idx', 'hello')
+
+        st = self.getQueryStats()
+        self.assertEqual(1, st['queries'])
+        self.assertEqual(3, st['rejected'])
+        self.assertEqual(0, st['degraded'])
+        self.assertEqual(10, st['docs_scanned'])
+        self.assertGreater(st['cpu_time_ms'], 0)
+
+
+class QueryCostReturnTestCase(ModuleTestCase('../redisearch.so',
+                                             module_args=['MAXQUERYCOST', '50',
+                                                          'ON_MAXQUERYCOST', 'RETURN'])):
+
+    def testDegradedQuery(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'f1', 'TEXT')
+        for x in range(100):
+            self.cmd('FT.ADD', 'idx', 'doc{}'.format(x), 1.0, 'FIELDS', 'f1', 'hello world')
+
+        # the query runs with a scan budget, and returns what it found within it
+        res = self.cmd('FT.SEARCH', 'idx', 'hello', 'NOCONTENT', 'LIMIT', 0, 100)
+        self.assertEqual(50, res[0])
+        self.assertEqual(51, len(res))
+
+        st = to_dict(to_dict(self.cmd('FT.INFO', 'idx'))['query_stats'])
+        self.assertEqual(1, float(st['queries']))
+        self.assertEqual(1, float(st['degraded']))
+        self.assertEqual(50, float(st['docs_scanned']))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,44 @@
+from rmtest import ModuleTestCase
+import redis
+import unittest
+
+
+class ShinglesTestCase(ModuleTestCase('../redisearch.so')):
+
+    def testExactPhrases(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'title', 'TEXT', 'SHINGLES', 'body', 'TEXT')
+        self.cmd('FT.ADD', 'idx', 'doc1', 1.0, 'FIELDS', 'title', 'the king of england')
+        self.cmd('FT.ADD', 'idx', 'doc2', 1.0, 'FIELDS', 'title', 'the king in england')
+        self.cmd('FT.ADD', 'idx', 'doc3', 1.0, 'FIELDS', 'title', 'england has a king')
+        self.cmd('FT.ADD', 'idx', 'doc4', 1.0, 'FIELDS', 'body', 'the king of england')
+
+        info = self.cmd('FT.INFO', 'idx')
+        fields = info[info.index('fields') + 1]
+        self.assertIn('SHINGLES', fields[0])
+        self.assertNotIn('SHINGLES', fields[1])
+
+        # the stopwords of the phrase must match
+        res = self.cmd('FT.SEARCH', 'idx', '@title:"king of england"', 'NOCONTENT')
+        self.assertEqual([1, 'doc1'], res)
+        res = self.cmd('FT.SEARCH', 'idx', '@title:"the king in england"', 'NOCONTENT')
+        self.assertEqual([1, 'doc2'], res)
+        res = self.cmd('FT.SEARCH', 'idx', '@title:"king england"', 'NOCONTENT')
+        self.assertEqual([0], res)
+        res = self.cmd('FT.SEARCH', 'idx', '@title:"a king"', 'NOCONTENT')
+        self.assertEqual([1, 'doc3'], res)
+
+        # a field without shingles ignores the stopwords, as before
+        res = self.cmd('FT.SEARCH', 'idx', '@body:"king in england"', 'NOCONTENT')
+        self.assertEqual([1, 'doc4'], res)
+
+        # highlighting maps the positions of the words, so it doesn't use the shingles
+        res = self.cmd('FT.SEARCH', 'idx', '@title:"england has"', 'HIGHLIGHT', 'FIELDS', 1, 'title')
+        self.assertEqual([1, 'doc3', ['title', '<b>england</b> <b>has</b> a king']], res)
+
+        # shingles are not expanded by prefixes
+        res = self.cmd('FT.SEARCH', 'idx', 'kin*', 'NOCONTENT')
+        self.assertEqual(4, res[0])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -88,6 +88,30 @@ class SummarizeTestCase(ModuleTestCase('../redisearch.so')):
         self.assertEqual([1L, 'redis', ['txt1', 'memory database project implementing a networked, in-memory ... by Salvatore Sanfilippo... ', 'txt2',
                                         'dataset in memory. Versions... as virtual memory[19] in... persistent durability mode where the dataset is asynchronously transferred from memory... ']], res)
 
+    def testSummarizationManyResults(self):
+        self.cmd('FT.CREATE', 'idx', 'SCHEMA', 'title', 'TEXT', 'body', 'TEXT')
+        for i in range(60):
+            self.cmd('FT.ADD', 'idx', 'doc%d' % i, 1.0, 'FIELDS',
+                     'title', 'hello   world number %d' % i,
+                     'body', 'some text before\t\tthe  hello word, then   more text and another world %d' % i)
+
+        # every field of every returned document is summarized with the positions of its own
+        # matches, even though they are only decoded once per document
+        res = self.cmd('FT.SEARCH', 'idx', 'hello world', 'LIMIT', 0, 50,
+                       'SUMMARIZE', 'FIELDS', 2, 'title', 'body', 'LEN', 3, 'SEPARATOR', '|',
+                       'HIGHLIGHT', 'TAGS', '<b>', '</b>')
+        self.assertEqual(60, res[0])
+        self.assertEqual(100, len(res) - 1)
+        for i in range(1, len(res), 2):
+            n = res[i][3:]
+            fields = dict(grouper(res[i + 1], 2))
+            self.assertTrue(fields['title'].startswith('<b>hello</b> <b>world</b> number'))
+            self.assertTrue(fields['title'].endswith('|'))
+            self.assertTrue('<b>hello</b>' in fields['body'])
+            self.assertTrue('<b>world</b> ' + n in fields['body'])
+            self.assertFalse('  ' in fields['body'])
+            self.assertFalse('\t' in fields['body'])
+
     def testSummarizationDisabled(self):
         self.cmd('FT.CREATE', 'idx', 'NOOFFSETS', 'SCHEMA', 'body', 'TEXT')
         self.cmd('FT.ADD', 'idx', 'doc', 1.0, 'FIELDS', 'body', 'hello world')
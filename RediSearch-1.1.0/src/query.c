@@ -11,12 +11,18 @@
 #include "query_parser/parser.h"
 #include "redis_index.h"
 #include "tokenize.h"
+#include "forward_index.h"
 #include "util/logging.h"
 #include "extension.h"
 #include "ext/default.h"
 #include "rmutil/sds.h"
 #include "tag_index.h"
 #include "concurrent_ctx.h"
+#include "prefix_cache.h"
+
+/* A numeric filter with this many times the entries of the most selective of its siblings in an
+ * intersection is checked against the results of the intersection rather than intersected */
+#define QUERY_POSTFILTER_RATIO 4
 
 static void QueryTokenNode_Free(QueryTokenNode *tn) {
 
@@ -31,6 +37,11 @@ static void QueryPhraseNode_Free(QueryPhraseNode *pn) {
     free(pn->children);
     pn->children = NULL;
   }
+  for (int i = 0; i < pn->numStopwords; i++) {
+    free(pn->stopwords[i].str);
+  }
+  free(pn->stopwords);
+  pn->stopwords = NULL;
 }
 
 static void QueryUnionNode_Free(QueryUnionNode *pn) {
@@ -82,6 +93,9 @@ void QueryNode_Free(QueryNode *n) {
     case QN_PREFX:
       QueryTokenNode_Free(&n->pfx);
       break;
+    case QN_FUZZY:
+      QueryTokenNode_Free(&n->fz.tok);
+      break;
     case QN_GEO:
       if (n->gn.gf) {
         GeoFilter_Free(n->gn.gf);
@@ -137,6 +151,17 @@ QueryNode *NewPrefixNode(QueryParseCtx *q, const char *s, size_t len) {
   return ret;
 }
 
+QueryNode *NewFuzzyNode(QueryParseCtx *q, const char *s, size_t len, int maxDist) {
+  QueryNode *ret = NewQueryNode(QN_FUZZY);
+  q->numTokens++;
+
+  ret->fz = (QueryFuzzyNode){
+      .tok = (RSToken){.str = (char *)s, .len = len, .expanded = 0, .flags = 0},
+      .maxDist = maxDist,
+  };
+  return ret;
+}
+
 QueryNode *NewUnionNode() {
   QueryNode *ret = NewQueryNode(QN_UNION);
   // ret->fieldMask = 0;
@@ -148,7 +173,8 @@ QueryNode *NewPhraseNode(int exact) {
   QueryNode *ret = NewQueryNode(QN_PHRASE);
   // ret->fieldMask = 0;
 
-  ret->pn = (QueryPhraseNode){.children = NULL, .numChildren = 0, .exact = exact};
+  ret->pn = (QueryPhraseNode){
+      .children = NULL, .numChildren = 0, .exact = exact, .stopwords = NULL, .numStopwords = 0};
   return ret;
 }
 
@@ -229,6 +255,15 @@ void Query_SetIdFilter(QueryParseCtx *q, IdFilter *f) {
   Query_SetFilterNode(q, NewIdFilterNode(f));
 }
 
+void Query_SetTagFilter(QueryParseCtx *q, const FieldSpec *fs, const char *tag, size_t len) {
+  // look the tag up as it was indexed
+  char *s = TagIndex_PreprocessValue(&fs->tagOpts, tag, len, &len);
+  QueryNode *tn = NewTagNode(strdup(fs->name), strlen(fs->name));
+  QueryNode *child = NewTokenNode(q, s, len);
+  QueryTagNode_AddChildren(tn, &child, 1);
+  Query_SetFilterNode(q, tn);
+}
+
 static void QueryNode_Expand(RSQueryTokenExpander expander, RSQueryExpanderCtx *expCtx,
                              QueryNode **pqn) {
 
@@ -267,6 +302,12 @@ void Query_Expand(QueryParseCtx *q, const char *expander) {
   }
 }
 
+/* Add the number of entries a leaf iterator may read to the estimated cost of the query */
+static inline IndexIterator *queryEval_AddCost(QueryEvalCtx *q, IndexIterator *it) {
+  if (it) q->cost += it->Len(it->ctx);
+  return it;
+}
+
 IndexIterator *Query_EvalTokenNode(QueryEvalCtx *q, QueryNode *qn) {
   if (qn->type != QN_TOKEN) {
     return NULL;
@@ -285,11 +326,87 @@ IndexIterator *Query_EvalTokenNode(QueryEvalCtx *q, QueryNode *qn) {
     return NULL;
   }
 
-  return NewReadIterator(ir);
+  return queryEval_AddCost(q, NewReadIterator(ir));
+}
+
+/* Append an iterator to the growing array of iterators a node expands to */
+static void appendExpansion(IndexIterator ***its, size_t *sz, size_t *cap, IndexIterator *it) {
+  (*its)[(*sz)++] = it;
+  if (*sz == *cap) {
+    *cap *= 2;
+    *its = realloc(*its, *cap * sizeof(**its));
+  }
+}
+
+/* Open a reader for a term a node expands to. Returns NULL if the term is not in the index */
+static IndexIterator *openExpansionReader(QueryEvalCtx *q, QueryNode *qn, char *str, size_t len,
+                                          double weight) {
+  RSToken tok = (RSToken){.str = str, .len = len, .expanded = 0, .flags = 0};
+  RSQueryTerm *term = NewQueryTerm(&tok, q->tokenId++);
+
+  // Open an index reader
+  IndexReader *ir = Redis_OpenReader(q->sctx, term, &q->sctx->spec->docs, 0,
+                                     q->opts->fieldMask & qn->fieldMask, q->conc);
+  if (!ir) {
+    Term_Free(term);
+    return NULL;
+  }
+  term->idf *= weight;
+  return queryEval_AddCost(q, NewReadIterator(ir));
+}
+
+static IndexIterator *unionExpansions(QueryEvalCtx *q, IndexIterator **its, size_t itsSz) {
+  // printf("Expanded %d terms!\n", itsSz);
+  if (itsSz == 0) {
+    free(its);
+    return NULL;
+  }
+  return NewUnionIterator(its, itsSz, q->docTable, 1);
+}
+
+/* Open readers for the terms a trie iterator yields, and union them. If weighByDistance is set, the
+ * idf of each term is divided by its edit distance plus one, so closer terms score higher. If
+ * cache is not NULL, the terms are also added to it */
+static IndexIterator *Query_EvalTrieExpansion(QueryEvalCtx *q, QueryNode *qn, TrieIterator *it,
+                                              int weighByDistance, PrefixCacheEntry *cache) {
+  size_t itsSz = 0, itsCap = 8;
+  IndexIterator **its = calloc(itsCap, sizeof(*its));
+
+  rune *rstr = NULL;
+  t_len slen = 0;
+  float score = 0;
+  int dist = 0;
+
+  // an upper limit on the number of expansions is enforced to avoid stuff like "*"
+
+  while (TrieIterator_Next(it, &rstr, &slen, NULL, &score, &dist) &&
+         itsSz < RSGlobalConfig.maxPrefixExpansions) {
+    size_t len;
+    char *str = runesToStr(rstr, slen, &len);
+    // shingles are not words, they are only matched by exact phrases
+    if (Shingle_IsShingle(str, len)) {
+      free(str);
+      continue;
+    }
+    if (cache) {
+      PrefixCacheEntry_AddTerm(cache, str, len);
+    }
+    double weight = weighByDistance ? 1.0 / (1 + dist) : 1;
+    IndexIterator *ret = openExpansionReader(q, qn, str, len, weight);
+    free(str);
+    if (ret) {
+      appendExpansion(&its, &itsSz, &itsCap, ret);
+    }
+  }
+
+  DFAFilter_Free(it->ctx);
+  free(it->ctx);
+  TrieIterator_Free(it);
+  return unionExpansions(q, its, itsSz);
 }
 
 /* Ealuate a prefix node by expanding all its possible matches and creating one big UNION on all of
- * them */
+ * them. The expansions are cached per index, so repeated prefixes do not walk the terms trie */
 static IndexIterator *Query_EvalPrefixNode(QueryEvalCtx *q, QueryNode *qn) {
   if (qn->type != QN_PREFX) {
     return NULL;
@@ -299,68 +416,215 @@ static IndexIterator *Query_EvalPrefixNode(QueryEvalCtx *q, QueryNode *qn) {
   if (qn->pfx.len < RSGlobalConfig.minTermPrefix) {
     return NULL;
   }
-  Trie *terms = q->sctx->spec->terms;
+  IndexSpec *sp = q->sctx->spec;
+  Trie *terms = sp->terms;
 
   if (!terms) return NULL;
 
+  if (!sp->prefixCache) {
+    sp->prefixCache = NewPrefixCache(PREFIX_CACHE_SIZE);
+  }
+  PrefixCacheEntry *e = PrefixCache_Get(sp->prefixCache, qn->pfx.str, qn->pfx.len, terms->revision);
+  if (e) {
+    size_t itsSz = 0, itsCap = 8;
+    IndexIterator **its = calloc(itsCap, sizeof(*its));
+    for (size_t i = 0; i < e->numTerms && itsSz < RSGlobalConfig.maxPrefixExpansions; i++) {
+      IndexIterator *ret = openExpansionReader(q, qn, e->terms[i].str, e->terms[i].len, 1);
+      if (ret) {
+        appendExpansion(&its, &itsSz, &itsCap, ret);
+      }
+    }
+    return unionExpansions(q, its, itsSz);
+  }
+
   TrieIterator *it = Trie_IteratePrefix(terms, qn->pfx.str, qn->pfx.len, 0);
   if (!it) return NULL;
 
-  size_t itsSz = 0, itsCap = 8;
-  IndexIterator **its = calloc(itsCap, sizeof(*its));
+  e = PrefixCache_Put(sp->prefixCache, qn->pfx.str, qn->pfx.len, terms->revision);
+  return Query_EvalTrieExpansion(q, qn, it, 0, e);
+}
 
-  rune *rstr = NULL;
-  t_len slen = 0;
-  float score = 0;
-  int dist = 0;
+/* Evaluate a fuzzy node by expanding it to all the index terms within its edit distance, and
+ * creating a UNION on them */
+static IndexIterator *Query_EvalFuzzyNode(QueryEvalCtx *q, QueryNode *qn) {
+  if (qn->type != QN_FUZZY) {
+    return NULL;
+  }
+  Trie *terms = q->sctx->spec->terms;
 
-  // an upper limit on the number of expansions is enforced to avoid stuff like "*"
+  if (!terms) return NULL;
 
-  while (TrieIterator_Next(it, &rstr, &slen, NULL, &score, &dist) &&
-         itsSz < RSGlobalConfig.maxPrefixExpansions) {
+  TrieIterator *it = Trie_Iterate(terms, qn->fz.tok.str, qn->fz.tok.len, qn->fz.maxDist, 0);
+  if (!it) return NULL;
 
-    // Create a token for the reader
-    RSToken tok = (RSToken){
-        .expanded = 0,
-        .flags = 0,
-        .len = 0,
-    };
-    tok.str = runesToStr(rstr, slen, &tok.len);
-    RSQueryTerm *term = NewQueryTerm(&tok, q->tokenId++);
+  return Query_EvalTrieExpansion(q, qn, it, 1, NULL);
+}
 
-    // Open an index reader
-    IndexReader *ir = Redis_OpenReader(q->sctx, term, &q->sctx->spec->docs, 0,
-                                       q->opts->fieldMask & qn->fieldMask, q->conc);
+/* Are the results of the query only filtered, and not scored? Sorted searches and aggregations do
+ * not run a scoring function, so the planner is free to change the shape of their index results */
+static int queryEval_IsUnscored(QueryEvalCtx *q) {
+  return q->opts && (q->opts->sortBy || (q->opts->flags & Search_AggregationQuery));
+}
 
-    free(tok.str);
-    if (!ir) {
-      Term_Free(term);
+/* Splice the children of nested nodes of the same kind into their parent - an intersection of
+ * intersections is a single intersection, and a union of unions is a single union. Scoring functions
+ * look at the nesting of the index results, so this is only done for unscored queries */
+static void queryEval_Flatten(QueryEvalCtx *q, QueryNode *qn) {
+  if (!queryEval_IsUnscored(q)) return;
+
+  QueryNode ***children = &qn->un.children;
+  int *num = &qn->un.numChildren;
+  if (qn->type == QN_PHRASE) {
+    // slop and order constraints apply to the terms of a single intersection
+    if (qn->pn.exact || q->opts->slop >= 0 || (q->opts->flags & Search_InOrder)) return;
+    children = &qn->pn.children;
+    num = &qn->pn.numChildren;
+  }
+
+  for (int i = 0; i < *num; i++) {
+    QueryNode *child = (*children)[i];
+    if (child->type != qn->type || (child->type == QN_PHRASE && child->pn.exact)) continue;
+
+    QueryNode **gc = child->type == QN_PHRASE ? child->pn.children : child->un.children;
+    int ngc = child->type == QN_PHRASE ? child->pn.numChildren : child->un.numChildren;
+    if (ngc == 0) continue;
+
+    *children = realloc(*children, (*num + ngc - 1) * sizeof(QueryNode *));
+    memmove(&(*children)[i + ngc], &(*children)[i + 1], (*num - i - 1) * sizeof(QueryNode *));
+    for (int j = 0; j < ngc; j++) {
+      gc[j]->fieldMask &= child->fieldMask;
+      (*children)[i + j] = gc[j];
+    }
+    *num += ngc - 1;
+
+    // free the nested node, but not its children which now belong to us
+    if (child->type == QN_PHRASE) {
+      child->pn.numChildren = 0;
+    } else {
+      child->un.numChildren = 0;
+    }
+    QueryNode_Free(child);
+    // the spliced children may be nested nodes themselves
+    i--;
+  }
+}
+
+/* Return the sortable index of the field of a numeric node that may be checked as a post filter,
+ * or -1 if it must be evaluated with the numeric index */
+static int queryEval_PostFilterIndex(QueryEvalCtx *q, QueryNode *qn) {
+  // numeric results add to the scores of scored queries, so only unscored ones may skip them
+  if (qn->type != QN_NUMERIC || !q->docTable || !q->sctx->spec->sortables ||
+      !queryEval_IsUnscored(q)) {
+    return -1;
+  }
+  FieldSpec *fs = IndexSpec_GetField(q->sctx->spec, qn->nn.nf->fieldName,
+                                     strlen(qn->nn.nf->fieldName));
+  if (!fs || fs->type != FIELD_NUMERIC || !FieldSpec_IsSortable(fs)) {
+    return -1;
+  }
+  return RSSortingTable_GetFieldIdx(q->sctx->spec->sortables, qn->nn.nf->fieldName);
+}
+
+/* Can an exact phrase be matched by the shingles of its fields? All its children must be plain
+ * terms short enough to be paired, and all the text fields it searches must be shingled. Shingle
+ * positions count stopwords and byte offsets don't, so queries that highlight or summarize their
+ * matches read the words instead */
+static int queryEval_UseShingles(QueryEvalCtx *q, QueryNode *qn) {
+  QueryPhraseNode *pn = &qn->pn;
+  if (!pn->exact || !q->sctx || !q->sctx->spec || pn->numChildren + pn->numStopwords < 2 ||
+      q->opts->fields.wantSummaries) {
+    return 0;
+  }
+  for (int i = 0; i < pn->numChildren; i++) {
+    if (pn->children[i]->type != QN_TOKEN || pn->children[i]->tn.len > SHINGLE_MAX_WORDLEN) {
+      return 0;
+    }
+  }
+  for (int i = 0; i < pn->numStopwords; i++) {
+    if (pn->stopwords[i].len > SHINGLE_MAX_WORDLEN) return 0;
+  }
+
+  IndexSpec *sp = q->sctx->spec;
+  t_fieldMask mask = q->opts->fieldMask & qn->fieldMask;
+  int numFields = 0;
+  for (int i = 0; i < sp->numFields; i++) {
+    FieldSpec *fs = &sp->fields[i];
+    if (fs->type != FIELD_FULLTEXT || !FieldSpec_IsIndexable(fs) || !(mask & FIELD_BIT(fs))) {
       continue;
     }
+    if (!FieldSpec_IsShingled(fs)) return 0;
+    numFields++;
+  }
+  return numFields > 0;
+}
 
-    // Add the reader to the iterator array
-    its[itsSz++] = NewReadIterator(ir);
-    if (itsSz == itsCap) {
-      itsCap *= 2;
-      its = realloc(its, itsCap * sizeof(*its));
+/* Evaluate an exact phrase as the intersection of its shingles - the pairs of its adjacent words,
+ * stopwords included - which must follow each other. A shingle is usually much rarer than both of
+ * its words, so this reads a lot less than intersecting the words themselves */
+static IndexIterator *Query_EvalShingles(QueryEvalCtx *q, QueryNode *qn) {
+  QueryPhraseNode *pn = &qn->pn;
+  int numWords = pn->numChildren + pn->numStopwords;
+  const char *words[numWords];
+  size_t lens[numWords];
+
+  // merge the terms and the stopwords back in the order of the phrase
+  int n = 0, sw = 0;
+  for (int i = 0; i <= pn->numChildren; i++) {
+    for (; sw < pn->numStopwords && pn->stopwords[sw].pos == i; sw++) {
+      words[n] = pn->stopwords[sw].str;
+      lens[n++] = pn->stopwords[sw].len;
+    }
+    if (i < pn->numChildren) {
+      words[n] = pn->children[i]->tn.str;
+      lens[n++] = pn->children[i]->tn.len;
     }
   }
 
-  DFAFilter_Free(it->ctx);
-  free(it->ctx);
-  TrieIterator_Free(it);
-  // printf("Expanded %d terms!\n", itsSz);
-  if (itsSz == 0) {
-    free(its);
-    return NULL;
+  t_fieldMask mask = q->opts->fieldMask & qn->fieldMask;
+  int numShingles = numWords - 1;
+  IndexIterator **iters = calloc(numShingles, sizeof(*iters));
+  size_t estimates[numShingles];
+  qn->estimate = SIZE_MAX;
+  for (int i = 0; i < numShingles; i++) {
+    char buf[SHINGLE_MAX_LEN];
+    size_t len = Shingle_Format(buf, words[i], lens[i], words[i + 1], lens[i + 1]);
+    RSToken tok = {.str = buf, .len = len, .expanded = 0, .flags = 0};
+    RSQueryTerm *term = NewQueryTerm(&tok, q->tokenId++);
+    IndexReader *ir = Redis_OpenReader(q->sctx, term, q->docTable, 0, mask, q->conc);
+    // a shingle no document has means no document has the phrase
+    if (!ir) {
+      Term_Free(term);
+      for (int j = 0; j < i; j++) {
+        iters[j]->Free(iters[j]);
+      }
+      free(iters);
+      return NULL;
+    }
+    estimates[i] = IR_NumDocs(ir);
+    qn->estimate = MIN(qn->estimate, estimates[i]);
+    iters[i] = queryEval_AddCost(q, NewReadIterator(ir));
   }
-  return NewUnionIterator(its, itsSz, q->docTable, 1);
+
+  qn->flags |= QueryNode_Shingled;
+  if (numShingles == 1) {
+    IndexIterator *ret = iters[0];
+    free(iters);
+    return ret;
+  }
+  // consecutive shingles are at consecutive positions, which is the final check of the phrase
+  IndexIterator *ret = NewIntersecIterator(iters, numShingles, q->docTable, mask, 0, 1);
+  IntersectIterator_SetDriveOrder(ret, estimates);
+  return ret;
 }
 
 static IndexIterator *Query_EvalPhraseNode(QueryEvalCtx *q, QueryNode *qn) {
   if (qn->type != QN_PHRASE) {
     return NULL;
   }
+  if (queryEval_UseShingles(q, qn)) {
+    return Query_EvalShingles(q, qn);
+  }
+  queryEval_Flatten(q, qn);
   QueryPhraseNode *node = &qn->pn;
   // an intersect stage with one child is the same as the child, so we just
   // return it
@@ -369,21 +633,56 @@ static IndexIterator *Query_EvalPhraseNode(QueryEvalCtx *q, QueryNode *qn) {
     return Query_EvalNode(q, node->children[0]);
   }
 
-  // recursively eval the children
+  // recursively eval the children. Numeric filters that may be post filters are evaluated last,
+  // once we know if any of their siblings is much more selective than them
   IndexIterator **iters = calloc(node->numChildren, sizeof(IndexIterator *));
+  int sortIdx[node->numChildren];
+  size_t minEstimate = SIZE_MAX;
   for (int i = 0; i < node->numChildren; i++) {
-    node->children[i]->fieldMask &= qn->fieldMask;
-    iters[i] = Query_EvalNode(q, node->children[i]);
+    QueryNode *child = node->children[i];
+    child->fieldMask &= qn->fieldMask;
+    sortIdx[i] = queryEval_PostFilterIndex(q, child);
+    if (sortIdx[i] < 0) {
+      iters[i] = Query_EvalNode(q, child);
+      minEstimate = MIN(minEstimate, child->estimate);
+    }
   }
-  IndexIterator *ret;
 
-  if (node->exact) {
-    ret = NewIntersecIterator(iters, node->numChildren, q->docTable,
-                              q->opts->fieldMask & qn->fieldMask, 0, 1);
+  int n = 0;
+  size_t estimates[node->numChildren];
+  for (int i = 0; i < node->numChildren; i++) {
+    QueryNode *child = node->children[i];
+    if (sortIdx[i] >= 0) {
+      child->estimate = NumericFilter_EstimateEntries(q->sctx, child->nn.nf);
+      if (minEstimate != SIZE_MAX && child->estimate > QUERY_POSTFILTER_RATIO * minEstimate) {
+        child->flags |= QueryNode_PostFilter;
+        continue;
+      }
+      iters[i] = Query_EvalNode(q, child);
+    }
+    estimates[n] = child->estimate;
+    iters[n++] = iters[i];
+  }
+
+  IndexIterator *ret;
+  if (n == 1) {
+    ret = iters[0];
+    free(iters);
+  } else if (node->exact) {
+    ret = NewIntersecIterator(iters, n, q->docTable, q->opts->fieldMask & qn->fieldMask, 0, 1);
   } else {
-    ret = NewIntersecIterator(iters, node->numChildren, q->docTable,
-                              q->opts->fieldMask & qn->fieldMask, q->opts->slop,
-                              q->opts->flags & Search_InOrder);
+    ret = NewIntersecIterator(iters, n, q->docTable, q->opts->fieldMask & qn->fieldMask,
+                              q->opts->slop, q->opts->flags & Search_InOrder);
+  }
+  if (n > 1) {
+    IntersectIterator_SetDriveOrder(ret, estimates);
+  }
+
+  for (int i = 0; i < node->numChildren && ret; i++) {
+    QueryNode *child = node->children[i];
+    if (child->flags & QueryNode_PostFilter) {
+      ret = NewNumericPostFilterIterator(ret, child->nn.nf, q->docTable, sortIdx[i]);
+    }
   }
   return ret;
 }
@@ -393,7 +692,7 @@ static IndexIterator *Query_EvalWildcardNode(QueryEvalCtx *q, QueryNode *qn) {
     return NULL;
   }
 
-  return NewWildcardIterator(q->docTable->maxDocId);
+  return queryEval_AddCost(q, NewWildcardIterator(q->docTable->maxDocId));
 }
 
 static IndexIterator *Query_EvalNotNode(QueryEvalCtx *q, QueryNode *qn) {
@@ -423,7 +722,10 @@ static IndexIterator *Query_EvalNumericNode(QueryEvalCtx *q, QueryNumericNode *n
     return NULL;
   }
 
-  return NewNumericFilterIterator(q->sctx, node->nf, q->conc);
+  size_t numEntries = 0;
+  IndexIterator *it = NewNumericFilterIterator(q->sctx, node->nf, q->conc, &numEntries);
+  q->cost += numEntries;
+  return it;
 }
 
 static IndexIterator *Query_EvalGeofilterNode(QueryEvalCtx *q, QueryGeofilterNode *node) {
@@ -434,18 +736,19 @@ static IndexIterator *Query_EvalGeofilterNode(QueryEvalCtx *q, QueryGeofilterNod
   }
 
   GeoIndex gi = {.ctx = q->sctx, .sp = fs};
-  return NewGeoRangeIterator(&gi, node->gf);
+  return queryEval_AddCost(q, NewGeoRangeIterator(&gi, node->gf));
 }
 
 static IndexIterator *Query_EvalIdFilterNode(QueryEvalCtx *q, QueryIdFilterNode *node) {
 
-  return NewIdFilterIterator(node->f);
+  return queryEval_AddCost(q, NewIdFilterIterator(node->f));
 }
 
 static IndexIterator *Query_EvalUnionNode(QueryEvalCtx *q, QueryNode *qn) {
   if (qn->type != QN_UNION) {
     return NULL;
   }
+  queryEval_Flatten(q, qn);
   QueryUnionNode *node = &qn->un;
 
   // a union stage with one child is the same as the child, so we just return it
@@ -492,37 +795,48 @@ static IndexIterator *Query_EvalTagPrefixNode(QueryEvalCtx *q, TagIndex *idx, Qu
   }
   if (!idx || !idx->values) return NULL;
 
-  TrieMapIterator *it = TrieMap_Iterate(idx->values, qn->pfx.str, qn->pfx.len);
-  if (!it) return NULL;
-
   size_t itsSz = 0, itsCap = 8;
   IndexIterator **its = calloc(itsCap, sizeof(*its));
 
+  if (!idx->prefixCache) {
+    idx->prefixCache = NewPrefixCache(PREFIX_CACHE_SIZE);
+  }
+  PrefixCacheEntry *e = PrefixCache_Get(idx->prefixCache, qn->pfx.str, qn->pfx.len, idx->revision);
+  if (e) {
+    for (size_t i = 0; i < e->numTerms && itsSz < RSGlobalConfig.maxPrefixExpansions; i++) {
+      IndexIterator *ret = queryEval_AddCost(
+          q, TagIndex_OpenReader(idx, q->docTable, e->terms[i].str, e->terms[i].len, q->conc, k, kn));
+      if (ret) {
+        appendExpansion(&its, &itsSz, &itsCap, ret);
+      }
+    }
+    return unionExpansions(q, its, itsSz);
+  }
+
+  TrieMapIterator *it = TrieMap_Iterate(idx->values, qn->pfx.str, qn->pfx.len);
+  if (!it) {
+    free(its);
+    return NULL;
+  }
+  e = PrefixCache_Put(idx->prefixCache, qn->pfx.str, qn->pfx.len, idx->revision);
+
   // an upper limit on the number of expansions is enforced to avoid stuff like "*"
   char *s;
   tm_len_t sl;
   void *ptr;
   // Find all completions of the prefix
   while (TrieMapIterator_Next(it, &s, &sl, &ptr) && itsSz < RSGlobalConfig.maxPrefixExpansions) {
-    IndexIterator *ret = TagIndex_OpenReader(idx, q->docTable, s, sl, q->conc, k, kn);
+    PrefixCacheEntry_AddTerm(e, s, sl);
+    IndexIterator *ret =
+        queryEval_AddCost(q, TagIndex_OpenReader(idx, q->docTable, s, sl, q->conc, k, kn));
     if (!ret) continue;
 
     // Add the reader to the iterator array
-    its[itsSz++] = ret;
-    if (itsSz == itsCap) {
-      itsCap *= 2;
-      its = realloc(its, itsCap * sizeof(*its));
-    }
+    appendExpansion(&its, &itsSz, &itsCap, ret);
   }
 
   TrieMapIterator_Free(it);
-
-  // printf("Expanded %d terms!\n", itsSz);
-  if (itsSz == 0) {
-    free(its);
-    return NULL;
-  }
-  return NewUnionIterator(its, itsSz, q->docTable, 1);
+  return unionExpansions(q, its, itsSz);
 }
 
 static IndexIterator *query_EvalSingleTagNode(QueryEvalCtx *q, TagIndex *idx, QueryNode *n,
@@ -533,7 +847,8 @@ static IndexIterator *query_EvalSingleTagNode(QueryEvalCtx *q, TagIndex *idx, Qu
       /*TagIndex *idx, DocTable *dt, const char *value, size_t len,
                                          ConcurrentSearchCtx *csx, RedisModuleKey *k,
                                          RedisModuleString *keyName);*/
-      return TagIndex_OpenReader(idx, q->docTable, n->tn.str, n->tn.len, q->conc, k, kn);
+      return queryEval_AddCost(
+          q, TagIndex_OpenReader(idx, q->docTable, n->tn.str, n->tn.len, q->conc, k, kn));
     case QN_PREFX:
       return Query_EvalTagPrefixNode(q, idx, n, k, kn);
 
@@ -549,7 +864,8 @@ static IndexIterator *query_EvalSingleTagNode(QueryEvalCtx *q, TagIndex *idx, Qu
 
       sds s = sdsjoin(terms, n->pn.numChildren, " ");
 
-      IndexIterator *ret = TagIndex_OpenReader(idx, q->docTable, s, sdslen(s), q->conc, k, kn);
+      IndexIterator *ret =
+          queryEval_AddCost(q, TagIndex_OpenReader(idx, q->docTable, s, sdslen(s), q->conc, k, kn));
       sdsfree(s);
       return ret;
     }
@@ -591,7 +907,7 @@ static IndexIterator *Query_EvalTagNode(QueryEvalCtx *q, QueryNode *qn) {
   return ret;
 }
 
-IndexIterator *Query_EvalNode(QueryEvalCtx *q, QueryNode *n) {
+static IndexIterator *queryEval_Node(QueryEvalCtx *q, QueryNode *n) {
   switch (n->type) {
     case QN_TOKEN:
       return Query_EvalTokenNode(q, n);
@@ -605,6 +921,8 @@ IndexIterator *Query_EvalNode(QueryEvalCtx *q, QueryNode *n) {
       return Query_EvalNotNode(q, n);
     case QN_PREFX:
       return Query_EvalPrefixNode(q, n);
+    case QN_FUZZY:
+      return Query_EvalFuzzyNode(q, n);
     case QN_NUMERIC:
       return Query_EvalNumericNode(q, &n->nn);
     case QN_OPTIONAL:
@@ -620,6 +938,125 @@ IndexIterator *Query_EvalNode(QueryEvalCtx *q, QueryNode *n) {
   return NULL;
 }
 
+/* Estimate the number of results of a node from those of its children, or for a leaf, from the
+ * number of index entries it reads */
+static size_t queryEval_Estimate(QueryEvalCtx *q, QueryNode *n, size_t leafCost) {
+  size_t maxDocs = q->docTable ? q->docTable->maxDocId : leafCost;
+  size_t est = 0;
+  switch (n->type) {
+    case QN_PHRASE:
+      // at most as many as its most selective shingle
+      if (n->flags & QueryNode_Shingled) {
+        return MIN(n->estimate, maxDocs);
+      }
+      // at most as many as its most selective child
+      est = SIZE_MAX;
+      for (int i = 0; i < n->pn.numChildren; i++) {
+        est = MIN(est, n->pn.children[i]->estimate);
+      }
+      return MIN(est, maxDocs);
+    case QN_UNION:
+      for (int i = 0; i < n->un.numChildren; i++) {
+        est += n->un.children[i]->estimate;
+      }
+      return MIN(est, maxDocs);
+    case QN_NOT:
+      est = n->not.child ? n->not.child->estimate : 0;
+      return maxDocs > est ? maxDocs - est : 0;
+    case QN_OPTIONAL:
+      return maxDocs;
+    default:
+      return MIN(leafCost, maxDocs);
+  }
+}
+
+IndexIterator *Query_EvalNode(QueryEvalCtx *q, QueryNode *n) {
+  size_t cost = q->cost;
+  IndexIterator *ret = queryEval_Node(q, n);
+  n->estimate = ret ? queryEval_Estimate(q, n, q->cost - cost) : 0;
+  return ret;
+}
+
+/* Can the query read the champion tiers of its terms first? Only if it is a single term or an OR of
+ * terms, scored by the default scorer, whose scores the impacts in the tiers bound */
+static int queryEval_UseChampions(QueryEvalCtx *q, QueryNode *root) {
+  if (!RSGlobalConfig.championThreshold || !q->minScore || !q->sctx || !q->sctx->spec) return 0;
+  if (!q->opts || queryEval_IsUnscored(q)) return 0;
+  if (q->opts->scorer && strcasecmp(q->opts->scorer, DEFAULT_SCORER_NAME)) return 0;
+
+  if (root->type == QN_TOKEN) return 1;
+  if (root->type != QN_UNION) return 0;
+  for (int i = 0; i < root->un.numChildren; i++) {
+    if (root->un.children[i]->type != QN_TOKEN) return 0;
+  }
+  return 1;
+}
+
+static int cmpDocIds(const void *p1, const void *p2) {
+  t_docId a = *(const t_docId *)p1, b = *(const t_docId *)p2;
+  return a < b ? -1 : a > b;
+}
+
+/* Wrap the root iterator of a query with an iterator reading the champions of its terms first. The
+ * score of any other document is at most the sum of the IDF of each term times the highest impact
+ * of the term outside its tier. If a term has no tier, the query is left as is */
+static IndexIterator *queryEval_Champions(QueryEvalCtx *q, QueryNode *root, IndexIterator *it) {
+  QueryNode **terms = root->type == QN_TOKEN ? &root : root->un.children;
+  int numTerms = root->type == QN_TOKEN ? 1 : root->un.numChildren;
+
+  t_docId *candidates = NULL;
+  size_t n = 0, estimate = 0;
+  double bound = 0;
+  for (int i = 0; i < numTerms; i++) {
+    RedisModuleKey *k = NULL;
+    InvertedIndex *idx =
+        Redis_OpenInvertedIndexEx(q->sctx, terms[i]->tn.str, terms[i]->tn.len, 0, &k);
+    // a term that is not in the index adds nothing to the results
+    if (!idx) continue;
+
+    ChampionTier *t = InvertedIndex_GetChampions(idx, q->sctx->spec->scoreRevision);
+    if (t) {
+      bound += CalculateIDF(q->docTable->size, idx->numDocs) * t->bound;
+      estimate += idx->numDocs;
+      candidates = realloc(candidates, (n + t->size) * sizeof(t_docId));
+      for (uint32_t j = 0; j < t->size; j++) {
+        candidates[n++] = t->entries[j].docId;
+      }
+    }
+    RedisModule_CloseKey(k);
+    if (!t) {
+      free(candidates);
+      return it;
+    }
+  }
+  if (!n) {
+    free(candidates);
+    return it;
+  }
+
+  // sort the candidates and remove the documents that are champions of more than one term
+  qsort(candidates, n, sizeof(t_docId), cmpDocIds);
+  size_t numCandidates = 1;
+  for (size_t i = 1; i < n; i++) {
+    if (candidates[i] != candidates[numCandidates - 1]) {
+      candidates[numCandidates++] = candidates[i];
+    }
+  }
+
+  // leave some room for rounding errors, the scorer sums the terms in a different order
+  bound *= 1 + 1e-9;
+  return NewChampionIterator(it, candidates, numCandidates, bound, MIN(estimate, q->docTable->size),
+                             q->minScore, q->totalResults);
+}
+
+IndexIterator *Query_EvalRoot(QueryEvalCtx *q, QueryNode *root) {
+  IndexIterator *ret = Query_EvalNode(q, root);
+  if (ret && queryEval_UseChampions(q, root)) {
+    ret = queryEval_Champions(q, root, ret);
+  }
+  return ret;
+}
+
 /* Set the field mask recursively on a query node. This is called by the parser to handle situations
  * like @foo:(bar baz|gaz), where a complex tree is being applied a field mask */
 void QueryNode_SetFieldMask(QueryNode *n, t_fieldMask mask) {
@@ -659,6 +1096,32 @@ void QueryPhraseNode_AddChild(QueryNode *parent, QueryNode *child) {
   // QueryNode_Print(NULL, parent, 0);
 }
 
+void Query_AddPhraseStopword(QueryParseCtx *q, char *s, size_t offset) {
+  q->phraseStopwords =
+      realloc(q->phraseStopwords, sizeof(*q->phraseStopwords) * (q->numPhraseStopwords + 1));
+  q->phraseStopwords[q->numPhraseStopwords++] =
+      (QueryPhraseStopword){.str = s, .len = strlen(s), .offset = offset};
+}
+
+void QueryPhraseNode_TakeStopwords(QueryParseCtx *q, QueryNode *parent, int offset) {
+  QueryPhraseNode *pn = &parent->pn;
+  // the stopwords are kept in the order of the query
+  int n = 0;
+  while (n < q->numPhraseStopwords && (offset < 0 || q->phraseStopwords[n].offset < (size_t)offset)) {
+    n++;
+  }
+  if (!n) return;
+
+  pn->stopwords = realloc(pn->stopwords, sizeof(*pn->stopwords) * (pn->numStopwords + n));
+  for (int i = 0; i < n; i++) {
+    pn->stopwords[pn->numStopwords] = q->phraseStopwords[i];
+    pn->stopwords[pn->numStopwords++].pos = pn->numChildren;
+  }
+  q->numPhraseStopwords -= n;
+  memmove(q->phraseStopwords, q->phraseStopwords + n,
+          q->numPhraseStopwords * sizeof(*q->phraseStopwords));
+}
+
 void QueryUnionNode_AddChild(QueryNode *parent, QueryNode *child) {
   if (!child) return;
   QueryUnionNode *un = &parent->un;
@@ -707,6 +1170,8 @@ QueryParseCtx *NewQueryParseCtx(RedisSearchCtx *sctx, const char *raw, size_t le
   ctx->sctx = sctx;
   ctx->tokenId = 1;
   ctx->errorMsg = NULL;
+  ctx->phraseStopwords = NULL;
+  ctx->numPhraseStopwords = 0;
   assignSearchOpts(&ctx->opts, opts, sctx);
 
   return ctx;
@@ -727,9 +1192,15 @@ static sds doPad(sds s, int len) {
   return sdscat(s, buf);
 }
 
-static sds QueryNode_DumpSds(sds s, QueryParseCtx *q, QueryNode *qs, int depth) {
+static sds QueryNode_DumpSds(sds s, QueryParseCtx *q, QueryNode *qs, int depth, int withCosts) {
   s = doPad(s, depth);
 
+  if (withCosts) {
+    s = sdscatprintf(s, "[est:%zu%s%s] ", qs->estimate,
+                     qs->flags & QueryNode_PostFilter ? " post-filter" : "",
+                     qs->flags & QueryNode_Shingled ? " shingles" : "");
+  }
+
   if (qs->fieldMask == 0) {
     s = sdscat(s, "@NULL:");
   }
@@ -760,7 +1231,7 @@ static sds QueryNode_DumpSds(sds s, QueryParseCtx *q, QueryNode *qs, int depth)
     case QN_PHRASE:
       s = sdscatprintf(s, "%s {\n", qs->pn.exact ? "EXACT" : "INTERSECT");
       for (int i = 0; i < qs->pn.numChildren; i++) {
-        s = QueryNode_DumpSds(s, q, qs->pn.children[i], depth + 1);
+        s = QueryNode_DumpSds(s, q, qs->pn.children[i], depth + 1, withCosts);
       }
       s = doPad(s, depth);
 
@@ -773,15 +1244,22 @@ static sds QueryNode_DumpSds(sds s, QueryParseCtx *q, QueryNode *qs, int depth)
       s = sdscatprintf(s, "PREFIX{%s*", (char *)qs->pfx.str);
       break;
 
+    case QN_FUZZY:
+      s = sdscat(s, "FUZZY{");
+      for (int i = 0; i < qs->fz.maxDist; i++) s = sdscat(s, "%");
+      s = sdscat(s, qs->fz.tok.str);
+      for (int i = 0; i < qs->fz.maxDist; i++) s = sdscat(s, "%");
+      break;
+
     case QN_NOT:
       s = sdscat(s, "NOT{\n");
-      s = QueryNode_DumpSds(s, q, qs->not.child, depth + 1);
+      s = QueryNode_DumpSds(s, q, qs->not.child, depth + 1, withCosts);
       s = doPad(s, depth);
       break;
 
     case QN_OPTIONAL:
       s = sdscat(s, "OPTIONAL{\n");
-      s = QueryNode_DumpSds(s, q, qs->not.child, depth + 1);
+      s = QueryNode_DumpSds(s, q, qs->not.child, depth + 1, withCosts);
       s = doPad(s, depth);
       break;
 
@@ -793,14 +1271,15 @@ static sds QueryNode_DumpSds(sds s, QueryParseCtx *q, QueryNode *qs, int depth)
     case QN_UNION:
       s = sdscat(s, "UNION {\n");
       for (int i = 0; i < qs->un.numChildren; i++) {
-        s = QueryNode_DumpSds(s, q, qs->un.children[i], depth + 1);
+        s = QueryNode_DumpSds(s, q, qs->un.children[i], depth + 1, withCosts);
       }
       s = doPad(s, depth);
       break;
     case QN_TAG:
       s = sdscatprintf(s, "TAG:@%.*s {\n", (int)qs->tag.len, qs->tag.fieldName);
       for (int i = 0; i < qs->tag.numChildren; i++) {
-        s = QueryNode_DumpSds(s, q, qs->tag.children[i], depth + 1);
+        // tag values are not evaluated as nodes of their own
+        s = QueryNode_DumpSds(s, q, qs->tag.children[i], depth + 1, 0);
       }
       s = doPad(s, depth);
       break;
@@ -834,14 +1313,116 @@ const char *Query_DumpExplain(QueryParseCtx *q) {
     return strdup("NULL");
   }
 
-  sds s = QueryNode_DumpSds(sdsnew(""), q, q->root, 0);
+  sds s = QueryNode_DumpSds(sdsnew(""), q, q->root, 0, 0);
+  const char *ret = strndup(s, sdslen(s));
+  sdsfree(s);
+  return ret;
+}
+
+const char *Query_DumpExplainCosts(QueryParseCtx *q, RSSearchOptions *opts) {
+  if (!q || !q->root) {
+    return strdup("NULL");
+  }
+
+  // plan the query as a search would, without running it
+  QueryEvalCtx ev = {.docTable = &q->sctx->spec->docs,
+                     .conc = NULL,
+                     .numTokens = q->numTokens,
+                     .tokenId = 1,
+                     .sctx = q->sctx,
+                     .opts = opts};
+  IndexIterator *it = Query_EvalNode(&ev, q->root);
+  if (it) it->Free(it);
+
+  sds s = sdscatprintf(sdsnew(""), "COST %zu\n", ev.cost);
+  s = QueryNode_DumpSds(s, q, q->root, 0, 1);
   const char *ret = strndup(s, sdslen(s));
   sdsfree(s);
   return ret;
 }
 
+static sds keyCatStr(sds s, const char *str, size_t len) {
+  s = sdscatprintf(s, "%zu:", len);
+  return sdscatlen(s, str, len);
+}
+
+static sds QueryNode_CacheKey(sds s, QueryNode *qn) {
+  if (!qn) {
+    return sdscat(s, "-;");
+  }
+  s = sdscatprintf(s, "%d/%d/", qn->type, qn->flags);
+  s = sdscatlen(s, &qn->fieldMask, sizeof(qn->fieldMask));
+
+  switch (qn->type) {
+    case QN_PHRASE:
+      s = sdscatprintf(s, "%d{", qn->pn.exact);
+      for (int i = 0; i < qn->pn.numChildren; i++) {
+        s = QueryNode_CacheKey(s, qn->pn.children[i]);
+      }
+      // phrases matched by their shingles differ by their stopwords
+      for (int i = 0; i < qn->pn.numStopwords; i++) {
+        s = sdscatprintf(s, "%d:", qn->pn.stopwords[i].pos);
+        s = keyCatStr(s, qn->pn.stopwords[i].str, qn->pn.stopwords[i].len);
+      }
+      s = sdscat(s, "}");
+      break;
+    case QN_UNION:
+      s = sdscat(s, "{");
+      for (int i = 0; i < qn->un.numChildren; i++) {
+        s = QueryNode_CacheKey(s, qn->un.children[i]);
+      }
+      s = sdscat(s, "}");
+      break;
+    case QN_TAG:
+      s = keyCatStr(s, qn->tag.fieldName, qn->tag.len);
+      s = sdscat(s, "{");
+      for (int i = 0; i < qn->tag.numChildren; i++) {
+        s = QueryNode_CacheKey(s, qn->tag.children[i]);
+      }
+      s = sdscat(s, "}");
+      break;
+    case QN_TOKEN:
+    case QN_PREFX:
+      s = sdscatprintf(s, "%d/%d/", qn->tn.expanded, qn->tn.flags);
+      s = keyCatStr(s, qn->tn.str, qn->tn.len);
+      break;
+    case QN_FUZZY:
+      s = sdscatprintf(s, "%d/", qn->fz.maxDist);
+      s = keyCatStr(s, qn->fz.tok.str, qn->fz.tok.len);
+      break;
+    case QN_NOT:
+      s = QueryNode_CacheKey(s, qn->not.child);
+      break;
+    case QN_OPTIONAL:
+      s = QueryNode_CacheKey(s, qn->opt.child);
+      break;
+    case QN_NUMERIC: {
+      NumericFilter *f = qn->nn.nf;
+      s = keyCatStr(s, f->fieldName, strlen(f->fieldName));
+      s = sdscatprintf(s, "%.17g/%d/%.17g/%d", f->min, f->inclusiveMin, f->max, f->inclusiveMax);
+    } break;
+    case QN_GEO: {
+      GeoFilter *gf = qn->gn.gf;
+      s = keyCatStr(s, gf->property, strlen(gf->property));
+      s = sdscatprintf(s, "%.17g/%.17g/%.17g/%s", gf->lon, gf->lat, gf->radius, gf->unit);
+    } break;
+    case QN_IDS:
+      for (int i = 0; i < qn->fn.f->size; i++) {
+        s = sdscatprintf(s, "%u,", qn->fn.f->ids[i]);
+      }
+      break;
+    case QN_WILDCARD:
+      break;
+  }
+  return sdscat(s, ";");
+}
+
+sds Query_CacheKey(QueryParseCtx *q, sds s) {
+  return QueryNode_CacheKey(s, q->root);
+}
+
 void QueryNode_Print(QueryParseCtx *q, QueryNode *qn, int depth) {
-  sds s = QueryNode_DumpSds(sdsnew(""), q, qn, depth);
+  sds s = QueryNode_DumpSds(sdsnew(""), q, qn, depth, 0);
   printf("%s", s);
   sdsfree(s);
 }
@@ -850,6 +1431,10 @@ void Query_Free(QueryParseCtx *q) {
   if (q->root) {
     QueryNode_Free(q->root);
   }
+  for (int i = 0; i < q->numPhraseStopwords; i++) {
+    free(q->phraseStopwords[i].str);
+  }
+  free(q->phraseStopwords);
 
   free(q->raw);
   free(q);
@@ -46,6 +46,9 @@ typedef struct RSQuery {
 
   RSSearchOptions opts;
 
+  // the stopwords of the exact phrase being parsed, until its node takes them
+  QueryPhraseStopword *phraseStopwords;
+  int numPhraseStopwords;
 } QueryParseCtx;
 
 typedef struct {
@@ -55,6 +58,12 @@ typedef struct {
   int tokenId;
   DocTable *docTable;
   RSSearchOptions *opts;
+  // the estimated cost of the query - the number of index entries its leaf iterators may read
+  size_t cost;
+  // the lowest score the query still accepts, and its count of results. They let scored queries
+  // stop reading once no other document can make it into the results. NULL if they can't
+  const double *minScore;
+  uint32_t *totalResults;
 } QueryEvalCtx;
 
 /* Evaluate a QueryParseCtx stage and prepare it for execution. As execution is lazy
@@ -62,13 +71,26 @@ this doesn't
 actually do anything besides prepare the execution chaing */
 IndexIterator *Query_EvalNode(QueryEvalCtx *q, QueryNode *n);
 
+/* Evaluate the root of a query. Scored queries on frequent terms read the champion tiers of the
+ * terms first, and may not read the rest of the documents at all */
+IndexIterator *Query_EvalRoot(QueryEvalCtx *q, QueryNode *root);
+
 /* Free the QueryParseCtx execution stage and its children recursively */
 void QueryNode_Free(QueryNode *n);
 QueryNode *NewTokenNode(QueryParseCtx *q, const char *s, size_t len);
 QueryNode *NewTokenNodeExpanded(QueryParseCtx *q, const char *s, size_t len, RSTokenFlags flags);
 QueryNode *NewPhraseNode(int exact);
+
+/* Keep a stopword of the exact phrase being parsed, at the given offset in the query. The query
+ * takes ownership of s */
+void Query_AddPhraseStopword(QueryParseCtx *q, char *s, size_t offset);
+
+/* Move the kept stopwords before the given offset in the query - or all of them if it is -1 - to
+ * a phrase node, after its current children */
+void QueryPhraseNode_TakeStopwords(QueryParseCtx *q, QueryNode *parent, int offset);
 QueryNode *NewUnionNode();
 QueryNode *NewPrefixNode(QueryParseCtx *q, const char *s, size_t len);
+QueryNode *NewFuzzyNode(QueryParseCtx *q, const char *s, size_t len, int maxDist);
 QueryNode *NewNotNode(QueryNode *n);
 QueryNode *NewOptionalNode(QueryNode *n);
 QueryNode *NewNumericNode(NumericFilter *flt);
@@ -81,6 +103,9 @@ void QueryNode_SetFieldMask(QueryNode *n, t_fieldMask mask);
 void Query_SetNumericFilter(QueryParseCtx *q, NumericFilter *nf);
 void Query_SetGeoFilter(QueryParseCtx *q, GeoFilter *gf);
 void Query_SetIdFilter(QueryParseCtx *q, IdFilter *f);
+/* Restrict the query to documents having a tag in a tag field. The tag is preprocessed as the
+ * field's tags are when indexed, and copied */
+void Query_SetTagFilter(QueryParseCtx *q, const FieldSpec *fs, const char *tag, size_t len);
 
 /* Only used in tests, for now */
 void QueryNode_Print(QueryParseCtx *q, QueryNode *qs, int depth);
@@ -103,6 +128,15 @@ void Query_Expand(QueryParseCtx *q, const char *expander);
  */
 const char *Query_DumpExplain(QueryParseCtx *q);
 
+/* Plan the query without running it, and return a string representation of the planned tree with
+ * the estimated number of results of every node, and the estimated cost of the query. The string
+ * should be freed by the caller */
+const char *Query_DumpExplainCosts(QueryParseCtx *q, RSSearchOptions *opts);
+
+/* Append an unambiguous form of the query tree to s, used as the key of the query cache. Unlike the
+ * explain output, it keeps numbers and strings exact */
+sds Query_CacheKey(QueryParseCtx *q, sds s);
+
 /* Free a QueryParseCtx object */
 void Query_Free(QueryParseCtx *q);
 
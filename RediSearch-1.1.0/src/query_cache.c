@@ -0,0 +1,174 @@
+#include "query_cache.h"
+#include "util/khash.h"
+#include "util/fnv.h"
+#include <string.h>
+
+typedef struct {
+  const char *str;
+  size_t len;
+} queryKey;
+
+static inline khint_t queryKey_hash(queryKey k) {
+  return rs_fnv_32a_buf((void *)k.str, k.len, 0);
+}
+
+static inline int queryKey_equal(queryKey a, queryKey b) {
+  return a.len == b.len && !memcmp(a.str, b.str, a.len);
+}
+
+typedef struct queryCacheEntry {
+  char *key;
+  size_t keyLen;
+  uint64_t revision;
+  QueryCacheValue val;
+
+  // LRU list links, most recently used first
+  struct queryCacheEntry *prev, *next;
+} queryCacheEntry;
+
+KHASH_INIT(queryCache, queryKey, queryCacheEntry *, 1, queryKey_hash, queryKey_equal);
+
+struct QueryCache {
+  khash_t(queryCache) * h;
+  queryCacheEntry *head, *tail;
+  size_t memory;
+  size_t maxMemory;
+  size_t hits;
+  size_t misses;
+};
+
+QueryCache *NewQueryCache(size_t maxMemory) {
+  QueryCache *qc = calloc(1, sizeof(*qc));
+  qc->h = kh_init(queryCache);
+  qc->maxMemory = maxMemory;
+  return qc;
+}
+
+static size_t entry_MemSize(size_t keyLen, size_t numResults) {
+  return sizeof(queryCacheEntry) + keyLen + numResults * sizeof(QueryCacheResult);
+}
+
+static void entry_Free(queryCacheEntry *e) {
+  free(e->val.results);
+  free(e->key);
+  free(e);
+}
+
+static void queryCache_Unlink(QueryCache *qc, queryCacheEntry *e) {
+  if (e->prev) {
+    e->prev->next = e->next;
+  } else {
+    qc->head = e->next;
+  }
+  if (e->next) {
+    e->next->prev = e->prev;
+  } else {
+    qc->tail = e->prev;
+  }
+  e->prev = e->next = NULL;
+}
+
+static void queryCache_PushFront(QueryCache *qc, queryCacheEntry *e) {
+  e->prev = NULL;
+  e->next = qc->head;
+  if (qc->head) {
+    qc->head->prev = e;
+  } else {
+    qc->tail = e;
+  }
+  qc->head = e;
+}
+
+/* Remove an entry from the cache and free it */
+static void queryCache_Del(QueryCache *qc, khiter_t it) {
+  queryCacheEntry *e = kh_val(qc->h, it);
+  kh_del(queryCache, qc->h, it);
+  queryCache_Unlink(qc, e);
+  qc->memory -= entry_MemSize(e->keyLen, e->val.numResults);
+  entry_Free(e);
+}
+
+void QueryCache_Free(QueryCache *qc) {
+  if (!qc) return;
+  queryCacheEntry *e = qc->head;
+  while (e) {
+    queryCacheEntry *next = e->next;
+    entry_Free(e);
+    e = next;
+  }
+  kh_destroy(queryCache, qc->h);
+  free(qc);
+}
+
+int QueryCache_Get(QueryCache *qc, const char *key, size_t len, uint64_t revision, size_t num,
+                   QueryCacheValue *val) {
+  khiter_t it = kh_get(queryCache, qc->h, ((queryKey){.str = key, .len = len}));
+  if (it == kh_end(qc->h)) {
+    qc->misses++;
+    return 0;
+  }
+  queryCacheEntry *e = kh_val(qc->h, it);
+  if (e->revision != revision) {
+    queryCache_Del(qc, it);
+    qc->misses++;
+    return 0;
+  }
+  // the entry was computed for a smaller page, and there are more results than it has
+  if (num > e->val.numResults && e->val.totalResults > e->val.numResults) {
+    qc->misses++;
+    return 0;
+  }
+
+  queryCache_Unlink(qc, e);
+  queryCache_PushFront(qc, e);
+  qc->hits++;
+
+  *val = e->val;
+  val->results = NULL;
+  if (e->val.numResults) {
+    val->results = malloc(e->val.numResults * sizeof(QueryCacheResult));
+    memcpy(val->results, e->val.results, e->val.numResults * sizeof(QueryCacheResult));
+  }
+  return 1;
+}
+
+void QueryCache_Put(QueryCache *qc, const char *key, size_t len, uint64_t revision,
+                    QueryCacheValue *val) {
+  khiter_t it = kh_get(queryCache, qc->h, ((queryKey){.str = key, .len = len}));
+  if (it != kh_end(qc->h)) {
+    queryCache_Del(qc, it);
+  }
+
+  size_t memsize = entry_MemSize(len, val->numResults);
+  if (memsize > qc->maxMemory) {
+    free(val->results);
+    return;
+  }
+  while (qc->memory + memsize > qc->maxMemory && qc->tail) {
+    queryCacheEntry *last = qc->tail;
+    queryCache_Del(qc, kh_get(queryCache, qc->h,
+                              ((queryKey){.str = last->key, .len = last->keyLen})));
+  }
+
+  queryCacheEntry *e = calloc(1, sizeof(*e));
+  e->key = malloc(len);
+  memcpy(e->key, key, len);
+  e->keyLen = len;
+  e->revision = revision;
+  e->val = *val;
+
+  int rc;
+  it = kh_put(queryCache, qc->h, ((queryKey){.str = e->key, .len = len}), &rc);
+  kh_val(qc->h, it) = e;
+  queryCache_PushFront(qc, e);
+  qc->memory += memsize;
+}
+
+void QueryCache_GetStats(QueryCache *qc, QueryCacheStats *st) {
+  if (!qc) {
+    *st = (QueryCacheStats){0};
+    return;
+  }
+  *st = (QueryCacheStats){
+      .hits = qc->hits, .misses = qc->misses, .entries = kh_size(qc->h), .memory = qc->memory};
+}
@@ -0,0 +1,57 @@
+#ifndef __QUERY_CACHE_H__
+#define __QUERY_CACHE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "redisearch.h"
+
+/* A cache of search results, used to save re-evaluating queries that are repeated within a short
+ * time, such as dashboard refreshes and popular searches.
+ *
+ * The key is a canonical form of the query and of the request options affecting its results. The
+ * value is the top results of the query - their ids and scores - and the total number of results.
+ * Each entry is tagged with the revision of the index it was computed at. The index gets a new
+ * revision on every write, so an entry with an old revision is dropped on the next lookup. When
+ * the cache is over its memory limit, the least recently used queries are evicted. */
+
+typedef struct {
+  t_docId docId;
+  double score;
+} QueryCacheResult;
+
+/* The cached results of a query */
+typedef struct {
+  // the top results, in the order they were returned
+  QueryCacheResult *results;
+  size_t numResults;
+  // the total number of results of the query
+  size_t totalResults;
+} QueryCacheValue;
+
+typedef struct {
+  size_t hits;
+  size_t misses;
+  size_t entries;
+  size_t memory;
+} QueryCacheStats;
+
+typedef struct QueryCache QueryCache;
+
+QueryCache *NewQueryCache(size_t maxMemory);
+
+void QueryCache_Free(QueryCache *qc);
+
+/* Look up the results of a query computed at the given revision of the index, which must include
+ * at least the top num results. On a hit, returns 1 and copies the results into val, whose results
+ * array should be freed by the caller */
+int QueryCache_Get(QueryCache *qc, const char *key, size_t len, uint64_t revision, size_t num,
+                   QueryCacheValue *val);
+
+/* Cache the results of a query, replacing any existing entry. The cache takes ownership of the
+ * results array, and frees it if the entry does not fit in the memory limit */
+void QueryCache_Put(QueryCache *qc, const char *key, size_t len, uint64_t revision,
+                    QueryCacheValue *val);
+
+void QueryCache_GetStats(QueryCache *qc, QueryCacheStats *st);
+
+#endif
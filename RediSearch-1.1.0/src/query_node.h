@@ -39,9 +39,23 @@ typedef enum {
   QN_WILDCARD,
 
   /* Tag node, a list of tags for a specific tag field */
-  QN_TAG
+  QN_TAG,
+
+  /* Fuzzy term node, matching terms within an edit distance of the token */
+  QN_FUZZY
 } QueryNodeType;
 
+/* A stopword of an exact phrase. Stopwords are not searched for, but a phrase matched by the
+ * shingles of its fields keeps them */
+typedef struct {
+  char *str;
+  size_t len;
+  // the offset of the stopword in the query
+  size_t offset;
+  // the number of children of the phrase before the stopword
+  int pos;
+} QueryPhraseStopword;
+
 /* A prhase node represents a list of nodes with intersection between them, or a phrase in the case
  * of several token nodes. */
 typedef struct {
@@ -49,6 +63,8 @@ typedef struct {
   int numChildren;
   int exact;
 
+  QueryPhraseStopword *stopwords;
+  int numStopwords;
 } QueryPhraseNode;
 
 /* A Union node represents a set of child nodes where the index unions the result between them */
@@ -80,6 +96,16 @@ typedef RSToken QueryTokenNode;
 
 typedef RSToken QueryPrefixNode;
 
+/* The maximal edit distance of a fuzzy term. The distance is the number of percent signs around the
+ * term in the query, i.e. %term% for 1, %%term%% for 2, etc */
+#define QUERY_FUZZY_MAX_DIST 3
+
+/* A fuzzy node is expanded to all the terms in the index within its maximal edit distance */
+typedef struct {
+  RSToken tok;
+  int maxDist;
+} QueryFuzzyNode;
+
 typedef struct {
 } QueryWildcardNode;
 
@@ -98,6 +124,11 @@ typedef struct {
 
 typedef enum {
   QueryNode_Verbatim = 0x01,
+  /* A numeric filter checked against the sortable values of the results of its siblings, rather
+   * than evaluated with the numeric index */
+  QueryNode_PostFilter = 0x02,
+  /* An exact phrase matched by the shingles of its fields, rather than the lists of its terms */
+  QueryNode_Shingled = 0x04,
 } QueryNodeFlags;
 /* QueryNode reqresents any query node in the query tree. It has a type to resolve which node it is,
  * and a union of all possible nodes  */
@@ -114,16 +145,20 @@ typedef struct RSQueryNode {
     QueryPrefixNode pfx;
     QueryWildcardNode wc;
     QueryTagNode tag;
+    QueryFuzzyNode fz;
   };
   t_fieldMask fieldMask;
   /* The node type, for resolving the union access */
   QueryNodeType type;
   QueryNodeFlags flags;
+  /* The estimated number of results of the node, set when the query is evaluated */
+  size_t estimate;
 } QueryNode;
 
 /* Add a child to a phrase node */
 void QueryPhraseNode_AddChild(QueryNode *parent, QueryNode *child);
 
+
 /* Add a child to a union node  */
 void QueryUnionNode_AddChild(QueryNode *parent, QueryNode *child);
 
@@ -16,6 +16,19 @@ void RSQuery_Parse(void *yyp, int yymajor, QueryToken yyminor, QueryParseCtx *ct
 void *RSQuery_ParseAlloc(void *(*mallocProc)(size_t));
 void RSQuery_ParseFree(void *p, void (*freeProc)(void *));
 
+/* The edit distance of a fuzzy term, which is marked by the same number of percent signs on both
+ * its sides, e.g. %term% or %%term%%. Returns 0 if the term is not fuzzy */
+static int fuzzyDistance(QueryParseCtx *q, const char *ts, const char *te) {
+  int before = 0, after = 0;
+  while (ts - before > q->raw && ts[-before - 1] == '%' && before <= QUERY_FUZZY_MAX_DIST) {
+    before++;
+  }
+  while (te + after < q->raw + q->len && te[after] == '%' && after <= QUERY_FUZZY_MAX_DIST) {
+    after++;
+  }
+  return before == after && before <= QUERY_FUZZY_MAX_DIST ? before : 0;
+}
+
 
 #line 195 "lexer.rl"
 
@@ -151,7 +164,9 @@ QueryNode *Query_Parse(QueryParseCtx *q, char **err) {
 	}
 
 #line 209 "lexer.rl"
-  QueryToken tok = {.len = 0, .pos = 0, .s = 0};
+  QueryToken tok = {.len = 0, .pos = 0, .s = 0, .fuzzyDist = 0};
+  // are we inside an exact phrase? Its stopwords are kept for matching it by shingles
+  int inQuote = 0;
   
   //parseCtx ctx = {.root = NULL, .ok = 1, .errorMsg = NULL, .q = q};
   const char* p = q->raw;
@@ -290,6 +305,7 @@ _eof_trans:
 #line 77 "lexer.rl"
 	{te = p+1;{
     tok.pos = ts-q->raw;
+    inQuote = !inQuote;
     RSQuery_Parse(pParser, QUOTE, tok, q);  
     if (!q->ok) {
       {p++; goto _out; }
@@ -459,11 +475,16 @@ _eof_trans:
     tok.s = ts;
     tok.numval = 0;
     tok.pos = ts-q->raw;
-    if (!StopWordList_Contains(q->opts.stopwords, tok.s, tok.len)) {
+    // fuzzy terms are explicitly requested, so we don't treat them as stopwords
+    tok.fuzzyDist = fuzzyDistance(q, ts, te);
+    if (tok.fuzzyDist || !StopWordList_Contains(q->opts.stopwords, tok.s, tok.len)) {
       RSQuery_Parse(pParser, TERM, tok, q);
+    } else if (inQuote) {
+      Query_AddPhraseStopword(q, strdupcase(tok.s, tok.len), tok.pos);
     } else {
       RSQuery_Parse(pParser, STOPWORD, tok, q);
     }
+    tok.fuzzyDist = 0;
     if (!q->ok) {
       {p++; goto _out; }
     }
@@ -540,11 +561,16 @@ _eof_trans:
     tok.s = ts;
     tok.numval = 0;
     tok.pos = ts-q->raw;
-    if (!StopWordList_Contains(q->opts.stopwords, tok.s, tok.len)) {
+    // fuzzy terms are explicitly requested, so we don't treat them as stopwords
+    tok.fuzzyDist = fuzzyDistance(q, ts, te);
+    if (tok.fuzzyDist || !StopWordList_Contains(q->opts.stopwords, tok.s, tok.len)) {
       RSQuery_Parse(pParser, TERM, tok, q);
+    } else if (inQuote) {
+      Query_AddPhraseStopword(q, strdupcase(tok.s, tok.len), tok.pos);
     } else {
       RSQuery_Parse(pParser, STOPWORD, tok, q);
     }
+    tok.fuzzyDist = 0;
     if (!q->ok) {
       {p++; goto _out; }
     }
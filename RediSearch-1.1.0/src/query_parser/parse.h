@@ -5,4 +5,7 @@
 #include "../query.h"
 //#include "../rmutil/alloc.h"
 
+/* Duplicate a term of the query, lower-cased and unescaped */
+char *strdupcase(const char *s, size_t len);
+
 #endif  // !__QUERY_PARSER_PARSE_H__
\ No newline at end of file
@@ -74,6 +74,15 @@ size_t unescapen(char *s, size_t sz) {
  
   return (size_t)(dst - s);
 }
+
+// create a token node for a term, or a fuzzy node if the term is fuzzy
+QueryNode *newTermNode(QueryParseCtx *ctx, QueryToken *tok) {
+  char *s = strdupcase(tok->s, tok->len);
+  if (tok->fuzzyDist) {
+    return NewFuzzyNode(ctx, s, strlen(s), tok->fuzzyDist);
+  }
+  return NewTokenNode(ctx, s, -1);
+}
    
 #line 79 "parser.c"
 /**************** End of %include directives **********************************/
@@ -1144,6 +1153,7 @@ static void yy_reduce(
 {
     yymsp[-1].minor.yy35->pn.exact =1;
     yymsp[-1].minor.yy35->flags |= QueryNode_Verbatim;
+    QueryPhraseNode_TakeStopwords(ctx, yymsp[-1].minor.yy35, -1);
 
     yymsp[-2].minor.yy35 = yymsp[-1].minor.yy35;
 }
@@ -1154,6 +1164,15 @@ static void yy_reduce(
 {
     yymsp[-2].minor.yy35 = NewTokenNode(ctx, strdupcase(yymsp[-1].minor.yy0.s, yymsp[-1].minor.yy0.len), -1);
     yymsp[-2].minor.yy35->flags |= QueryNode_Verbatim;
+    // a term with stopwords is a phrase of its own
+    if (ctx->numPhraseStopwords) {
+        QueryNode *pn = NewPhraseNode(1);
+        pn->flags |= QueryNode_Verbatim;
+        QueryPhraseNode_TakeStopwords(ctx, pn, yymsp[-1].minor.yy0.pos);
+        QueryPhraseNode_AddChild(pn, yymsp[-2].minor.yy35);
+        QueryPhraseNode_TakeStopwords(ctx, pn, -1);
+        yymsp[-2].minor.yy35 = pn;
+    }
     
 }
 #line 1160 "parser.c"
@@ -1161,7 +1180,7 @@ static void yy_reduce(
       case 12: /* expr ::= term */
 #line 268 "parser.y"
 {
-   yylhsminor.yy35 = NewTokenNode(ctx, strdupcase(yymsp[0].minor.yy0.s, yymsp[0].minor.yy0.len), -1);
+   yylhsminor.yy35 = newTermNode(ctx, &yymsp[0].minor.yy0);
 }
 #line 1167 "parser.c"
   yymsp[0].minor.yy35 = yylhsminor.yy35;
@@ -1193,8 +1212,10 @@ static void yy_reduce(
 #line 284 "parser.y"
 {
     yylhsminor.yy35 = NewPhraseNode(0);
-    QueryPhraseNode_AddChild(yylhsminor.yy35, NewTokenNode(ctx, strdupcase(yymsp[-1].minor.yy0.s, yymsp[-1].minor.yy0.len), -1));
-    QueryPhraseNode_AddChild(yylhsminor.yy35, NewTokenNode(ctx, strdupcase(yymsp[0].minor.yy0.s, yymsp[0].minor.yy0.len), -1));
+    QueryPhraseNode_TakeStopwords(ctx, yylhsminor.yy35, yymsp[-1].minor.yy0.pos);
+    QueryPhraseNode_AddChild(yylhsminor.yy35, newTermNode(ctx, &yymsp[-1].minor.yy0));
+    QueryPhraseNode_TakeStopwords(ctx, yylhsminor.yy35, yymsp[0].minor.yy0.pos);
+    QueryPhraseNode_AddChild(yylhsminor.yy35, newTermNode(ctx, &yymsp[0].minor.yy0));
 }
 #line 1200 "parser.c"
   yymsp[-1].minor.yy35 = yylhsminor.yy35;
@@ -1203,7 +1224,8 @@ static void yy_reduce(
 #line 290 "parser.y"
 {
     yylhsminor.yy35 = yymsp[-1].minor.yy35;
-    QueryPhraseNode_AddChild(yylhsminor.yy35, NewTokenNode(ctx, strdupcase(yymsp[0].minor.yy0.s, yymsp[0].minor.yy0.len), -1));
+    QueryPhraseNode_TakeStopwords(ctx, yylhsminor.yy35, yymsp[0].minor.yy0.pos);
+    QueryPhraseNode_AddChild(yylhsminor.yy35, newTermNode(ctx, &yymsp[0].minor.yy0));
 }
 #line 1209 "parser.c"
   yymsp[-1].minor.yy35 = yylhsminor.yy35;
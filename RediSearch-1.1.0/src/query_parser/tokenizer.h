@@ -27,6 +27,8 @@ typedef struct {
   int pos;
   char *field;
   double numval;
+  // the maximal edit distance of a fuzzy term (e.g. %term%), or 0 for regular terms
+  int fuzzyDist;
   // QueryTokenType ;
 } QueryToken;
 
@@ -1,7 +1,9 @@
 #include "query_plan.h"
 #include "config.h"
+#include "err.h"
 #include "value.h"
 #include "aggregate/aggregate.h"
+#include "util/arr.h"
 
 /******************************************************************************************************
  *   Query Plan - the actual binding context of the whole execution plan - from filters to
@@ -86,6 +88,46 @@ static size_t serializeResult(QueryPlan *qex, SearchResult *r, RSSearchFlags fla
 #define HAS_TIMEOUT_FAILURE(qex) \
   ((qex)->execCtx.state == QPState_TimedOut && (qex)->opts.timeoutPolicy == TimeoutPolicy_Fail)
 
+/* Get the next result, from the prefetch buffer if we have one */
+static int queryPlan_Next(QueryPlan *qex, SearchResult *r) {
+  if (qex->prefetchPos < array_len(qex->prefetched)) {
+    *r = qex->prefetched[qex->prefetchPos++];
+    return RS_RESULT_OK;
+  }
+  if (qex->prefetchEOF) {
+    return RS_RESULT_EOF;
+  }
+  return ResultProcessor_Next(qex->rootProcessor, r, 1);
+}
+
+size_t QueryPlan_Prefetch(QueryPlan *plan, size_t maxResults) {
+  if (plan->prefetchEOF) return 0;
+  if (!plan->prefetched) {
+    plan->prefetched = array_new(SearchResult, maxResults);
+  }
+
+  // move whatever the client did not read yet to the front of the buffer
+  size_t left = array_len(plan->prefetched) - plan->prefetchPos;
+  memmove(plan->prefetched, plan->prefetched + plan->prefetchPos, left * sizeof(SearchResult));
+  array_hdr(plan->prefetched)->len = left;
+  plan->prefetchPos = 0;
+
+  plan->pause = 0;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &plan->execCtx.startTime);
+  size_t n = 0;
+  while (left + n < maxResults && !plan->pause && plan->execCtx.state == QPState_Running) {
+    SearchResult r = SEARCH_RESULT_INIT;
+    if (ResultProcessor_Next(plan->rootProcessor, &r, 1) == RS_RESULT_EOF) {
+      plan->prefetchEOF = 1;
+      break;
+    }
+    plan->prefetched = array_append(plan->prefetched, r);
+    n++;
+  }
+  plan->pause = 0;
+  return n;
+}
+
 static void Query_SerializeResults(QueryPlan *qex, RedisModuleCtx *output) {
   int rc;
   int count = 0;
@@ -109,7 +151,7 @@ static void Query_SerializeResults(QueryPlan *qex, RedisModuleCtx *output) {
 
   do {
     SearchResult r = SEARCH_RESULT_INIT;
-    rc = ResultProcessor_Next(qex->rootProcessor, &r, 1);
+    rc = queryPlan_Next(qex, &r);
 
     if (rc == RS_RESULT_EOF) {
       qex->outputFlags |= QP_OUTPUT_FLAG_DONE;
@@ -220,6 +262,12 @@ void QueryPlan_Free(QueryPlan *plan) {
   if (plan->postHook.privdata) {
     if (plan->postHook.free) plan->postHook.free(plan->postHook.privdata);
   }
+  if (plan->prefetched) {
+    for (size_t i = plan->prefetchPos; i < array_len(plan->prefetched); i++) {
+      SearchResult_FreeInternal(&plan->prefetched[i]);
+    }
+    array_free(plan->prefetched);
+  }
 
   free(plan);
 }
@@ -231,16 +279,63 @@ static int queryPlan_EvalQuery(QueryPlan *plan, QueryParseCtx *parsedQuery, RSSe
                      .numTokens = parsedQuery->numTokens,
                      .tokenId = 1,
                      .sctx = plan->ctx,
-                     .opts = opts};
+                     .opts = opts,
+                     .minScore = &plan->execCtx.minScore,
+                     .totalResults = &plan->execCtx.totalResults};
 
-  plan->rootFilter = Query_EvalNode(&ev, parsedQuery->root);
+  plan->rootFilter = Query_EvalRoot(&ev, parsedQuery->root);
+  plan->execCtx.cost = ev.cost;
   return plan->rootFilter ? 1 : 0;
 }
 
+/* Check the estimated cost of the query against MAXQUERYCOST. Returns 0 and sets err if the query
+ * is rejected. Depending on the policy, a query over the budget may instead run with a scan budget
+ * and return the results found within it */
+static int queryPlan_Admit(QueryPlan *plan, char **err) {
+  IndexSpec *sp = plan->ctx ? plan->ctx->spec : NULL;
+  size_t cost = plan->execCtx.cost;
+
+  if (RSGlobalConfig.maxQueryCost && cost > RSGlobalConfig.maxQueryCost) {
+    if (RSGlobalConfig.queryCostPolicy == TimeoutPolicy_Fail) {
+      if (sp) sp->queryStats.numRejected++;
+      FMT_ERR(err, "Query cost %zu exceeds the maximum of %lld", cost,
+              RSGlobalConfig.maxQueryCost);
+      return 0;
+    }
+    plan->execCtx.maxDocsScanned = RSGlobalConfig.maxQueryCost;
+    if (sp) sp->queryStats.numDegraded++;
+  }
+  if (sp) sp->queryStats.numQueries++;
+  return 1;
+}
+
+static uint64_t queryPlan_CPUTimeSince(struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (uint64_t)1000000000 * (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec);
+}
+
+/* Account the CPU time and documents scanned by the current run of the plan, in the plan and in
+ * the query stats of the index */
+static void queryPlan_UpdateStats(QueryPlan *plan) {
+  uint64_t cpu = queryPlan_CPUTimeSince(&plan->cpuStart);
+  plan->cpuStart = (struct timespec){0, 0};
+  plan->execCtx.cpuTimeNS += cpu;
+
+  // the spec is gone if it was deleted while the query was running
+  IndexSpec *sp = plan->ctx ? plan->ctx->spec : NULL;
+  if (sp) {
+    sp->queryStats.cpuTimeNS += cpu;
+    sp->queryStats.docsScanned += plan->execCtx.docsScanned - plan->docsScannedReported;
+    plan->docsScannedReported = plan->execCtx.docsScanned;
+  }
+}
+
 QueryPlan *Query_BuildPlan(RedisSearchCtx *ctx, QueryParseCtx *parsedQuery, RSSearchOptions *opts,
                            ProcessorChainBuilder pcb, void *chainBuilderContext, char **err) {
   QueryPlan *plan = calloc(1, sizeof(*plan));
   plan->ctx = ctx;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &plan->cpuStart);
   plan->conc = opts->concurrentMode ? malloc(sizeof(*plan->conc)) : NULL;
   plan->opts = opts ? *opts : RS_DEFAULT_SEARCHOPTS;
   if (plan->opts.timeoutMS == 0) {
@@ -270,6 +365,10 @@ QueryPlan *Query_BuildPlan(RedisSearchCtx *ctx, QueryParseCtx *parsedQuery, RSSe
     QueryPlan_Free(plan);
     return NULL;
   }
+  if (!queryPlan_Admit(plan, err)) {
+    QueryPlan_Free(plan);
+    return NULL;
+  }
   plan->execCtx.rootFilter = plan->rootFilter;
   plan->rootProcessor = pcb(plan, chainBuilderContext, err);
   if (!plan->rootProcessor) {
@@ -280,7 +379,12 @@ QueryPlan *Query_BuildPlan(RedisSearchCtx *ctx, QueryParseCtx *parsedQuery, RSSe
 }
 
 void QueryPlan_Run(QueryPlan *plan, RedisModuleCtx *outputCtx) {
+  // the first run also accounts for building the plan; cursor reads start their own count
+  if (!plan->cpuStart.tv_sec && !plan->cpuStart.tv_nsec) {
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &plan->cpuStart);
+  }
   Query_SerializeResults(plan, outputCtx);
+  queryPlan_UpdateStats(plan);
 }
 void QueryPlan_SetHook(QueryPlan *plan, QueryPlanHookType ht, QueryHookCallback cb, void *privdata,
                        void (*freefn)(void *)) {
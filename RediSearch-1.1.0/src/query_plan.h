@@ -58,6 +58,17 @@ typedef struct QueryPlan {
 
   /** Deferred count for RM_ReplyArray */
   unsigned count;
+
+  /** Results read ahead by a prefetching cursor, served before pulling from the processors */
+  SearchResult *prefetched;
+  size_t prefetchPos;
+  /** Set if the prefetched results reach the end of the query */
+  int prefetchEOF;
+
+  /** Thread CPU time when the current run started, zero between runs */
+  struct timespec cpuStart;
+  /** Documents scanned that were already added to the index query stats */
+  size_t docsScannedReported;
 } QueryPlan;
 
 /* Set the concurrent mode of the QueryParseCtx. By default it's on, setting here to 0 will turn
@@ -78,6 +89,11 @@ void QueryPlan_SetHook(QueryPlan *plan, QueryPlanHookType ht, QueryHookCallback
 /** Run the query plan, */
 void QueryPlan_Run(QueryPlan *plan, RedisModuleCtx *outputCtx);
 
+/* Read up to maxResults results ahead into the plan's prefetch buffer, to be served by the next
+ * QueryPlan_Run call. Stops early at EOF or if the plan is paused. Returns the number of results
+ * buffered */
+size_t QueryPlan_Prefetch(QueryPlan *plan, size_t maxResults);
+
 void QueryPlan_Free(QueryPlan *plan);
 
 #define QueryPlan_HasError(plan) ((plan)->execCtx.state != QueryState_OK)
@@ -41,6 +41,17 @@ void *InvertedIndex_RdbLoad(RedisModuleIO *rdb, int encver) {
     blk->data->offset = cap;
     // if we read a buffer of 0 bytes we still read 1 byte from the RDB that needs to be freed
     if (!cap && data) RedisModule_Free(data);
+
+    if (encver > INVERTED_INDEX_INLINE_OFFSETS_VER && (idx->flags & Index_StoreTermOffsets)) {
+      data = RedisModule_LoadStringBuffer(rdb, &cap);
+      blk->offsets = Buffer_Wrap(cap > 0 ? data : NULL, cap);
+      blk->offsets->offset = cap;
+      if (!cap && data) RedisModule_Free(data);
+    }
+  }
+  // older versions wrote the term offsets inline with the records
+  if (encver <= INVERTED_INDEX_INLINE_OFFSETS_VER) {
+    InvertedIndex_SplitOffsets(idx);
   }
   return idx;
 }
@@ -58,6 +69,10 @@ void InvertedIndex_RdbSave(RedisModuleIO *rdb, void *value) {
     RedisModule_SaveUnsigned(rdb, blk->lastId);
     RedisModule_SaveUnsigned(rdb, blk->numDocs);
     RedisModule_SaveStringBuffer(rdb, blk->data->data ? blk->data->data : "", blk->data->offset);
+    if (blk->offsets) {
+      RedisModule_SaveStringBuffer(rdb, blk->offsets->data ? blk->offsets->data : "",
+                                   blk->offsets->offset);
+    }
   }
 }
 void InvertedIndex_Digest(RedisModuleDigest *digest, void *value) {
@@ -70,6 +85,12 @@ unsigned long InvertedIndex_MemUsage(const void *value) {
     ret += sizeof(IndexBlock);
     ret += sizeof(Buffer);
     ret += Buffer_Offset(idx->blocks[i].data);
+    if (idx->blocks[i].offsets) {
+      ret += sizeof(Buffer) + Buffer_Offset(idx->blocks[i].offsets);
+    }
+  }
+  if (idx->champions) {
+    ret += sizeof(ChampionTier) + idx->champions->cap * sizeof(IndexChampion);
   }
   return ret;
 }
@@ -286,7 +307,7 @@ IndexReader *Redis_OpenReader(RedisSearchCtx *ctx, RSQueryTerm *term, DocTable *
   IndexReader *ret = NewTermIndexReader(idx, dt, fieldMask, term);
   if (csx) {
     ConcurrentSearch_AddKey(csx, k, REDISMODULE_READ, termKey, IndexReader_OnReopen, ret, NULL,
-                            ConcurrentKey_SharedNothing);
+                            ConcurrentKey_Versioned);
   }
   return ret;
 }
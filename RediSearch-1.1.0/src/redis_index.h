@@ -31,8 +31,10 @@ const char *Redis_SelectRandomTerm(RedisSearchCtx *ctx, size_t *tlen);
 #define SKIPINDEX_KEY_FORMAT "si:%s/%.*s"
 #define SCOREINDEX_KEY_FORMAT "ss:%s/%.*s"
 
-#define INVERTED_INDEX_ENCVER 1
+#define INVERTED_INDEX_ENCVER 2
 #define INVERTED_INDEX_NOFREQFLAG_VER 0
+// the last version writing the term offsets of the records inline, rather than in their own stream
+#define INVERTED_INDEX_INLINE_OFFSETS_VER 1
 
 typedef int (*ScanFunc)(RedisModuleCtx *ctx, RedisModuleString *keyName, void *opaque);
 
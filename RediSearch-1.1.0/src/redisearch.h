@@ -309,6 +309,35 @@ typedef struct {
 typedef double (*RSScoringFunction)(RSScoringFunctionCtx *ctx, RSIndexResult *res,
                                     RSDocumentMetadata *dmd, double minScore);
 
+/* RSScoringBatch is a batch of search results passed to a batch scoring function. The documents of
+ * the results are described by parallel arrays. The index results are flattened into their leaves -
+ * the terms, numeric ranges and other filters each result matched - whose frequencies and idfs are
+ * laid out in two more arrays. The leaves of result i are at indexes leafOffsets[i] up to
+ * leafOffsets[i + 1]. Leaves that are not terms have an idf of 1 */
+typedef struct {
+  size_t numResults;
+  const t_docId *docIds;
+  RSDocumentMetadata *const *dmds;
+  /* The score, length and maximal term frequency of each document */
+  const double *docScores;
+  const double *docLens;
+  const double *maxFreqs;
+  /* The "slop" of each result, as returned by RSScoringFunctionCtx.GetSlop() */
+  const int *slops;
+
+  const size_t *leafOffsets;
+  size_t numLeaves;
+  const double *leafFreqs;
+  const double *leafIdfs;
+  /* Scratch space of numLeaves doubles, for the scoring function to use */
+  double *scratch;
+} RSScoringBatch;
+
+/* RSBatchScoringFunction scores a batch of results at once, writing the score of result i to
+ * scores[i]. It is an optional companion of a scoring function, and must give the same scores */
+typedef void (*RSBatchScoringFunction)(RSScoringFunctionCtx *ctx, const RSScoringBatch *batch,
+                                       double minScore, double *scores);
+
 /* The extension registeration context, containing the callbacks avaliable to the extension for
  * registering query expanders and scorers. */
 typedef struct RSExtensionCtx {
@@ -316,6 +345,8 @@ typedef struct RSExtensionCtx {
                                  void *privdata);
   int (*RegisterQueryExpander)(const char *alias, RSQueryTokenExpander exp, RSFreeFunction ff,
                                void *privdata);
+  /* Add a batch entry point to an already registered scoring function */
+  int (*RegisterBatchScoringFunction)(const char *alias, RSBatchScoringFunction func);
 } RSExtensionCtx;
 
 /* An extension initialization function  */
@@ -136,12 +136,19 @@ int baseResultProcessor_Next(ResultProcessorCtx *ctx, SearchResult *res) {
   int rc;
   // Read from the root filter until we have a valid result
   do {
+    // a query over its cost budget returns what it found within its scan budget
+    if (q->execCtx.maxDocsScanned && q->execCtx.docsScanned >= q->execCtx.maxDocsScanned) {
+      q->rootFilter->Abort(q->rootFilter->ctx);
+      return RS_RESULT_EOF;
+    }
     rc = q->rootFilter->Read(q->rootFilter->ctx, &r);
 
     // This means we are done!
     if (rc == INDEXREAD_EOF) {
       return RS_RESULT_EOF;
-    } else if (!r || rc == INDEXREAD_NOTFOUND) {
+    }
+    ++q->execCtx.docsScanned;
+    if (!r || rc == INDEXREAD_NOTFOUND) {
       continue;
     }
 
@@ -193,11 +200,40 @@ ResultProcessor *NewBaseProcessor(QueryPlan *q, QueryProcessingCtx *xc) {
  * It may not be invoked if we are working in SORTBY mode (or later on in aggregations)
  ********************************************************************************************************************/
 
+/* The number of results a batch scoring function scores at once */
+#define SCORER_BATCH_SIZE 64
+
+/* Results read from upstream and scored together by a batch scoring function. The index results are
+ * only valid until the next read, so their leaves are copied out as the results are read */
+struct scorerBatch {
+  t_docId docIds[SCORER_BATCH_SIZE];
+  RSDocumentMetadata *dmds[SCORER_BATCH_SIZE];
+  double docScores[SCORER_BATCH_SIZE];
+  double docLens[SCORER_BATCH_SIZE];
+  double maxFreqs[SCORER_BATCH_SIZE];
+  int slops[SCORER_BATCH_SIZE];
+  size_t leafOffsets[SCORER_BATCH_SIZE + 1];
+  double scores[SCORER_BATCH_SIZE];
+
+  // the leaves of all the results, and scratch space for the scoring function
+  double *leafFreqs;
+  double *leafIdfs;
+  double *scratch;
+  size_t leafCap;
+
+  // the number of results in the batch, and the next one to return
+  size_t len;
+  size_t pos;
+  int eof;
+};
+
 /* The scorer context - basically the scoring function and its private data */
 struct scorerCtx {
   RSScoringFunction scorer;
+  RSBatchScoringFunction batchScorer;
   RSFreeFunction scorerFree;
   RSScoringFunctionCtx scorerCtx;
+  struct scorerBatch *batch;
 };
 
 int scorerProcessor_Next(ResultProcessorCtx *ctx, SearchResult *res) {
@@ -221,12 +257,102 @@ int scorerProcessor_Next(ResultProcessorCtx *ctx, SearchResult *res) {
   return rc;
 }
 
+/* Append the leaves of an index result to the batch, the way the scorers walk them */
+static void scorerBatch_AddLeaves(struct scorerBatch *b, RSIndexResult *r, size_t *n) {
+  if (r->type & (RSResultType_Intersection | RSResultType_Union)) {
+    for (int i = 0; i < r->agg.numChildren; i++) {
+      scorerBatch_AddLeaves(b, r->agg.children[i], n);
+    }
+    return;
+  }
+  if (*n == b->leafCap) {
+    b->leafCap = b->leafCap ? b->leafCap * 2 : SCORER_BATCH_SIZE * 4;
+    b->leafFreqs = realloc(b->leafFreqs, b->leafCap * sizeof(double));
+    b->leafIdfs = realloc(b->leafIdfs, b->leafCap * sizeof(double));
+    b->scratch = realloc(b->scratch, b->leafCap * sizeof(double));
+  }
+  b->leafFreqs[*n] = (double)r->freq;
+  b->leafIdfs[*n] = r->type != RSResultType_Term ? 1 : r->term.term ? r->term.term->idf : 0;
+  (*n)++;
+}
+
+/* Read the next batch of results from upstream, and score them */
+static void scorer_FillBatch(ResultProcessorCtx *ctx, struct scorerCtx *sc, SearchResult *res) {
+  struct scorerBatch *b = sc->batch;
+  size_t numLeaves = 0;
+  b->len = b->pos = 0;
+  while (b->len < SCORER_BATCH_SIZE) {
+    if (RS_RESULT_EOF == ResultProcessor_Next(ctx->upstream, res, 0)) {
+      b->eof = 1;
+      break;
+    }
+    size_t i = b->len++;
+    RSDocumentMetadata *dmd = res->md;
+    b->docIds[i] = res->docId;
+    b->dmds[i] = dmd;
+    b->docScores[i] = dmd->score;
+    b->docLens[i] = dmd->len;
+    b->maxFreqs[i] = dmd->maxFreq;
+    b->slops[i] = sc->scorerCtx.GetSlop(res->indexResult);
+    b->leafOffsets[i] = numLeaves;
+    scorerBatch_AddLeaves(b, res->indexResult, &numLeaves);
+  }
+  if (!b->len) return;
+  b->leafOffsets[b->len] = numLeaves;
+
+  RSScoringBatch batch = {.numResults = b->len,
+                          .docIds = b->docIds,
+                          .dmds = b->dmds,
+                          .docScores = b->docScores,
+                          .docLens = b->docLens,
+                          .maxFreqs = b->maxFreqs,
+                          .slops = b->slops,
+                          .leafOffsets = b->leafOffsets,
+                          .numLeaves = numLeaves,
+                          .leafFreqs = b->leafFreqs,
+                          .leafIdfs = b->leafIdfs,
+                          .scratch = b->scratch};
+  sc->batchScorer(&sc->scorerCtx, &batch, ctx->qxc->minScore, b->scores);
+}
+
+/* Next implementation for scoring functions with a batch version. Results are read and scored a
+ * batch at a time, and then returned one by one. The index results of the returned results are not
+ * valid anymore, so they are unset - nothing past the scorer uses them */
+int scorerProcessor_NextBatch(ResultProcessorCtx *ctx, SearchResult *res) {
+  struct scorerCtx *sc = ctx->privdata;
+  struct scorerBatch *b = sc->batch;
+
+  while (b->pos == b->len) {
+    if (b->eof) return RS_RESULT_EOF;
+    scorer_FillBatch(ctx, sc, res);
+  }
+
+  size_t i = b->pos++;
+  res->docId = b->docIds[i];
+  res->md = b->dmds[i];
+  res->sv = res->md->sortVector;
+  res->indexResult = NULL;
+  res->score = b->scores[i];
+
+  // If we got the special score RS_SCORE_FILTEROUT - disregard the result and decrease the total
+  // number of results (it's been increased by the upstream processor)
+  if (res->score == RS_SCORE_FILTEROUT) ctx->qxc->totalResults--;
+
+  return RS_RESULT_OK;
+}
+
 /* Free impl. for scorer - frees up the scorer privdata if needed */
 static void scorer_Free(ResultProcessor *rp) {
   struct scorerCtx *sc = rp->ctx.privdata;
   if (sc->scorerFree) {
     sc->scorerFree(sc->scorerCtx.privdata);
   }
+  if (sc->batch) {
+    free(sc->batch->leafFreqs);
+    free(sc->batch->leafIdfs);
+    free(sc->batch->scratch);
+    free(sc->batch);
+  }
   ResultProcessor_GenericFree(rp);
 }
 
@@ -241,13 +367,15 @@ ResultProcessor *NewScorer(const char *scorer, ResultProcessor *upstream, RSSear
   }
 
   sc->scorer = scx->sf;
+  sc->batchScorer = scx->bsf;
   sc->scorerFree = scx->ff;
   sc->scorerCtx.payload = req->payload;
+  sc->batch = sc->batchScorer ? calloc(1, sizeof(*sc->batch)) : NULL;
   // Initialize scorer stats
   IndexSpec_GetStats(upstream->ctx.qxc->sctx->spec, &sc->scorerCtx.indexStats);
 
   ResultProcessor *rp = NewResultProcessor(upstream, sc);
-  rp->Next = scorerProcessor_Next;
+  rp->Next = sc->batchScorer ? scorerProcessor_NextBatch : scorerProcessor_Next;
   rp->Free = scorer_Free;
   return rp;
 }
@@ -567,36 +695,35 @@ ResultProcessor *NewPager(ResultProcessor *upstream, uint32_t offset, uint32_t l
  *
  * It fills the result objects' field map with values corresponding to the requested return fields
  *
+ * Results are pulled from upstream in batches, and the whole batch is loaded in one go without
+ * letting the concurrent context switch in between, so we take the lock once per batch instead of
+ * once per document. When specific fields are requested, we read just those from the hash and wrap
+ * the returned strings without copying them. Values are always read from the hash, even for
+ * sortable fields, so they are returned exactly as they were stored.
+ *
  *******************************************************************************************************************/
+#define LOADER_BATCH_SIZE 32
+
 struct loaderCtx {
   RedisSearchCtx *ctx;
   const char **fields;
   size_t numFields;
   int explicitReturn;
-};
 
-int loader_Next(ResultProcessorCtx *ctx, SearchResult *r) {
-  struct loaderCtx *lc = ctx->privdata;
+  // The current batch of results, already loaded
+  SearchResult batch[LOADER_BATCH_SIZE];
+  size_t batchLen;
+  size_t batchPos;
+  int upstreamEOF;
+};
 
-  int rc = ResultProcessor_Next(ctx->upstream, r, 1);
-  // END - let's write the total processed size
-  if (rc == RS_RESULT_EOF) {
-    return rc;
-  }
+/* Load all the fields of the document with HGETALL */
+static void loader_LoadAll(struct loaderCtx *lc, SearchResult *r) {
   Document doc = {NULL};
-  RedisModuleKey *rkey = NULL;
-
-  // Current behavior skips entire result if document does not exist.
-  // I'm unusre if that's intentional or an oversight.
   RedisModuleString *idstr = DMD_CreateKeyString(r->md, lc->ctx->redisCtx);
-  if (!lc->explicitReturn) {
-    Redis_LoadDocument(lc->ctx, idstr, &doc);
-  } else {
+  Redis_LoadDocument(lc->ctx, idstr, &doc);
+  RedisModule_FreeString(lc->ctx->redisCtx, idstr);
 
-    Redis_LoadDocumentEx(lc->ctx, idstr, lc->fields, lc->numFields, &doc, &rkey);
-    RedisModule_FreeString(lc->ctx->redisCtx, idstr);
-  }
-  // TODO: load should return strings, not redis strings
   for (int i = 0; i < doc.numFields; i++) {
     if (doc.fields[i].text) {
       RSFieldMap_Set(&r->fields, doc.fields[i].name, RS_RedisStringVal(doc.fields[i].text));
@@ -605,18 +732,89 @@ int loader_Next(ResultProcessorCtx *ctx, SearchResult *r) {
     }
   }
   Document_Free(&doc);
+}
+
+/* Load just the requested fields from the hash. Fields missing from the document are not set */
+static void loader_LoadFields(struct loaderCtx *lc, SearchResult *r) {
+  RedisModuleCtx *ctx = lc->ctx->redisCtx;
+  RedisModuleString *idstr = DMD_CreateKeyString(r->md, ctx);
+  RedisModuleKey *k = RedisModule_OpenKey(ctx, idstr, REDISMODULE_READ);
+  RedisModule_FreeString(ctx, idstr);
+  if (!k) return;
+
+  if (RedisModule_KeyType(k) == REDISMODULE_KEYTYPE_HASH) {
+    for (size_t i = 0; i < lc->numFields; i++) {
+      RedisModuleString *v = NULL;
+      RedisModule_HashGet(k, REDISMODULE_HASH_CFIELDS, lc->fields[i], &v, NULL);
+      if (v) {
+        RSFieldMap_Set(&r->fields, lc->fields[i], RS_RedisStringVal(v));
+      }
+    }
+  }
+  RedisModule_CloseKey(k);
+}
+
+/* Read the next batch of results from upstream and load all of them */
+static void loader_FillBatch(ResultProcessorCtx *ctx, struct loaderCtx *lc) {
+  lc->batchLen = lc->batchPos = 0;
+
+  // Context switches are allowed while we read from upstream, but not while loading
+  while (lc->batchLen < LOADER_BATCH_SIZE) {
+    SearchResult *r = &lc->batch[lc->batchLen];
+    *r = SEARCH_RESULT_INIT;
+    if (ResultProcessor_Next(ctx->upstream, r, 1) == RS_RESULT_EOF) {
+      lc->upstreamEOF = 1;
+      break;
+    }
+    // the index result belongs to the iterators and is not valid after the next read
+    r->indexResult = NULL;
+    lc->batchLen++;
+  }
+
+  for (size_t i = 0; i < lc->batchLen; i++) {
+    if (lc->explicitReturn) {
+      loader_LoadFields(lc, &lc->batch[i]);
+    } else {
+      loader_LoadAll(lc, &lc->batch[i]);
+    }
+  }
+}
+
+int loader_Next(ResultProcessorCtx *ctx, SearchResult *r) {
+  struct loaderCtx *lc = ctx->privdata;
+
+  if (lc->batchPos == lc->batchLen) {
+    if (lc->upstreamEOF) {
+      return RS_RESULT_EOF;
+    }
+    loader_FillBatch(ctx, lc);
+    // END - let's write the total processed size
+    if (lc->batchLen == 0) {
+      return RS_RESULT_EOF;
+    }
+  }
 
+  // hand the result over to the caller, including its field map
+  if (r->fields) {
+    RSFieldMap_Free(r->fields, 0);
+  }
+  *r = lc->batch[lc->batchPos++];
   return RS_RESULT_OK;
 }
 
 void loader_Free(ResultProcessor *rp) {
   struct loaderCtx *lc = rp->ctx.privdata;
+  // free results we've loaded but never yielded
+  for (size_t i = lc->batchPos; i < lc->batchLen; i++) {
+    SearchResult_FreeInternal(&lc->batch[i]);
+  }
   free(lc->fields);
   free(lc);
   free(rp);
 }
+
 ResultProcessor *NewLoader(ResultProcessor *upstream, RedisSearchCtx *sctx, FieldList *fields) {
-  struct loaderCtx *sc = malloc(sizeof(*sc));
+  struct loaderCtx *sc = calloc(1, sizeof(*sc));
 
   sc->ctx = sctx;
   sc->fields = calloc(fields->numFields, sizeof(char *));
@@ -633,25 +831,168 @@ ResultProcessor *NewLoader(ResultProcessor *upstream, RedisSearchCtx *sctx, Fiel
   return rp;
 }
 
+/*******************************************************************************************************************
+ *  Cached Results Processor
+ *
+ * When the results of a search are found in the query cache, this processor replaces the base
+ * processor, the scorer and the sorter, and yields the cached top results in order
+ *******************************************************************************************************************/
+
+struct cachedResultsCtx {
+  QueryCacheValue *val;
+  size_t pos;
+};
+
+int cachedResults_Next(ResultProcessorCtx *ctx, SearchResult *res) {
+  struct cachedResultsCtx *cc = ctx->privdata;
+  if (!RP_SPEC(ctx)) {
+    return RS_RESULT_EOF;
+  }
+
+  while (cc->pos < cc->val->numResults) {
+    QueryCacheResult *cr = &cc->val->results[cc->pos++];
+    RSDocumentMetadata *dmd = DocTable_Get(&RP_SPEC(ctx)->docs, cr->docId);
+    // the document may have been deleted while we were switched out
+    if (!dmd || (dmd->flags & Document_Deleted)) {
+      continue;
+    }
+
+    res->docId = cr->docId;
+    res->indexResult = NULL;
+    res->score = cr->score;
+    res->sv = dmd->sortVector;
+    res->md = dmd;
+    if (res->fields != NULL) {
+      res->fields->len = 0;
+    }
+    return RS_RESULT_OK;
+  }
+  return RS_RESULT_EOF;
+}
+
+/* Create a processor yielding cached results. The results are owned by the caller */
+ResultProcessor *NewCachedResultsProcessor(QueryProcessingCtx *xc, QueryCacheValue *val) {
+  struct cachedResultsCtx *cc = malloc(sizeof(*cc));
+  cc->val = val;
+  cc->pos = 0;
+  xc->totalResults = val->totalResults;
+
+  ResultProcessor *rp = NewResultProcessor(NULL, cc);
+  rp->ctx.qxc = xc;
+  rp->Next = cachedResults_Next;
+  rp->Free = ResultProcessor_GenericFree;
+  return rp;
+}
+
+/*******************************************************************************************************************
+ *  Cache Writer Processor
+ *
+ * Placed after the sorter, it records the ids and scores of the top results it passes downstream,
+ * and stores them in the query cache once it has seen all the results the request asked for. The
+ * sorter drains the index before yielding its first result, so by then the total is known
+ *******************************************************************************************************************/
+
+struct cacheWriterCtx {
+  RSSearchRequest *req;
+  QueryCacheValue val;
+  // the allocated size of val.results
+  size_t alloc;
+  // the number of results the request asked for
+  size_t cap;
+  int done;
+};
+
+static void cacheWriter_Store(ResultProcessorCtx *ctx, struct cacheWriterCtx *wc) {
+  wc->done = 1;
+  QueryProcessingCtx *qxc = ctx->qxc;
+  IndexSpec *sp = RP_SPEC(ctx);
+
+  // partial results of timed out or budgeted queries are not cached, and neither are results that
+  // may have been computed across a write to the index
+  if (!sp || !sp->queryCache || qxc->state != QPState_Running || qxc->maxDocsScanned ||
+      sp->revision != wc->req->cacheRevision) {
+    return;
+  }
+
+  wc->val.totalResults = qxc->totalResults;
+  QueryCache_Put(sp->queryCache, wc->req->cacheKey, sdslen(wc->req->cacheKey), sp->revision,
+                 &wc->val);
+  wc->val.results = NULL;
+}
+
+int cacheWriter_Next(ResultProcessorCtx *ctx, SearchResult *res) {
+  struct cacheWriterCtx *wc = ctx->privdata;
+
+  if (ResultProcessor_Next(ctx->upstream, res, 1) == RS_RESULT_EOF) {
+    if (!wc->done) cacheWriter_Store(ctx, wc);
+    return RS_RESULT_EOF;
+  }
+
+  if (!wc->done) {
+    if (wc->val.numResults < wc->cap) {
+      if (wc->val.numResults == wc->alloc) {
+        wc->alloc = wc->alloc ? wc->alloc * 2 : 16;
+        wc->val.results = realloc(wc->val.results, wc->alloc * sizeof(QueryCacheResult));
+      }
+      wc->val.results[wc->val.numResults++] =
+          (QueryCacheResult){.docId = res->docId, .score = res->score};
+    }
+    if (wc->val.numResults == wc->cap) {
+      cacheWriter_Store(ctx, wc);
+    }
+  }
+  return RS_RESULT_OK;
+}
+
+static void cacheWriter_Free(ResultProcessor *rp) {
+  struct cacheWriterCtx *wc = rp->ctx.privdata;
+  free(wc->val.results);
+  ResultProcessor_GenericFree(rp);
+}
+
+/* Create a processor caching the top results of a search, up to the number the request asked for */
+ResultProcessor *NewCacheWriter(ResultProcessor *upstream, RSSearchRequest *req, size_t cap) {
+  struct cacheWriterCtx *wc = calloc(1, sizeof(*wc));
+  wc->req = req;
+  wc->cap = cap;
+
+  ResultProcessor *rp = NewResultProcessor(upstream, wc);
+  rp->Next = cacheWriter_Next;
+  rp->Free = cacheWriter_Free;
+  return rp;
+}
+
 /*******************************************************************************************************************
  * Building the processor chaing based on the processors available and the request parameters
  *******************************************************************************************************************/
 ResultProcessor *Query_BuildProcessorChain(QueryPlan *q, void *privdata, char **err) {
   *err = NULL;
   RSSearchRequest *req = privdata;
-  // The base processor translates index results into search results
-  ResultProcessor *next = NewBaseProcessor(q, &q->execCtx);
+  ResultProcessor *next;
 
-  // If we are not in SORTBY mode - add a scorer to the chain
-  if (q->opts.sortBy == NULL) {
-    next = NewScorer(q->opts.scorer, next, req);
-    // Scorers usually need the index results, let's tell the query plan that
-    q->opts.needIndexResult = 1;
-  }
+  if (req->cached) {
+    // The results were found in the query cache, already scored and sorted
+    next = NewCachedResultsProcessor(&q->execCtx, req->cached);
+  } else {
+    // The base processor translates index results into search results
+    next = NewBaseProcessor(q, &q->execCtx);
+
+    // If we are not in SORTBY mode - add a scorer to the chain
+    if (q->opts.sortBy == NULL) {
+      next = NewScorer(q->opts.scorer, next, req);
+      // Scorers usually need the index results, let's tell the query plan that
+      q->opts.needIndexResult = 1;
+    }
+
+    // The sorter sorts the top-N results
+    next = NewSorter(q->opts.sortBy ? Sort_BySortKey : Sort_ByScore, q->opts.sortBy,
+                     q->opts.offset + q->opts.num, next, req->opts.fields.wantSummaries);
 
-  // The sorter sorts the top-N results
-  next = NewSorter(q->opts.sortBy ? Sort_BySortKey : Sort_ByScore, q->opts.sortBy,
-                   q->opts.offset + q->opts.num, next, req->opts.fields.wantSummaries);
+    // Cache the top-N results for the next time the same search is made
+    if (req->cacheKey) {
+      next = NewCacheWriter(next, req, q->opts.offset + q->opts.num);
+    }
+  }
 
   // The pager pages over the results of the sorter
   next = NewPager(next, q->opts.offset, q->opts.num);
@@ -56,6 +56,15 @@ typedef struct {
 
   struct timespec startTime;
 
+  // the estimated cost of the query, in index entries it may read
+  size_t cost;
+  // the number of documents read from the root filter so far
+  size_t docsScanned;
+  // if not 0, stop reading the root filter after this many documents
+  size_t maxDocsScanned;
+  // the CPU time spent on the query so far, in nanoseconds
+  uint64_t cpuTimeNS;
+
 } QueryProcessingCtx;
 
 static inline RSSortingTable *QueryProcessingCtx_GetSortingTable(QueryProcessingCtx *c) {
@@ -301,6 +301,15 @@ void RSSearchRequest_Free(RSSearchRequest *req) {
 
   FieldList_Free(&req->opts.fields);
 
+  if (req->cacheKey) {
+    sdsfree(req->cacheKey);
+  }
+
+  if (req->cached) {
+    free(req->cached->results);
+    free(req->cached);
+  }
+
   free(req);
 }
 
@@ -342,8 +351,47 @@ QueryParseCtx *SearchRequest_ParseQuery(RedisSearchCtx *sctx, RSSearchRequest *r
   return q;
 }
 
+/* The key of a request in the query cache - the query tree, and the options affecting which results
+ * are returned and in what order. Options affecting only the output, such as WITHSCORES or
+ * LIMIT, are not part of the key */
+static sds searchRequest_CacheKey(RSSearchRequest *req, QueryParseCtx *q) {
+  RSSearchOptions *opts = &req->opts;
+  sds s = Query_CacheKey(q, sdsempty());
+
+  s = sdscatlen(s, &opts->fieldMask, sizeof(opts->fieldMask));
+  int flags = opts->flags & (Search_Verbatim | Search_NoStopwrods | Search_InOrder);
+  s = sdscatprintf(s, "|%d|%d|", flags, opts->slop);
+  if (opts->sortBy) {
+    s = sdscatprintf(s, "%d/%d|", opts->sortBy->index, opts->sortBy->ascending);
+  }
+  s = sdscatprintf(s, "%s|%s|%zu:", opts->scorer ? opts->scorer : "",
+                   opts->language ? opts->language : "", req->payload.len);
+  if (req->payload.len) {
+    s = sdscatlen(s, req->payload.data, req->payload.len);
+  }
+  return s;
+}
+
 QueryPlan *SearchRequest_BuildPlan(RedisSearchCtx *sctx, RSSearchRequest *req, QueryParseCtx *q,
                                    char **err) {
   if (!q) return NULL;
+
+  // Highlighting and summarizing need the term offsets of the index results, which are not cached
+  if (RSGlobalConfig.queryCacheMaxMemory && sctx->spec && !req->opts.fields.wantSummaries) {
+    req->cacheKey = searchRequest_CacheKey(req, q);
+    req->cacheRevision = sctx->spec->revision;
+
+    if (!sctx->spec->queryCache) {
+      sctx->spec->queryCache = NewQueryCache(RSGlobalConfig.queryCacheMaxMemory);
+    }
+    QueryCacheValue val;
+    if (QueryCache_Get(sctx->spec->queryCache, req->cacheKey, sdslen(req->cacheKey),
+                       req->cacheRevision, req->opts.offset + req->opts.num, &val)) {
+      req->cached = malloc(sizeof(*req->cached));
+      *req->cached = val;
+      // no need to evaluate the query
+      return Query_BuildPlan(sctx, NULL, &req->opts, Query_BuildProcessorChain, req, err);
+    }
+  }
   return Query_BuildPlan(sctx, q, &req->opts, Query_BuildProcessorChain, req, err);
 }
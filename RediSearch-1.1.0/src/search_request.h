@@ -28,6 +28,15 @@ typedef struct {
 
   RSPayload payload;
 
+  /* The key of the request in the query cache, or NULL if its results are not cached */
+  sds cacheKey;
+
+  /* The revision of the index when the request was looked up in the query cache */
+  uint64_t cacheRevision;
+
+  /* The cached results of the request, if it was found in the query cache */
+  QueryCacheValue *cached;
+
 } RSSearchRequest;
 
 RSSearchRequest *ParseRequest(RedisSearchCtx *ctx, RedisModuleString **argv, int argc,
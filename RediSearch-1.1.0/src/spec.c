@@ -154,6 +154,9 @@ int __parseFieldSpec(const char **argv, int *offset, int argc, FieldSpec *sp, ch
       if (!strcasecmp(argv[*offset], SPEC_NOSTEM_STR)) {
         sp->options |= FieldSpec_NoStemming;
 
+      } else if (!strcasecmp(argv[*offset], SPEC_SHINGLES_STR)) {
+        sp->options |= FieldSpec_Shingles;
+
       } else if (!strcasecmp(argv[*offset], SPEC_WEIGHT_STR)) {
         // weight with no value is invalid
         if (++*offset == argc) {
@@ -420,6 +423,7 @@ char *IndexSpec_GetRandomTerm(IndexSpec *sp, size_t sampleSize) {
 
 void IndexSpec_Free(void *ctx) {
   IndexSpec *spec = ctx;
+  ConcurrentSearch_AdvanceEpoch();
 
   if (spec->gc) {
     GC_Stop(spec->gc);
@@ -428,6 +432,8 @@ void IndexSpec_Free(void *ctx) {
   if (spec->terms) {
     TrieType_Free(spec->terms);
   }
+  PrefixCache_Free(spec->prefixCache);
+  QueryCache_Free(spec->queryCache);
   DocTable_Free(&spec->docs);
   if (spec->fields != NULL) {
     for (int i = 0; i < spec->numFields; i++) {
@@ -522,9 +528,14 @@ IndexSpec *NewIndexSpec(const char *name, size_t numFields) {
   sp->docs = NewDocTable(100);
   sp->stopwords = DefaultStopWordList();
   sp->terms = NewTrie();
+  sp->prefixCache = NULL;
+  sp->revision = 0;
+  sp->scoreRevision = 0;
+  sp->queryCache = NULL;
   sp->sortables = NULL;
   sp->gc = NULL;
   memset(&sp->stats, 0, sizeof(sp->stats));
+  memset(&sp->queryStats, 0, sizeof(sp->queryStats));
   return sp;
 }
 
@@ -651,10 +662,15 @@ void *IndexSpec_RdbLoad(RedisModuleIO *rdb, int encver) {
   RedisModuleCtx *ctx = RedisModule_GetContextFromIO(rdb);
   IndexSpec *sp = rm_malloc(sizeof(IndexSpec));
   sp->terms = NULL;
+  sp->prefixCache = NULL;
+  sp->revision = 0;
+  sp->scoreRevision = 0;
+  sp->queryCache = NULL;
   sp->docs = NewDocTable(1000);
   sp->sortables = NULL;
   sp->name = RedisModule_LoadStringBuffer(rdb, NULL);
   sp->gc = NULL;
+  memset(&sp->queryStats, 0, sizeof(sp->queryStats));
   sp->flags = (IndexFlags)RedisModule_LoadUnsigned(rdb);
   if (encver < INDEX_MIN_NOFREQ_VERSION) {
     sp->flags |= Index_StoreFreqs;
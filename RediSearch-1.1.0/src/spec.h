@@ -9,6 +9,8 @@
 #include "sortable.h"
 #include "stopwords.h"
 #include "gc.h"
+#include "prefix_cache.h"
+#include "query_cache.h"
 
 typedef enum fieldType { FIELD_FULLTEXT, FIELD_NUMERIC, FIELD_GEO, FIELD_TAG } FieldType;
 
@@ -23,6 +25,7 @@ typedef enum fieldType { FIELD_FULLTEXT, FIELD_NUMERIC, FIELD_GEO, FIELD_TAG } F
 #define SPEC_TEXT_STR "TEXT"
 #define SPEC_WEIGHT_STR "WEIGHT"
 #define SPEC_NOSTEM_STR "NOSTEM"
+#define SPEC_SHINGLES_STR "SHINGLES"
 #define SPEC_TAG_STR "TAG"
 #define SPEC_SORTABLE_STR "SORTABLE"
 #define SPEC_STOPWORDS_STR "STOPWORDS" //ֹͣʣ""""ȣĵڸôʣԵЩ
@@ -45,7 +48,9 @@ static const char *SpecTypeNames[] = {[FIELD_FULLTEXT] = SPEC_TEXT_STR,
 typedef enum {
   FieldSpec_Sortable = 0x01,
   FieldSpec_NoStemming = 0x02,
-  FieldSpec_NotIndexable = 0x04
+  FieldSpec_NotIndexable = 0x04,
+  // index the pairs of adjacent words of a text field, to speed up exact phrase searches
+  FieldSpec_Shingles = 0x08
 } FieldSpecOptions;
 
 // Specific options for text fields
@@ -97,6 +102,7 @@ typedef struct fieldSpec { //
 
 #define FieldSpec_IsSortable(fs) ((fs)->options & FieldSpec_Sortable)
 #define FieldSpec_IsNoStem(fs) ((fs)->options & FieldSpec_NoStemming)
+#define FieldSpec_IsShingled(fs) ((fs)->options & FieldSpec_Shingles)
 #define FieldSpec_IsIndexable(fs) (0 == ((fs)->options & FieldSpec_NotIndexable))
 
 typedef struct { //״̬
@@ -112,6 +118,20 @@ typedef struct { //
   size_t termsSize;
 } IndexStats;
 
+/* Query accounting, kept in memory only */
+typedef struct {
+  // the number of queries admitted for execution
+  size_t numQueries;
+  // queries rejected because their estimated cost exceeded MAXQUERYCOST
+  size_t numRejected;
+  // queries admitted with a scan budget because their estimated cost exceeded MAXQUERYCOST
+  size_t numDegraded;
+  // documents read from the root filters of the queries
+  size_t docsScanned;
+  // CPU time spent building and running the queries, in nanoseconds
+  uint64_t cpuTimeNS;
+} QueryStats;
+
 typedef enum {
   Index_StoreTermOffsets = 0x01,
   Index_StoreFieldFlags = 0x02,
@@ -167,9 +187,20 @@ typedef struct { //
   int numFields; //ǰдŵҲָfieldsǰٸԪЧ
 
   IndexStats stats;
+  QueryStats queryStats;
   IndexFlags flags; //־Ƿ֧offsetȣ־ɰλ
 
   Trie *terms;
+  // cached expansions of prefix queries on the terms trie. NULL until the first prefix query
+  PrefixCache *prefixCache;
+
+  // incremented on every write to the index, so cached query results can tell they are stale
+  uint64_t revision;
+  // incremented when the score of a document is raised without reindexing it, so the champion
+  // tiers of the terms can tell their impacts may be stale
+  uint32_t scoreRevision;
+  // cached results of searches. NULL until the first cacheable search
+  QueryCache *queryCache;
 
   RSSortingTable *sortables;
 
@@ -2,7 +2,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/param.h>
+#include <pthread.h>
 #include "dep/snowball/include/libstemmer.h"
+#include "util/khash.h"
+#include "util/fnv.h"
 
 const char *__supportedLanguages[] = {"arabic",     "danish",   "dutch",     "english", "finnish",
                                       "french",     "german",   "hungarian", "italian", "norwegian",
@@ -19,15 +22,93 @@ int IsSupportedLanguage(const char *language, size_t len) {
   return 0;
 }
 
+typedef struct {
+  const char *str;
+  size_t len;
+} stemKey;
+
+typedef struct {
+  // the stem with its '+' prefix, or NULL if the word stems to itself
+  const char *stem;
+  size_t len;
+} stemValue;
+
+static inline khint_t stemKey_hash(stemKey k) {
+  return rs_fnv_32a_buf((void *)k.str, k.len, 0);
+}
+
+static inline int stemKey_equal(stemKey a, stemKey b) {
+  return a.len == b.len && !memcmp(a.str, b.str, a.len);
+}
+
+KHASH_INIT(stemCache, stemKey, stemValue, 1, stemKey_hash, stemKey_equal);
+
+// stem cache stats of all the stemmers, updated from the indexing threads
+static StemCacheStats stemCacheStats_g = {0};
+
+void Stemmer_GetCacheStats(StemCacheStats *stats) {
+  stats->hits = __atomic_load_n(&stemCacheStats_g.hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n(&stemCacheStats_g.misses, __ATOMIC_RELAXED);
+  stats->entries = __atomic_load_n(&stemCacheStats_g.entries, __ATOMIC_RELAXED);
+  stats->memory = __atomic_load_n(&stemCacheStats_g.memory, __ATOMIC_RELAXED);
+}
+
 struct sbStemmerCtx {
   struct sb_stemmer *sb;
   char *buf;
   size_t cap;
+
+  khash_t(stemCache) * cache;
+  // the bytes taken by the cached words and stems
+  size_t cacheMem;
 };
 
-const char *__sbstemmer_Stem(void *ctx, const char *word, size_t len, size_t *outlen) {
+// the memory a cached word takes, including its hash table slot
+#define STEM_CACHE_ENTRY_SIZE(wordLen, stemLen) \
+  ((wordLen) + (stemLen) + 2 + sizeof(stemKey) + sizeof(stemValue))
+
+static void stemCache_Clear(struct sbStemmerCtx *ctx) {
+  khiter_t it;
+  for (it = kh_begin(ctx->cache); it != kh_end(ctx->cache); ++it) {
+    if (kh_exist(ctx->cache, it)) {
+      free((char *)kh_key(ctx->cache, it).str);
+    }
+  }
+  __atomic_fetch_sub(&stemCacheStats_g.entries, kh_size(ctx->cache), __ATOMIC_RELAXED);
+  __atomic_fetch_sub(&stemCacheStats_g.memory, ctx->cacheMem, __ATOMIC_RELAXED);
+  kh_clear(stemCache, ctx->cache);
+  ctx->cacheMem = 0;
+}
+
+/* Cache the stem of a word. The word and stem are copied into a single allocation */
+static void stemCache_Put(struct sbStemmerCtx *ctx, const char *word, size_t len, const char *stem,
+                          size_t stemLen) {
+  size_t mem = STEM_CACHE_ENTRY_SIZE(len, stemLen);
+  if (kh_size(ctx->cache) >= STEM_CACHE_MAX_ENTRIES || ctx->cacheMem + mem > STEM_CACHE_MAX_BYTES) {
+    stemCache_Clear(ctx);
+  }
+
+  char *buf = malloc(len + stemLen + 2);
+  memcpy(buf, word, len);
+  buf[len] = '\0';
+  stemValue val = {.stem = NULL, .len = 0};
+  if (stem) {
+    memcpy(buf + len + 1, stem, stemLen);
+    buf[len + 1 + stemLen] = '\0';
+    val = (stemValue){.stem = buf + len + 1, .len = stemLen};
+  }
+
+  int rc;
+  khiter_t it = kh_put(stemCache, ctx->cache, ((stemKey){.str = buf, .len = len}), &rc);
+  kh_val(ctx->cache, it) = val;
+  ctx->cacheMem += mem;
+  __atomic_fetch_add(&stemCacheStats_g.entries, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stemCacheStats_g.memory, mem, __ATOMIC_RELAXED);
+}
+
+static const char *sbstemmer_StemUncached(struct sbStemmerCtx *stctx, const char *word, size_t len,
+                                          size_t *outlen) {
   const sb_symbol *b = (const sb_symbol *)word;
-  struct sbStemmerCtx *stctx = ctx;
   struct sb_stemmer *sb = stctx->sb;
 
   const sb_symbol *stemmed = sb_stemmer_stem(sb, b, (int)len);
@@ -53,11 +134,34 @@ const char *__sbstemmer_Stem(void *ctx, const char *word, size_t len, size_t *ou
   return NULL;
 }
 
+const char *__sbstemmer_Stem(void *ctx, const char *word, size_t len, size_t *outlen) {
+  struct sbStemmerCtx *stctx = ctx;
+  if (len > STEM_CACHE_MAX_WORD_LEN) {
+    return sbstemmer_StemUncached(stctx, word, len, outlen);
+  }
+
+  khiter_t it = kh_get(stemCache, stctx->cache, ((stemKey){.str = word, .len = len}));
+  if (it != kh_end(stctx->cache)) {
+    __atomic_fetch_add(&stemCacheStats_g.hits, 1, __ATOMIC_RELAXED);
+    stemValue *val = &kh_val(stctx->cache, it);
+    *outlen = val->len;
+    return val->stem;
+  }
+
+  __atomic_fetch_add(&stemCacheStats_g.misses, 1, __ATOMIC_RELAXED);
+  const char *stem = sbstemmer_StemUncached(stctx, word, len, outlen);
+  stemCache_Put(stctx, word, len, stem, stem ? *outlen : 0);
+  return stem;
+}
+
 void __sbstemmer_Free(Stemmer *s) {
   struct sbStemmerCtx *ctx = s->ctx;
   sb_stemmer_delete(ctx->sb);
+  stemCache_Clear(ctx);
+  kh_destroy(stemCache, ctx->cache);
   free(ctx->buf);
   free(ctx);
+  free(s->language);
   free(s);
 }
 
@@ -73,9 +177,12 @@ Stemmer *__newSnowballStemmer(const char *language) {
   ctx->cap = 24;
   ctx->buf = malloc(ctx->cap);
   ctx->buf[0] = STEM_PREFIX;
+  ctx->cache = kh_init(stemCache);
+  ctx->cacheMem = 0;
 
   Stemmer *ret = malloc(sizeof(Stemmer));
   ret->ctx = ctx;
+  ret->language = strdup(language);
   ret->Stem = __sbstemmer_Stem;
   ret->Free = __sbstemmer_Free;
   return ret;
@@ -91,3 +198,53 @@ Stemmer *NewStemmer(StemmerType type, const char *language) {
   fprintf(stderr, "Invalid stemmer type");
   return NULL;
 }
+
+typedef struct {
+  char *language;
+  // NULL if there is no stemmer for the language
+  Stemmer *stemmer;
+} threadStemmer;
+
+typedef struct {
+  threadStemmer *stemmers;
+  size_t num;
+} threadStemmers;
+
+static pthread_key_t threadStemmersKey_g;
+
+static void threadStemmersDtor(void *p) {
+  threadStemmers *ts = p;
+  for (size_t i = 0; i < ts->num; i++) {
+    free(ts->stemmers[i].language);
+    if (ts->stemmers[i].stemmer) {
+      ts->stemmers[i].stemmer->Free(ts->stemmers[i].stemmer);
+    }
+  }
+  free(ts->stemmers);
+  free(ts);
+}
+
+static void __attribute__((constructor)) initThreadStemmersKey() {
+  pthread_key_create(&threadStemmersKey_g, threadStemmersDtor);
+}
+
+Stemmer *GetThreadStemmer(const char *language) {
+  threadStemmers *ts = pthread_getspecific(threadStemmersKey_g);
+  if (ts == NULL) {
+    ts = calloc(1, sizeof(*ts));
+    pthread_setspecific(threadStemmersKey_g, ts);
+  }
+
+  // a thread only ever sees a few languages, so a linear scan will do
+  for (size_t i = 0; i < ts->num; i++) {
+    if (!strcasecmp(ts->stemmers[i].language, language)) {
+      return ts->stemmers[i].stemmer;
+    }
+  }
+
+  ts->stemmers = realloc(ts->stemmers, (ts->num + 1) * sizeof(*ts->stemmers));
+  threadStemmer *t = &ts->stemmers[ts->num++];
+  t->language = strdup(language);
+  t->stemmer = NewStemmer(SnowballStemmer, language);
+  return t->stemmer;
+}
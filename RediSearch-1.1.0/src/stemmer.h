@@ -12,12 +12,37 @@ typedef enum { SnowballStemmer } StemmerType;
  * stemmer libs */
 typedef struct stemmer {
   void *ctx;
+  // the language the stemmer was created for
+  char *language;
   const char *(*Stem)(void *ctx, const char *word, size_t len, size_t *outlen);
   void (*Free)(struct stemmer *);
 } Stemmer;
 
 Stemmer *NewStemmer(StemmerType type, const char *language);
 
+/* Get a stemmer owned by the calling thread, created on the first call with the language, and
+ * kept until the thread exits. Returns NULL if there is no stemmer for the language. Callers must
+ * not free it */
+Stemmer *GetThreadStemmer(const char *language);
+
+/* Snowball stemmers keep a cache of the stems of the words they see, including words that stem to
+ * themselves. Words longer than STEM_CACHE_MAX_WORD_LEN are not cached, and when a cache reaches
+ * STEM_CACHE_MAX_ENTRIES words or STEM_CACHE_MAX_BYTES bytes it is cleared and starts over */
+#define STEM_CACHE_MAX_ENTRIES 4096
+#define STEM_CACHE_MAX_BYTES (256 * 1024)
+#define STEM_CACHE_MAX_WORD_LEN 32
+
+typedef struct {
+  size_t hits;
+  size_t misses;
+  // the words currently cached, and the memory they take
+  size_t entries;
+  size_t memory;
+} StemCacheStats;
+
+/* Get the stem cache stats, summed over all stemmers */
+void Stemmer_GetCacheStats(StemCacheStats *stats);
+
 /* check if a language is supported by our stemmers */
 int IsSupportedLanguage(const char *language, size_t len);
 
@@ -1,16 +1,92 @@
 #define __REDISEARCH_STOPORWORDS_C__
 #include "stopwords.h"
-#include "dep/triemap/triemap.h"
 #include "rmalloc.h"
+#include "util/fnv.h"
 #include <ctype.h>
+#include <string.h>
+#include <sys/param.h>
 
 #define MAX_STOPWORDLIST_SIZE 1024
 
+/* Stopword lists never change once created, so they are compiled into an open addressing hash
+ * table, kept at most half full. Most tokens are rejected by the length mask without hashing, and
+ * the rest usually by comparing the length and first bytes of a single slot, before any memcmp */
+typedef struct {
+  // NULL for an empty slot
+  const char *str;
+  uint32_t len;
+  // the first (up to) 4 bytes of the word, zero padded
+  uint32_t prefix;
+} stopWordSlot;
+
 typedef struct StopWordList {
-  TrieMap *m;
+  // the words, in the order they were added. The slots point into them
+  char **words;
+  size_t numWords;
+
+  stopWordSlot *slots;
+  uint32_t mask;
+  // bit i is set if there is a word of length i. Words of 63 bytes and up all set bit 63
+  uint64_t lengths;
+
   size_t refcount;
 } StopWordList;
 
+#define STOPWORD_LENGTH_BIT(len) (1ULL << MIN(len, 63))
+
+static inline uint32_t stopWord_Hash(const char *str, size_t len, uint32_t *prefix) {
+  uint32_t p = 0;
+  memcpy(&p, str, MIN(len, 4));
+  *prefix = p;
+  return rs_fnv_32a_buf((void *)str, len, 0);
+}
+
+static int stopWordList_Find(StopWordList *sl, const char *term, size_t len) {
+  uint32_t prefix;
+  uint32_t i = stopWord_Hash(term, len, &prefix) & sl->mask;
+  for (stopWordSlot *slot = &sl->slots[i]; slot->str; slot = &sl->slots[i]) {
+    if (slot->len == len && slot->prefix == prefix && !memcmp(slot->str, term, len)) {
+      return 1;
+    }
+    i = (i + 1) & sl->mask;
+  }
+  return 0;
+}
+
+/* Create an empty list with room for up to maxWords words */
+static StopWordList *newStopWordList(size_t maxWords) {
+  StopWordList *sl = rm_malloc(sizeof(*sl));
+  sl->refcount = 1;
+  sl->words = rm_malloc(MAX(maxWords, 1) * sizeof(*sl->words));
+  sl->numWords = 0;
+  sl->lengths = 0;
+
+  size_t cap = 4;
+  while (cap < maxWords * 2) {
+    cap *= 2;
+  }
+  sl->slots = rm_calloc(cap, sizeof(*sl->slots));
+  sl->mask = cap - 1;
+  return sl;
+}
+
+/* Add a word to the list, taking ownership of it. Duplicates are freed */
+static void stopWordList_Add(StopWordList *sl, char *str, size_t len) {
+  if (stopWordList_Find(sl, str, len)) {
+    rm_free(str);
+    return;
+  }
+  sl->words[sl->numWords++] = str;
+  sl->lengths |= STOPWORD_LENGTH_BIT(len);
+
+  uint32_t prefix;
+  uint32_t i = stopWord_Hash(str, len, &prefix) & sl->mask;
+  while (sl->slots[i].str) {
+    i = (i + 1) & sl->mask;
+  }
+  sl->slots[i] = (stopWordSlot){.str = str, .len = len, .prefix = prefix};
+}
+
 StopWordList *__default_stopwords = NULL;
 StopWordList *__empty_stopwords = NULL;
 
@@ -31,11 +107,11 @@ StopWordList *EmptyStopWordList() {
 
 /* Check if a stopword list contains a term. The term must be already lowercased */
 int StopWordList_Contains(StopWordList *sl, const char *term, size_t len) {
-  if (!sl || !term) {
+  if (!sl || !term || !(sl->lengths & STOPWORD_LENGTH_BIT(len))) {
     return 0;
   }
 
-  return TrieMap_Find(sl->m, (char *)term, len) != TRIEMAP_NOTFOUND;
+  return stopWordList_Find(sl, term, len);
 }
 
 /* Create a new stopword list from a list of redis strings */
@@ -56,13 +132,11 @@ StopWordList *NewStopWordListCStr(const char **strs, size_t len) {
   if (len > MAX_STOPWORDLIST_SIZE) {
     len = MAX_STOPWORDLIST_SIZE;
   }
-  StopWordList *sl = rm_malloc(sizeof(*sl));
-  sl->refcount = 1;
-  sl->m = NewTrieMap();
+  StopWordList *sl = newStopWordList(len);
 
   for (size_t i = 0; i < len; i++) {
 
-    char *t = strdup(strs[i]);
+    char *t = rm_strdup(strs[i]);
     if (t == NULL) {
       break;
     }
@@ -75,8 +149,7 @@ StopWordList *NewStopWordListCStr(const char **strs, size_t len) {
       }
     }
     // printf("Adding stopword %s\n", t);
-    TrieMap_Add(sl->m, t, tlen, NULL, NULL);
-    free(t);
+    stopWordList_Add(sl, t, tlen);
   }
   return sl;
 }
@@ -95,23 +168,26 @@ void StopWordList_Unref(StopWordList *sl) {
     return;
   }
 
-  if (sl) {
-    TrieMap_Free(sl->m, NULL);
+  for (size_t i = 0; i < sl->numWords; i++) {
+    rm_free(sl->words[i]);
   }
+  rm_free(sl->words);
+  rm_free(sl->slots);
   rm_free(sl);
 }
 
 /* Load a stopword list from RDB */
 StopWordList *StopWordList_RdbLoad(RedisModuleIO *rdb, int encver) {
   uint64_t elements = RedisModule_LoadUnsigned(rdb);
-  StopWordList *sl = rm_malloc(sizeof(*sl));
-  sl->m = NewTrieMap();
-  sl->refcount = 1;
+  StopWordList *sl = newStopWordList(elements);
 
   while (elements--) {
     size_t len;
     char *str = RedisModule_LoadStringBuffer(rdb, &len);
-    TrieMap_Add(sl->m, str, len, NULL, NULL);
+    char *t = rm_malloc(len + 1);
+    memcpy(t, str, len);
+    t[len] = '\0';
+    stopWordList_Add(sl, t, len);
     RedisModule_Free(str);
   }
 
@@ -121,14 +197,8 @@ StopWordList *StopWordList_RdbLoad(RedisModuleIO *rdb, int encver) {
 /* Save a stopword list to RDB */
 void StopWordList_RdbSave(RedisModuleIO *rdb, StopWordList *sl) {
 
-  RedisModule_SaveUnsigned(rdb, sl->m->cardinality);
-  TrieMapIterator *it = TrieMap_Iterate(sl->m, "", 0);
-  char *str;
-  tm_len_t len;
-  void *ptr;
-
-  while (TrieMapIterator_Next(it, &str, &len, &ptr)) {
-    RedisModule_SaveStringBuffer(rdb, str, len);
+  RedisModule_SaveUnsigned(rdb, sl->numWords);
+  for (size_t i = 0; i < sl->numWords; i++) {
+    RedisModule_SaveStringBuffer(rdb, sl->words[i], strlen(sl->words[i]));
   }
-  TrieMapIterator_Free(it);
 }
@@ -14,6 +14,8 @@
 TagIndex *NewTagIndex() {
   TagIndex *idx = rm_new(TagIndex);
   idx->values = NewTrieMap();
+  idx->revision = 0;
+  idx->prefixCache = NULL;
   return idx;
 }
 
@@ -70,18 +72,24 @@ char **TagIndex_Preprocess(const TagFieldOptions *opts, const DocumentField *dat
     // this means we're at the end
     if (tok == NULL) break;
     if (toklen > 0) {
-      // lowercase the string (TODO: non latin lowercase)
-      if (!(opts->flags & TagField_CaseSensitive)) {
-        tok = strtolower(tok);
-      }
-      tok = strndup(tok, MIN(toklen, MAX_TAG_LEN));
-      ret = array_append(ret, tok);
+      ret = array_append(ret, TagIndex_PreprocessValue(opts, tok, toklen, &toklen));
     }
   }
   free(pp);
   return ret;
 }
 
+char *TagIndex_PreprocessValue(const TagFieldOptions *opts, const char *value, size_t len,
+                               size_t *outLen) {
+  char *tok = strndup(value, MIN(len, MAX_TAG_LEN));
+  // lowercase the string (TODO: non latin lowercase)
+  if (!(opts->flags & TagField_CaseSensitive)) {
+    tok = strtolower(tok);
+  }
+  *outLen = strlen(tok);
+  return tok;
+}
+
 /* Ecode a single docId into a specific tag value */
 static inline size_t tagIndex_Put(TagIndex *idx, char *value, size_t len, t_docId docId) {
 
@@ -89,6 +97,7 @@ static inline size_t tagIndex_Put(TagIndex *idx, char *value, size_t len, t_docI
   if (iv == TRIEMAP_NOTFOUND) {
     iv = NewInvertedIndex(Index_DocIdsOnly, 1);
     TrieMap_Add(idx->values, value, len, iv, NULL);
+    idx->revision++;
   }
 
   IndexEncoder enc = InvertedIndex_GetEncoder(Index_DocIdsOnly);
@@ -178,7 +187,8 @@ IndexIterator *TagIndex_OpenReader(TagIndex *idx, DocTable *dt, const char *valu
     tc->idx = idx;
     tc->it = it;
     ConcurrentSearch_AddKey(csx, k, REDISMODULE_READ, keyName, TagReader_OnReopen, tc, free,
-                            ConcurrentKey_SharedKey | ConcurrentKey_SharedKeyString);
+                            ConcurrentKey_SharedKey | ConcurrentKey_SharedKeyString |
+                                ConcurrentKey_Versioned);
   }
 
   return it;
@@ -277,7 +287,9 @@ void TagIndex_Digest(RedisModuleDigest *digest, void *value) {
 
 void TagIndex_Free(void *p) {
   TagIndex *idx = p;
+  ConcurrentSearch_AdvanceEpoch();
   TrieMap_Free(idx->values, InvertedIndex_Free);
+  PrefixCache_Free(idx->prefixCache);
   rm_free(idx);
 }
 
@@ -6,6 +6,7 @@
 #include "document.h"
 #include "value.h"
 #include "geo_index.h"
+#include "prefix_cache.h"
 
 /**
  * A Tag Index is an index that indexes textual tags for documents, in a simple manner than a full
@@ -88,6 +89,10 @@
  */
 typedef struct {
   TrieMap *values;
+  // incremented whenever a new value is added, to invalidate cached prefix expansions
+  uint64_t revision;
+  // cached expansions of prefix queries on the values. NULL until the first prefix query
+  PrefixCache *prefixCache;
 } TagIndex;
 
 #define TAG_INDEX_KEY_FMT "tag:%s/%s"
@@ -100,6 +105,11 @@ TagIndex *NewTagIndex();
 /* Preprocess a document tag field, returning a vector of all tags split from the content */
 char **TagIndex_Preprocess(const TagFieldOptions *opts, const DocumentField *data);
 
+/* Preprocess a single tag value the way tags are indexed, returning a new string and putting its
+ * length in outLen */
+char *TagIndex_PreprocessValue(const TagFieldOptions *opts, const char *value, size_t len,
+                               size_t *outLen);
+
 /* Index a vector of pre-processed tags for a docId */
 size_t TagIndex_Index(TagIndex *idx, char **values, t_docId docId);
 
@@ -1,12 +1,14 @@
 #include <rmutil/alloc.h>
 
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 #include <aggregate/aggregate.h>
 #include <aggregate/reducer.h>
 #include "test_util.h"
 #include "time_sample.h"
 #include <util/arr.h>
+#include <dep/hll/hll.h>
 
 struct mockProcessorCtx {
   int counter;
@@ -292,6 +294,199 @@ int testRevertToBasic() {
   RETURN_TEST_SUCCESS;
 }
 */
+int testFilter() {
+  char *err = NULL;
+  AggregateFilterPredicate *preds =
+      AggregateFilter_Parse("@score >= 10 && @score < 20 && @value != 'bar'", &err);
+  ASSERT(preds);
+  ASSERT(!err);
+  ASSERT_EQUAL(3, array_len(preds));
+  ASSERT_STRING_EQ("score", preds[0].property.key);
+  ASSERT_EQUAL(FilterOp_Ge, preds[0].op);
+  ASSERT_EQUAL(FilterOp_Lt, preds[1].op);
+  ASSERT_EQUAL(FilterOp_Ne, preds[2].op);
+  ASSERT(RSValue_IsString(preds[2].value));
+
+  char *values[] = {"foo", "bar", "baz"};
+  struct mockProcessorCtx ctx = {0, values, 3, NULL};
+  ResultProcessor *mp = NewResultProcessor(NULL, &ctx);
+  mp->Next = mock_Next;
+  mp->Free = NULL;
+  QueryProcessingCtx qxc = {};
+  mp->ctx.qxc = &qxc;
+
+  ResultProcessor *fp = NewFilterProcessor(NULL, mp, preds);
+  ASSERT(fp != mp);
+  fp->ctx.qxc = &qxc;
+  SearchResult *res = NewSearchResult();
+  res->fields = NULL;
+  int n = 0;
+  while (ResultProcessor_Next(fp, res, 0) != RS_RESULT_EOF) {
+    RSValue *v = RSFieldMap_Get(res->fields, "score");
+    ASSERT(v->numval >= 10 && v->numval < 20);
+    ASSERT((int)v->numval % 3 != 1);
+    RSFieldMap_Reset(res->fields);
+    n++;
+  }
+  // 10..19 without 10, 13, 16, 19
+  ASSERT_EQUAL(6, n);
+  SearchResult_Free(res);
+  ResultProcessor_Free(fp);
+
+  // predicates pushed down to the index are not evaluated again
+  for (size_t i = 0; i < array_len(preds); i++) preds[i].pushedDown = 1;
+  mp = NewResultProcessor(NULL, NULL);
+  ASSERT(NewFilterProcessor(NULL, mp, preds) == mp);
+  ResultProcessor_Free(mp);
+  AggregateFilter_Free(preds);
+
+  ASSERT(!AggregateFilter_Parse("@score = 10", &err));
+  ASSERT(err);
+  ERR_FREE(err);
+  err = NULL;
+  ASSERT(!AggregateFilter_Parse("@value == 'foo", &err));
+  ASSERT(err);
+  ERR_FREE(err);
+  RETURN_TEST_SUCCESS;
+}
+
+int testFilterPushDown() {
+  char *err = NULL;
+  static const char *schema[] = {"SCHEMA", "price", "NUMERIC", "rank",    "NUMERIC",
+                                 "SORTABLE", "NOINDEX", "brand", "TAG"};
+  RedisSearchCtx ctx = {
+      .spec = IndexSpec_Parse("idx", schema, sizeof(schema) / sizeof(const char *), &err)};
+  ASSERT(ctx.spec);
+
+  // the tag is longer than tags are indexed
+  char filter[0x1100];
+  char *p = filter + sprintf(filter, "@price > 5 && @rank > 5 && @brand == 'ACME");
+  memset(p, 'X', 0x1000);
+  strcpy(p + 0x1000, "'");
+  const char *args[] = {"FT.AGGREGATE", "idx", "*", "FILTER", filter};
+  int len = sizeof(args) / sizeof(char *);
+  CmdString *argv = CmdParser_NewArgListC(args, len);
+  CmdArg *cmd = NULL;
+  Aggregate_BuildSchema();
+  CmdParser_ParseCmd(GetAggregateRequestSchema(), &cmd, argv, len, &err, 1);
+  ASSERT(cmd);
+  AggregatePlan plan;
+  ASSERT(AggregatePlan_Build(&plan, cmd, &err));
+
+  RSSearchOptions opts = {.flags = RS_DEFAULT_QUERY_FLAGS,
+                          .fieldMask = RS_FIELDMASK_ALL,
+                          .indexName = "idx",
+                          .language = "en",
+                          .stopwords = DefaultStopWordList()};
+  QueryParseCtx *q = NewQueryParseCtx(&ctx, "*", 1, &opts);
+  ASSERT(Query_Parse(q, &err));
+  AggregatePlan_PushDownFilters(&plan, q, ctx.spec);
+
+  // the NOINDEX field has no index to push the predicate to, it stays a residual filter
+  AggregateStep *step = AggregateStep_FirstOf(plan.head, AggregateStep_Filter);
+  ASSERT(step);
+  AggregateFilterPredicate *preds = step->filter.preds;
+  ASSERT_EQUAL(3, array_len(preds));
+  ASSERT(preds[0].pushedDown);
+  ASSERT(!preds[1].pushedDown);
+  ASSERT(preds[2].pushedDown);
+
+  // the pushed down tag is looked up as it was indexed - lower cased and truncated
+  QueryNode *tag = NULL;
+  ASSERT_EQUAL(QN_PHRASE, q->root->type);
+  for (int i = 0; i < q->root->pn.numChildren; i++) {
+    if (q->root->pn.children[i]->type == QN_TAG) tag = q->root->pn.children[i];
+  }
+  ASSERT(tag);
+  ASSERT_EQUAL(1, tag->tag.numChildren);
+  QueryTokenNode *tn = &tag->tag.children[0]->tn;
+  ASSERT_EQUAL(0x1000, tn->len);
+  ASSERT(!strncmp(tn->str, "acmexxx", 7));
+
+  Query_Free(q);
+  AggregatePlan_Free(&plan);
+  CmdArg_Free(cmd);
+  IndexSpec_Free(ctx.spec);
+  RETURN_TEST_SUCCESS;
+}
+
+static double runReducer(Reducer *r, void *inst, int numVals, int mod) {
+  SearchResult res = SEARCH_RESULT_INIT;
+  for (int i = 0; i < numVals; i++) {
+    RSFieldMap_Set(&res.fields, "value", RS_NumVal(i % mod));
+    r->Add(inst, &res);
+  }
+  RSFieldMap_Reset(res.fields);
+  r->Finalize(inst, "out", &res);
+  RSValue *v = RSFieldMap_Get(res.fields, "out");
+  double d = v->t == RSValue_Number ? v->numval : -1;
+  RSFieldMap_Free(res.fields, 0);
+  return d;
+}
+
+/* The same estimate computed by a plain dense HLL, for checking the sparse representation */
+static double denseCount(int bits, int numVals, int mod) {
+  struct HLL hll;
+  hll_init(&hll, bits);
+  for (int i = 0; i < numVals; i++) {
+    RSValue *v = RS_NumVal(i % mod);
+    uint64_t hval = RSValue_Hash(v, 0x5f61767a);
+    hll_add_hash(&hll, (uint32_t)hval ^ (uint32_t)(hval >> 32));
+    RSValue_Free(v);
+  }
+  double ret = (uint64_t)hll_count(&hll);
+  hll_destroy(&hll);
+  return ret;
+}
+
+int testCountDistinctish() {
+  // 1000 distinct values with 14 bits of precision, kept in a sparse counter
+  Reducer *r = NewCountDistinctish(NULL, "count", "value", 14);
+  void *inst = r->NewInstance(&r->ctx);
+  double d = runReducer(r, inst, 5000, 1000);
+  ASSERT(d > 0);
+  ASSERT_EQUAL(denseCount(14, 5000, 1000), d);
+  r->FreeInstance(inst);
+  r->Free(r);
+
+  // many more distinct values than the sparse representation can hold
+  r = NewCountDistinctish(NULL, "count", "value", 10);
+  inst = r->NewInstance(&r->ctx);
+  d = runReducer(r, inst, 100000, 100000);
+  ASSERT_EQUAL(denseCount(10, 100000, 100000), d);
+  r->FreeInstance(inst);
+  r->Free(r);
+
+  // serialized sparse counters are merged by HLL_SUM
+  r = NewHLL(NULL, "hll", "value", 14);
+  inst = r->NewInstance(&r->ctx);
+  SearchResult res = SEARCH_RESULT_INIT;
+  for (int i = 0; i < 500; i++) {
+    RSFieldMap_Set(&res.fields, "value", RS_NumVal(i));
+    r->Add(inst, &res);
+  }
+  RSFieldMap_Reset(res.fields);
+  r->Finalize(inst, "value", &res);
+  ASSERT(RSValue_IsString(RSFieldMap_Get(res.fields, "value")));
+
+  Reducer *sum = NewHLLSum(NULL, "sum", "value");
+  void *sumInst = sum->NewInstance(&sum->ctx);
+  ASSERT(sum->Add(sumInst, &res));
+  ASSERT(sum->Add(sumInst, &res));
+  RSFieldMap_Reset(res.fields);
+  sum->Finalize(sumInst, "sum", &res);
+  d = RSFieldMap_Get(res.fields, "sum")->numval;
+  // merging a counter with itself changes nothing
+  ASSERT_EQUAL(denseCount(14, 500, 500), d);
+  RSFieldMap_Free(res.fields, 0);
+
+  r->FreeInstance(inst);
+  r->Free(r);
+  sum->FreeInstance(sumInst);
+  sum->Free(sum);
+  RETURN_TEST_SUCCESS;
+}
+
 TEST_MAIN({
   RMUTil_InitAlloc();
 
@@ -300,5 +495,8 @@ TEST_MAIN({
   // TESTFUNC(testGroupBy);
   // TESTFUNC(testAggregatePlan);
   TESTFUNC(testPlanSchema);
+  TESTFUNC(testFilter);
+  TESTFUNC(testFilterPushDown);
+  TESTFUNC(testCountDistinctish);
   // TESTFUNC(testDistribute);
 })
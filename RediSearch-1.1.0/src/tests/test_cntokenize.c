@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <float.h>
+#include <pthread.h>
 
 static char *getFile(const char *name) {
   FILE *fp = fopen(name, "rb");
@@ -73,8 +74,105 @@ static int testCnTokenize(void) {
   return 0;
 }
 
+static const char *cnThreadsTxt =
+    "RediSearch是一个高性能的全文搜索引擎，它作为Redis的模块运行。我们在北京和上海都有用户，"
+    "他们每天索引数百万篇中文文档，并且希望分词的速度和英文一样快。卡拉ok和x射线也要能正确切分。"
+    // english words with synonyms in the dictionary
+    "用户都admire它的spirit, 也喜欢decimal numbers。";
+
+#define CN_MAX_TOKENS 256
+
+typedef struct {
+  char toks[CN_MAX_TOKENS][64];
+  uint32_t offsets[CN_MAX_TOKENS];
+  size_t num;
+} cnTokens;
+
+static void cnTokenizeText(cnTokens *out) {
+  char *txt = strdup(cnThreadsTxt);
+  RSTokenizer *tok = NewChineseTokenizer(NULL, NULL, 0);
+  tok->Start(tok, txt, strlen(txt), 0);
+  Token t;
+  out->num = 0;
+  while (tok->Next(tok, &t) && out->num < CN_MAX_TOKENS) {
+    snprintf(out->toks[out->num], sizeof(out->toks[0]), "%.*s", (int)t.tokLen, t.tok);
+    out->offsets[out->num++] = t.raw - txt;
+  }
+  tok->Free(tok);
+  free(txt);
+}
+
+static void *cnTokenizeThread(void *p) {
+  cnTokens *res = p;
+  for (int i = 0; i < 200; i++) {
+    cnTokenizeText(&res[i % 2]);
+  }
+  return NULL;
+}
+
+// Tokenizers segmenting in parallel get the same tokens and offsets as a single one
+static int testCnTokenizeThreads(void) {
+  static cnTokens expected, results[4][2];
+  cnTokenizeText(&expected);
+  ASSERT(expected.num > 10);
+
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&threads[i], NULL, cnTokenizeThread, results[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 2; j++) {
+      cnTokens *res = &results[i][j];
+      ASSERT_EQUAL(expected.num, res->num);
+      for (size_t k = 0; k < expected.num; k++) {
+        ASSERT_STRING_EQ(expected.toks[k], res->toks[k]);
+        ASSERT_EQUAL(expected.offsets[k], res->offsets[k]);
+      }
+    }
+  }
+  return 0;
+}
+
+// Stopwords are returned without a position of their own only when the caller asks for them
+static int testCnTokenizeStopwords(void) {
+  char *txt = strdup("他说the king of england是我们的朋友");
+  RSTokenizer *tok = NewChineseTokenizer(NULL, DefaultStopWordList(), 0);
+  Token t;
+  int numStopwords = 0;
+  uint32_t lastPos = 0;
+  tok->Start(tok, txt, strlen(txt), TOKENIZE_STOPWORDS);
+  while (tok->Next(tok, &t)) {
+    if (t.flags & Token_Stopword) {
+      ASSERT_EQUAL(lastPos + 1, t.pos);
+      numStopwords++;
+    } else {
+      ASSERT_EQUAL(++lastPos, t.pos);
+    }
+  }
+  ASSERT_EQUAL(2, numStopwords);
+
+  // without the option they are skipped
+  uint32_t numTokens = 0;
+  tok->Start(tok, txt, strlen(txt), 0);
+  while (tok->Next(tok, &t)) {
+    ASSERT(!(t.flags & Token_Stopword));
+    numTokens++;
+  }
+  ASSERT_EQUAL(lastPos, numTokens);
+
+  tok->Free(tok);
+  free(txt);
+  return 0;
+}
+
 TEST_MAIN({
   // LOGGING_INIT(L_INFO);
   RMUTil_InitAlloc();
+  TESTFUNC(testCnTokenizeThreads);
+  TESTFUNC(testCnTokenizeStopwords);
   TESTFUNC(testCnTokenize);
 });
\ No newline at end of file
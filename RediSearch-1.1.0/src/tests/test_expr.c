@@ -1,7 +1,9 @@
 #include "test_util.h"
 #include "time_sample.h"
 #include <aggregate/expr/expression.h>
+#include <aggregate/expr/bytecode.h>
 #include <aggregate/functions/function.h>
+#include "../rmutil/alloc.h"
 
 int testExpr() {
 
@@ -91,10 +93,96 @@ int testPropertyFetch() {
   RETURN_TEST_SUCCESS;
   RETURN_TEST_SUCCESS;
 }
+int testCompile() {
+  RegisterMathFunctions();
+  char *err = NULL;
+
+  // fully constant expressions are folded into a single literal
+  char *e = "floor(2.5) + 3 * (4 - 1)";
+  RSExprProgram *p = RSExpr_Compile(RSExpr_Parse(e, strlen(e), &err), NULL, &err);
+  ASSERT(p != NULL);
+  ASSERT_EQUAL(1, p->len);
+  ASSERT_EQUAL(RSExpr_Literal, p->root->t);
+  ASSERT_EQUAL(11, p->root->literal.numval);
+  RSExprProgram_Free(p);
+
+  SearchResult *rs = NewSearchResult();
+  rs->docId = 1;
+  RSFieldMap_Add(&rs->fields, "foo", RS_NumVal(10));
+  RSFieldMap_Add(&rs->fields, "bar", RS_ConstStringVal("4", 1));
+  RSFieldMap_Add(&rs->fields, "baz", RS_ConstStringVal("hello", 5));
+
+  e = "log(@foo) + 2*sqrt(@bar) - (3 ^ 2)";
+  RSExpr *root = RSExpr_Parse(e, strlen(e), &err);
+  RSExprEvalCtx ctx = {.r = rs, .fctx = RS_NewFunctionEvalCtx()};
+  RSValue expected = RSVALUE_STATIC;
+  ASSERT_EQUAL(EXPR_EVAL_OK, RSExpr_Eval(&ctx, root, &expected, &err));
+
+  p = RSExpr_Compile(root, NULL, &err);
+  ASSERT(p != NULL);
+  for (int i = 0; i < 3; i++) {
+    RSValue val = RSVALUE_STATIC;
+    ASSERT_EQUAL(EXPR_EVAL_OK, RSExprProgram_Eval(&ctx, p, &val, &err));
+    ASSERT_EQUAL(RSValue_Number, val.t);
+    ASSERT_EQUAL(expected.numval, val.numval);
+    RSValue_Free(&val);
+  }
+  RSExprProgram_Free(p);
+
+  // arithmetic on non numeric values is an error
+  e = "@baz + 1";
+  p = RSExpr_Compile(RSExpr_Parse(e, strlen(e), &err), NULL, &err);
+  ASSERT(p != NULL);
+  RSValue val = RSVALUE_STATIC;
+  ASSERT_EQUAL(EXPR_EVAL_ERR, RSExprProgram_Eval(&ctx, p, &val, &err));
+  RSExprProgram_Free(p);
+
+  RSFunctionEvalCtx_Free(ctx.fctx);
+  SearchResult_Free(rs);
+  RETURN_TEST_SUCCESS;
+}
+
+// keys that must not be cached are looked up in the sorting table on every evaluation
+int testCompileNoCache() {
+  char *err = NULL;
+  RSSortingTable *tbl = NewSortingTable(1);
+  SortingTable_SetFieldName(tbl, 0, "foo", RSValue_Number);
+  RSDocumentMetadata md = {.sortVector = NewSortingVector(1)};
+  double d = 10;
+  RSSortingVector_Put(md.sortVector, 0, &d, RS_SORTABLE_NUM);
+
+  char *e = "@foo + 1";
+  RSExpr *root = RSExpr_Parse(e, strlen(e), &err);
+  ASSERT(root != NULL);
+  RSKey *k = &root->op.left->property;
+  k->sortableIdx = RSKEY_NOCACHE;
+  RSExprProgram *p = RSExpr_Compile(root, tbl, &err);
+  ASSERT(p != NULL);
+  ASSERT_EQUAL(RSKEY_NOCACHE, k->sortableIdx);
+
+  SearchResult *rs = NewSearchResult();
+  rs->md = &md;
+  RSExprEvalCtx ctx = {.r = rs, .sortables = tbl};
+  RSValue val = RSVALUE_STATIC;
+  ASSERT_EQUAL(EXPR_EVAL_OK, RSExprProgram_Eval(&ctx, p, &val, &err));
+  ASSERT_EQUAL(11, val.numval);
+  ASSERT_EQUAL(RSKEY_NOCACHE, k->sortableIdx);
+
+  rs->md = NULL;
+  SearchResult_Free(rs);
+  RSExprProgram_Free(p);
+  SortingVector_Free(md.sortVector);
+  SortingTable_Free(tbl);
+  RETURN_TEST_SUCCESS;
+}
+
 TEST_MAIN({
+  RMUTil_InitAlloc();
   TESTFUNC(testExpr);
   TESTFUNC(testParser);
   TESTFUNC(testFunction);
   TESTFUNC(testPropertyFetch);
+  TESTFUNC(testCompile);
+  TESTFUNC(testCompileNoCache);
 
 });
\ No newline at end of file
@@ -5,7 +5,11 @@
 #include "../query_parser/tokenizer.h"
 #include "../rmutil/alloc.h"
 #include "../spec.h"
+#include "../numeric_index.h"
+#include "../concurrent_ctx.h"
 #include "../tokenize.h"
+#include "../forward_index.h"
+#include "../stopwords.h"
 #include "../varint.h"
 #include "test_util.h"
 #include "time_sample.h"
@@ -120,6 +124,42 @@ int testDistance() {
   return 0;
 }
 
+int testWithinRangeLarge() {
+  // more positions than are decoded on the stack, with the only match at the end
+  VarintVectorWriter *vws[3];
+  RSIndexResult *res = NewIntersectResult(3);
+  for (int k = 0; k < 3; k++) {
+    vws[k] = NewVarintVectorWriter(8);
+    for (int i = 0; i < 200; i++) {
+      VVW_Write(vws[k], 1 + i * 10 + k * 3);
+    }
+    VVW_Write(vws[k], 5000 + k);
+    VVW_Truncate(vws[k]);
+    RSIndexResult *t = NewTokenRecord(NULL);
+    t->docId = 1;
+    t->fieldMask = 0x01 | (0x02 << k);
+    t->term.offsets = (RSOffsetVector)VVW_OFFSETVECTOR_INIT(vws[k]);
+    AggregateResult_AddChild(res, t);
+  }
+
+  for (int inOrder = 0; inOrder < 2; inOrder++) {
+    ASSERT_EQUAL(1, IndexResult_IsWithinRange(res, 0, inOrder));
+    ASSERT_EQUAL(1, IndexResult_IsWithinRange(res, 4, inOrder));
+  }
+  ASSERT_EQUAL(0x01, IndexResult_CommonFields(res));
+
+  // the terms don't share a field
+  res->agg.children[0]->fieldMask = 0x02;
+  ASSERT_EQUAL(0, IndexResult_CommonFields(res));
+
+  for (int k = 0; k < 3; k++) {
+    IndexResult_Free(res->agg.children[k]);
+    VVW_Free(vws[k]);
+  }
+  IndexResult_Free(res);
+  return 0;
+}
+
 int testIndexReadWriteFlags(uint32_t indexFlags) {
 
   InvertedIndex *idx = NewInvertedIndex(indexFlags, 1);
@@ -210,6 +250,115 @@ int testIndexReadWrite() {
   return 0;
 }
 
+// document i has the term at offsets i, i+1, ... i + i%3
+static void writeOffsetsDoc(InvertedIndex *idx, t_docId docId) {
+  ForwardIndexEntry h = {.docId = docId, .fieldMask = 1, .freq = 1 + docId % 3};
+  h.vw = NewVarintVectorWriter(8);
+  for (int n = 0; n <= docId % 3; n++) {
+    VVW_Write(h.vw, docId + n);
+  }
+  InvertedIndex_WriteForwardIndexEntry(idx, InvertedIndex_GetEncoder(idx->flags), &h);
+  VVW_Free(h.vw);
+}
+
+static int checkOffsetsDocs(InvertedIndex *idx, int step, int num) {
+  IndexReader *ir = NewTermIndexReader(idx, NULL, RS_FIELDMASK_ALL, NULL);
+  RSIndexResult *h = NULL;
+  int n = 0;
+  while (IR_Read(ir, &h) != INDEXREAD_EOF) {
+    t_docId docId = 1 + n * step;
+    ASSERT_EQUAL(docId, h->docId);
+    ASSERT_EQUAL(1 + docId % 3, h->freq);
+    RSOffsetIterator it = RSIndexResult_IterateOffsets(h);
+    for (int k = 0; k <= docId % 3; k++) {
+      ASSERT_EQUAL(docId + k, it.Next(it.ctx, NULL));
+    }
+    ASSERT_EQUAL(RS_OFFSETVECTOR_EOF, it.Next(it.ctx, NULL));
+    it.Free(it.ctx);
+    n++;
+  }
+  ASSERT_EQUAL(num, n);
+  IR_Free(ir);
+  return 0;
+}
+
+int testOffsetsStream() {
+  DocTable dt = NewDocTable(10);
+  InvertedIndex *idx = NewInvertedIndex(INDEX_DEFAULT_FLAGS, 1);
+  char buf[16];
+  for (int i = 1; i <= 250; i++) {
+    sprintf(buf, "doc%d", i);
+    t_docId docId = DocTable_Put(&dt, MakeDocKey(buf, strlen(buf)), 1, 0, NULL, 0);
+    writeOffsetsDoc(idx, docId);
+  }
+  ASSERT_EQUAL(3, idx->size);
+  if (checkOffsetsDocs(idx, 1, 250)) return -1;
+
+  // the records only hold the length of their offsets, the offsets are in a stream of their own
+  size_t offsetsSz = 0;
+  for (int i = 1; i <= 100; i++) {
+    offsetsSz += 1 + i % 3;
+  }
+  ASSERT_EQUAL(offsetsSz, Buffer_Offset(idx->blocks[0].offsets));
+  InvertedIndex *noOffsets = NewInvertedIndex((INDEX_DEFAULT_FLAGS) & ~Index_StoreTermOffsets, 1);
+  ASSERT(noOffsets->blocks[0].offsets == NULL);
+  InvertedIndex_Free(noOffsets);
+
+  // skipping over records does not lose track of their offsets
+  IndexReader *ir = NewTermIndexReader(idx, NULL, RS_FIELDMASK_ALL, NULL);
+  RSIndexResult *h = NULL;
+  ASSERT_EQUAL(INDEXREAD_OK, IR_SkipTo(ir, 150, &h));
+  ASSERT_EQUAL(150, h->docId);
+  RSOffsetIterator it = RSIndexResult_IterateOffsets(h);
+  ASSERT_EQUAL(150, it.Next(it.ctx, NULL));
+  it.Free(it.ctx);
+  IR_Free(ir);
+
+  // the GC compacts both streams
+  for (int i = 2; i <= 250; i += 2) {
+    sprintf(buf, "doc%d", i);
+    DocTable_Delete(&dt, MakeDocKey(buf, strlen(buf)));
+  }
+  size_t bytesCollected = 0, recordsRemoved = 0;
+  InvertedIndex_Repair(idx, &dt, 0, -1, &bytesCollected, &recordsRemoved);
+  ASSERT_EQUAL(125, recordsRemoved);
+  if (checkOffsetsDocs(idx, 2, 125)) return -1;
+  InvertedIndex_Free(idx);
+
+  // an index written with the offsets inline, the way older versions did, is split on load
+  idx = NewInvertedIndex(INDEX_DEFAULT_FLAGS, 1);
+  Buffer_Free(idx->blocks[0].offsets);
+  free(idx->blocks[0].offsets);
+  idx->blocks[0].offsets = NULL;
+  IndexEncoder enc = InvertedIndex_GetEncoder(idx->flags);
+  BufferWriter bw = NewBufferWriter(idx->blocks[0].data);
+  for (t_docId docId = 1; docId <= 50; docId++) {
+    ForwardIndexEntry h = {.docId = docId, .fieldMask = 1, .freq = 1 + docId % 3};
+    h.vw = NewVarintVectorWriter(8);
+    for (int n = 0; n <= docId % 3; n++) {
+      VVW_Write(h.vw, docId + n);
+    }
+    RSIndexResult rec = {.type = RSResultType_Term,
+                         .freq = h.freq,
+                         .fieldMask = h.fieldMask,
+                         .offsetsSz = VVW_GetByteLength(h.vw)};
+    rec.term.offsets = (RSOffsetVector){VVW_GetByteData(h.vw), VVW_GetByteLength(h.vw)};
+    enc(&bw, &bw, 1, &rec);
+    VVW_Free(h.vw);
+  }
+  idx->blocks[0] = (IndexBlock){.firstId = 1, .lastId = 50, .numDocs = 50,
+                                .data = idx->blocks[0].data};
+  idx->lastId = 50;
+  idx->numDocs = 50;
+  InvertedIndex_SplitOffsets(idx);
+  ASSERT(idx->blocks[0].offsets != NULL);
+  if (checkOffsetsDocs(idx, 1, 50)) return -1;
+  InvertedIndex_Free(idx);
+
+  DocTable_Free(&dt);
+  return 0;
+}
+
 InvertedIndex *createIndex(int size, int idStep) {
   InvertedIndex *idx = NewInvertedIndex(INDEX_DEFAULT_FLAGS, 1);
 
@@ -343,6 +492,150 @@ int testNot() {
   return 0;
 }
 
+int testIntersectionDriveOrder() {
+  InvertedIndex *w = createIndex(100, 1);
+  InvertedIndex *w2 = createIndex(10, 7);
+  IndexReader *r1 = NewTermIndexReader(w, NULL, RS_FIELDMASK_ALL, NULL);
+  IndexReader *r2 = NewTermIndexReader(w2, NULL, RS_FIELDMASK_ALL, NULL);
+
+  IndexIterator **irs = calloc(2, sizeof(IndexIterator *));
+  irs[0] = NewReadIterator(r1);
+  irs[1] = NewReadIterator(r2);
+  IndexIterator *r2it = irs[1];
+
+  // drive the intersection from the smaller child
+  IndexIterator *ii = NewIntersecIterator(irs, 2, NULL, RS_FIELDMASK_ALL, -1, 0);
+  size_t estimates[] = {100, 10};
+  IntersectIterator_SetDriveOrder(ii, estimates);
+
+  RSIndexResult *h = NULL;
+  int n = 0;
+  while (ii->Read(ii->ctx, &h) != INDEXREAD_EOF) {
+    n++;
+    ASSERT_EQUAL(7 * n, h->docId);
+    // the results keep the original order of the children
+    ASSERT_EQUAL(2, h->agg.numChildren);
+    ASSERT(h->agg.children[1] == r2it->Current(r2it->ctx));
+  }
+  ASSERT_EQUAL(10, n);
+
+  // skipping works the same
+  ii->Rewind(ii->ctx);
+  ASSERT_EQUAL(INDEXREAD_NOTFOUND, ii->SkipTo(ii->ctx, 30, &h));
+  ASSERT_EQUAL(35, h->docId);
+  ASSERT_EQUAL(INDEXREAD_OK, ii->SkipTo(ii->ctx, 42, &h));
+  ASSERT_EQUAL(42, h->docId);
+  ASSERT(h->agg.children[1] == r2it->Current(r2it->ctx));
+
+  ii->Free(ii);
+  InvertedIndex_Free(w);
+  InvertedIndex_Free(w2);
+  return 0;
+}
+
+/* Add a document to the doc table and write it to the index, with the given score */
+static t_docId addChampionDoc(InvertedIndex *idx, DocTable *dt, int n, double score) {
+  char buf[16];
+  sprintf(buf, "doc%d", n);
+  t_docId docId = DocTable_Put(dt, MakeDocKey(buf, strlen(buf)), score, 0, NULL, 0);
+  DocTable_Get(dt, docId)->maxFreq = 1;
+
+  ForwardIndexEntry h = {.docId = docId, .fieldMask = 1, .freq = 1, .term = "hello", .len = 5};
+  h.vw = NewVarintVectorWriter(8);
+  VVW_Write(h.vw, 1);
+  InvertedIndex_WriteForwardIndexEntry(idx, InvertedIndex_GetEncoder(idx->flags), &h);
+  VVW_Free(h.vw);
+  return docId;
+}
+
+static int championTierHas(ChampionTier *t, t_docId docId) {
+  for (uint32_t i = 0; i < t->size; i++) {
+    if (t->entries[i].docId == docId) return 1;
+  }
+  return 0;
+}
+
+int testChampions() {
+  DocTable dt = NewDocTable(10);
+  InvertedIndex *idx = NewInvertedIndex(INDEX_DEFAULT_FLAGS, 1);
+  for (int i = 1; i <= 20; i++) {
+    addChampionDoc(idx, &dt, i, i);
+  }
+
+  // the documents with the highest scores are the champions
+  InvertedIndex_BuildChampions(idx, &dt, 5, 0);
+  ChampionTier *t = InvertedIndex_GetChampions(idx, 0);
+  ASSERT(t != NULL);
+  ASSERT_EQUAL(5, t->size);
+  for (t_docId id = 16; id <= 20; id++) {
+    ASSERT(championTierHas(t, id));
+  }
+  ASSERT_EQUAL(15, t->bound);
+
+  // a weak document stays out of the tier, a strong one replaces the weakest champion
+  t_docId weak = addChampionDoc(idx, &dt, 21, 0.5);
+  InvertedIndex_AddChampion(idx, &dt, weak, 1, 5, 0);
+  ASSERT(!championTierHas(t, weak));
+  ASSERT_EQUAL(15, t->bound);
+  t_docId strong = addChampionDoc(idx, &dt, 22, 30);
+  InvertedIndex_AddChampion(idx, &dt, strong, 1, 5, 0);
+  ASSERT(championTierHas(t, strong));
+  ASSERT(!championTierHas(t, 16));
+  ASSERT_EQUAL(16, t->bound);
+
+  // the GC drops deleted champions
+  DocTable_Delete(&dt, MakeDocKey("doc20", 5));
+  InvertedIndex_CollectChampions(idx, &dt, 5, 0);
+  ASSERT_EQUAL(4, t->size);
+  ASSERT(!championTierHas(t, 20));
+  ASSERT_EQUAL(16, t->bound);
+
+  // and rebuilds a tier computed at an older score revision
+  ASSERT(InvertedIndex_GetChampions(idx, 1) == NULL);
+  InvertedIndex_CollectChampions(idx, &dt, 5, 1);
+  t = InvertedIndex_GetChampions(idx, 1);
+  ASSERT(t != NULL);
+  ASSERT_EQUAL(5, t->size);
+  ASSERT(championTierHas(t, 16));
+  ASSERT(championTierHas(t, strong));
+  ASSERT_EQUAL(15, t->bound);
+
+  // read the champions first, and stop if the other documents can't make it into the results
+  t_docId expected[] = {16, 17, 18, 19, 22};
+  for (int stop = 0; stop < 2; stop++) {
+    t_docId *candidates = malloc(sizeof(expected));
+    memcpy(candidates, expected, sizeof(expected));
+    double minScore = stop ? 20 : 10;
+    uint32_t total = 0;
+    IndexReader *r = NewTermIndexReader(idx, NULL, RS_FIELDMASK_ALL, NULL);
+    IndexIterator *it =
+        NewChampionIterator(NewReadIterator(r), candidates, 5, 15, 21, &minScore, &total);
+
+    RSIndexResult *h = NULL;
+    int n = 0;
+    char seen[32] = {0};
+    while (it->Read(it->ctx, &h) != INDEXREAD_EOF) {
+      if (n < 5) ASSERT_EQUAL(expected[n], h->docId);
+      ASSERT(!seen[h->docId]);
+      seen[h->docId] = 1;
+      n++;
+    }
+    if (stop) {
+      // the results not read are estimated
+      ASSERT_EQUAL(5, n);
+      ASSERT_EQUAL(16, total);
+    } else {
+      ASSERT_EQUAL(22, n);
+      ASSERT_EQUAL(0, total);
+    }
+    it->Free(it);
+  }
+
+  InvertedIndex_Free(idx);
+  DocTable_Free(&dt);
+  return 0;
+}
+
 int testPureNot() {
   InvertedIndex *w = createIndex(10, 3);
 
@@ -429,6 +722,30 @@ int testNumericInverted() {
   return 0;
 }
 
+int testWriteEpoch() {
+  uint64_t epoch = ConcurrentSearch_Epoch();
+
+  // appending to an index does not invalidate readers
+  InvertedIndex *w = createIndex(1000, 1);
+  ASSERT(ConcurrentSearch_Epoch() == epoch);
+
+  // but freeing it does
+  InvertedIndex_Free(w);
+  ASSERT(ConcurrentSearch_Epoch() > epoch);
+
+  // and so does splitting the nodes of a numeric tree
+  NumericRangeTree *t = NewNumericRangeTree();
+  epoch = ConcurrentSearch_Epoch();
+  int splits = 0;
+  for (int i = 0; i < 1000; i++) {
+    splits += NumericRangeTree_Add(t, i + 1, (double)i) ? 1 : 0;
+  }
+  ASSERT(splits > 0);
+  ASSERT(ConcurrentSearch_Epoch() >= epoch + t->revisionId);
+  NumericRangeTree_Free(t);
+  return 0;
+}
+
 int testNumericVaried() {
   InvertedIndex *idx = NewInvertedIndex(Index_StoreNumeric, 1);
 
@@ -668,6 +985,72 @@ int tokenFunc(void *ctx, const Token *t) {
   return 0;
 }
 
+static ForwardIndexEntry *findFwdEntry(ForwardIndex *idx, const char *term) {
+  ForwardIndexIterator it = ForwardIndex_Iterate(idx);
+  ForwardIndexEntry *e;
+  while ((e = ForwardIndexIterator_Next(&it))) {
+    if (e->len == strlen(term) && !memcmp(e->term, term, e->len)) return e;
+  }
+  return NULL;
+}
+
+static uint32_t firstPosition(ForwardIndexEntry *e) {
+  BufferReader br = NewBufferReader(&e->vw->buf);
+  return ReadVarint(&br);
+}
+
+int testShingles() {
+  Document doc = {.language = "english"};
+  ForwardIndex *idx = NewForwardIndex(&doc, INDEX_DEFAULT_FLAGS);
+  RSTokenizer *tk = NewSimpleTokenizer(NULL, DefaultStopWordList(), 0);
+
+  char *txt = strdup("The King of England");
+  ForwardIndexTokenizerCtx ctx;
+  ForwardIndexTokenizerCtx_Init(&ctx, idx, txt, NULL, 0, 1, 1);
+  tk->Start(tk, txt, strlen(txt), TOKENIZE_STOPWORDS);
+  Token tok;
+  uint32_t lastPos = 0;
+  while (tk->Next(tk, &tok)) {
+    forwardIndexTokenFunc(&ctx, &tok);
+    if (!(tok.flags & Token_Stopword)) lastPos = tok.pos;
+  }
+  // stopwords don't take positions of their own
+  ASSERT_EQUAL(2, lastPos);
+
+  // stopwords are only indexed as parts of shingles
+  ASSERT(findFwdEntry(idx, "the") == NULL);
+  ASSERT(findFwdEntry(idx, "of") == NULL);
+  ASSERT_EQUAL(2, firstPosition(findFwdEntry(idx, "england")));
+
+  const char *shingles[] = {"\x01the king", "\x01king of", "\x01of england"};
+  for (int i = 0; i < 3; i++) {
+    ForwardIndexEntry *e = findFwdEntry(idx, shingles[i]);
+    ASSERT(e != NULL);
+    ASSERT_EQUAL(1, e->freq);
+    ASSERT_EQUAL(i + 1, firstPosition(e));
+  }
+  ASSERT(findFwdEntry(idx, "\x01king england") == NULL);
+  // shingles are not words of the document
+  ASSERT_EQUAL(1, idx->maxFreq);
+  ASSERT_EQUAL(2, idx->totalFreq);
+
+  // a field without shingles skips its stopwords
+  ForwardIndex_Reset(idx, &doc, INDEX_DEFAULT_FLAGS);
+  ForwardIndexTokenizerCtx_Init(&ctx, idx, txt, NULL, 0, 1, 0);
+  strcpy(txt, "The King of England");
+  tk->Start(tk, txt, strlen(txt), TOKENIZE_DEFAULT_OPTIONS);
+  while (tk->Next(tk, &tok)) {
+    ASSERT(!(tok.flags & Token_Stopword));
+    forwardIndexTokenFunc(&ctx, &tok);
+  }
+  ASSERT(findFwdEntry(idx, "\x01king of") == NULL);
+
+  free(txt);
+  tk->Free(tk);
+  ForwardIndexFree(idx);
+  return 0;
+}
+
 // int testTokenize() {
 //   char *txt = strdup("Hello? world...   ? -WAZZ@UP? שלום");
 //   tokenContext ctx = {0};
@@ -1116,17 +1499,23 @@ TEST_MAIN({
   TESTFUNC(testNumericInverted);
   TESTFUNC(testNumericVaried);
   TESTFUNC(testNumericEncoding);
+  TESTFUNC(testWriteEpoch);
 
   TESTFUNC(testVarint);
   TESTFUNC(testDistance);
+  TESTFUNC(testWithinRangeLarge);
   TESTFUNC(testIndexReadWrite);
+  TESTFUNC(testOffsetsStream);
 
   TESTFUNC(testReadIterator);
   TESTFUNC(testIntersection);
   TESTFUNC(testNot);
+  TESTFUNC(testIntersectionDriveOrder);
+  TESTFUNC(testChampions);
   TESTFUNC(testUnion);
 
   TESTFUNC(testBuffer);
+  TESTFUNC(testShingles);
   // TESTFUNC(testTokenize);
   TESTFUNC(testIndexSpec);
   TESTFUNC(testIndexFlags);
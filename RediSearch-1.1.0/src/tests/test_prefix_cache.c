@@ -0,0 +1,49 @@
+#include "test_util.h"
+#include "../prefix_cache.h"
+#include <string.h>
+#include <stdio.h>
+
+int testPrefixCache() {
+  PrefixCache *pc = NewPrefixCache(4);
+  ASSERT(PrefixCache_Get(pc, "hel", 3, 1) == NULL);
+
+  PrefixCacheEntry *e = PrefixCache_Put(pc, "hel", 3, 1);
+  PrefixCacheEntry_AddTerm(e, "hello", 5);
+  PrefixCacheEntry_AddTerm(e, "help", 4);
+
+  e = PrefixCache_Get(pc, "hel", 3, 1);
+  ASSERT(e != NULL);
+  ASSERT_EQUAL(2, e->numTerms);
+  ASSERT_STRING_EQ("hello", e->terms[0].str);
+  ASSERT_STRING_EQ("help", e->terms[1].str);
+  ASSERT_EQUAL(4, e->terms[1].len);
+
+  // a new revision of the dictionary drops the entry
+  ASSERT(PrefixCache_Get(pc, "hel", 3, 2) == NULL);
+  ASSERT(PrefixCache_Get(pc, "hel", 3, 1) == NULL);
+  ASSERT_EQUAL(0, PrefixCache_Size(pc));
+
+  // the least recently used prefix is evicted when the cache is full
+  char buf[16];
+  for (int i = 0; i < 4; i++) {
+    sprintf(buf, "p%d", i);
+    PrefixCache_Put(pc, buf, strlen(buf), 1);
+  }
+  ASSERT(PrefixCache_Get(pc, "p0", 2, 1) != NULL);
+  PrefixCache_Put(pc, "p4", 2, 1);
+  ASSERT_EQUAL(4, PrefixCache_Size(pc));
+  ASSERT(PrefixCache_Get(pc, "p1", 2, 1) == NULL);
+  ASSERT(PrefixCache_Get(pc, "p0", 2, 1) != NULL);
+  ASSERT(PrefixCache_Get(pc, "p4", 2, 1) != NULL);
+
+  // putting an existing prefix replaces its entry
+  e = PrefixCache_Put(pc, "p0", 2, 3);
+  ASSERT_EQUAL(0, e->numTerms);
+  ASSERT_EQUAL(4, PrefixCache_Size(pc));
+  ASSERT(PrefixCache_Get(pc, "p0", 2, 3) == e);
+
+  PrefixCache_Free(pc);
+  return 0;
+}
+
+TEST_MAIN({ TESTFUNC(testPrefixCache); })
@@ -236,6 +236,44 @@ int testPureNegative() {
   return 0;
 }
 
+int testFuzzyQuery() {
+  char *err = NULL;
+  static const char *args[] = {"SCHEMA", "title", "text", "body", "text"};
+  RedisSearchCtx ctx = {
+      .spec = IndexSpec_Parse("idx", args, sizeof(args) / sizeof(const char *), &err)};
+  RSSearchOptions opts = SEARCH_OPTS(ctx);
+
+  char *qt = "%hello% %%World%% %for% %bar%% @title:%%%foo%%%";
+  QueryParseCtx *q = QUERY_PARSE_CTX(ctx, qt, opts);
+  QueryNode *n = Query_Parse(q, &err);
+
+  if (err) FAIL("Error parsing query: %s", err);
+  QueryNode_Print(q, n, 0);
+  ASSERT(n != NULL);
+  ASSERT_EQUAL(n->type, QN_PHRASE);
+  ASSERT_EQUAL(n->pn.numChildren, 5);
+
+  // fuzzy terms are not treated as stopwords
+  const char *terms[] = {"hello", "world", "for", NULL, "foo"};
+  const int dists[] = {1, 2, 1, 0, 3};
+  for (int i = 0; i < 5; i++) {
+    QueryNode *c = n->pn.children[i];
+    if (!terms[i]) continue;
+    ASSERT_EQUAL(c->type, QN_FUZZY);
+    ASSERT_STRING_EQ(terms[i], c->fz.tok.str);
+    ASSERT_EQUAL(dists[i], c->fz.maxDist);
+  }
+  ASSERT(n->pn.children[4]->fieldMask != RS_FIELDMASK_ALL);
+
+  // unbalanced percent signs are just separators
+  ASSERT_EQUAL(n->pn.children[3]->type, QN_TOKEN);
+  ASSERT_STRING_EQ("bar", n->pn.children[3]->tn.str);
+
+  Query_Free(q);
+  IndexSpec_Free(ctx.spec);
+  return 0;
+}
+
 int testGeoQuery() {
   char *err;
   static const char *args[] = {"SCHEMA", "title", "text", "loc", "geo"};
@@ -384,6 +422,67 @@ int testTags() {
 //   char *qt = "(hello|world) \"another world\"";
 //   char *err = NULL;
 
+int testPhraseStopwords() {
+  char *err = NULL;
+  static const char *args[] = {"SCHEMA", "title", "text", "shingles", "body", "text"};
+  RedisSearchCtx ctx = {
+      .spec = IndexSpec_Parse("idx", args, sizeof(args) / sizeof(const char *), &err)};
+  ASSERT(ctx.spec != NULL);
+  ASSERT(FieldSpec_IsShingled(&ctx.spec->fields[0]));
+  ASSERT(!FieldSpec_IsShingled(&ctx.spec->fields[1]));
+  RSSearchOptions opts = SEARCH_OPTS(ctx);
+
+  char *qt = "\"king of the hill\"";
+  QueryParseCtx *q = QUERY_PARSE_CTX(ctx, qt, opts);
+  QueryNode *n = Query_Parse(q, &err);
+  if (err) FAIL("Error parsing query: %s", err);
+  ASSERT(n != NULL);
+  ASSERT_EQUAL(n->type, QN_PHRASE);
+  ASSERT(n->pn.exact);
+  ASSERT_EQUAL(2, n->pn.numChildren);
+
+  // the stopwords are kept in their place in the phrase
+  ASSERT_EQUAL(2, n->pn.numStopwords);
+  ASSERT_STRING_EQ("of", n->pn.stopwords[0].str);
+  ASSERT_STRING_EQ("the", n->pn.stopwords[1].str);
+  ASSERT_EQUAL(1, n->pn.stopwords[0].pos);
+  ASSERT_EQUAL(1, n->pn.stopwords[1].pos);
+
+  // a single term with stopwords is an exact phrase too
+  char *err2 = NULL;
+  QueryParseCtx *q2 = QUERY_PARSE_CTX(ctx, "\"the hill\" world", opts);
+  n = Query_Parse(q2, &err2);
+  if (err2) FAIL("Error parsing query: %s", err2);
+  ASSERT_EQUAL(n->type, QN_PHRASE);
+  ASSERT(!n->pn.exact);
+  QueryNode *pn = n->pn.children[0];
+  ASSERT_EQUAL(pn->type, QN_PHRASE);
+  ASSERT(pn->pn.exact);
+  ASSERT_EQUAL(1, pn->pn.numChildren);
+  ASSERT_EQUAL(1, pn->pn.numStopwords);
+  ASSERT_STRING_EQ("the", pn->pn.stopwords[0].str);
+  ASSERT_EQUAL(0, pn->pn.stopwords[0].pos);
+  // stopwords outside of phrases are still dropped
+  ASSERT_EQUAL(0, n->pn.numStopwords);
+  Query_Free(q2);
+
+  // phrases that differ only by their stopwords have different cache keys
+  sds k1 = Query_CacheKey(q, sdsempty());
+  Query_Free(q);
+  qt = "\"king in the hill\"";
+  q = QUERY_PARSE_CTX(ctx, qt, opts);
+  n = Query_Parse(q, &err);
+  if (err) FAIL("Error parsing query: %s", err);
+  sds k2 = Query_CacheKey(q, sdsempty());
+  ASSERT(strcmp(k1, k2));
+
+  sdsfree(k1);
+  sdsfree(k2);
+  Query_Free(q);
+  IndexSpec_Free(ctx.spec);
+  return 0;
+}
+
 //   RSSearcreq = SEARCH_REQUEST(qt, NULL);
 
 //   q = NewQueryParseCtx(&req);
@@ -401,7 +500,9 @@ TEST_MAIN({
   TESTFUNC(testGeoQuery);
   TESTFUNC(testQueryParser);
   TESTFUNC(testPureNegative);
+  TESTFUNC(testFuzzyQuery);
   TESTFUNC(testFieldSpec);
+  TESTFUNC(testPhraseStopwords);
   // benchmarkQueryParser();
 
 });
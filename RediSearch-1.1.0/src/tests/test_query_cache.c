@@ -0,0 +1,75 @@
+#include "test_util.h"
+#include "../query_cache.h"
+#include <string.h>
+#include <stdio.h>
+
+static QueryCacheValue makeValue(size_t numResults, size_t totalResults) {
+  QueryCacheValue val = {.numResults = numResults, .totalResults = totalResults};
+  val.results = malloc(numResults * sizeof(QueryCacheResult));
+  for (size_t i = 0; i < numResults; i++) {
+    val.results[i] = (QueryCacheResult){.docId = i + 1, .score = 1.0 / (i + 1)};
+  }
+  return val;
+}
+
+int testQueryCache() {
+  QueryCache *qc = NewQueryCache(4096);
+  QueryCacheValue val;
+  ASSERT(!QueryCache_Get(qc, "q1", 2, 1, 10, &val));
+
+  QueryCacheValue put = makeValue(10, 100);
+  QueryCache_Put(qc, "q1", 2, 1, &put);
+
+  ASSERT(QueryCache_Get(qc, "q1", 2, 1, 10, &val));
+  ASSERT_EQUAL(10, val.numResults);
+  ASSERT_EQUAL(100, val.totalResults);
+  ASSERT_EQUAL(3, val.results[2].docId);
+  ASSERT_EQUAL(0.5, val.results[1].score);
+  free(val.results);
+
+  // asking for more results than were cached misses
+  ASSERT(!QueryCache_Get(qc, "q1", 2, 1, 20, &val));
+
+  // unless the entry holds all the results of the query
+  put = makeValue(3, 3);
+  QueryCache_Put(qc, "q2", 2, 1, &put);
+  ASSERT(QueryCache_Get(qc, "q2", 2, 1, 20, &val));
+  ASSERT_EQUAL(3, val.numResults);
+  free(val.results);
+
+  // a new revision of the index drops the entry
+  ASSERT(!QueryCache_Get(qc, "q2", 2, 2, 1, &val));
+  ASSERT(!QueryCache_Get(qc, "q2", 2, 1, 1, &val));
+
+  QueryCacheStats st;
+  QueryCache_GetStats(qc, &st);
+  ASSERT_EQUAL(2, st.hits);
+  ASSERT_EQUAL(4, st.misses);
+  ASSERT_EQUAL(1, st.entries);
+
+  // the least recently used queries are evicted to stay within the memory limit
+  char buf[16];
+  for (int i = 0; i < 100; i++) {
+    sprintf(buf, "p%d", i);
+    put = makeValue(10, 10);
+    QueryCache_Put(qc, buf, strlen(buf), 1, &put);
+    ASSERT(QueryCache_Get(qc, "p0", 2, 1, 10, &val));
+    free(val.results);
+  }
+  QueryCache_GetStats(qc, &st);
+  ASSERT(st.memory <= 4096);
+  ASSERT(st.entries < 100);
+  ASSERT(!QueryCache_Get(qc, "p1", 2, 1, 10, &val));
+  ASSERT(QueryCache_Get(qc, "p99", 3, 1, 10, &val));
+  free(val.results);
+
+  // an entry larger than the cache is not stored
+  put = makeValue(1000, 1000);
+  QueryCache_Put(qc, "big", 3, 1, &put);
+  ASSERT(!QueryCache_Get(qc, "big", 3, 1, 10, &val));
+
+  QueryCache_Free(qc);
+  return 0;
+}
+
+TEST_MAIN({ TESTFUNC(testQueryCache); })
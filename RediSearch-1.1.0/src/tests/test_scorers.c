@@ -0,0 +1,101 @@
+#include "test_util.h"
+#include "../extension.h"
+#include "../redisearch.h"
+#include "../index_result.h"
+#include "../rmutil/alloc.h"
+#include "../ext/default.h"
+#include <math.h>
+
+static RSIndexResult *newTerm(const char *str, uint32_t freq, double idf) {
+  RSToken tok = {.str = (char *)str, .len = strlen(str)};
+  RSQueryTerm *term = NewQueryTerm(&tok, 1);
+  term->idf = idf;
+  RSIndexResult *r = NewTokenRecord(term);
+  r->freq = freq;
+  return r;
+}
+
+#define NUM_RESULTS 3
+
+int testBatchScorers() {
+  Extensions_Init();
+  ASSERT(REDISEARCH_OK == Extension_Load("default", DefaultExtensionInit));
+
+  // a single term, a term intersected with a numeric filter, and a union of a term and an
+  // intersection
+  RSIndexResult *results[NUM_RESULTS];
+  results[0] = newTerm("foo", 3, 2.0);
+
+  results[1] = NewIntersectResult(2);
+  AggregateResult_AddChild(results[1], newTerm("bar", 1, 1.5));
+  AggregateResult_AddChild(results[1], NewNumericResult());
+
+  RSIndexResult *inner = NewIntersectResult(2);
+  AggregateResult_AddChild(inner, newTerm("baz", 4, 1.0));
+  AggregateResult_AddChild(inner, newTerm("qux", 1, 3.0));
+  results[2] = NewUnionResult(2);
+  AggregateResult_AddChild(results[2], newTerm("foo", 2, 0.5));
+  AggregateResult_AddChild(results[2], inner);
+
+  RSDocumentMetadata dmds[NUM_RESULTS] = {
+      {.score = 1.0, .len = 10, .maxFreq = 3},
+      {.score = 0.5, .len = 20, .maxFreq = 2},
+      {.score = 0, .len = 30, .maxFreq = 4},
+  };
+
+  // the flattened batch of the results above
+  t_docId docIds[NUM_RESULTS] = {1, 2, 3};
+  RSDocumentMetadata *dmdPtrs[NUM_RESULTS] = {&dmds[0], &dmds[1], &dmds[2]};
+  double docScores[NUM_RESULTS] = {1.0, 0.5, 0};
+  double docLens[NUM_RESULTS] = {10, 20, 30};
+  double maxFreqs[NUM_RESULTS] = {3, 2, 4};
+  int slops[NUM_RESULTS];
+  size_t leafOffsets[NUM_RESULTS + 1] = {0, 1, 3, 6};
+  double leafFreqs[] = {3, 1, 1, 2, 4, 1};
+  double leafIdfs[] = {2.0, 1.5, 1, 0.5, 1.0, 3.0};
+  double scratch[6];
+
+  const char *names[] = {DEFAULT_SCORER_NAME, TFIDF_DOCNORM_SCORER_NAME, BM25_SCORER_NAME,
+                         DOCSCORE_SCORER};
+  for (int n = 0; n < sizeof(names) / sizeof(*names); n++) {
+    RSScoringFunctionCtx ctx = {.indexStats = {.numDocs = 3, .numTerms = 4, .avgDocLen = 20}};
+    ExtScoringFunctionCtx *scx = Extensions_GetScoringFunction(&ctx, names[n]);
+    ASSERT(scx != NULL);
+    ASSERT(scx->bsf != NULL);
+
+    for (int i = 0; i < NUM_RESULTS; i++) {
+      slops[i] = ctx.GetSlop(results[i]);
+    }
+    RSScoringBatch batch = {.numResults = NUM_RESULTS,
+                            .docIds = docIds,
+                            .dmds = dmdPtrs,
+                            .docScores = docScores,
+                            .docLens = docLens,
+                            .maxFreqs = maxFreqs,
+                            .slops = slops,
+                            .leafOffsets = leafOffsets,
+                            .numLeaves = 6,
+                            .leafFreqs = leafFreqs,
+                            .leafIdfs = leafIdfs,
+                            .scratch = scratch};
+    double scores[NUM_RESULTS];
+    scx->bsf(&ctx, &batch, 0, scores);
+
+    // the batch scores are those of the single result scorer
+    for (int i = 0; i < NUM_RESULTS; i++) {
+      double expected = scx->sf(&ctx, results[i], &dmds[i], 0);
+      ASSERT(fabs(expected - scores[i]) < 1e-9);
+    }
+  }
+
+  // the scorers that need the whole result have no batch version
+  ExtScoringFunctionCtx *scx = Extensions_GetScoringFunction(NULL, DISMAX_SCORER_NAME);
+  ASSERT(scx != NULL);
+  ASSERT(scx->bsf == NULL);
+  return 0;
+}
+
+TEST_MAIN({
+  RMUTil_InitAlloc();
+  TESTFUNC(testBatchScorers);
+})
@@ -0,0 +1,157 @@
+#include "../util/tdigest.h"
+#include "../util/cmsketch.h"
+#include "../rmutil/alloc.h"
+#include "test_util.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int testTDigest() {
+  TDigest *td = NewTDigest(100);
+  ASSERT(isnan(TD_Quantile(td, 0.5)));
+
+  // a shuffled uniform sequence of 0..99999
+  size_t n = 100000;
+  for (size_t i = 0; i < n; i++) {
+    TD_Add(td, (double)((i * 7919) % n), 1);
+  }
+  ASSERT_EQUAL(n, (size_t)TD_Count(td));
+  double qs[] = {0.01, 0.1, 0.5, 0.9, 0.99};
+  for (int i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+    double v = TD_Quantile(td, qs[i]);
+    ASSERT(fabs(v - qs[i] * n) < n * 0.005);
+  }
+  ASSERT_EQUAL(0, TD_Quantile(td, 0));
+  ASSERT_EQUAL(n - 1, TD_Quantile(td, 1));
+
+  // split the same values into two digests, serialize and merge them
+  TDigest *a = NewTDigest(100), *b = NewTDigest(100);
+  for (size_t i = 0; i < n; i++) {
+    TD_Add(i % 2 ? a : b, (double)((i * 7919) % n), 1);
+  }
+  size_t len;
+  char *buf = TD_Serialize(b, &len);
+  TDigest *b2 = TD_Deserialize(buf, len);
+  ASSERT(b2);
+  ASSERT(!TD_Deserialize(buf, len - 1));
+  free(buf);
+  TD_Merge(a, b2);
+  ASSERT_EQUAL(n, (size_t)TD_Count(a));
+  for (int i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+    ASSERT(fabs(TD_Quantile(a, qs[i]) - TD_Quantile(td, qs[i])) < n * 0.005);
+  }
+
+  // small digests are exact
+  TDigest *small = NewTDigest(100);
+  TD_Add(small, 3, 1);
+  ASSERT_EQUAL(3, TD_Quantile(small, 0.5));
+  TD_Add(small, 1, 1);
+  TD_Add(small, 2, 1);
+  ASSERT_EQUAL(2, TD_Quantile(small, 0.5));
+
+  TD_Free(td);
+  TD_Free(a);
+  TD_Free(b);
+  TD_Free(b2);
+  TD_Free(small);
+
+  // a digest deserialized at its maximal size takes new centroids. 6 * 10 + 10 is the maximal
+  // number of centroids of a digest with a compression of 10
+  size_t full = 70;
+  len = 32 + full * 2 * sizeof(double);
+  buf = calloc(1, len);
+  double compression = 10, min = 0, max = full - 1;
+  uint32_t numCentroids = full;
+  memcpy(buf + 4, &compression, sizeof(double));
+  memcpy(buf + 12, &min, sizeof(double));
+  memcpy(buf + 20, &max, sizeof(double));
+  memcpy(buf + 28, &numCentroids, sizeof(uint32_t));
+  for (size_t i = 0; i < full; i++) {
+    double c[2] = {i, 1};
+    memcpy(buf + 32 + i * sizeof(c), c, sizeof(c));
+  }
+  TDigest *d1 = TD_Deserialize(buf, len), *d2 = TD_Deserialize(buf, len);
+  ASSERT(d1 && d2);
+  TD_Merge(d1, d2);
+  TD_Add(d1, 100, 1);
+  ASSERT_EQUAL(2 * full + 1, (size_t)TD_Count(d1));
+  ASSERT_EQUAL(100, TD_Quantile(d1, 1));
+  TD_Free(d1);
+  TD_Free(d2);
+
+  // centroids must have finite positive weights, and be in order between min and max
+  double bad[][2] = {{5, NAN}, {5, -1}, {5, 0}, {NAN, 1}, {INFINITY, 1}, {-1, 1}, {100, 1}};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    double orig[2];
+    memcpy(orig, buf + 32 + 5 * sizeof(orig), sizeof(orig));
+    memcpy(buf + 32 + 5 * sizeof(orig), bad[i], sizeof(orig));
+    ASSERT(!TD_Deserialize(buf, len));
+    memcpy(buf + 32 + 5 * sizeof(orig), orig, sizeof(orig));
+  }
+  double nanCompression = NAN;
+  memcpy(buf + 4, &nanCompression, sizeof(double));
+  ASSERT(!TD_Deserialize(buf, len));
+  memcpy(buf + 4, &compression, sizeof(double));
+
+  // but not one bigger than that
+  numCentroids = full + 1;
+  memcpy(buf + 28, &numCentroids, sizeof(uint32_t));
+  buf = realloc(buf, len + 2 * sizeof(double));
+  ASSERT(!TD_Deserialize(buf, len + 2 * sizeof(double)));
+  free(buf);
+  RETURN_TEST_SUCCESS;
+}
+
+static int testCMSketch() {
+  ASSERT(!NewCMSketchByError(0, 0.01));
+  // tiny errors would overflow the width
+  ASSERT(!NewCMSketchByError(1e-12, 0.01));
+  uint32_t width, depth;
+  ASSERT(!CMS_DimensionsByError(0.01, 1, &width, &depth));
+  CMSketch *cms = NewCMSketchByError(0.001, 0.01);
+  ASSERT(cms);
+  ASSERT_EQUAL(2719, cms->width);
+  ASSERT_EQUAL(5, cms->depth);
+
+  // value i appears i times
+  for (uint64_t i = 1; i <= 1000; i++) {
+    CMS_Add(cms, i * 0x9E3779B97F4A7C15ULL, i);
+  }
+  for (uint64_t i = 1; i <= 1000; i++) {
+    uint32_t c = CMS_Query(cms, i * 0x9E3779B97F4A7C15ULL);
+    ASSERT(c >= i);
+    ASSERT(c <= i + 0.001 * cms->total * 2);
+  }
+
+  size_t len;
+  char *buf = CMS_Serialize(cms, &len);
+  CMSketch *other = CMS_Deserialize(buf, len);
+  ASSERT(other);
+  ASSERT(!CMS_Deserialize(buf, len - 1));
+  // querying the serialized sketch gives the same counts
+  for (uint64_t i = 1; i <= 1000; i += 37) {
+    uint32_t c;
+    ASSERT(CMS_QuerySerialized(buf, len, i * 0x9E3779B97F4A7C15ULL, &c));
+    ASSERT_EQUAL(CMS_Query(cms, i * 0x9E3779B97F4A7C15ULL), c);
+  }
+  uint32_t c;
+  ASSERT(!CMS_QuerySerialized(buf, len - 1, 1, &c));
+  free(buf);
+  ASSERT(CMS_Merge(other, cms));
+  ASSERT_EQUAL(2 * cms->total, other->total);
+  ASSERT(CMS_Query(other, 7 * 0x9E3779B97F4A7C15ULL) >= 14);
+
+  CMSketch *small = NewCMSketch(10, 2);
+  ASSERT(!CMS_Merge(other, small));
+
+  CMS_Free(cms);
+  CMS_Free(other);
+  CMS_Free(small);
+  RETURN_TEST_SUCCESS;
+}
+
+TEST_MAIN({
+  RMUTil_InitAlloc();
+  TESTFUNC(testTDigest);
+  TESTFUNC(testCMSketch);
+})
@@ -1,8 +1,10 @@
 #include "../stemmer.h"
 #include "../tokenize.h"
+#include "../toksep.h"
 #include "test_util.h"
 #include "../rmutil/alloc.h"
 #include <string.h>
+#include <ctype.h>
 
 int testStemmer() {
 
@@ -21,6 +23,60 @@ int testStemmer() {
   return 0;
 }
 
+int testStemCache() {
+  Stemmer *s = NewStemmer(SnowballStemmer, "english");
+  ASSERT(s != NULL);
+  ASSERT_STRING_EQ("english", s->language);
+
+  StemCacheStats before, after;
+  Stemmer_GetCacheStats(&before);
+
+  size_t sl;
+  const char *stem = s->Stem(s->ctx, "going", 5, &sl);
+  ASSERT(stem != NULL);
+  ASSERT_EQUAL(3, sl);
+  ASSERT(!strncmp(stem, "+go", sl));
+  // the second time the stem comes from the cache
+  stem = s->Stem(s->ctx, "going", 5, &sl);
+  ASSERT(stem != NULL);
+  ASSERT_EQUAL(3, sl);
+  ASSERT(!strncmp(stem, "+go", sl));
+
+  // so do words that stem to themselves
+  ASSERT(s->Stem(s->ctx, "hello", 5, &sl) == NULL);
+  ASSERT(s->Stem(s->ctx, "hello", 5, &sl) == NULL);
+
+  Stemmer_GetCacheStats(&after);
+  size_t hits = after.hits - before.hits, misses = after.misses - before.misses;
+  size_t entries = after.entries - before.entries;
+  ASSERT_EQUAL(2, hits);
+  ASSERT_EQUAL(2, misses);
+  ASSERT_EQUAL(2, entries);
+
+  // the cache never grows past its limit
+  char buf[32];
+  for (int i = 0; i < STEM_CACHE_MAX_ENTRIES * 2; i++) {
+    sprintf(buf, "word%dings", i);
+    s->Stem(s->ctx, buf, strlen(buf), &sl);
+  }
+  Stemmer_GetCacheStats(&after);
+  ASSERT(after.entries - before.entries <= STEM_CACHE_MAX_ENTRIES);
+  ASSERT(after.memory - before.memory <= STEM_CACHE_MAX_BYTES);
+
+  s->Free(s);
+  Stemmer_GetCacheStats(&after);
+  ASSERT_EQUAL(before.entries, after.entries);
+  ASSERT_EQUAL(before.memory, after.memory);
+
+  // thread stemmers are kept per language
+  Stemmer *ts = GetThreadStemmer("english");
+  ASSERT(ts != NULL);
+  ASSERT(ts == GetThreadStemmer("English"));
+  ASSERT(ts != GetThreadStemmer("german"));
+  ASSERT(GetThreadStemmer("klingon") == NULL);
+  return 0;
+}
+
 typedef struct {
   int num;
   const char **expectedTokens;
@@ -76,8 +132,102 @@ int testTokenize() {
   return 0;
 }
 
+// The tokens of the scalar toksep, normalized byte by byte
+static int referenceTokens(char *txt, char **toks, size_t *lens, int max) {
+  int n = 0;
+  char *pos = txt;
+  while (pos && n < max) {
+    size_t len;
+    char *tok = toksep(&pos, &len);
+    char *norm = malloc(len + 1);
+    size_t nl = 0;
+    for (size_t ii = 0; ii < len; ii++) {
+      if (isupper(tok[ii])) {
+        norm[nl++] = tolower(tok[ii]);
+      } else if (!isblank(tok[ii]) && !iscntrl(tok[ii])) {
+        norm[nl++] = tok[ii];
+      }
+    }
+    if (nl == 0) {
+      free(norm);
+      continue;
+    }
+    toks[n] = norm;
+    lens[n++] = nl;
+  }
+  return n;
+}
+
+int testTokenizeFastPath() {
+#ifdef __SSE2__
+  // the block classifier agrees with the separator table on every byte
+  for (int c = 0; c < 256; c++) {
+    char block[16];
+    memset(block, 'a', sizeof(block));
+    block[c % 16] = c;
+    int mask = toksep_blockMask(_mm_loadu_si128((const __m128i *)block));
+    int expected = c == 0 || istoksep(c) ? 1 << (c % 16) : 0;
+    ASSERT_EQUAL(expected, mask);
+  }
+#endif
+
+  // toksepLen must split exactly like toksep, wherever the separators fall in a block
+  const char alphabet[] = "aBcDeFgHzZ_09 \t,.-@[`{~\x7f\x01\xc3\xa9";
+  srand(1337);
+  for (int round = 0; round < 2000; round++) {
+    char txt[200];
+    size_t len = rand() % (sizeof(txt) - 1);
+    for (size_t ii = 0; ii < len; ii++) {
+      // mostly letters, so tokens are long enough to span blocks
+      txt[ii] = rand() % 4 ? alphabet[rand() % 8] : alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    txt[len] = '\0';
+
+    char *a = txt, *b = txt;
+    while (a) {
+      size_t la, lb;
+      char *ta = toksep(&a, &la);
+      char *tb = toksepLen(&b, txt + len, &lb);
+      ASSERT(ta == tb);
+      ASSERT(la == lb);
+      ASSERT(a == b);
+    }
+
+    char copy[200];
+    memcpy(copy, txt, len + 1);
+    char *refToks[200];
+    size_t refLens[200];
+    int n = referenceTokens(copy, refToks, refLens, 200);
+
+    RSTokenizer *tk = NewSimpleTokenizer(NULL, NULL, 0);
+    tk->Start(tk, txt, len, 0);
+    Token t;
+    int i = 0;
+    while (tk->Next(tk, &t)) {
+      ASSERT(i < n);
+      ASSERT(t.tokLen == refLens[i]);
+      ASSERT(!memcmp(t.tok, refToks[i], t.tokLen));
+      ASSERT(t.pos == i + 1);
+      free(refToks[i++]);
+    }
+    ASSERT_EQUAL(n, i);
+    tk->Free(tk);
+  }
+
+  // an embedded NUL ends the text, like it does for toksep
+  char txt[] = "abcdefghijklmnopqrstuvwxyz\0 qwertyuiopasdfghjkl";
+  char *pos = txt;
+  size_t len;
+  toksepLen(&pos, txt + sizeof(txt) - 1, &len);
+  ASSERT(pos == NULL);
+  ASSERT_EQUAL(26, len);
+  return 0;
+}
+
 TEST_MAIN({
   RMUTil_InitAlloc();
   TESTFUNC(testStemmer);
+  TESTFUNC(testStemCache);
   TESTFUNC(testTokenize);
+  TESTFUNC(testTokenizeFastPath);
 });
\ No newline at end of file
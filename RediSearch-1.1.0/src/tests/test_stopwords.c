@@ -43,8 +43,37 @@ int testDefaultStopwords() {
   return 0;
 }
 
+int testLargeStopwordList() {
+  // words sharing their length, first bytes and last byte all hash to the same slot
+  char *terms[1000];
+  for (int i = 0; i < 1000; i++) {
+    terms[i] = malloc(32);
+    sprintf(terms[i], i % 2 ? "word%04dx" : "w%d", i);
+  }
+  // duplicates are only added once
+  terms[999] = strcpy(terms[999], terms[0]);
+
+  StopWordList *sl = NewStopWordListCStr((const char **)terms, 1000);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT(StopWordList_Contains(sl, terms[i], strlen(terms[i])));
+  }
+  ASSERT(!StopWordList_Contains(sl, "word1000x", strlen("word1000x")));
+  ASSERT(!StopWordList_Contains(sl, "word0001", strlen("word0001")));
+  ASSERT(!StopWordList_Contains(sl, "w", 1));
+  ASSERT(!StopWordList_Contains(sl, "", 0));
+  ASSERT(!StopWordList_Contains(sl, "a much longer token than any of the stopwords in the list",
+                                strlen("a much longer token than any of the stopwords in the list")));
+
+  StopWordList_Free(sl);
+  for (int i = 0; i < 1000; i++) {
+    free(terms[i]);
+  }
+  return 0;
+}
+
 TEST_MAIN({
   RMUTil_InitAlloc();
   TESTFUNC(testStopwordList);
   TESTFUNC(testDefaultStopwords);
+  TESTFUNC(testLargeStopwordList);
 });
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "test_util.h"
+#include "../dep/thpool/thpool.h"
+#include <pthread.h>
+#include <unistd.h>
+
+static pthread_mutex_t gate_g = PTHREAD_MUTEX_INITIALIZER;
+static int order_g[64];
+static int numDone_g = 0;
+
+static void blockJob(void *arg) {
+  pthread_mutex_lock(&gate_g);
+  pthread_mutex_unlock(&gate_g);
+}
+
+static void recordJob(void *arg) {
+  order_g[numDone_g++] = (int)(intptr_t)arg;
+}
+
+int testPriorities() {
+  threadpool pool = thpool_init(1);
+
+  // hold the only thread so the jobs below pile up in the queue
+  pthread_mutex_lock(&gate_g);
+  thpool_add_work(pool, blockJob, NULL);
+  while (!thpool_num_threads_working(pool)) {
+    usleep(100);
+  }
+
+  thpool_add_work_priority(pool, recordJob, (void *)3, 3);
+  thpool_add_work_priority(pool, recordJob, (void *)1, 1);
+  thpool_add_work_priority(pool, recordJob, (void *)10, THPOOL_PRIORITY_HIGH);
+  thpool_add_work_priority(pool, recordJob, (void *)11, THPOOL_PRIORITY_HIGH);
+  ASSERT(thpool_add_work_priority(pool, recordJob, NULL, THPOOL_NUM_PRIORITIES) == -1);
+
+  pthread_mutex_unlock(&gate_g);
+  thpool_wait(pool);
+
+  // the most urgent jobs first, each priority in FIFO order
+  int n = numDone_g;
+  ASSERT_EQUAL(4, n);
+  ASSERT_EQUAL(10, order_g[0]);
+  ASSERT_EQUAL(11, order_g[1]);
+  ASSERT_EQUAL(1, order_g[2]);
+  ASSERT_EQUAL(3, order_g[3]);
+
+  // a low priority job is not starved by a stream of urgent ones
+  numDone_g = 0;
+  pthread_mutex_lock(&gate_g);
+  thpool_add_work(pool, blockJob, NULL);
+  while (!thpool_num_threads_working(pool)) {
+    usleep(100);
+  }
+  thpool_add_work_priority(pool, recordJob, (void *)100, 2);
+  for (int i = 0; i < 2 * THPOOL_MAX_SKIPS; i++) {
+    thpool_add_work(pool, recordJob, (void *)(intptr_t)i);
+  }
+  pthread_mutex_unlock(&gate_g);
+  thpool_wait(pool);
+
+  n = numDone_g;
+  ASSERT_EQUAL(2 * THPOOL_MAX_SKIPS + 1, n);
+  ASSERT_EQUAL(100, order_g[THPOOL_MAX_SKIPS]);
+  for (int i = 0; i < THPOOL_MAX_SKIPS; i++) {
+    ASSERT_EQUAL(i, order_g[i]);
+  }
+
+  thpool_destroy(pool);
+  return 0;
+}
+
+TEST_MAIN({ TESTFUNC(testPriorities); })
@@ -1,6 +1,8 @@
 #include "../trie/trie.h"
 #include "../trie/levenshtein.h"
 #include "../trie/rune_util.h"
+#include "../trie/trie_type.h"
+#include "../rmutil/alloc.h"
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -106,6 +108,178 @@ int testRuneUtil() {
   return 0;
 }
 
+/* Check the strings returned by a trie prefix search. expected is NULL terminated */
+static int checkCompletions(Trie *t, char *prefix, size_t num, const char **expected) {
+  Vector *res = Trie_Search(t, prefix, strlen(prefix), num, 0, 1, 0, 0);
+  ASSERT(res != NULL);
+  int n = 0;
+  while (expected[n]) n++;
+  ASSERT_EQUAL(n, Vector_Size(res));
+  for (int i = 0; i < n; i++) {
+    TrieSearchResult *e;
+    Vector_Get(res, i, &e);
+    ASSERT_STRING_EQ(expected[i], e->str);
+    TrieSearchResult_Free(e);
+  }
+  Vector_Free(res);
+  return 0;
+}
+
+#define ASSERT_COMPLETIONS(t, prefix, num, ...) \
+  ASSERT_EQUAL(0, checkCompletions(t, prefix, num, (const char *[]){__VA_ARGS__, NULL}))
+
+int testCompletions() {
+  Trie *t = NewTrie();
+  Trie_InsertStringBuffer(t, "hello", 5, 1, 0, NULL);
+  Trie_InsertStringBuffer(t, "help", 4, 2, 0, NULL);
+  Trie_InsertStringBuffer(t, "helmet", 6, 3, 0, NULL);
+  Trie_InsertStringBuffer(t, "hero", 4, 4, 0, NULL);
+  Trie_InsertStringBuffer(t, "world", 5, 5, 0, NULL);
+
+  // the first search fills the cache, the next ones are served from it
+  ASSERT_COMPLETIONS(t, "he", 3, "hero", "helmet", "help");
+  ASSERT_COMPLETIONS(t, "HE", 3, "hero", "helmet", "help");
+
+  Trie_InsertStringBuffer(t, "helium", 6, 10, 0, NULL);
+  ASSERT_COMPLETIONS(t, "he", 3, "helium", "hero", "helmet");
+  Trie_Delete(t, "hero", 4);
+  ASSERT_COMPLETIONS(t, "he", 3, "helium", "helmet", "help");
+  Trie_InsertStringBuffer(t, "help", 4, 0.5, 0, NULL);
+  ASSERT_COMPLETIONS(t, "he", 10, "helium", "helmet", "hello", "help");
+  ASSERT_COMPLETIONS(t, "wor", 3, "world");
+
+  // more completions than we keep - lowering a kept one drops the cached prefix
+  char buf[16];
+  for (int i = 0; i < 20; i++) {
+    sprintf(buf, "x%02d", i);
+    Trie_InsertStringBuffer(t, buf, 3, i + 1, 0, NULL);
+  }
+  ASSERT_COMPLETIONS(t, "x", 2, "x19", "x18");
+  Trie_InsertStringBuffer(t, "x19", 3, 0.1, 0, NULL);
+  Trie_InsertStringBuffer(t, "x00", 3, 100, 1, NULL);
+  ASSERT_COMPLETIONS(t, "x", 3, "x00", "x18", "x17");
+  Trie_Delete(t, "x18", 3);
+  ASSERT_COMPLETIONS(t, "x", 3, "x00", "x17", "x16");
+
+  TrieType_Free(t);
+  return 0;
+}
+
+static int cmpResults(const void *p1, const void *p2) {
+  const TrieSearchResult *r1 = *(const TrieSearchResult **)p1, *r2 = *(const TrieSearchResult **)p2;
+  if (r1->score != r2->score) return r1->score < r2->score ? 1 : -1;
+  return strcmp(r1->str, r2->str);
+}
+
+/* Check that a search returns the same results, with the same payloads, in both tries */
+static int checkSameResults(Trie *t1, Trie *t2, char *s, int maxDist, int prefixMode) {
+  Vector *r1 = Trie_Search(t1, s, strlen(s), 5000, maxDist, prefixMode, 0, 0);
+  Vector *r2 = Trie_Search(t2, s, strlen(s), 5000, maxDist, prefixMode, 0, 0);
+  ASSERT_EQUAL(Vector_Size(r1), Vector_Size(r2));
+  qsort(r1->data, Vector_Size(r1), sizeof(TrieSearchResult *), cmpResults);
+  qsort(r2->data, Vector_Size(r2), sizeof(TrieSearchResult *), cmpResults);
+  for (int i = 0; i < Vector_Size(r1); i++) {
+    TrieSearchResult *e1, *e2;
+    Vector_Get(r1, i, &e1);
+    Vector_Get(r2, i, &e2);
+    ASSERT_STRING_EQ(e1->str, e2->str);
+    ASSERT_EQUAL(e1->score, e2->score);
+    ASSERT_EQUAL(e1->plen, e2->plen);
+    ASSERT(e1->plen == 0 || !memcmp(e1->payload, e2->payload, e1->plen));
+    TrieSearchResult_Free(e1);
+    TrieSearchResult_Free(e2);
+  }
+  Vector_Free(r1);
+  Vector_Free(r2);
+  return 0;
+}
+
+#define ASSERT_SAME_RESULTS(t1, t2, s, maxDist, prefixMode) \
+  ASSERT_EQUAL(0, checkSameResults(t1, t2, s, maxDist, prefixMode))
+
+int testFrozenTrie() {
+  // t is compacted, and is checked against plain
+  Trie *t = NewTrie(), *plain = NewTrie();
+  char buf[32];
+  for (int i = 0; i < 2000; i++) {
+    int n = sprintf(buf, "%s%d", i % 3 ? "foo" : "bär", i);
+    RSPayload payload = {.data = buf, .len = i % 5 ? 0 : n};
+    Trie_InsertStringBuffer(t, buf, n, 1 + i % 37, 0, &payload);
+    Trie_InsertStringBuffer(plain, buf, n, 1 + i % 37, 0, &payload);
+  }
+  ASSERT(Trie_NeedsCompaction(t));
+  // we only ask for compaction once
+  ASSERT(!Trie_NeedsCompaction(t));
+  Trie_Compact(t);
+  ASSERT(t->frozen != NULL);
+  ASSERT_EQUAL(2000, FrozenTrie_Size(t->frozen));
+  ASSERT_EQUAL(2000, t->size);
+  ASSERT_EQUAL(0, t->deltaSize);
+
+  char *queries[] = {"f", "foo1", "foo12", "bä", "BÄR1", "bar1", "x", NULL};
+  for (int i = 0; queries[i]; i++) {
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 0, 1);
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 1, 1);
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 1, 0);
+  }
+
+  // re-adding compacted strings with a zero score changes nothing
+  for (int i = 0; i < 2000; i += 13) {
+    int n = sprintf(buf, "%s%d", i % 3 ? "foo" : "bär", i);
+    ASSERT_EQUAL(0, Trie_InsertStringBuffer(t, buf, n, 0, i % 2, NULL));
+  }
+  ASSERT_EQUAL(2000, t->size);
+  ASSERT_EQUAL(0, t->deltaSize);
+
+  // updates of compacted strings, with and without payloads, deletes and new strings. Compacted
+  // strings keep their payloads unless they get new ones
+  for (int i = 0; i < 2000; i += 7) {
+    int n = sprintf(buf, "%s%d", i % 3 ? "foo" : "bär", i);
+    RSPayload payload = {.data = "pl", .len = i % 2 ? 2 : 0};
+    RSPayload kept = {.data = buf, .len = n};
+    int rc1 = Trie_InsertStringBuffer(plain, buf, n, 3, i % 4 == 0,
+                                      !payload.len && i % 5 == 0 ? &kept : &payload);
+    int rc2 = Trie_InsertStringBuffer(t, buf, n, 3, i % 4 == 0, &payload);
+    ASSERT_EQUAL(rc1, rc2);
+  }
+  for (int i = 0; i < 2000; i += 11) {
+    int n = sprintf(buf, "%s%d", i % 3 ? "foo" : "bär", i);
+    int rc1 = Trie_Delete(plain, buf, n);
+    int rc2 = Trie_Delete(t, buf, n);
+    ASSERT_EQUAL(rc1, rc2);
+    rc2 = Trie_Delete(t, buf, n);
+    ASSERT_EQUAL(0, rc2);
+  }
+  // prefixes that are not strings in the trie cannot be deleted
+  int rc = Trie_Delete(plain, "fo", 2);
+  ASSERT_EQUAL(0, rc);
+  rc = Trie_Delete(t, "fo", 2);
+  ASSERT_EQUAL(0, rc);
+  for (int i = 0; i < 300; i++) {
+    int n = sprintf(buf, "foo%dx", i);
+    int rc1 = Trie_InsertStringBuffer(plain, buf, n, 40, 0, NULL);
+    int rc2 = Trie_InsertStringBuffer(t, buf, n, 40, 0, NULL);
+    ASSERT_EQUAL(rc1, rc2);
+  }
+  ASSERT_EQUAL(plain->size, t->size);
+  for (int i = 0; queries[i]; i++) {
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 0, 1);
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 1, 1);
+  }
+
+  // compacting again merges the delta into the frozen trie
+  Trie_Compact(t);
+  ASSERT_EQUAL(plain->size, FrozenTrie_Size(t->frozen));
+  for (int i = 0; queries[i]; i++) {
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 0, 1);
+    ASSERT_SAME_RESULTS(t, plain, queries[i], 1, 0);
+  }
+
+  TrieType_Free(t);
+  TrieType_Free(plain);
+  return 0;
+}
+
 int testPayload() {
   rune *rootRunes = strToRunes("", NULL);
   TrieNode *root = __newTrieNode(rootRunes, 0, 0, NULL, 0, 0, 1, 0);
@@ -145,6 +319,44 @@ int testPayload() {
   return 0;
 }
 
+int testDFACache() {
+  size_t rlen;
+  rune *runes = strToRunes("hello", &rlen);
+
+  // the same query and distance share a compiled automaton
+  dfaAutomaton *dfa = DFA_Get(runes, rlen, 1);
+  dfaAutomaton *dfa2 = DFA_Get(runes, rlen, 1);
+  ASSERT(dfa == dfa2);
+  DFA_Release(dfa2);
+  dfa2 = DFA_Get(runes, rlen, 2);
+  ASSERT(dfa != dfa2);
+  DFA_Release(dfa2);
+
+  // the alphabet is the distinct runes of the query
+  ASSERT_EQUAL(4, dfa->alphabetSize);
+  ASSERT(__dfn_getEdge(dfa, dfa->root, 'h') != NULL);
+  ASSERT(__dfn_getEdge(dfa, dfa->root, 'z') == NULL);
+  ASSERT(dfa->root->fallback != NULL);
+
+  // an evicted automaton stays valid until released
+  for (int i = 0; i < DFA_CACHE_SIZE; i++) {
+    char buf[32];
+    size_t n;
+    sprintf(buf, "term%d", i);
+    rune *r = strToRunes(buf, &n);
+    DFA_Release(DFA_Get(r, n, 1));
+    free(r);
+  }
+  dfa2 = DFA_Get(runes, rlen, 1);
+  ASSERT(dfa != dfa2);
+  ASSERT(__dfn_getEdge(dfa, dfa->root, 'h') != NULL);
+  DFA_Release(dfa);
+  DFA_Release(dfa2);
+
+  free(runes);
+  return 0;
+}
+
 int testTrie() {
   rune *rootRunes = strToRunes("", NULL);
   TrieNode *root = __newTrieNode(rootRunes, 0, 0, NULL, 0, 0, 1, 0);
@@ -344,9 +556,13 @@ int testDFAFilter() {
 }
 
 TEST_MAIN({
+  RMUTil_InitAlloc();
   TESTFUNC(testRuneUtil);
+  TESTFUNC(testCompletions);
+  TESTFUNC(testFrozenTrie);
   TESTFUNC(testDFAFilter);
   TESTFUNC(testTrie);
   TESTFUNC(testPayload);
+  TESTFUNC(testDFACache);
   TESTFUNC(testUnicode);
 });
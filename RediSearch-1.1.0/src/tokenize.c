@@ -11,6 +11,8 @@
 typedef struct {
   RSTokenizer base;
   char **pos;
+  // the end of the text, where its NUL terminator is
+  const char *end;
   Stemmer *stemmer;
 } simpleTokenizer;
 
@@ -21,6 +23,7 @@ static void simpleTokenizer_Start(RSTokenizer *base, char *text, size_t len, uin
   ctx->options = options;
   ctx->len = len;
   self->pos = &ctx->text;
+  self->end = text + len;
 }
 
 // Shortest word which can/should actually be stemmed
@@ -29,6 +32,30 @@ static void simpleTokenizer_Start(RSTokenizer *base, char *text, size_t len, uin
 // Normalization buffer
 #define MAX_NORMALIZE_SIZE 128
 
+#ifdef __SSE2__
+/**
+ * Lowercases ASCII text 16 bytes at a time from s to dst (which may be the same buffer), stopping
+ * at the first block that has anything else - a blank or control character that needs to be
+ * dropped, or a non-ASCII byte. Returns the number of bytes done, the rest is left to the byte loop
+ */
+static size_t normalizeASCII(const char *s, char *dst, size_t len) {
+  // non-ASCII bytes are negative, so they are below '!' as well
+  const __m128i minPrint = _mm_set1_epi8('!'), del = _mm_set1_epi8(0x7f);
+  const __m128i caseBit = _mm_set1_epi8(0x20);
+  size_t ii = 0;
+  for (; ii + 16 <= len; ii += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + ii));
+    __m128i other = _mm_or_si128(_mm_cmpgt_epi8(minPrint, v), _mm_cmpeq_epi8(v, del));
+    if (_mm_movemask_epi8(other)) {
+      break;
+    }
+    __m128i upper = TOKSEP_RANGE(v, 'A', 'Z');
+    _mm_storeu_si128((__m128i *)(dst + ii), _mm_or_si128(v, _mm_and_si128(upper, caseBit)));
+  }
+  return ii;
+}
+#endif
+
 /**
  * Normalizes text.
  * - s contains the raw token
@@ -38,21 +65,17 @@ static void simpleTokenizer_Start(RSTokenizer *base, char *text, size_t len, uin
  */
 static char *DefaultNormalize(char *s, char *dst, size_t *len) {
   size_t origLen = *len;
-  char *realDest = s;
-  size_t dstLen = 0;
+  size_t ii = 0, dstLen = 0;
 
-#define SWITCH_DEST()        \
-  if (realDest != dst) {     \
-    realDest = dst;          \
-    memcpy(realDest, s, ii); \
-  }
+#ifdef __SSE2__
+  ii = dstLen = normalizeASCII(s, dst, origLen);
+#endif
 
-  for (size_t ii = 0; ii < origLen; ++ii) {
+  for (; ii < origLen; ++ii) {
     if (isupper(s[ii])) {
-      SWITCH_DEST();
-      realDest[dstLen++] = tolower(s[ii]);
+      dst[dstLen++] = tolower(s[ii]);
     } else if (isblank(s[ii]) || iscntrl(s[ii])) {
-      SWITCH_DEST();
+      // dropped
     } else {
       dst[dstLen++] = s[ii];
     }
@@ -69,7 +92,7 @@ uint32_t simpleTokenizer_Next(RSTokenizer *base, Token *t) {
   while (*self->pos != NULL) {
     // get the next token
     size_t origLen;
-    char *tok = toksep(self->pos, &origLen);
+    char *tok = toksepLen(self->pos, self->end, &origLen);
 
     // normalize the token
     size_t normLen = origLen;
@@ -91,9 +114,19 @@ uint32_t simpleTokenizer_Next(RSTokenizer *base, Token *t) {
       continue;
     }
 
-    // skip stopwords
+    // skip stopwords, unless the caller wants to see them. They don't take a position
     if (StopWordList_Contains(ctx->stopwords, normalized, normLen)) {
-      continue;
+      if (!(ctx->options & TOKENIZE_STOPWORDS)) {
+        continue;
+      }
+      *t = (Token){.tok = normalized,
+                   .tokLen = normLen,
+                   .raw = tok,
+                   .rawLen = origLen,
+                   .pos = ctx->lastOffset + 1,
+                   .stem = NULL,
+                   .flags = Token_Stopword};
+      return t->pos;
     }
 
     *t = (Token){.tok = normalized,
@@ -10,7 +10,13 @@
 #include <stdlib.h>
 #include <strings.h>
 
-typedef enum { Token_CopyRaw = 0x01, Token_CopyStem = 0x02 } TokenFlags;
+typedef enum {
+  Token_CopyRaw = 0x01,
+  Token_CopyStem = 0x02,
+  // a stopword, returned only with TOKENIZE_STOPWORDS. It is not indexed as a term, and its
+  // position is that of the next token
+  Token_Stopword = 0x04
+} TokenFlags;
 
 /* Represents a token found in a document */
 typedef struct {
@@ -70,6 +76,8 @@ RSTokenizer *NewChineseTokenizer(Stemmer *stemmer, StopWordList *stopwords, uint
 #define TOKENIZE_NOMODIFY 0x01
 // don't stem a field
 #define TOKENIZE_NOSTEM 0x02
+// return stopwords as tokens flagged Token_Stopword instead of skipping them
+#define TOKENIZE_STOPWORDS 0x04
 
 /**
  * Pooled tokenizer functions:
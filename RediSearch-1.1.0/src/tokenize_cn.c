@@ -3,21 +3,21 @@
 #include "dep/friso/friso.h"
 #include "cndict_loader.h"
 #include <assert.h>
+#include <pthread.h>
 
+// The dictionary and config are loaded once and never change afterwards, so they are shared by
+// all the tokenizers. The segmentation state lives in each tokenizer's task, so tokenizers can
+// run in different threads at once
 static friso_config_t config_g;
 static friso_t friso_g;
+static pthread_once_t frisoInitOnce_g = PTHREAD_ONCE_INIT;
 
 typedef struct {
   RSTokenizer base;
   friso_task_t fTask;
 } cnTokenizer;
 
-// TODO: This is just a global init
-static void maybeFrisoInit() {
-  if (friso_g) {
-    return;
-  }
-
+static void frisoInit() {
   const char *configfile = RSGlobalConfig.frisoIni;
   friso_g = friso_new();
   config_g = friso_new_config();
@@ -37,6 +37,13 @@ static void maybeFrisoInit() {
   // Overrides:
   // Don't segment english text. We might use our actual tokenizer later if needed
   config_g->en_sseg = 0;
+
+  // No more words are added, compact the dictionary for faster lookups
+  friso_dic_freeze(friso_g->dic);
+}
+
+static void maybeFrisoInit() {
+  pthread_once(&frisoInitOnce_g, frisoInit);
 }
 
 static void cnTokenizer_Start(RSTokenizer *base, char *text, size_t len, uint32_t options) {
@@ -56,14 +63,25 @@ static uint32_t cnTokenizer_Next(RSTokenizer *base, Token *t) {
       return 0;
     }
 
-    // Check if it's a stopword?
-    if (ctx->stopwords && StopWordList_Contains(ctx->stopwords, tok->word, tok->length)) {
-      continue;
+    // Check if it's a stopword? Like the simple tokenizer, return it without taking a position if
+    // the caller wants to see stopwords
+    if (tok->type == __LEX_STOPWORDS__ ||
+        (ctx->stopwords && StopWordList_Contains(ctx->stopwords, tok->word, tok->length))) {
+      if (!(ctx->options & TOKENIZE_STOPWORDS)) {
+        continue;
+      }
+      *t = (Token){.tok = tok->word,
+                   .tokLen = tok->length,
+                   .raw = ctx->text + tok->offset,
+                   .rawLen = tok->rlen,
+                   .stem = NULL,
+                   .flags = Token_Stopword,
+                   .pos = ctx->lastOffset + 1};
+      return t->pos;
     }
 
     switch (tok->type) {
       // Skip words we know we don't care about.
-      case __LEX_STOPWORDS__:
       case __LEX_PUNC_WORDS__:
       case __LEX_ENPUN_WORDS__:
       case __LEX_CJK_UNITS__:
@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 //! " # $ % & ' ( ) * + , - . / : ; < = > ? @ [ \ ] ^ ` { | } ~
 static const char ToksepMap_g[256] = {
         [' '] = 1, ['\t'] = 1, [','] = 1, ['.'] = 1, ['/'] = 1, ['('] = 1, [')'] = 1,
@@ -36,6 +39,60 @@ static inline char *toksep(char **s, size_t *tokLen) {
   return orig;
 }
 
+#ifdef __SSE2__
+#define TOKSEP_RANGE(v, lo, hi) \
+  _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((lo)-1)), _mm_cmplt_epi8(v, _mm_set1_epi8((hi) + 1)))
+
+/**
+ * Returns a bitmask of the bytes in a 16 byte block that end a token, i.e. separators and NUL.
+ * All the separators are ASCII - tab, and the ranges ' '-'/', ':'-'@', '['-'^', '`' and '{'-'~'.
+ * Bytes with the high bit set compare as negative, so they never fall in a range.
+ */
+static inline int toksep_blockMask(__m128i v) {
+  __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+                           _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  m = _mm_or_si128(m, TOKSEP_RANGE(v, ' ', '/'));
+  m = _mm_or_si128(m, TOKSEP_RANGE(v, ':', '@'));
+  m = _mm_or_si128(m, TOKSEP_RANGE(v, '[', '^'));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('`')));
+  m = _mm_or_si128(m, TOKSEP_RANGE(v, '{', '~'));
+  return _mm_movemask_epi8(m);
+}
+#endif
+
+/**
+ * Same as toksep, but `end` points to the end of the string (its NUL terminator). With SSE2 we
+ * scan 16 bytes at a time up to `end`, and finish with toksep. An embedded NUL still ends the
+ * string, so the tokens are exactly those of toksep.
+ */
+static inline char *toksepLen(char **s, const char *end, size_t *tokLen) {
+#ifdef __SSE2__
+  char *orig = *s;
+  char *pos = orig;
+  for (; end - pos >= 16; pos += 16) {
+    int mask = toksep_blockMask(_mm_loadu_si128((const __m128i *)pos));
+    if (mask) {
+      pos += __builtin_ctz(mask);
+      *tokLen = pos - orig;
+      if (!*pos || !*++pos) {
+        *s = NULL;
+      } else {
+        *s = pos;
+      }
+      return orig;
+    }
+  }
+
+  size_t tailLen;
+  *s = pos;
+  toksep(s, &tailLen);
+  *tokLen = (pos - orig) + tailLen;
+  return orig;
+#else
+  return toksep(s, tokLen);
+#endif
+}
+
 static inline int istoksep(int c) {
   return ToksepMap_g[(uint8_t)c] != 0;
 }
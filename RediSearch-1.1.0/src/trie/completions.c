@@ -0,0 +1,172 @@
+#include "completions.h"
+#include "rune_util.h"
+#include "../util/khash.h"
+#include "../util/fnv.h"
+#include <math.h>
+#include <limits.h>
+
+typedef struct {
+  const rune *str;
+  t_len len;
+} prefixKey;
+
+static inline khint_t prefixKey_hash(prefixKey k) {
+  return rs_fnv_32a_buf((void *)k.str, k.len * sizeof(rune), 0);
+}
+
+static inline int prefixKey_equal(prefixKey a, prefixKey b) {
+  return a.len == b.len && !memcmp(a.str, b.str, a.len * sizeof(rune));
+}
+
+KHASH_INIT(completions, prefixKey, TrieCompletionList *, 1, prefixKey_hash, prefixKey_equal);
+
+struct TrieCompletions {
+  khash_t(completions) * h;
+};
+
+TrieCompletions *NewTrieCompletions() {
+  TrieCompletions *tc = malloc(sizeof(*tc));
+  tc->h = kh_init(completions);
+  return tc;
+}
+
+static void completionList_Free(TrieCompletionList *l) {
+  for (int i = 0; i < l->num; i++) {
+    free(l->entries[i].str);
+  }
+  free(l);
+}
+
+/* Remove a prefix from the cache, freeing its key and list */
+static void completions_Del(TrieCompletions *tc, khiter_t it) {
+  free((rune *)kh_key(tc->h, it).str);
+  completionList_Free(kh_val(tc->h, it));
+  kh_del(completions, tc->h, it);
+}
+
+static void completions_Clear(TrieCompletions *tc) {
+  for (khiter_t it = kh_begin(tc->h); it != kh_end(tc->h); ++it) {
+    if (kh_exist(tc->h, it)) {
+      completions_Del(tc, it);
+    }
+  }
+}
+
+void TrieCompletions_Free(TrieCompletions *tc) {
+  if (!tc) return;
+  completions_Clear(tc);
+  kh_destroy(completions, tc->h);
+  free(tc);
+}
+
+float TrieCompletion_Rank(const rune *prefix, t_len plen, size_t qlen, const rune *str, t_len len,
+                          float score) {
+  if (len > 0 && len == plen && memcmp(prefix, str, len * sizeof(rune)) == 0) {
+    score = INT_MAX;
+  }
+  return score / sqrt(1 + (len >= qlen ? len - qlen : qlen - len));
+}
+
+const TrieCompletionList *TrieCompletions_Get(TrieCompletions *tc, const rune *prefix, t_len plen) {
+  khiter_t it = kh_get(completions, tc->h, ((prefixKey){.str = prefix, .len = plen}));
+  return it == kh_end(tc->h) ? NULL : kh_val(tc->h, it);
+}
+
+TrieCompletionList *TrieCompletions_Put(TrieCompletions *tc, const rune *prefix, t_len plen) {
+  if (kh_size(tc->h) >= TRIE_COMPLETIONS_MAX_PREFIXES) {
+    completions_Clear(tc);
+  }
+
+  rune *key = malloc(plen * sizeof(rune));
+  memcpy(key, prefix, plen * sizeof(rune));
+  int rc;
+  khiter_t it = kh_put(completions, tc->h, ((prefixKey){.str = key, .len = plen}), &rc);
+  if (rc == 0) {
+    // already cached - replace the old list
+    free(key);
+    completionList_Free(kh_val(tc->h, it));
+  }
+  TrieCompletionList *l = calloc(1, sizeof(*l));
+  kh_val(tc->h, it) = l;
+  return l;
+}
+
+void TrieCompletionList_Add(TrieCompletionList *l, const rune *str, t_len len, float rank) {
+  if (l->num == TRIE_COMPLETIONS_K) return;
+  TrieCompletion *c = &l->entries[l->num++];
+  c->str = malloc(len * sizeof(rune));
+  memcpy(c->str, str, len * sizeof(rune));
+  c->len = len;
+  c->rank = rank;
+}
+
+/* Move entry i up or down the list to keep it sorted by descending rank */
+static void completionList_Reposition(TrieCompletionList *l, int i) {
+  TrieCompletion c = l->entries[i];
+  while (i > 0 && l->entries[i - 1].rank < c.rank) {
+    l->entries[i] = l->entries[i - 1];
+    i--;
+  }
+  while (i < l->num - 1 && l->entries[i + 1].rank > c.rank) {
+    l->entries[i] = l->entries[i + 1];
+    i++;
+  }
+  l->entries[i] = c;
+}
+
+/* Apply the new score of str to a prefix's list. Returns 0 if the list can no longer be trusted to
+ * hold the top completions, and should be dropped */
+static int completionList_Update(TrieCompletionList *l, const rune *prefix, t_len plen, size_t qlen,
+                                 const rune *str, t_len len, float score) {
+  int i = 0;
+  while (i < l->num && !(l->entries[i].len == len &&
+                         !memcmp(l->entries[i].str, str, len * sizeof(rune)))) {
+    i++;
+  }
+  const int full = l->num == TRIE_COMPLETIONS_K;
+
+  if (i < l->num) {
+    float rank = score ? TrieCompletion_Rank(prefix, plen, qlen, str, len, score) : 0;
+    // the string went down - if we don't have all completions, another one may take its place
+    if (full && rank < l->entries[i].rank) {
+      return 0;
+    }
+    if (!score) {
+      free(l->entries[i].str);
+      memmove(&l->entries[i], &l->entries[i + 1], (l->num - i - 1) * sizeof(TrieCompletion));
+      l->num--;
+      return 1;
+    }
+    l->entries[i].rank = rank;
+    completionList_Reposition(l, i);
+    return 1;
+  }
+
+  if (!score) return 1;
+  float rank = TrieCompletion_Rank(prefix, plen, qlen, str, len, score);
+  if (full) {
+    // a new completion that does not make it into the list
+    if (rank <= l->entries[l->num - 1].rank) return 1;
+    free(l->entries[--l->num].str);
+  }
+  TrieCompletionList_Add(l, str, len, rank);
+  completionList_Reposition(l, l->num - 1);
+  return 1;
+}
+
+void TrieCompletions_Update(TrieCompletions *tc, const rune *str, t_len len, float score) {
+  if (!kh_size(tc->h)) return;
+
+  rune folded[len];
+  size_t qlen = 0;
+  for (t_len i = 0; i < len; i++) {
+    folded[i] = runeFold(str[i]);
+    qlen += runeUtf8Len(folded[i]);
+
+    khiter_t it = kh_get(completions, tc->h, ((prefixKey){.str = folded, .len = i + 1}));
+    if (it != kh_end(tc->h) &&
+        !completionList_Update(kh_val(tc->h, it), folded, i + 1, qlen, str, len, score)) {
+      completions_Del(tc, it);
+    }
+  }
+}
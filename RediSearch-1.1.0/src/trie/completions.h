@@ -0,0 +1,60 @@
+#ifndef __TRIE_COMPLETIONS_H__
+#define __TRIE_COMPLETIONS_H__
+
+#include "trie.h"
+
+/* A cache of the top completions of prefixes searched in a trie, used to answer non fuzzy prefix
+ * searches (i.e. FT.SUGGET) with a single lookup instead of traversing the prefix's subtree.
+ *
+ * Entries are keyed by the case folded prefix rather than by trie node, since prefix searches are
+ * case insensitive and a single prefix may span several nodes. They are created lazily on the first
+ * search of a prefix, and maintained incrementally when strings are added or deleted. An update that
+ * may bring in a string we did not keep (e.g. lowering the score of a cached string) just drops the
+ * prefix's entry, to be rebuilt by the next search. */
+
+/* The number of completions we keep per prefix. SUGGET returns at most 10 results */
+#define TRIE_COMPLETIONS_K 10
+
+/* The maximal number of cached prefixes. When reached, the cache is cleared */
+#define TRIE_COMPLETIONS_MAX_PREFIXES 4096
+
+typedef struct {
+  // the completion string, as it is in the trie
+  rune *str;
+  t_len len;
+  // the score used for ranking the completion for this prefix
+  float rank;
+} TrieCompletion;
+
+typedef struct {
+  TrieCompletion entries[TRIE_COMPLETIONS_K];
+  // if there are less than TRIE_COMPLETIONS_K entries, these are all the prefix's completions
+  int num;
+} TrieCompletionList;
+
+typedef struct TrieCompletions TrieCompletions;
+
+TrieCompletions *NewTrieCompletions();
+
+void TrieCompletions_Free(TrieCompletions *tc);
+
+/* The score a prefix search ranks a completion by - an exact match comes first, and then longer
+ * completions are penalized. plen is the prefix length in runes, and qlen its length in bytes */
+float TrieCompletion_Rank(const rune *prefix, t_len plen, size_t qlen, const rune *str, t_len len,
+                          float score);
+
+/* Get the cached completions of a folded prefix, or NULL if they are not cached */
+const TrieCompletionList *TrieCompletions_Get(TrieCompletions *tc, const rune *prefix, t_len plen);
+
+/* Start caching completions for a folded prefix. Returns the new list, to be filled by the caller
+ * with TrieCompletionList_Add */
+TrieCompletionList *TrieCompletions_Put(TrieCompletions *tc, const rune *prefix, t_len plen);
+
+/* Add a completion to a new list. Completions should be added by descending rank */
+void TrieCompletionList_Add(TrieCompletionList *l, const rune *str, t_len len, float rank);
+
+/* Update the cached prefixes of str after its score has changed. A score of 0 means the string was
+ * deleted */
+void TrieCompletions_Update(TrieCompletions *tc, const rune *str, t_len len, float score);
+
+#endif
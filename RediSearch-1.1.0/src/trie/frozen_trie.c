@@ -0,0 +1,519 @@
+#include "frozen_trie.h"
+#include "../util/arr.h"
+#include <sys/param.h>
+
+#define FROZEN_TERMINAL 0x1
+#define FROZEN_DELETED 0x2
+
+typedef struct {
+  // offset of the node's utf-8 label in the labels arena
+  uint32_t label;
+  // index of the node's first child. The children of a node are contiguous
+  uint32_t children;
+  // the label's length in bytes
+  uint16_t labelLen;
+  t_len numChildren;
+} frozenNode;
+
+struct FrozenTrie {
+  frozenNode *nodes;
+  float *scores;
+  // the maximal score of the node and any of its descendants, used to skip subtrees when iterating
+  float *maxChildScores;
+  // offset of each node's payload in the payloads arena, or FROZEN_TRIE_NONE
+  uint32_t *payloads;
+  uint8_t *flags;
+  uint32_t numNodes;
+  uint32_t root;
+  size_t numStrings;
+
+  char *labels;
+  size_t labelsLen;
+  // payloads are stored as TriePayloads, i.e. their length followed by their data
+  char *payloadData;
+  size_t payloadDataLen;
+};
+
+#define __ft_isLive(ft, n) \
+  (((ft)->flags[n] & (FROZEN_TERMINAL | FROZEN_DELETED)) == FROZEN_TERMINAL)
+
+size_t FrozenTrie_Size(FrozenTrie *ft) {
+  return ft->numStrings;
+}
+
+size_t FrozenTrie_MemUsage(FrozenTrie *ft) {
+  return sizeof(*ft) +
+         ft->numNodes * (sizeof(frozenNode) + 2 * sizeof(float) + sizeof(uint32_t) + 1) +
+         ft->labelsLen + ft->payloadDataLen;
+}
+
+void FrozenTrie_Free(FrozenTrie *ft) {
+  if (!ft) return;
+  free(ft->nodes);
+  free(ft->scores);
+  free(ft->maxChildScores);
+  free(ft->payloads);
+  free(ft->flags);
+  free(ft->labels);
+  free(ft->payloadData);
+  free(ft);
+}
+
+/***************************************************************
+ *
+ *                       Building
+ *
+ ***************************************************************/
+
+/* A node whose children are all complete, waiting for its parent to be complete, so that it can be
+ * placed along with its siblings */
+typedef struct {
+  rune *label;
+  t_len labelLen;
+  uint32_t children;
+  t_len numChildren;
+  float score;
+  float maxChildScore;
+  uint32_t payload;
+  uint8_t flags;
+} builderRecord;
+
+/* A node on the path of the last added string. Its children are complete records */
+typedef struct {
+  uint8_t flags;
+  float score;
+  uint32_t payload;
+  builderRecord *children;
+} builderLevel;
+
+struct FrozenTrieBuilder {
+  FrozenTrie *ft;
+  size_t nodesCap;
+  size_t labelsCap;
+  size_t payloadDataCap;
+  // the last added string. Level i is the node of its first i runes
+  rune prev[TRIE_MAX_STRING_LEN];
+  t_len prevLen;
+  builderLevel levels[TRIE_MAX_STRING_LEN + 1];
+};
+
+static void builder_openLevel(FrozenTrieBuilder *b, t_len d) {
+  builderLevel *l = &b->levels[d];
+  l->flags = 0;
+  l->score = 0;
+  l->payload = FROZEN_TRIE_NONE;
+  if (!l->children) {
+    l->children = array_new(builderRecord, 4);
+  }
+  array_hdr(l->children)->len = 0;
+}
+
+FrozenTrieBuilder *NewFrozenTrieBuilder() {
+  FrozenTrieBuilder *b = calloc(1, sizeof(*b));
+  b->ft = calloc(1, sizeof(*b->ft));
+  builder_openLevel(b, 0);
+  return b;
+}
+
+static uint32_t builder_addPayload(FrozenTrieBuilder *b, const char *payload, size_t plen) {
+  if (!payload || !plen) return FROZEN_TRIE_NONE;
+  FrozenTrie *ft = b->ft;
+  size_t sz = sizeof(TriePayload) + plen;
+  if (ft->payloadDataLen + sz > b->payloadDataCap) {
+    b->payloadDataCap = MAX(b->payloadDataCap * 2, ft->payloadDataLen + sz);
+    ft->payloadData = realloc(ft->payloadData, b->payloadDataCap);
+  }
+  uint32_t off = ft->payloadDataLen;
+  TriePayload *tp = (TriePayload *)(ft->payloadData + off);
+  tp->len = plen;
+  memcpy(tp->data, payload, plen);
+  ft->payloadDataLen += sz;
+  return off;
+}
+
+/* Write a record as a new node, returning its index */
+static uint32_t builder_placeNode(FrozenTrieBuilder *b, builderRecord *r) {
+  FrozenTrie *ft = b->ft;
+  if (ft->numNodes == b->nodesCap) {
+    b->nodesCap = MAX(b->nodesCap * 2, 16);
+    ft->nodes = realloc(ft->nodes, b->nodesCap * sizeof(*ft->nodes));
+    ft->scores = realloc(ft->scores, b->nodesCap * sizeof(*ft->scores));
+    ft->maxChildScores = realloc(ft->maxChildScores, b->nodesCap * sizeof(*ft->maxChildScores));
+    ft->payloads = realloc(ft->payloads, b->nodesCap * sizeof(*ft->payloads));
+    ft->flags = realloc(ft->flags, b->nodesCap * sizeof(*ft->flags));
+  }
+
+  // a rune takes at most 4 bytes as utf-8
+  if (ft->labelsLen + r->labelLen * 4 > b->labelsCap) {
+    b->labelsCap = MAX(b->labelsCap * 2, ft->labelsLen + r->labelLen * 4);
+    ft->labels = realloc(ft->labels, b->labelsCap);
+  }
+  char *start = ft->labels + ft->labelsLen, *p = start;
+  for (t_len i = 0; i < r->labelLen; i++) {
+    p = nu_utf8_write(r->label[i], p);
+  }
+  free(r->label);
+
+  uint32_t n = ft->numNodes++;
+  ft->nodes[n] = (frozenNode){.label = ft->labelsLen,
+                              .children = r->children,
+                              .labelLen = p - start,
+                              .numChildren = r->numChildren};
+  ft->labelsLen += p - start;
+  ft->scores[n] = r->score;
+  ft->maxChildScores[n] = r->maxChildScore;
+  ft->payloads[n] = r->payload;
+  ft->flags[n] = r->flags;
+  return n;
+}
+
+static int cmpRecords(const void *p1, const void *p2) {
+  const builderRecord *r1 = p1, *r2 = p2;
+  return r1->maxChildScore < r2->maxChildScore ? 1 : r1->maxChildScore > r2->maxChildScore ? -1 : 0;
+}
+
+/* Place the children of a complete level contiguously, and turn the level into a record */
+static builderRecord builder_placeLevel(FrozenTrieBuilder *b, builderLevel *l, rune *label,
+                                        t_len labelLen) {
+  builderRecord r = {.label = label,
+                     .labelLen = labelLen,
+                     .children = b->ft->numNodes,
+                     .numChildren = array_len(l->children),
+                     .score = l->score,
+                     .maxChildScore = l->score,
+                     .payload = l->payload,
+                     .flags = l->flags};
+
+  // like TrieNode, iterate the children with the highest scores first
+  qsort(l->children, r.numChildren, sizeof(builderRecord), cmpRecords);
+  for (t_len i = 0; i < r.numChildren; i++) {
+    r.maxChildScore = MAX(r.maxChildScore, l->children[i].maxChildScore);
+    builder_placeNode(b, &l->children[i]);
+  }
+  array_hdr(l->children)->len = 0;
+  return r;
+}
+
+/* Complete the nodes of the last string deeper than depth, adding each to its parent's children */
+static void builder_closeLevels(FrozenTrieBuilder *b, t_len depth) {
+  for (t_len d = b->prevLen; d > depth; d--) {
+    builderLevel *l = &b->levels[d];
+    builderRecord r;
+    if (!l->flags && array_len(l->children) == 1) {
+      // a non terminal node with a single child is merged into its child
+      r = l->children[0];
+      r.label = realloc(r.label, (r.labelLen + 1) * sizeof(rune));
+      memmove(r.label + 1, r.label, r.labelLen * sizeof(rune));
+      r.label[0] = b->prev[d - 1];
+      r.labelLen++;
+      array_hdr(l->children)->len = 0;
+    } else {
+      rune *label = malloc(sizeof(rune));
+      label[0] = b->prev[d - 1];
+      r = builder_placeLevel(b, l, label, 1);
+    }
+    b->levels[d - 1].children = array_append(b->levels[d - 1].children, r);
+  }
+  b->prevLen = MIN(b->prevLen, depth);
+}
+
+void FrozenTrieBuilder_Add(FrozenTrieBuilder *b, const rune *str, t_len len, float score,
+                           const char *payload, size_t plen) {
+  if (len == 0 || len > TRIE_MAX_STRING_LEN) return;
+
+  t_len lcp = 0;
+  while (lcp < b->prevLen && lcp < len && b->prev[lcp] == str[lcp]) {
+    lcp++;
+  }
+  // strings are added in ascending order, so the nodes of the previous string below the common
+  // prefix will not get any more children
+  builder_closeLevels(b, lcp);
+  for (t_len d = lcp + 1; d <= len; d++) {
+    builder_openLevel(b, d);
+  }
+  memcpy(b->prev + lcp, str + lcp, (len - lcp) * sizeof(rune));
+  b->prevLen = len;
+
+  builderLevel *l = &b->levels[len];
+  if (!l->flags) {
+    b->ft->numStrings++;
+  }
+  l->flags = FROZEN_TERMINAL;
+  l->score = score;
+  l->payload = builder_addPayload(b, payload, plen);
+}
+
+FrozenTrie *FrozenTrieBuilder_Finish(FrozenTrieBuilder *b) {
+  builder_closeLevels(b, 0);
+  builderRecord root = builder_placeLevel(b, &b->levels[0], NULL, 0);
+  FrozenTrie *ft = b->ft;
+  ft->root = builder_placeNode(b, &root);
+
+  ft->nodes = realloc(ft->nodes, ft->numNodes * sizeof(*ft->nodes));
+  ft->scores = realloc(ft->scores, ft->numNodes * sizeof(*ft->scores));
+  ft->maxChildScores = realloc(ft->maxChildScores, ft->numNodes * sizeof(*ft->maxChildScores));
+  ft->payloads = realloc(ft->payloads, ft->numNodes * sizeof(*ft->payloads));
+  ft->flags = realloc(ft->flags, ft->numNodes * sizeof(*ft->flags));
+  if (ft->labelsLen) ft->labels = realloc(ft->labels, ft->labelsLen);
+  if (ft->payloadDataLen) ft->payloadData = realloc(ft->payloadData, ft->payloadDataLen);
+
+  for (int i = 0; i <= TRIE_MAX_STRING_LEN; i++) {
+    if (b->levels[i].children) array_free(b->levels[i].children);
+  }
+  free(b);
+  return ft;
+}
+
+/***************************************************************
+ *
+ *                       Lookups and updates
+ *
+ ***************************************************************/
+
+static inline rune ft_firstRune(FrozenTrie *ft, uint32_t n) {
+  uint32_t cp;
+  nu_utf8_read(ft->labels + ft->nodes[n].label, &cp);
+  return (rune)cp;
+}
+
+static inline void ft_payload(FrozenTrie *ft, uint32_t n, RSPayload *payload) {
+  if (ft->payloads[n] == FROZEN_TRIE_NONE) {
+    payload->data = NULL;
+    payload->len = 0;
+  } else {
+    TriePayload *tp = (TriePayload *)(ft->payloadData + ft->payloads[n]);
+    payload->data = tp->data;
+    payload->len = tp->len;
+  }
+}
+
+/* Find the node holding exactly str, putting the nodes on the way to it in path if it's not NULL.
+ * Returns FROZEN_TRIE_NONE if there is no such node */
+static uint32_t ft_lookup(FrozenTrie *ft, const rune *str, t_len len, uint32_t *path,
+                          int *pathLen) {
+  uint32_t n = ft->root;
+  t_len offset = 0;
+  for (;;) {
+    if (path) path[(*pathLen)++] = n;
+    frozenNode *fn = &ft->nodes[n];
+    const char *p = ft->labels + fn->label, *end = p + fn->labelLen;
+    while (p < end) {
+      uint32_t cp;
+      p = nu_utf8_read(p, &cp);
+      if (offset == len || (rune)cp != str[offset++]) {
+        return FROZEN_TRIE_NONE;
+      }
+    }
+    if (offset == len) {
+      return n;
+    }
+
+    uint32_t next = FROZEN_TRIE_NONE;
+    for (t_len i = 0; i < fn->numChildren; i++) {
+      if (ft_firstRune(ft, fn->children + i) == str[offset]) {
+        next = fn->children + i;
+        break;
+      }
+    }
+    if (next == FROZEN_TRIE_NONE) {
+      return FROZEN_TRIE_NONE;
+    }
+    n = next;
+  }
+}
+
+int FrozenTrie_Find(FrozenTrie *ft, const rune *str, t_len len, float *score, RSPayload *payload) {
+  uint32_t n = ft_lookup(ft, str, len, NULL, NULL);
+  if (n == FROZEN_TRIE_NONE || !__ft_isLive(ft, n)) {
+    return 0;
+  }
+  if (score) *score = ft->scores[n];
+  if (payload) ft_payload(ft, n, payload);
+  return 1;
+}
+
+int FrozenTrie_SetScore(FrozenTrie *ft, const rune *str, t_len len, float score) {
+  uint32_t path[TRIE_MAX_STRING_LEN + 1];
+  int pathLen = 0;
+  uint32_t n = ft_lookup(ft, str, len, path, &pathLen);
+  if (n == FROZEN_TRIE_NONE || !__ft_isLive(ft, n)) {
+    return 0;
+  }
+  ft->scores[n] = score;
+  for (int i = 0; i < pathLen; i++) {
+    ft->maxChildScores[path[i]] = MAX(ft->maxChildScores[path[i]], score);
+  }
+  return 1;
+}
+
+int FrozenTrie_Delete(FrozenTrie *ft, const rune *str, t_len len) {
+  uint32_t n = ft_lookup(ft, str, len, NULL, NULL);
+  if (n == FROZEN_TRIE_NONE || !__ft_isLive(ft, n)) {
+    return 0;
+  }
+  // the max scores of the ancestors are left as they are. They only serve as an upper bound
+  ft->flags[n] |= FROZEN_DELETED;
+  ft->scores[n] = 0;
+  return 1;
+}
+
+typedef struct {
+  rune r;
+  uint32_t node;
+} childRune;
+
+static int cmpChildRunes(const void *p1, const void *p2) {
+  const childRune *c1 = p1, *c2 = p2;
+  return (int)c1->r - (int)c2->r;
+}
+
+static void ft_walk(FrozenTrie *ft, uint32_t n, rune *buf, t_len len, FrozenTrieWalkCallback cb,
+                    void *ctx) {
+  frozenNode *fn = &ft->nodes[n];
+  const char *p = ft->labels + fn->label, *end = p + fn->labelLen;
+  while (p < end) {
+    uint32_t cp;
+    p = nu_utf8_read(p, &cp);
+    buf[len++] = (rune)cp;
+  }
+  if (__ft_isLive(ft, n)) {
+    RSPayload payload;
+    ft_payload(ft, n, &payload);
+    cb(buf, len, ft->scores[n], &payload, ctx);
+  }
+  if (!fn->numChildren) return;
+
+  // children are ordered by score, so we sort them by their first rune
+  childRune *children = malloc(fn->numChildren * sizeof(*children));
+  for (t_len i = 0; i < fn->numChildren; i++) {
+    children[i] = (childRune){.r = ft_firstRune(ft, fn->children + i), .node = fn->children + i};
+  }
+  qsort(children, fn->numChildren, sizeof(*children), cmpChildRunes);
+  for (t_len i = 0; i < fn->numChildren; i++) {
+    ft_walk(ft, children[i].node, buf, len, cb, ctx);
+  }
+  free(children);
+}
+
+void FrozenTrie_Walk(FrozenTrie *ft, FrozenTrieWalkCallback cb, void *ctx) {
+  rune buf[TRIE_MAX_STRING_LEN + 1];
+  ft_walk(ft, ft->root, buf, 0, cb, ctx);
+}
+
+/***************************************************************
+ *
+ *                       Iteration
+ *
+ ***************************************************************/
+
+static void fti_push(FrozenTrieIterator *it, uint32_t node) {
+  if (it->stackOffset < TRIE_MAX_STRING_LEN - 1) {
+    frozenStackNode *sn = &it->stack[it->stackOffset++];
+    *sn = (frozenStackNode){.state = ITERSTATE_SELF, .node = node};
+  }
+}
+
+static void fti_pop(FrozenTrieIterator *it) {
+  if (it->stackOffset > 0) {
+    frozenStackNode *current = &it->stack[it->stackOffset - 1];
+    if (it->popCallback) {
+      it->popCallback(it->ctx, current->stringOffset);
+    }
+    it->bufOffset -= current->stringOffset;
+    --it->stackOffset;
+  }
+}
+
+/* A single iteration step, see __ti_step */
+static int fti_step(FrozenTrieIterator *it, void *matchCtx) {
+  if (it->stackOffset == 0) {
+    return __STEP_STOP;
+  }
+  FrozenTrie *ft = it->ft;
+  frozenStackNode *current = &it->stack[it->stackOffset - 1];
+  frozenNode *fn = &ft->nodes[current->node];
+  int matched = 0;
+
+  switch (current->state) {
+    case ITERSTATE_MATCH:
+      fti_pop(it);
+      return __STEP_CONT;
+
+    case ITERSTATE_SELF:
+      if (current->labelOffset < fn->labelLen) {
+        uint32_t cp;
+        const char *p = ft->labels + fn->label + current->labelOffset;
+        const char *next = nu_utf8_read(p, &cp);
+        rune b = (rune)cp;
+
+        if (it->filter) {
+          FilterCode rc = it->filter(b, it->ctx, &matched, matchCtx);
+          if (rc == F_STOP) {
+            if (matched) {
+              current->state = ITERSTATE_MATCH;
+              return __STEP_MATCH;
+            }
+            fti_pop(it);
+            return __STEP_CONT;
+          }
+        }
+
+        it->buf[it->bufOffset++] = b;
+        current->stringOffset++;
+        current->labelOffset += next - p;
+
+        if (!it->filter && current->labelOffset == fn->labelLen && __ft_isLive(ft, current->node)) {
+          matched = 1;
+        }
+        return matched ? __STEP_MATCH : __STEP_CONT;
+      }
+      current->state = ITERSTATE_CHILDREN;
+
+    case ITERSTATE_CHILDREN:
+    default:
+      if (current->childOffset < fn->numChildren) {
+        uint32_t ch = fn->children + current->childOffset++;
+        if (ft->maxChildScores[ch] >= it->minScore) {
+          fti_push(it, ch);
+        }
+      } else {
+        fti_pop(it);
+      }
+  }
+  return __STEP_CONT;
+}
+
+FrozenTrieIterator *FrozenTrie_Iterate(FrozenTrie *ft, StepFilter f, StackPopCallback pf,
+                                       void *ctx) {
+  FrozenTrieIterator *it = calloc(1, sizeof(*it));
+  it->ft = ft;
+  it->filter = f;
+  it->popCallback = pf;
+  it->ctx = ctx;
+  fti_push(it, ft->root);
+  return it;
+}
+
+int FrozenTrieIterator_Next(FrozenTrieIterator *it, rune **ptr, t_len *len, RSPayload *payload,
+                            float *score, void *matchCtx) {
+  int rc;
+  while ((rc = fti_step(it, matchCtx)) != __STEP_STOP) {
+    if (rc == __STEP_MATCH) {
+      frozenStackNode *sn = &it->stack[it->stackOffset - 1];
+      if (__ft_isLive(it->ft, sn->node) && sn->labelOffset == it->ft->nodes[sn->node].labelLen) {
+        *ptr = it->buf;
+        *len = it->bufOffset;
+        *score = it->ft->scores[sn->node];
+        if (payload != NULL) {
+          ft_payload(it->ft, sn->node, payload);
+        }
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+void FrozenTrieIterator_Free(FrozenTrieIterator *it) {
+  free(it);
+}
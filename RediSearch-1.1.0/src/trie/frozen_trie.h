@@ -0,0 +1,92 @@
+#ifndef __FROZEN_TRIE_H__
+#define __FROZEN_TRIE_H__
+
+#include "trie.h"
+
+/* A compact, read mostly representation of a trie, used for large suggestion dictionaries.
+ *
+ * Instead of a heap allocated node per edge, all nodes are kept in a few flat arrays, with the
+ * children of each node laid out contiguously and referenced by the index of the first one. Node
+ * labels are stored as utf-8 in a single string arena, and payloads in a separate arena. The
+ * structure cannot be changed once built, but scores can be updated and strings deleted in place.
+ * New strings go to a regular mutable trie, which is merged with the frozen trie into a new one
+ * from time to time.
+ *
+ * Like TrieNode, children are ordered by descending max score, and iteration accepts the same
+ * step filters (e.g. the levenshtein DFA). */
+
+#define FROZEN_TRIE_NONE UINT32_MAX
+
+typedef struct FrozenTrie FrozenTrie;
+
+/* Frozen tries are built by adding their strings in ascending rune order */
+typedef struct FrozenTrieBuilder FrozenTrieBuilder;
+
+FrozenTrieBuilder *NewFrozenTrieBuilder();
+
+/* Add a string with its score and payload. Strings must be added in strictly ascending order */
+void FrozenTrieBuilder_Add(FrozenTrieBuilder *b, const rune *str, t_len len, float score,
+                           const char *payload, size_t plen);
+
+/* Finish building, freeing the builder, and return the new frozen trie */
+FrozenTrie *FrozenTrieBuilder_Finish(FrozenTrieBuilder *b);
+
+void FrozenTrie_Free(FrozenTrie *ft);
+
+/* The number of strings in the trie, including deleted ones */
+size_t FrozenTrie_Size(FrozenTrie *ft);
+
+/* The number of bytes the trie takes */
+size_t FrozenTrie_MemUsage(FrozenTrie *ft);
+
+/* Find a string that was not deleted. Returns 1 and puts its score and payload (which may be NULL)
+ * in the pointers if found, 0 otherwise */
+int FrozenTrie_Find(FrozenTrie *ft, const rune *str, t_len len, float *score, RSPayload *payload);
+
+/* Set the score of an existing string that was not deleted. Returns 0 if it is not in the trie */
+int FrozenTrie_SetScore(FrozenTrie *ft, const rune *str, t_len len, float score);
+
+/* Delete a string. Returns 1 if it was in the trie and not already deleted, 0 otherwise */
+int FrozenTrie_Delete(FrozenTrie *ft, const rune *str, t_len len);
+
+/* Call the callback on each string that was not deleted, in ascending rune order. Used for merging
+ * tries */
+typedef void (*FrozenTrieWalkCallback)(const rune *str, t_len len, float score, RSPayload *payload,
+                                       void *ctx);
+void FrozenTrie_Walk(FrozenTrie *ft, FrozenTrieWalkCallback cb, void *ctx);
+
+/* frozen trie iterator stack node. for internal use only */
+typedef struct {
+  int state;
+  uint32_t node;
+  // the offset in the node's utf-8 label
+  uint16_t labelOffset;
+  t_len stringOffset;
+  t_len childOffset;
+} frozenStackNode;
+
+typedef struct {
+  FrozenTrie *ft;
+  rune buf[TRIE_MAX_STRING_LEN + 1];
+  t_len bufOffset;
+
+  frozenStackNode stack[TRIE_MAX_STRING_LEN + 1];
+  t_len stackOffset;
+  StepFilter filter;
+  float minScore;
+  StackPopCallback popCallback;
+  void *ctx;
+} FrozenTrieIterator;
+
+/* Iterate the trie with a step filter, exactly like TrieNode_Iterate */
+FrozenTrieIterator *FrozenTrie_Iterate(FrozenTrie *ft, StepFilter f, StackPopCallback pf,
+                                       void *ctx);
+
+/* Iterate to the next matching entry in the trie. Returns 1 if we can continue, or 0 if we're done
+ * and should exit */
+int FrozenTrieIterator_Next(FrozenTrieIterator *it, rune **ptr, t_len *len, RSPayload *payload,
+                            float *score, void *matchCtx);
+
+void FrozenTrieIterator_Free(FrozenTrieIterator *it);
+
+#endif
@@ -2,8 +2,11 @@
 #include <stdio.h>
 #include <sys/param.h>
 #include <string.h>
+#include <pthread.h>
 #include "levenshtein.h"
 #include "rune_util.h"
+#include "../util/khash.h"
+#include "../util/fnv.h"
 
 // NewSparseAutomaton creates a new automaton for the string s, with a given max
 // edit distance check
@@ -81,7 +84,6 @@ dfaNode *__newDfaNode(int distance, sparseVector *state) {
   ret->distance = distance;
   ret->v = state;
   ret->edges = NULL;
-  ret->numEdges = 0;
 
   return ret;
 }
@@ -104,118 +106,264 @@ int __sv_equals(sparseVector *sv1, sparseVector *sv2) {
   return 1;
 }
 
-dfaNode *__dfn_getCache(Vector *cache, sparseVector *v) {
-  size_t n = Vector_Size(cache);
-  for (int i = 0; i < n; i++) {
-    dfaNode *dfn;
-    Vector_Get(cache, i, &dfn);
+static inline khint_t __sv_hash(sparseVector *v) {
+  return rs_fnv_32a_buf(v->entries, v->len * sizeof(sparseVectorEntry), 0);
+}
+
+// The table of the automaton states during construction, mapping state vectors to their nodes
+KHASH_INIT(dfaStates, sparseVector *, dfaNode *, 1, __sv_hash, __sv_equals);
 
-    if (__sv_equals(v, dfn->v)) {
-      return dfn;
+/* The position of a rune in the automaton's alphabet, or -1 if it is not in it */
+static inline int __dfa_runeIndex(dfaAutomaton *dfa, rune r) {
+  size_t lo = 0, hi = dfa->alphabetSize;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (dfa->alphabet[mid] < r) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
   }
-  return NULL;
+  return lo < dfa->alphabetSize && dfa->alphabet[lo] == r ? lo : -1;
 }
 
-void __dfn_putCache(Vector *cache, dfaNode *dfn) {
-  Vector_Push(cache, dfn);
+inline dfaNode *__dfn_getEdge(dfaAutomaton *dfa, dfaNode *n, rune r) {
+  int i = __dfa_runeIndex(dfa, r);
+  return i < 0 ? NULL : n->edges[i];
 }
 
-inline dfaNode *__dfn_getEdge(dfaNode *n, rune r) {
-  for (int i = 0; i < n->numEdges; i++) {
-    if (n->edges[i].r == r) {
-      return n->edges[i].n;
-    }
+typedef struct {
+  dfaAutomaton *dfa;
+  SparseAutomaton a;
+  khash_t(dfaStates) * states;
+  size_t nodesCap;
+} dfaBuilder;
+
+static void dfa_build(dfaBuilder *b, dfaNode *parent);
+
+/* Add a new node to the automaton and build its transitions */
+static dfaNode *dfaBuilder_AddNode(dfaBuilder *b, khiter_t it, int distance, sparseVector *v) {
+  dfaAutomaton *dfa = b->dfa;
+  dfaNode *dfn = __newDfaNode(distance, v);
+  dfn->edges = calloc(dfa->alphabetSize + 1, sizeof(dfaNode *));
+  kh_val(b->states, it) = dfn;
+
+  if (dfa->numNodes == b->nodesCap) {
+    b->nodesCap = b->nodesCap ? b->nodesCap * 2 : 16;
+    dfa->nodes = realloc(dfa->nodes, b->nodesCap * sizeof(dfaNode *));
   }
-  return NULL;
+  dfa->nodes[dfa->numNodes++] = dfn;
+
+  dfa_build(b, dfn);
+  return dfn;
 }
 
-void __dfn_addEdge(dfaNode *n, rune r, dfaNode *child) {
-  n->edges = realloc(n->edges, sizeof(dfaEdge) * (n->numEdges + 1));
-  n->edges[n->numEdges++] = (dfaEdge){.r = r, .n = child};
+/* Get the node of the state the vector represents, creating it if needed. Returns NULL for the
+ * empty state. The builder takes ownership of the vector */
+static dfaNode *dfaBuilder_GetNode(dfaBuilder *b, sparseVector *v) {
+  if (v->len == 0) {
+    sparseVector_free(v);
+    return NULL;
+  }
+  int rc;
+  khiter_t it = kh_put(dfaStates, b->states, v, &rc);
+  if (rc == 0) {
+    sparseVector_free(v);
+    return kh_val(b->states, it);
+  }
+  return dfaBuilder_AddNode(b, it, v->entries[v->len - 1].val, v);
 }
 
-void dfa_build(dfaNode *parent, SparseAutomaton *a, Vector *cache) {
+/* Recusively build the DFA node and all its descendants */
+static void dfa_build(dfaBuilder *b, dfaNode *parent) {
+  SparseAutomaton *a = &b->a;
   parent->match = SparseAutomaton_IsMatch(a, parent->v);
 
   for (int i = 0; i < parent->v->len; i++) {
     if (parent->v->entries[i].idx < a->len) {
       rune c = a->string[parent->v->entries[i].idx];
-      // printf("%c ---> ", c);
-      dfaNode *edge = __dfn_getEdge(parent, c);
-      if (edge == NULL) {
-        sparseVector *nv = SparseAutomaton_Step(a, parent->v, c);
-
-        if (nv->len > 0) {
-          dfaNode *dfn = __dfn_getCache(cache, nv);
-          if (dfn == NULL) {
-            int dist = nv->entries[nv->len - 1].val;
-            edge = __newDfaNode(dist, nv);
-            __dfn_addEdge(parent, c, edge);
-            __dfn_putCache(cache, edge);
-            dfa_build(edge, a, cache);
-            continue;
-          } else {
-            __dfn_addEdge(parent, c, dfn);
-          }
-        }
-        sparseVector_free(nv);
+      int ai = __dfa_runeIndex(b->dfa, c);
+      if (parent->edges[ai] == NULL) {
+        parent->edges[ai] = dfaBuilder_GetNode(b, SparseAutomaton_Step(a, parent->v, c));
       }
     }
   }
 
-  // if (parent->distance < a->max) {
-  sparseVector *nv = SparseAutomaton_Step(a, parent->v, 1);
+  parent->fallback = dfaBuilder_GetNode(b, SparseAutomaton_Step(a, parent->v, 1));
+}
 
-  if (nv->len > 0) {
-    dfaNode *dfn = __dfn_getCache(cache, nv);
-    if (dfn) {
-      parent->fallback = dfn;
-    } else {
-      int dist = nv->entries[nv->len - 1].val;
-      // printf("DEFAULT EDGE! edge %s - dist %d\n", a->string, dist);
-      parent->fallback = __newDfaNode(dist, nv);
-      __dfn_putCache(cache, parent->fallback);
-      dfa_build(parent->fallback, a, cache);
-      return;
+static int cmpRunes(const void *p1, const void *p2) {
+  rune r1 = *(const rune *)p1, r2 = *(const rune *)p2;
+  return r1 < r2 ? -1 : (r1 > r2 ? 1 : 0);
+}
+
+static dfaAutomaton *newDfaAutomaton(const rune *str, size_t len, int maxDist) {
+  dfaAutomaton *dfa = calloc(1, sizeof(*dfa));
+  dfa->str = malloc((len + 1) * sizeof(rune));
+  memcpy(dfa->str, str, len * sizeof(rune));
+  dfa->len = len;
+  dfa->maxDist = maxDist;
+
+  // the alphabet is the sorted distinct runes of the string
+  dfa->alphabet = malloc((len + 1) * sizeof(rune));
+  memcpy(dfa->alphabet, str, len * sizeof(rune));
+  qsort(dfa->alphabet, len, sizeof(rune), cmpRunes);
+  for (size_t i = 0; i < len; i++) {
+    if (!dfa->alphabetSize || dfa->alphabet[dfa->alphabetSize - 1] != dfa->alphabet[i]) {
+      dfa->alphabet[dfa->alphabetSize++] = dfa->alphabet[i];
     }
   }
-  sparseVector_free(nv);
 
-  //}
+  dfaBuilder b = {.dfa = dfa,
+                  .a = NewSparseAutomaton(dfa->str, len, maxDist),
+                  .states = kh_init(dfaStates),
+                  .nodesCap = 0};
+  sparseVector *v = SparseAutomaton_Start(&b.a);
+  int rc;
+  khiter_t it = kh_put(dfaStates, b.states, v, &rc);
+  dfa->root = dfaBuilder_AddNode(&b, it, 0, v);
+
+  kh_destroy(dfaStates, b.states);
+  return dfa;
 }
 
-DFAFilter NewDFAFilter(rune *str, size_t len, int maxDist, int prefixMode) {
-  Vector *cache = NewVector(dfaNode *, 8);
+static void dfaAutomaton_Free(dfaAutomaton *dfa) {
+  for (size_t i = 0; i < dfa->numNodes; i++) {
+    __dfaNode_free(dfa->nodes[i]);
+  }
+  free(dfa->nodes);
+  free(dfa->alphabet);
+  free(dfa->str);
+  free(dfa);
+}
+
+typedef struct {
+  const rune *str;
+  size_t len;
+  int maxDist;
+} dfaKey;
+
+static inline khint_t dfaKey_hash(dfaKey k) {
+  return rs_fnv_32a_buf((void *)k.str, k.len * sizeof(rune), k.maxDist);
+}
+
+static inline int dfaKey_equal(dfaKey a, dfaKey b) {
+  return a.len == b.len && a.maxDist == b.maxDist && !memcmp(a.str, b.str, a.len * sizeof(rune));
+}
+
+KHASH_INIT(dfaCache, dfaKey, dfaAutomaton *, 1, dfaKey_hash, dfaKey_equal);
+
+/* The LRU cache of compiled automata. Automata are compiled per query, so it is shared by all the
+ * indexes and dictionaries, and may be accessed from the query threads */
+static struct {
+  khash_t(dfaCache) * h;
+  dfaAutomaton *head, *tail;
+  pthread_mutex_t lock;
+} dfaCache_g = {.h = NULL, .head = NULL, .tail = NULL, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+static void dfaCache_Unlink(dfaAutomaton *dfa) {
+  if (dfa->prev) {
+    dfa->prev->next = dfa->next;
+  } else {
+    dfaCache_g.head = dfa->next;
+  }
+  if (dfa->next) {
+    dfa->next->prev = dfa->prev;
+  } else {
+    dfaCache_g.tail = dfa->prev;
+  }
+  dfa->prev = dfa->next = NULL;
+}
 
-  SparseAutomaton a = NewSparseAutomaton(str, len, maxDist);
+static void dfaCache_PushFront(dfaAutomaton *dfa) {
+  dfa->prev = NULL;
+  dfa->next = dfaCache_g.head;
+  if (dfaCache_g.head) {
+    dfaCache_g.head->prev = dfa;
+  } else {
+    dfaCache_g.tail = dfa;
+  }
+  dfaCache_g.head = dfa;
+}
 
-  sparseVector *v = SparseAutomaton_Start(&a);
-  dfaNode *dr = __newDfaNode(0, v);
-  __dfn_putCache(cache, dr);
-  dfa_build(dr, &a, cache);
+/* Remove the least recently used automaton from the cache. It is freed when its last filter is */
+static void dfaCache_EvictLast() {
+  dfaAutomaton *dfa = dfaCache_g.tail;
+  dfaKey key = {.str = dfa->str, .len = dfa->len, .maxDist = dfa->maxDist};
+  khiter_t it = kh_get(dfaCache, dfaCache_g.h, key);
+  kh_del(dfaCache, dfaCache_g.h, it);
+  dfaCache_Unlink(dfa);
+  if (--dfa->refcount == 0) {
+    dfaAutomaton_Free(dfa);
+  }
+}
+
+dfaAutomaton *DFA_Get(const rune *str, size_t len, int maxDist) {
+  dfaKey key = {.str = str, .len = len, .maxDist = maxDist};
+
+  pthread_mutex_lock(&dfaCache_g.lock);
+  if (!dfaCache_g.h) {
+    dfaCache_g.h = kh_init(dfaCache);
+  }
+  khiter_t it = kh_get(dfaCache, dfaCache_g.h, key);
+  if (it != kh_end(dfaCache_g.h)) {
+    dfaAutomaton *dfa = kh_val(dfaCache_g.h, it);
+    dfa->refcount++;
+    dfaCache_Unlink(dfa);
+    dfaCache_PushFront(dfa);
+    pthread_mutex_unlock(&dfaCache_g.lock);
+    return dfa;
+  }
+  pthread_mutex_unlock(&dfaCache_g.lock);
+
+  // compile the automaton without holding the lock
+  dfaAutomaton *dfa = newDfaAutomaton(str, len, maxDist);
+  dfa->refcount = 1;
+
+  pthread_mutex_lock(&dfaCache_g.lock);
+  key.str = dfa->str;
+  int rc;
+  it = kh_put(dfaCache, dfaCache_g.h, key, &rc);
+  // if another thread has cached the same automaton meanwhile, we just don't cache ours
+  if (rc != 0) {
+    kh_val(dfaCache_g.h, it) = dfa;
+    dfa->refcount++;
+    dfaCache_PushFront(dfa);
+    if (kh_size(dfaCache_g.h) > DFA_CACHE_SIZE) {
+      dfaCache_EvictLast();
+    }
+  }
+  pthread_mutex_unlock(&dfaCache_g.lock);
+  return dfa;
+}
+
+void DFA_Release(dfaAutomaton *dfa) {
+  pthread_mutex_lock(&dfaCache_g.lock);
+  int last = --dfa->refcount == 0;
+  pthread_mutex_unlock(&dfaCache_g.lock);
+  if (last) {
+    dfaAutomaton_Free(dfa);
+  }
+}
+
+DFAFilter NewDFAFilter(rune *str, size_t len, int maxDist, int prefixMode) {
+  dfaAutomaton *dfa = DFA_Get(str, len, maxDist);
 
   DFAFilter ret;
-  ret.cache = cache;
+  ret.dfa = dfa;
   ret.stack = NewVector(dfaNode *, 8);
   ret.distStack = NewVector(int, 8);
-  ret.a = a;
+  // the automaton owns a copy of the string, so the filter does not depend on the caller's
+  ret.a = NewSparseAutomaton(dfa->str, len, maxDist);
   ret.prefixMode = prefixMode;
-  Vector_Push(ret.stack, dr);
+  Vector_Push(ret.stack, dfa->root);
   Vector_Push(ret.distStack, (maxDist + 1));
 
   return ret;
 }
 
 void DFAFilter_Free(DFAFilter *fc) {
-  for (int i = 0; i < Vector_Size(fc->cache); i++) {
-    dfaNode *dn;
-    Vector_Get(fc->cache, i, &dn);
-
-    if (dn) __dfaNode_free(dn);
-  }
-
-  Vector_Free(fc->cache);
+  DFA_Release(fc->dfa);
   Vector_Free(fc->stack);
   Vector_Free(fc->distStack);
 }
@@ -249,7 +397,7 @@ FilterCode FilterFunc(rune b, void *ctx, int *matched, void *matchCtx) {
   rune foldedRune = runeFold(b);
 
   // get the next state change
-  dfaNode *next = __dfn_getEdge(dn, foldedRune);
+  dfaNode *next = __dfn_getEdge(fc->dfa, dn, foldedRune);
   if (!next) next = dn->fallback;
 
   // we can continue - push the state on the stack
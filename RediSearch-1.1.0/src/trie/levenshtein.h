@@ -20,33 +20,56 @@ typedef struct {
     int max;
 } SparseAutomaton;
 
-struct dfaEdge; 
-
 /* dfaNode is DFA graph node constructed using the Levenshtein automaton */
 typedef struct dfaNode {
     int distance;
 
     int match;
     sparseVector *v;
-    struct dfaEdge *edges;
-    size_t numEdges;
+    // the transitions of the node, indexed by the position of the rune in the automaton's alphabet.
+    // NULL means the fallback transition applies
+    struct dfaNode **edges;
     struct dfaNode *fallback;
 } dfaNode;
 
-typedef struct dfaEdge {
-    dfaNode *n;
-    rune r;
-} dfaEdge;
+/* The maximal number of compiled automata we keep for reuse */
+#define DFA_CACHE_SIZE 128
 
-/* Get an edge for a dfa node given the next rune */
-dfaNode *__dfn_getEdge(dfaNode *n, rune r);
+/* dfaAutomaton is a compiled DFA for a query string and maximal distance. It is immutable once
+ * built, and shared between all the filters of the same query through a global LRU cache */
+typedef struct dfaAutomaton {
+    // a copy of the query string
+    rune *str;
+    size_t len;
+    int maxDist;
+
+    // the distinct runes of the query, sorted. Node transitions are indexed by position in it
+    rune *alphabet;
+    size_t alphabetSize;
 
+    dfaNode *root;
+    // all the nodes of the automaton, for freeing it
+    dfaNode **nodes;
+    size_t numNodes;
+
+    // the number of filters using the automaton, plus one while it is in the cache
+    int refcount;
+    // the LRU list links, most recently used first
+    struct dfaAutomaton *prev, *next;
+} dfaAutomaton;
+
+/* Get an edge for a dfa node given the next rune */
+dfaNode *__dfn_getEdge(dfaAutomaton *dfa, dfaNode *n, rune r);
 
 /* Create a new DFA node */
 dfaNode *__newDfaNode(int distance, sparseVector *state);
 
-/* Recusively build the DFA node and all its descendants */
-void dfa_build(dfaNode *parent, SparseAutomaton *a, Vector *cache);
+/* Compile a DFA for a string and maximal distance, or get it from the cache if it was recently
+ * compiled. The returned automaton should be released with DFA_Release */
+dfaAutomaton *DFA_Get(const rune *str, size_t len, int maxDist);
+
+/* Release an automaton returned by DFA_Get */
+void DFA_Release(dfaAutomaton *dfa);
 
 /* Create a new Sparse Levenshtein Automaton  for string s and length len, with a maximal edit
  * distance of maxEdits */
@@ -66,8 +89,8 @@ int SparseAutomaton_CanMatch(SparseAutomaton *a, sparseVector *v);
 
 /* DFAFilter is a constructed DFA used to filter the traversal on the trie */
 typedef struct {
-    // a cache of the DFA states, allowing us to re-use the same state whenever we need it
-    Vector *cache;
+    // the compiled DFA of the query
+    dfaAutomaton *dfa;
     // A stack of the states leading up to the current state
     Vector *stack;
     // A stack of the minimal distance for each state, used for prefix matching
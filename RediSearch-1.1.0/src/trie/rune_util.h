@@ -25,4 +25,9 @@ rune *strToRunes(const char *str, size_t *len);
 /* Decode a string to a rune in-place */
 size_t strToRunesN(const char *s, size_t slen, rune *outbuf);
 
+/* The length of a rune when encoded as utf-8 */
+static inline size_t runeUtf8Len(rune r) {
+  return r < 0x80 ? 1 : r < 0x800 ? 2 : r < 0x10000 ? 3 : 4;
+}
+
 #endif
@@ -214,6 +214,11 @@ int TrieNode_Add(TrieNode **np, rune *str, t_len len, RSPayload *payload, float
 }
 
 float TrieNode_Find(TrieNode *n, rune *str, t_len len) {
+  n = TrieNode_Get(n, str, len);
+  return n && !__trieNode_isDeleted(n) ? n->score : 0;
+}
+
+TrieNode *TrieNode_Get(TrieNode *n, rune *str, t_len len) {
   t_len offset = 0;
   while (n && offset < len) {
     // printf("n %.*s offset %d, len %d\n", n->len, n->str, offset,
@@ -227,7 +232,7 @@ float TrieNode_Find(TrieNode *n, rune *str, t_len len) {
 
     if (offset == len) {
       // we're at the end of both strings!
-      if (localOffset == n->len) return __trieNode_isDeleted(n) ? 0 : n->score;
+      if (localOffset == n->len) return n;
 
     } else if (localOffset == n->len) {
       // we've reached the end of the node's string but not the search string
@@ -247,11 +252,11 @@ float TrieNode_Find(TrieNode *n, rune *str, t_len len) {
       n = nextChild;
 
     } else {
-      return 0;
+      return NULL;
     }
   }
 
-  return 0;
+  return NULL;
 }
 
 void __trieNode_sortChildren(TrieNode *n);
@@ -277,7 +282,7 @@ void __trieNode_optimizeChildren(TrieNode *n) {
       // just "fill" the hole with the next node up
       while (i < n->numChildren - 1) {
         nodes[i] = nodes[i + 1];
-        n->maxChildScore = MAX(n->maxChildScore, nodes[i]->maxChildScore);
+        n->maxChildScore = MAX(n->maxChildScore, MAX(nodes[i]->maxChildScore, nodes[i]->score));
         i++;
       }
       // reduce child count
@@ -289,7 +294,7 @@ void __trieNode_optimizeChildren(TrieNode *n) {
       if (nodes[i] && nodes[i]->numChildren == 1) {
         nodes[i] = __trieNode_MergeWithSingleChild(nodes[i]);
       }
-      n->maxChildScore = MAX(n->maxChildScore, nodes[i]->maxChildScore);
+      n->maxChildScore = MAX(n->maxChildScore, MAX(nodes[i]->maxChildScore, nodes[i]->score));
     }
     i++;
   }
@@ -315,7 +320,8 @@ int TrieNode_Delete(TrieNode *n, rune *str, t_len len) {
       // we're at the end of both strings!
       // this means we've found what we're looking for
       if (localOffset == n->len) {
-        if (!(n->flags & TRIENODE_DELETED)) {
+        // only terminal nodes hold strings. A deleted node is no longer terminal
+        if (__trieNode_isTerminal(n)) {
 
           n->flags |= TRIENODE_DELETED;
           n->flags &= ~TRIENODE_TERMINAL;
@@ -106,6 +106,10 @@ int TrieNode_Add(TrieNode **n, rune *str, t_len len, RSPayload *payload, float s
  * Note that you cannot put entries with zero score */
 float TrieNode_Find(TrieNode *n, rune *str, t_len len);
 
+/* Find the node holding exactly the given string, or NULL if there is none. The node is not
+ * necessarily terminal */
+TrieNode *TrieNode_Get(TrieNode *n, rune *str, t_len len);
+
 /* Mark a node as deleted. For simplicity for now we don't actually delete
  * anything,
  * but the node will not be persisted to disk, thus deleted after reload.
@@ -18,6 +18,11 @@ Trie *NewTrie() {
   rune *rs = strToRunes("", 0);
   tree->root = __newTrieNode(rs, 0, 0, NULL, 0, 0, 0, 0);
   tree->size = 0;
+  tree->completions = NULL;
+  tree->frozen = NULL;
+  tree->deltaSize = 0;
+  tree->compactRequested = 0;
+  tree->revision = 0;
   free(rs);
   return tree;
 }
@@ -59,6 +64,42 @@ static inline void runeBufFree(runeBuf *buf) {
   }
 }
 
+/* Get the score of a string, wherever it is, or 0 if it's not in the trie */
+static float trie_findScore(Trie *t, rune *runes, t_len len) {
+  float score = TrieNode_Find(t->root, runes, len);
+  if (!score && t->frozen) {
+    FrozenTrie_Find(t->frozen, runes, len, &score, NULL);
+  }
+  return score;
+}
+
+/* Get the payload of a string, wherever it is */
+static void trie_getPayload(Trie *t, rune *runes, t_len len, RSPayload *payload) {
+  TrieNode *n = TrieNode_Get(t->root, runes, len);
+  if (n && __trieNode_isTerminal(n) && !__trieNode_isDeleted(n)) {
+    payload->data = n->payload ? n->payload->data : NULL;
+    payload->len = n->payload ? n->payload->len : 0;
+  } else if (!t->frozen || !FrozenTrie_Find(t->frozen, runes, len, NULL, payload)) {
+    payload->data = NULL;
+    payload->len = 0;
+  }
+}
+
+/* Update a string that is in the frozen trie. Payloads cannot be changed there, so if the string
+ * has or gets one, it is moved to the delta - keeping its current payload if it gets no new one */
+static void trie_updateFrozen(Trie *t, rune *runes, t_len len, float score, RSPayload *curPayload,
+                              RSPayload *payload) {
+  int hasPayload = payload && payload->data && payload->len;
+  if (!curPayload->len && !hasPayload) {
+    FrozenTrie_SetScore(t->frozen, runes, len, score);
+  } else {
+    // deleting from the frozen trie only marks the string, so its payload is still readable
+    FrozenTrie_Delete(t->frozen, runes, len);
+    TrieNode_Add(&t->root, runes, len, hasPayload ? payload : curPayload, score, ADD_REPLACE);
+    t->deltaSize++;
+  }
+}
+
 int Trie_InsertStringBuffer(Trie *t, char *s, size_t len, double score, int incr,
                             RSPayload *payload) {
   if (len > TRIE_MAX_STRING_LEN * sizeof(rune)) {
@@ -69,8 +110,24 @@ int Trie_InsertStringBuffer(Trie *t, char *s, size_t len, double score, int incr
   int rc;
 
   if (runes && len && len < TRIE_MAX_STRING_LEN) {
-    rc = TrieNode_Add(&t->root, runes, len, payload, (float)score, incr ? ADD_INCR : ADD_REPLACE);
+    float cur;
+    RSPayload curPayload;
+    if (t->frozen && FrozenTrie_Find(t->frozen, runes, len, &cur, &curPayload)) {
+      // like adding to the delta, a zero score leaves the string as it is
+      if (score != 0) {
+        trie_updateFrozen(t, runes, len, incr ? cur + (float)score : (float)score, &curPayload,
+                          payload);
+      }
+      rc = 0;
+    } else {
+      rc = TrieNode_Add(&t->root, runes, len, payload, (float)score, incr ? ADD_INCR : ADD_REPLACE);
+      t->deltaSize += rc;
+    }
     t->size += rc;
+    t->revision += rc;
+    if (t->completions) {
+      TrieCompletions_Update(t->completions, runes, len, trie_findScore(t, runes, len));
+    }
   } else {
     rc = 0;
   }
@@ -86,11 +143,127 @@ int Trie_Delete(Trie *t, char *s, size_t len) {
     return 0;
   }
   int rc = TrieNode_Delete(t->root, runes, len);
+  if (!rc && t->frozen) {
+    rc = FrozenTrie_Delete(t->frozen, runes, len);
+  }
   t->size -= rc;
+  t->revision += rc;
+  if (rc && t->completions) {
+    TrieCompletions_Update(t->completions, runes, len, 0);
+  }
   free(runes);
   return rc;
 }
 
+int Trie_NeedsCompaction(Trie *t) {
+  size_t threshold = MAX(TRIE_COMPACT_MIN_DELTA, t->size * TRIE_COMPACT_RATIO);
+  if (t->deltaSize < threshold ||
+      (t->compactRequested && t->deltaSize < 2 * t->compactRequested)) {
+    return 0;
+  }
+  t->compactRequested = t->deltaSize;
+  return 1;
+}
+
+typedef struct {
+  rune *str;
+  t_len len;
+  float score;
+  RSPayload payload;
+} compactEntry;
+
+static int cmpRunes(const rune *s1, t_len len1, const rune *s2, t_len len2) {
+  for (t_len i = 0; i < len1 && i < len2; i++) {
+    if (s1[i] != s2[i]) return s1[i] < s2[i] ? -1 : 1;
+  }
+  return (int)len1 - (int)len2;
+}
+
+static int cmpCompactEntries(const void *p1, const void *p2) {
+  const compactEntry *e1 = p1, *e2 = p2;
+  return cmpRunes(e1->str, e1->len, e2->str, e2->len);
+}
+
+typedef struct {
+  FrozenTrieBuilder *builder;
+  // the sorted strings of the delta, merged into the frozen trie's strings as they are walked
+  compactEntry *delta;
+  size_t numDelta;
+  size_t pos;
+} compactCtx;
+
+static inline void compact_addDelta(compactCtx *cc) {
+  compactEntry *e = &cc->delta[cc->pos++];
+  FrozenTrieBuilder_Add(cc->builder, e->str, e->len, e->score, e->payload.data, e->payload.len);
+}
+
+static void compact_mergeFrozen(const rune *str, t_len len, float score, RSPayload *payload,
+                                void *ctx) {
+  compactCtx *cc = ctx;
+  int cmp = -1;
+  while (cc->pos < cc->numDelta &&
+         (cmp = cmpRunes(cc->delta[cc->pos].str, cc->delta[cc->pos].len, str, len)) < 0) {
+    compact_addDelta(cc);
+  }
+  if (cc->pos < cc->numDelta && cmp == 0) {
+    // should not happen, but the delta is the newer one
+    compact_addDelta(cc);
+    return;
+  }
+  FrozenTrieBuilder_Add(cc->builder, str, len, score, payload->data, payload->len);
+}
+
+void Trie_Compact(Trie *t) {
+  size_t cap = MAX(t->deltaSize, 1);
+  compactCtx cc = {.builder = NewFrozenTrieBuilder(),
+                   .delta = malloc(cap * sizeof(compactEntry)),
+                   .numDelta = 0,
+                   .pos = 0};
+
+  // collect the delta's strings. Payloads point into its nodes, which we free only when done
+  TrieIterator *it = TrieNode_Iterate(t->root, NULL, NULL, NULL);
+  rune *rstr;
+  t_len len;
+  float score;
+  RSPayload payload = {.data = NULL, .len = 0};
+  while (TrieIterator_Next(it, &rstr, &len, &payload, &score, NULL)) {
+    if (cc.numDelta == cap) {
+      cap *= 2;
+      cc.delta = realloc(cc.delta, cap * sizeof(compactEntry));
+    }
+    compactEntry *e = &cc.delta[cc.numDelta++];
+    e->str = malloc(len * sizeof(rune));
+    memcpy(e->str, rstr, len * sizeof(rune));
+    e->len = len;
+    e->score = score;
+    e->payload = payload;
+  }
+  TrieIterator_Free(it);
+  qsort(cc.delta, cc.numDelta, sizeof(compactEntry), cmpCompactEntries);
+
+  if (t->frozen) {
+    FrozenTrie_Walk(t->frozen, compact_mergeFrozen, &cc);
+  }
+  while (cc.pos < cc.numDelta) {
+    compact_addDelta(&cc);
+  }
+  FrozenTrie *frozen = FrozenTrieBuilder_Finish(cc.builder);
+
+  for (size_t i = 0; i < cc.numDelta; i++) {
+    free(cc.delta[i].str);
+  }
+  free(cc.delta);
+  FrozenTrie_Free(t->frozen);
+  t->frozen = frozen;
+
+  TrieNode_Free(t->root);
+  rune *rs = strToRunes("", 0);
+  t->root = __newTrieNode(rs, 0, 0, NULL, 0, 0, 0, 0);
+  free(rs);
+  t->deltaSize = 0;
+  t->compactRequested = 0;
+}
+
 void TrieSearchResult_Free(TrieSearchResult *e) {
   if (e->str) {
     free(e->str);
@@ -113,119 +286,219 @@ static int cmpEntries(const void *p1, const void *p2, const void *udata) {
 }
 
 TrieIterator *Trie_IteratePrefix(Trie *t, char *prefix, size_t len, int maxDist) {
+  return Trie_Iterate(t, prefix, len, maxDist, 1);
+}
+
+TrieIterator *Trie_Iterate(Trie *t, const char *str, size_t len, int maxDist, int prefixMode) {
   size_t rlen;
-  rune *runes = strToFoldedRunes(prefix, &rlen);
+  rune *runes = strToFoldedRunes((char *)str, &rlen);
   if (!runes || rlen > TRIE_MAX_PREFIX) {
     return NULL;
   }
   DFAFilter *fc = malloc(sizeof(*fc));
-  *fc = NewDFAFilter(runes, rlen, maxDist, 1);
+  *fc = NewDFAFilter(runes, rlen, maxDist, prefixMode);
 
   TrieIterator *it = TrieNode_Iterate(t->root, FilterFunc, StackPop, fc);
   free(runes);
   return it;
 }
 
-Vector *Trie_Search(Trie *tree, char *s, size_t len, size_t num, int maxDist, int prefixMode,
-                    int trim, int optimize) {
+typedef struct {
+  heap_t *pq;
+  TrieSearchResult *pooledEntry;
+  // the folded query and its length in bytes
+  rune *runes;
+  size_t rlen;
+  size_t len;
+  int maxDist;
+  int prefixMode;
+  // the minimal score of the results in the heap, once it is full
+  float minScore;
+} trieSearchCtx;
+
+/* Offer a match to the search's heap of top results */
+static void trie_searchOffer(trieSearchCtx *sc, rune *rstr, t_len slen, RSPayload *payload,
+                             float score, int dist) {
+  if (sc->pooledEntry == NULL) {
+    sc->pooledEntry = malloc(sizeof(TrieSearchResult));
+    sc->pooledEntry->str = NULL;
+    sc->pooledEntry->payload = NULL;
+    sc->pooledEntry->plen = 0;
+  }
+  TrieSearchResult *ent = sc->pooledEntry;
 
-  if (len > TRIE_MAX_PREFIX * sizeof(rune)) {
-    return NULL;
+  // in prefix mode we also factor in the total length of the suffix
+  if (sc->prefixMode) {
+    ent->score = TrieCompletion_Rank(sc->runes, sc->rlen, sc->len, rstr, slen, score);
+  } else {
+    ent->score = slen > 0 && slen == sc->rlen && memcmp(sc->runes, rstr, slen * sizeof(rune)) == 0
+                     ? INT_MAX
+                     : score;
   }
-  size_t rlen;
-  rune *runes = strToFoldedRunes(s, &rlen);
-  // make sure query length does not overflow
-  if (!runes || rlen >= TRIE_MAX_PREFIX) {
-    free(runes);
-    return NULL;
+
+  if (sc->maxDist > 0) {
+    // factor the distance into the score
+    ent->score *= exp((double)-(2 * dist));
   }
 
-  heap_t *pq = malloc(heap_sizeof(num));
-  heap_init(pq, cmpEntries, NULL, num);
+  heap_t *pq = sc->pq;
+  if (heap_count(pq) < heap_size(pq)) {
+    ent->str = runesToStr(rstr, slen, &ent->len);
+    ent->payload = payload->data;
+    ent->plen = payload->len;
+    heap_offerx(pq, ent);
+    sc->pooledEntry = NULL;
+
+    if (heap_count(pq) == heap_size(pq)) {
+      TrieSearchResult *qe = heap_peek(pq);
+      sc->minScore = qe->score;
+    }
+
+  } else {
+    if (ent->score >= sc->minScore) {
+      sc->pooledEntry = heap_poll(pq);
+      free(sc->pooledEntry->str);
+      sc->pooledEntry->str = NULL;
+      ent->str = runesToStr(rstr, slen, &ent->len);
+      ent->payload = payload->data;
+      ent->plen = payload->len;
+      heap_offerx(pq, ent);
+
+      // get the new minimal score
+      TrieSearchResult *qe = heap_peek(pq);
+      if (qe->score > sc->minScore) {
+        sc->minScore = qe->score;
+      }
+    }
+  }
+}
+
+/* Traverse the trie for the top num matches of the folded runes, and return them in a vector sorted
+ * by descending score */
+static Vector *trie_searchTraverse(Trie *tree, rune *runes, size_t rlen, size_t len, size_t num,
+                                   int maxDist, int prefixMode) {
+  trieSearchCtx sc = {.pq = malloc(heap_sizeof(num)),
+                      .pooledEntry = NULL,
+                      .runes = runes,
+                      .rlen = rlen,
+                      .len = len,
+                      .maxDist = maxDist,
+                      .prefixMode = prefixMode,
+                      .minScore = 0};
+  heap_init(sc.pq, cmpEntries, NULL, num);
 
   DFAFilter fc = NewDFAFilter(runes, rlen, maxDist, prefixMode);
 
-  TrieIterator *it = TrieNode_Iterate(tree->root, FilterFunc, StackPop, &fc);
-  // TrieIterator *it = TrieNode_Iterate(tree->root,NULL, NULL, NULL);
   rune *rstr;
   t_len slen;
   float score;
   RSPayload payload = {.data = NULL, .len = 0};
-
-  TrieSearchResult *pooledEntry = NULL;
   int dist = maxDist + 1;
+
+  TrieIterator *it = TrieNode_Iterate(tree->root, FilterFunc, StackPop, &fc);
   while (TrieIterator_Next(it, &rstr, &slen, &payload, &score, &dist)) {
-    if (pooledEntry == NULL) {
-      pooledEntry = malloc(sizeof(TrieSearchResult));
-      pooledEntry->str = NULL;
-      pooledEntry->payload = NULL;
-      pooledEntry->plen = 0;
+    trie_searchOffer(&sc, rstr, slen, &payload, score, dist);
+    it->minScore = sc.minScore;
+  }
+  TrieIterator_Free(it);
+
+  // the filter is back at its initial state, so we can run it on the frozen trie as well
+  if (tree->frozen) {
+    FrozenTrieIterator *fit = FrozenTrie_Iterate(tree->frozen, FilterFunc, StackPop, &fc);
+    fit->minScore = sc.minScore;
+    while (FrozenTrieIterator_Next(fit, &rstr, &slen, &payload, &score, &dist)) {
+      trie_searchOffer(&sc, rstr, slen, &payload, score, dist);
+      fit->minScore = sc.minScore;
     }
-    TrieSearchResult *ent = pooledEntry;
+    FrozenTrieIterator_Free(fit);
+  }
 
-    ent->score = slen > 0 && slen == rlen && memcmp(runes, rstr, slen) == 0 ? INT_MAX : score;
+  if (sc.pooledEntry) {
+    TrieSearchResult_Free(sc.pooledEntry);
+  }
 
-    if (maxDist > 0) {
-      // factor the distance into the score
-      ent->score *= exp((double)-(2 * dist));
-    }
-    // in prefix mode we also factor in the total length of the suffix
-    if (prefixMode) {
-      ent->score /= sqrt(1 + (slen >= len ? slen - len : len - slen));
-    }
+  // put the results from the heap on a vector to return
+  size_t n = MIN(heap_count(sc.pq), num);
+  Vector *ret = NewVector(TrieSearchResult *, n);
+  for (int i = 0; i < n; ++i) {
+    TrieSearchResult *h = heap_poll(sc.pq);
+    Vector_Put(ret, n - i - 1, h);
+  }
 
-    if (heap_count(pq) < heap_size(pq)) {
-      ent->str = runesToStr(rstr, slen, &ent->len);
-      ent->payload = payload.data;
-      ent->plen = payload.len;
-      heap_offerx(pq, ent);
-      pooledEntry = NULL;
+  DFAFilter_Free(&fc);
+  heap_free(sc.pq);
+  return ret;
+}
 
-      if (heap_count(pq) == heap_size(pq)) {
-        TrieSearchResult *qe = heap_peek(pq);
-        it->minScore = qe->score;
-      }
+/* Get the top completions of a folded prefix from the completions cache, filling it by traversing
+ * the trie on a miss */
+static Vector *trie_searchCompletions(Trie *tree, rune *runes, size_t rlen, size_t len,
+                                      size_t num) {
+  if (!tree->completions) {
+    tree->completions = NewTrieCompletions();
+  }
 
-    } else {
-      if (ent->score >= it->minScore) {
-        pooledEntry = heap_poll(pq);
-        free(pooledEntry->str);
-        pooledEntry->str = NULL;
-        ent->str = runesToStr(rstr, slen, &ent->len);
-        ent->payload = payload.data;
-        ent->plen = payload.len;
-        heap_offerx(pq, ent);
-
-        // get the new minimal score
-        TrieSearchResult *qe = heap_peek(pq);
-        if (qe->score > it->minScore) {
-          it->minScore = qe->score;
-        }
-
-      } else {
-        pooledEntry = ent;
-      }
+  const TrieCompletionList *l = TrieCompletions_Get(tree->completions, runes, rlen);
+  if (!l) {
+    Vector *top = trie_searchTraverse(tree, runes, rlen, len, TRIE_COMPLETIONS_K, 0, 1);
+    TrieCompletionList *nl = TrieCompletions_Put(tree->completions, runes, rlen);
+    for (size_t i = 0; i < Vector_Size(top); i++) {
+      TrieSearchResult *h;
+      Vector_Get(top, i, &h);
+      size_t slen;
+      rune *str = strToRunes(h->str, &slen);
+      TrieCompletionList_Add(nl, str, slen, h->score);
+      free(str);
+      TrieSearchResult_Free(h);
     }
-
-    // dist = maxDist + 3;
+    Vector_Free(top);
+    l = nl;
   }
 
-  if (pooledEntry) {
-    TrieSearchResult_Free(pooledEntry);
+  size_t n = MIN(l->num, num);
+  Vector *ret = NewVector(TrieSearchResult *, n);
+  for (size_t i = 0; i < n; i++) {
+    const TrieCompletion *c = &l->entries[i];
+    TrieSearchResult *ent = malloc(sizeof(*ent));
+    ent->str = runesToStr(c->str, c->len, &ent->len);
+    ent->score = c->rank;
+    // payloads are not cached, as the nodes holding them may be reallocated
+    RSPayload payload;
+    trie_getPayload(tree, c->str, c->len, &payload);
+    ent->payload = payload.data;
+    ent->plen = payload.len;
+    Vector_Push(ret, ent);
   }
+  return ret;
+}
 
-  // printf("Nodes consumed: %d/%d (%.02f%%)\n", it->nodesConsumed,
-  //        it->nodesConsumed + it->nodesSkipped,
-  //        100.0 * (float)(it->nodesConsumed) / (float)(it->nodesConsumed +
-  //        it->nodesSkipped));
+Vector *Trie_Search(Trie *tree, char *s, size_t len, size_t num, int maxDist, int prefixMode,
+                    int trim, int optimize) {
 
-  // put the results from the heap on a vector to return
-  size_t n = MIN(heap_count(pq), num);
-  Vector *ret = NewVector(TrieSearchResult *, n);
-  for (int i = 0; i < n; ++i) {
-    TrieSearchResult *h = heap_poll(pq);
-    Vector_Put(ret, n - i - 1, h);
+  if (len > TRIE_MAX_PREFIX * sizeof(rune)) {
+    return NULL;
+  }
+  size_t rlen;
+  rune *runes = strToFoldedRunes(s, &rlen);
+  // make sure query length does not overflow
+  if (!runes || rlen >= TRIE_MAX_PREFIX) {
+    free(runes);
+    return NULL;
+  }
+
+  // Exact prefix searches are served from the completions cache. The ranking depends on the
+  // query's byte length, so we only use it if folding did not change it
+  size_t foldedLen = 0;
+  for (size_t i = 0; i < rlen; i++) {
+    foldedLen += runeUtf8Len(runes[i]);
   }
+  Vector *ret;
+  if (prefixMode && maxDist == 0 && rlen > 0 && num <= TRIE_COMPLETIONS_K && foldedLen == len) {
+    ret = trie_searchCompletions(tree, runes, rlen, len, num);
+  } else {
+    ret = trie_searchTraverse(tree, runes, rlen, len, num, maxDist, prefixMode);
+  }
+  size_t n = Vector_Size(ret);
 
   // trim the results to remove irrelevant results
   if (trim) {
@@ -251,10 +524,6 @@ Vector *Trie_Search(Trie *tree, char *s, size_t len, size_t num, int maxDist, in
   }
 
   free(runes);
-  TrieIterator_Free(it);
-  DFAFilter_Free(&fc);
-  heap_free(pq);
-
   return ret;
 }
 
@@ -290,13 +559,9 @@ int Trie_RandomKey(Trie *t, char **str, t_len *len, double *score) {
 /* declaration of the type for redis registration. */
 RedisModuleType *TrieType;
 
-void *TrieType_RdbLoad(RedisModuleIO *rdb, int encver) {
-  if (encver > TRIE_ENCVER_CURRENT) {
-    return NULL;
-  }
-  return TrieType_GenericLoad(rdb, encver > TRIE_ENCVER_NOPAYLOADS);
-}
-void *TrieType_GenericLoad(RedisModuleIO *rdb, int loadPayloads) {
+/* Load a trie. If compact is set, the trie is compacted as it is loaded, whenever the loaded delta
+ * is as large as the frozen trie, so we never hold the whole dictionary in TrieNodes */
+static Trie *trie_load(RedisModuleIO *rdb, int loadPayloads, int compact) {
 
   uint64_t elements = RedisModule_LoadUnsigned(rdb);
   Trie *tree = NewTrie();
@@ -314,52 +579,82 @@ void *TrieType_GenericLoad(RedisModuleIO *rdb, int loadPayloads) {
     Trie_InsertStringBuffer(tree, str, len - 1, score, 0, payload.len ? &payload : NULL);
     RedisModule_Free(str);
     if (payload.data != NULL) RedisModule_Free(payload.data);
+
+    if (compact && tree->deltaSize >= MAX(TRIE_COMPACT_MIN_DELTA, tree->size - tree->deltaSize)) {
+      Trie_Compact(tree);
+    }
+  }
+  if (compact && tree->deltaSize >= TRIE_COMPACT_MIN_DELTA) {
+    Trie_Compact(tree);
   }
   // TrieNode_Print(tree->root, 0, 0);
   return tree;
 }
 
+void *TrieType_RdbLoad(RedisModuleIO *rdb, int encver) {
+  if (encver > TRIE_ENCVER_CURRENT) {
+    return NULL;
+  }
+  return trie_load(rdb, encver > TRIE_ENCVER_NOPAYLOADS, 1);
+}
+
+void *TrieType_GenericLoad(RedisModuleIO *rdb, int loadPayloads) {
+  return trie_load(rdb, loadPayloads, 0);
+}
+
 void TrieType_RdbSave(RedisModuleIO *rdb, void *value) {
   TrieType_GenericSave(rdb, (Trie *)value, 1);
 }
 
+static void trie_saveEntry(RedisModuleIO *rdb, rune *rstr, t_len len, float score,
+                           RSPayload *payload, int savePayloads) {
+  size_t slen = 0;
+  char *s = runesToStr(rstr, len, &slen);
+  RedisModule_SaveStringBuffer(rdb, s, slen + 1);
+  RedisModule_SaveDouble(rdb, (double)score);
+
+  if (savePayloads) {
+    // save an extra space for the null terminator to make the payload null terminated on load
+    if (payload->data != NULL && payload->len > 0) {
+      RedisModule_SaveStringBuffer(rdb, payload->data, payload->len + 1);
+    } else {
+      // If there's no payload - we save an empty string
+      RedisModule_SaveStringBuffer(rdb, "", 1);
+    }
+  }
+  // TODO: Save a marker for empty payload!
+  free(s);
+}
+
 void TrieType_GenericSave(RedisModuleIO *rdb, Trie *tree, int savePayloads) {
   RedisModule_SaveUnsigned(rdb, tree->size);
   RedisModuleCtx *ctx = RedisModule_GetContextFromIO(rdb);
   RedisModule_Log(ctx, "notice", "Trie: saving %zd nodes.", tree->size);
   int count = 0;
+  rune *rstr;
+  t_len len;
+  float score;
+  RSPayload payload = {.data = NULL, .len = 0};
   if (tree->root) {
     TrieIterator *it = TrieNode_Iterate(tree->root, NULL, NULL, NULL);
-    rune *rstr;
-    t_len len;
-    float score;
-    RSPayload payload = {.data = NULL, .len = 0};
-
     while (TrieIterator_Next(it, &rstr, &len, &payload, &score, NULL)) {
-      size_t slen = 0;
-      char *s = runesToStr(rstr, len, &slen);
-      RedisModule_SaveStringBuffer(rdb, s, slen + 1);
-      RedisModule_SaveDouble(rdb, (double)score);
-
-      if (savePayloads) {
-        // save an extra space for the null terminator to make the payload null terminated on load
-        if (payload.data != NULL && payload.len > 0) {
-          RedisModule_SaveStringBuffer(rdb, payload.data, payload.len + 1);
-        } else {
-          // If there's no payload - we save an empty string
-          RedisModule_SaveStringBuffer(rdb, "", 1);
-        }
-      }
-      // TODO: Save a marker for empty payload!
-      free(s);
+      trie_saveEntry(rdb, rstr, len, score, &payload, savePayloads);
       count++;
     }
-    if (count != tree->size) {
-      RedisModule_Log(ctx, "warning", "Trie: saving %zd nodes actually iterated only %zd nodes",
-                      tree->size, count);
-    }
     TrieIterator_Free(it);
   }
+  if (tree->frozen) {
+    FrozenTrieIterator *it = FrozenTrie_Iterate(tree->frozen, NULL, NULL, NULL);
+    while (FrozenTrieIterator_Next(it, &rstr, &len, &payload, &score, NULL)) {
+      trie_saveEntry(rdb, rstr, len, score, &payload, savePayloads);
+      count++;
+    }
+    FrozenTrieIterator_Free(it);
+  }
+  if (count != tree->size) {
+    RedisModule_Log(ctx, "warning", "Trie: saving %zd nodes actually iterated only %zd nodes",
+                    tree->size, count);
+  }
 }
 
 void TrieType_Digest(RedisModuleDigest *digest, void *value) {
@@ -372,6 +667,8 @@ void TrieType_Free(void *value) {
 
     TrieNode_Free(tree->root);
   }
+  TrieCompletions_Free(tree->completions);
+  FrozenTrie_Free(tree->frozen);
 
   RedisModule_Free(tree);
 }
@@ -5,6 +5,8 @@
 
 #include "trie.h"
 #include "levenshtein.h"
+#include "completions.h"
+#include "frozen_trie.h"
 
 extern RedisModuleType *TrieType;
 
@@ -14,6 +16,18 @@ extern RedisModuleType *TrieType;
 typedef struct { //ǰ׺
   TrieNode *root; //ͷڵ
   size_t size; //ǰ׺Ԫظͷڵ
+  // cached top completions of searched prefixes. NULL until the first prefix search
+  TrieCompletions *completions;
+  // a compact copy of the trie as of its last compaction. Each string is either there or in root,
+  // which only holds the strings added since. NULL if the trie was never compacted
+  FrozenTrie *frozen;
+  // the number of strings added to root since the last compaction
+  size_t deltaSize;
+  // the delta size when compaction was last requested, see Trie_NeedsCompaction
+  size_t compactRequested;
+  // incremented whenever a string is added or deleted, but not when scores change. Used to
+  // invalidate cached prefix expansions
+  uint64_t revision;
 } Trie;
 
 typedef struct {
@@ -26,6 +40,11 @@ typedef struct {
 
 #define SCORE_TRIM_FACTOR 10.0
 
+/* A trie is compacted once the strings added since its last compaction reach this ratio of its size,
+ * and at least TRIE_COMPACT_MIN_DELTA strings */
+#define TRIE_COMPACT_RATIO 0.125
+#define TRIE_COMPACT_MIN_DELTA 1000
+
 Trie *NewTrie();
 int Trie_Insert(Trie *t, RedisModuleString *s, double score, int incr, RSPayload *payload);
 int Trie_InsertStringBuffer(Trie *t, char *s, size_t len, double score, int incr,
@@ -37,12 +56,25 @@ void TrieSearchResult_Free(TrieSearchResult *e);
 Vector *Trie_Search(Trie *tree, char *s, size_t len, size_t num, int maxDist, int prefixMode,
                     int trim, int optimize);
 
+/* Check whether enough strings were added to the trie to compact it. Once this returns 1 it does not
+ * return 1 again until the trie is compacted, or the number of added strings doubles */
+int Trie_NeedsCompaction(Trie *t);
+
+/* Merge the strings added since the last compaction into a new frozen trie. Used for suggestion
+ * dictionaries, which are large and mostly read */
+void Trie_Compact(Trie *t);
+
 /* Iterate a prefix in the trie, using maxDist edit distance, returning a trie iterator that the
- * caller needs to free */
+ * caller needs to free. This only covers strings that were not compacted, and is used on the index
+ * terms trie which is never compacted */
 TrieIterator *Trie_IteratePrefix(Trie *t, char *prefix, size_t len, int maxDist);
 
+/* Like Trie_IteratePrefix, but if prefixMode is 0 only whole strings within maxDist of str are
+ * matched. The iterator's filter context is a DFAFilter the caller frees along with the iterator */
+TrieIterator *Trie_Iterate(Trie *t, const char *str, size_t len, int maxDist, int prefixMode);
+
 /* Get a random key from the trie, and put the node's score in the score pointer. Returns 0 if the
- * trie is empty and we cannot do that */
+ * trie is empty and we cannot do that. Like Trie_IteratePrefix, compacted strings are not covered */
 int Trie_RandomKey(Trie *t, char **str, t_len *len, double *score);
 /* Commands related to the redis TrieType registration */
 int TrieType_Register(RedisModuleCtx *ctx);
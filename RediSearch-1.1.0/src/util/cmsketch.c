@@ -0,0 +1,134 @@
+#include <math.h>
+#include <string.h>
+#include "cmsketch.h"
+
+/* Sanity limit for deserialized and user requested sketches - 64MB of counters */
+#define CMS_MAX_COUNTERS (1 << 24)
+
+/** Serialized sketch format */
+typedef struct __attribute__((packed)) {
+  uint32_t flags;  // Currently unused
+  uint32_t width;
+  uint32_t depth;
+  uint64_t total;
+  // followed by width * depth uint32 counters
+} CMSSerializedHeader;
+
+CMSketch *NewCMSketch(uint32_t width, uint32_t depth) {
+  if (!width || !depth || (uint64_t)width * depth > CMS_MAX_COUNTERS) {
+    return NULL;
+  }
+  CMSketch *cms = malloc(sizeof(*cms));
+  cms->width = width;
+  cms->depth = depth;
+  cms->total = 0;
+  cms->counters = calloc((size_t)width * depth, sizeof(uint32_t));
+  return cms;
+}
+
+int CMS_DimensionsByError(double error, double delta, uint32_t *width, uint32_t *depth) {
+  if (!(error > 0 && error < 1 && delta > 0 && delta < 1)) {
+    return 0;
+  }
+  // check the dimensions as doubles first, tiny values would overflow them
+  double w = ceil(M_E / error), d = ceil(log(1 / delta));
+  if (w * d > CMS_MAX_COUNTERS) {
+    return 0;
+  }
+  *width = (uint32_t)w;
+  *depth = (uint32_t)d;
+  return 1;
+}
+
+CMSketch *NewCMSketchByError(double error, double delta) {
+  uint32_t width, depth;
+  if (!CMS_DimensionsByError(error, delta, &width, &depth)) {
+    return NULL;
+  }
+  return NewCMSketch(width, depth);
+}
+
+void CMS_Free(CMSketch *cms) {
+  if (!cms) return;
+  free(cms->counters);
+  free(cms);
+}
+
+/* We derive the hash of each row from the two halves of the value's hash (Kirsch-Mitzenmacher) */
+static inline uint32_t cms_pos(uint32_t width, uint64_t hash, uint32_t row) {
+  uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32);
+  return row * width + (h1 + row * h2) % width;
+}
+
+void CMS_Add(CMSketch *cms, uint64_t hash, uint32_t count) {
+  for (uint32_t i = 0; i < cms->depth; i++) {
+    cms->counters[cms_pos(cms->width, hash, i)] += count;
+  }
+  cms->total += count;
+}
+
+uint32_t CMS_Query(const CMSketch *cms, uint64_t hash) {
+  uint32_t ret = UINT32_MAX;
+  for (uint32_t i = 0; i < cms->depth; i++) {
+    uint32_t c = cms->counters[cms_pos(cms->width, hash, i)];
+    if (c < ret) ret = c;
+  }
+  return ret;
+}
+
+int CMS_Merge(CMSketch *dst, const CMSketch *src) {
+  if (dst->width != src->width || dst->depth != src->depth) {
+    return 0;
+  }
+  for (size_t i = 0; i < (size_t)dst->width * dst->depth; i++) {
+    dst->counters[i] += src->counters[i];
+  }
+  dst->total += src->total;
+  return 1;
+}
+
+char *CMS_Serialize(const CMSketch *cms, size_t *len) {
+  CMSSerializedHeader hdr = {
+      .flags = 0, .width = cms->width, .depth = cms->depth, .total = cms->total};
+  size_t sz = (size_t)cms->width * cms->depth * sizeof(uint32_t);
+  *len = sizeof(hdr) + sz;
+  char *buf = malloc(*len);
+  memcpy(buf, &hdr, sizeof(hdr));
+  memcpy(buf + sizeof(hdr), cms->counters, sz);
+  return buf;
+}
+
+/* Read the header of a serialized sketch, checking that the buffer holds all its counters */
+static int cms_readHeader(const char *buf, size_t len, CMSSerializedHeader *hdr) {
+  if (len < sizeof(*hdr)) return 0;
+  memcpy(hdr, buf, sizeof(*hdr));
+  if (!hdr->width || !hdr->depth || (uint64_t)hdr->width * hdr->depth > CMS_MAX_COUNTERS) {
+    return 0;
+  }
+  return len == sizeof(*hdr) + (size_t)hdr->width * hdr->depth * sizeof(uint32_t);
+}
+
+CMSketch *CMS_Deserialize(const char *buf, size_t len) {
+  CMSSerializedHeader hdr;
+  if (!cms_readHeader(buf, len, &hdr)) return NULL;
+
+  CMSketch *cms = NewCMSketch(hdr.width, hdr.depth);
+  size_t sz = (size_t)hdr.width * hdr.depth * sizeof(uint32_t);
+  memcpy(cms->counters, buf + sizeof(hdr), sz);
+  cms->total = hdr.total;
+  return cms;
+}
+
+int CMS_QuerySerialized(const char *buf, size_t len, uint64_t hash, uint32_t *count) {
+  CMSSerializedHeader hdr;
+  if (!cms_readHeader(buf, len, &hdr)) return 0;
+
+  const char *counters = buf + sizeof(hdr);
+  *count = UINT32_MAX;
+  for (uint32_t i = 0; i < hdr.depth; i++) {
+    uint32_t c;
+    memcpy(&c, counters + (size_t)cms_pos(hdr.width, hash, i) * sizeof(c), sizeof(c));
+    if (c < *count) *count = c;
+  }
+  return 1;
+}
@@ -0,0 +1,52 @@
+#ifndef RS_CMSKETCH_H_
+#define RS_CMSKETCH_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* A count-min sketch, estimating the frequency of values in a stream using a fixed amount of
+ * memory. Estimates are never lower than the true count, and with probability 1 - delta they
+ * exceed it by at most error * the total count.
+ *
+ * Sketches of the same dimensions can be merged and serialized. Values are added and queried by
+ * their 64 bit hash */
+
+#define CMS_DEFAULT_ERROR 0.01
+#define CMS_DEFAULT_DELTA 0.01
+
+typedef struct {
+  uint32_t width;
+  uint32_t depth;
+  uint64_t total;
+  uint32_t *counters;
+} CMSketch;
+
+CMSketch *NewCMSketch(uint32_t width, uint32_t depth);
+
+/* Compute the dimensions of a sketch for the given relative error and failure probability.
+ * Returns 0 if they are out of range, or the sketch would be too big */
+int CMS_DimensionsByError(double error, double delta, uint32_t *width, uint32_t *depth);
+
+/* Create a sketch sized for the given relative error and failure probability */
+CMSketch *NewCMSketchByError(double error, double delta);
+
+void CMS_Add(CMSketch *cms, uint64_t hash, uint32_t count);
+
+uint32_t CMS_Query(const CMSketch *cms, uint64_t hash);
+
+/* Add the counts of src to dst. Returns 0 if the dimensions do not match */
+int CMS_Merge(CMSketch *dst, const CMSketch *src);
+
+/* Serialize the sketch into a malloc'ed buffer, putting its length in len */
+char *CMS_Serialize(const CMSketch *cms, size_t *len);
+
+/* Load a serialized sketch. Returns NULL if the buffer is not a valid sketch */
+CMSketch *CMS_Deserialize(const char *buf, size_t len);
+
+/* Query a serialized sketch in place, without loading it. Puts the estimated count in count, and
+ * returns 0 if the buffer is not a valid sketch */
+int CMS_QuerySerialized(const char *buf, size_t len, uint64_t hash, uint32_t *count);
+
+void CMS_Free(CMSketch *cms);
+
+#endif
@@ -0,0 +1,214 @@
+#include <math.h>
+#include <string.h>
+#include <sys/param.h>
+#include "tdigest.h"
+
+typedef struct {
+  double mean;
+  double weight;
+} Centroid;
+
+struct TDigest {
+  double compression;
+  Centroid *centroids;
+  size_t len;
+  size_t cap;
+  // we never grow beyond this, but compress instead
+  size_t maxCap;
+  // number of centroids added since the last compression
+  size_t unmerged;
+  double total;
+  double min;
+  double max;
+};
+
+/** Serialized digest format */
+typedef struct __attribute__((packed)) {
+  uint32_t flags;  // Currently unused
+  double compression;
+  double min;
+  double max;
+  uint32_t len;
+  // followed by len pairs of (mean, weight)
+} TDigestSerializedHeader;
+
+TDigest *NewTDigest(double compression) {
+  if (compression < 10) compression = 10;
+  TDigest *td = calloc(1, sizeof(*td));
+  td->compression = compression;
+  td->maxCap = (size_t)(6 * compression) + 10;
+  td->min = INFINITY;
+  td->max = -INFINITY;
+  return td;
+}
+
+void TD_Free(TDigest *td) {
+  if (!td) return;
+  free(td->centroids);
+  free(td);
+}
+
+/* The k1 scale function, mapping a quantile to the centroid index space. Centroids may only span
+ * one unit of k, which keeps them small at the tails */
+static inline double td_k(double compression, double q) {
+  return compression / (2 * M_PI) * asin(2 * q - 1);
+}
+
+static inline double td_kInverse(double compression, double k) {
+  if (k >= compression / 4) return 1;
+  return (sin(k * 2 * M_PI / compression) + 1) / 2;
+}
+
+static int centroidCmp(const void *a, const void *b) {
+  double ma = ((const Centroid *)a)->mean, mb = ((const Centroid *)b)->mean;
+  return ma < mb ? -1 : ma > mb ? 1 : 0;
+}
+
+/* Sort the centroids and merge neighbors as long as they fit in the scale function's bounds */
+static void td_compress(TDigest *td) {
+  if (!td->unmerged) return;
+  td->unmerged = 0;
+  if (td->len <= 1) return;
+
+  qsort(td->centroids, td->len, sizeof(Centroid), centroidCmp);
+
+  Centroid *c = td->centroids;
+  size_t n = 0;
+  double wSoFar = 0;
+  double wLimit = td->total * td_kInverse(td->compression, td_k(td->compression, 0) + 1);
+  for (size_t i = 1; i < td->len; i++) {
+    if (wSoFar + c[n].weight + c[i].weight <= wLimit) {
+      c[n].weight += c[i].weight;
+      c[n].mean += (c[i].mean - c[n].mean) * c[i].weight / c[n].weight;
+    } else {
+      wSoFar += c[n].weight;
+      wLimit = td->total *
+               td_kInverse(td->compression, td_k(td->compression, wSoFar / td->total) + 1);
+      c[++n] = c[i];
+    }
+  }
+  td->len = n + 1;
+}
+
+static void td_addCentroid(TDigest *td, double mean, double weight) {
+  if (td->len == td->cap && td->cap >= td->maxCap) {
+    // compress even if nothing was added since the last compression - a deserialized digest may
+    // start out full
+    td->unmerged = td->len;
+    td_compress(td);
+  }
+  if (td->len == td->cap) {
+    // if the centroids could not be merged, we have to grow past the maximal capacity
+    td->cap = td->cap < td->maxCap ? MIN(MAX(td->cap * 2, 16), td->maxCap) : td->cap + 16;
+    td->centroids = realloc(td->centroids, td->cap * sizeof(Centroid));
+  }
+  td->centroids[td->len++] = (Centroid){.mean = mean, .weight = weight};
+  td->total += weight;
+  td->unmerged++;
+}
+
+void TD_Add(TDigest *td, double val, double weight) {
+  if (isnan(val) || weight <= 0) return;
+  td_addCentroid(td, val, weight);
+  if (val < td->min) td->min = val;
+  if (val > td->max) td->max = val;
+}
+
+void TD_Merge(TDigest *dst, const TDigest *src) {
+  for (size_t i = 0; i < src->len; i++) {
+    td_addCentroid(dst, src->centroids[i].mean, src->centroids[i].weight);
+  }
+  if (src->min < dst->min) dst->min = src->min;
+  if (src->max > dst->max) dst->max = src->max;
+}
+
+double TD_Count(const TDigest *td) {
+  return td->total;
+}
+
+double TD_Quantile(TDigest *td, double q) {
+  if (td->len == 0) return NAN;
+  td_compress(td);
+
+  Centroid *c = td->centroids;
+  size_t n = td->len;
+  if (n == 1 || q <= 0) return n == 1 ? c[0].mean : td->min;
+  if (q >= 1) return td->max;
+
+  double index = q * td->total;
+  // the first and last centroids are interpolated against the extremes
+  if (index < c[0].weight / 2) {
+    return td->min + 2 * index / c[0].weight * (c[0].mean - td->min);
+  }
+
+  double wSoFar = c[0].weight / 2;
+  for (size_t i = 0; i < n - 1; i++) {
+    double dw = (c[i].weight + c[i + 1].weight) / 2;
+    if (wSoFar + dw > index) {
+      double z1 = index - wSoFar;
+      double z2 = wSoFar + dw - index;
+      return (c[i].mean * z2 + c[i + 1].mean * z1) / (z1 + z2);
+    }
+    wSoFar += dw;
+  }
+
+  double z = index - wSoFar;
+  double half = c[n - 1].weight / 2;
+  return c[n - 1].mean + (half > 0 ? z / half : 0) * (td->max - c[n - 1].mean);
+}
+
+char *TD_Serialize(TDigest *td, size_t *len) {
+  td_compress(td);
+  TDigestSerializedHeader hdr = {.flags = 0,
+                                 .compression = td->compression,
+                                 .min = td->min,
+                                 .max = td->max,
+                                 .len = (uint32_t)td->len};
+  *len = sizeof(hdr) + td->len * sizeof(Centroid);
+  char *buf = malloc(*len);
+  memcpy(buf, &hdr, sizeof(hdr));
+  memcpy(buf + sizeof(hdr), td->centroids, td->len * sizeof(Centroid));
+  return buf;
+}
+
+/* Check that deserialized centroids are what compression leaves behind: finite means in order
+ * between min and max, with finite positive weights. Returns 0 if they aren't */
+static int td_validCentroids(const Centroid *cs, size_t len, double min, double max) {
+  if (len == 0) return 1;
+  if (!(min <= cs[0].mean) || !(max >= cs[len - 1].mean)) return 0;
+  for (size_t i = 0; i < len; i++) {
+    if (!isfinite(cs[i].mean) || !isfinite(cs[i].weight) || cs[i].weight <= 0) return 0;
+    if (i > 0 && cs[i].mean < cs[i - 1].mean) return 0;
+  }
+  return 1;
+}
+
+TDigest *TD_Deserialize(const char *buf, size_t len) {
+  TDigestSerializedHeader hdr;
+  if (len < sizeof(hdr)) return NULL;
+  memcpy(&hdr, buf, sizeof(hdr));
+  if (!(hdr.compression >= 10 && hdr.compression <= 100000) ||
+      len != sizeof(hdr) + (size_t)hdr.len * sizeof(Centroid)) {
+    return NULL;
+  }
+
+  TDigest *td = NewTDigest(hdr.compression);
+  if (hdr.len > td->maxCap) {
+    TD_Free(td);
+    return NULL;
+  }
+  td->cap = MAX(hdr.len, 16);
+  td->centroids = malloc(td->cap * sizeof(Centroid));
+  memcpy(td->centroids, buf + sizeof(hdr), hdr.len * sizeof(Centroid));
+  if (!td_validCentroids(td->centroids, hdr.len, hdr.min, hdr.max)) {
+    TD_Free(td);
+    return NULL;
+  }
+  td->len = hdr.len;
+  for (size_t i = 0; i < td->len; i++) {
+    td->total += td->centroids[i].weight;
+  }
+  td->min = hdr.min;
+  td->max = hdr.max;
+  return td;
+}
@@ -0,0 +1,42 @@
+#ifndef RS_TDIGEST_H_
+#define RS_TDIGEST_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* A merging t-digest (Dunning & Ertl) for approximate quantiles.
+ *
+ * The digest keeps at most ~6 * compression weighted centroids, sized so that the centroids near
+ * the tails are small and accurate, and those around the median are larger. Memory is bounded by
+ * the compression regardless of the number of values added, and is only allocated as needed, so
+ * small groups stay small.
+ *
+ * Digests can be merged and serialized, so partial digests can be sent between shards and cursor
+ * reads and combined later on */
+
+#define TDIGEST_DEFAULT_COMPRESSION 100
+
+typedef struct TDigest TDigest;
+
+TDigest *NewTDigest(double compression);
+
+void TD_Add(TDigest *td, double val, double weight);
+
+/* Add all the values of src into dst. src is not modified */
+void TD_Merge(TDigest *dst, const TDigest *src);
+
+/* Return the estimated value at quantile q, between 0 and 1. Returns NAN for an empty digest */
+double TD_Quantile(TDigest *td, double q);
+
+/* The total weight (number of values) added to the digest */
+double TD_Count(const TDigest *td);
+
+/* Serialize the digest into a malloc'ed buffer, putting its length in len */
+char *TD_Serialize(TDigest *td, size_t *len);
+
+/* Load a serialized digest. Returns NULL if the buffer is not a valid digest */
+TDigest *TD_Deserialize(const char *buf, size_t len);
+
+void TD_Free(TDigest *td);
+
+#endif